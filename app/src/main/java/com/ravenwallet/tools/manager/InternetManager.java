@@ -8,6 +8,8 @@ import android.net.ConnectivityManager;
 import android.net.NetworkInfo;
 import android.util.Log;
 
+import com.ravenwallet.wallet.WalletsMaster;
+
 import java.util.ArrayList;
 import java.util.List;
 
@@ -69,6 +71,7 @@ public class InternetManager extends BroadcastReceiver {
             NetworkInfo networkInfo = intent.getParcelableExtra(ConnectivityManager.EXTRA_NETWORK_INFO);
             if (networkInfo != null && networkInfo.getDetailedState() == NetworkInfo.DetailedState.CONNECTED) {
                 connected = true;
+                WalletsMaster.getInstance(context).updateMeteredSync(context);
 //                WalletsMaster.getInstance(context).getCurrentWallet(context).getPeerManager().connect();
                 Log.e(TAG, "onReceive: core connecting");
             } else if (networkInfo != null && networkInfo.getDetailedState() == NetworkInfo.DetailedState.DISCONNECTED) {
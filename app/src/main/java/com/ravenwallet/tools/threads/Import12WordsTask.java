@@ -13,6 +13,7 @@ import com.ravenwallet.core.BRCoreKey;
 import com.ravenwallet.core.BRCoreTransaction;
 import com.ravenwallet.core.BRCoreTransactionInput;
 import com.ravenwallet.core.BRCoreTransactionOutput;
+import com.ravenwallet.core.BRCoreWallet;
 import com.ravenwallet.presenter.activities.settings.ImportActivity;
 import com.ravenwallet.presenter.customviews.BRDialogView;
 import com.ravenwallet.tools.animation.BRDialog;
@@ -27,6 +28,7 @@ import com.ravenwallet.wallet.RvnWalletManager;
 import java.math.BigDecimal;
 import java.util.ArrayList;
 import java.util.List;
+import java.util.concurrent.CountDownLatch;
 
 import static com.ravenwallet.tools.util.BRConstants.SEQUENCE_EXTERNAL_CHAIN;
 import static com.ravenwallet.tools.util.BRConstants.SEQUENCE_INTERNAL_CHAIN;
@@ -80,10 +82,7 @@ public class Import12WordsTask extends AsyncTask<Void, Void, Void> {
 
     @Override
     protected Void doInBackground(Void... voids) {
-        if (ImportActivity.BIP32.equals(bipToUse))
-            fetchUtxosBip32(phrase, 0);
-        else
-            fetchUtxosBip44(phrase, 0);
+        fetchUtxos(phrase, ImportActivity.BIP32.equals(bipToUse));
         return null;
     }
 
@@ -173,14 +172,19 @@ public class Import12WordsTask extends AsyncTask<Void, Void, Void> {
         return transaction;
     }
 
-    private void fetchUtxosBip44(byte[] phrase, int index) {
-        if (countFails > 20) {
-            countFails = 0;
-            return;
-        }
+    private void fetchUtxos(byte[] phrase, boolean bip32) {
+        int index = 0;
+        KeyDerivation derivation = new KeyDerivation(phrase, index, chain, bip32);
+
+        while (countFails <= 20) {
+            BRCoreKey privKey = derivation.await();
+            if (privKey == null) break;
+
+            // derive the next key on the native worker pool while this one's address is looked up
+            int nextChain = chain == SEQUENCE_EXTERNAL_CHAIN ? SEQUENCE_INTERNAL_CHAIN : SEQUENCE_EXTERNAL_CHAIN;
+            int nextIndex = (nextChain == SEQUENCE_EXTERNAL_CHAIN) ? (index + 1) : index;
+            derivation = new KeyDerivation(phrase, nextIndex, nextChain, bip32);
 
-        BRCoreKey privKey = rvnWalletManager.getWallet().generatePrivateKeyBip44(phrase, index, chain);
-        if (privKey != null) {
             String address = privKey.address();
             boolean isUsed = BRApiManager.isAddressUsed(context, address);
             if (isUsed) {
@@ -190,44 +194,50 @@ public class Import12WordsTask extends AsyncTask<Void, Void, Void> {
                     mKeys.add(privKey);
                     mListUtxos.addAll(listUtxo);
                 }
-                chain = chain == SEQUENCE_EXTERNAL_CHAIN ? SEQUENCE_INTERNAL_CHAIN : SEQUENCE_EXTERNAL_CHAIN;
-                int nextIndex = (chain == SEQUENCE_EXTERNAL_CHAIN) ? (index + 1) : index;
-                fetchUtxosBip44(phrase, nextIndex);
             } else {
                 countFails = countFails + 1;
-                chain = chain == SEQUENCE_EXTERNAL_CHAIN ? SEQUENCE_INTERNAL_CHAIN : SEQUENCE_EXTERNAL_CHAIN;
-                int nextIndex = (chain == SEQUENCE_EXTERNAL_CHAIN) ? (index + 1) : index;
-                fetchUtxosBip44(phrase, nextIndex);
             }
+            chain = nextChain;
+            index = nextIndex;
         }
+        derivation.cancel();
+        countFails = 0;
     }
 
-    private void fetchUtxosBip32(byte[] phrase, int index) {
-        if (countFails > 20) {
-            countFails = 0;
-            return;
+    /**
+     * A private key derived with generatePrivateKeyBip44Async()/generatePrivateKeyBip32Async().
+     */
+    private class KeyDerivation implements BRCoreWallet.OperationListener {
+        private final CountDownLatch done = new CountDownLatch(1);
+        private final long operationId = BRCoreWallet.newOperationId();
+        private BRCoreKey key;
+
+        KeyDerivation(byte[] phrase, int index, int chain, boolean bip32) {
+            if (bip32)
+                rvnWalletManager.getWallet().generatePrivateKeyBip32Async(operationId, phrase, index, chain, this);
+            else
+                rvnWalletManager.getWallet().generatePrivateKeyBip44Async(operationId, phrase, index, chain, this);
         }
 
-        BRCoreKey privKey = rvnWalletManager.getWallet().generatePrivateKeyBip32(phrase, index, chain);
-        if (privKey != null) {
-            String address = privKey.address();
-            boolean isUsed = BRApiManager.isAddressUsed(context, address);
-            if (isUsed) {
-                this.countFails = 0;
-                List<ApiUTxo> listUtxo = BRApiManager.fetchUTXOS(context, address, false);
-                if (listUtxo != null) {
-                    mKeys.add(privKey);
-                    mListUtxos.addAll(listUtxo);
-                }
-                chain = chain == SEQUENCE_EXTERNAL_CHAIN ? SEQUENCE_INTERNAL_CHAIN : SEQUENCE_EXTERNAL_CHAIN;
-                int nextIndex = (chain == SEQUENCE_EXTERNAL_CHAIN) ? (index + 1) : index;
-                fetchUtxosBip32(phrase, nextIndex);
-            } else {
-                countFails = countFails + 1;
-                chain = chain == SEQUENCE_EXTERNAL_CHAIN ? SEQUENCE_INTERNAL_CHAIN : SEQUENCE_EXTERNAL_CHAIN;
-                int nextIndex = (chain == SEQUENCE_EXTERNAL_CHAIN) ? (index + 1) : index;
-                fetchUtxosBip32(phrase, nextIndex);
+        @Override
+        public void onOperationComplete(long operationId, Object result, boolean cancelled) {
+            key = (BRCoreKey) result;
+            done.countDown();
+        }
+
+        // returns the key, or null if the derivation was cancelled or the wait interrupted
+        BRCoreKey await() {
+            try {
+                done.await();
+            } catch (InterruptedException e) {
+                cancel();
+                return null;
             }
+            return key;
+        }
+
+        void cancel() {
+            BRCoreWallet.cancelOperation(operationId);
         }
     }
 }
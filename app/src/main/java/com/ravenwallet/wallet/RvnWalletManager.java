@@ -78,6 +78,7 @@ import com.ravenwallet.wallet.configs.WalletUiConfiguration;
 import org.json.JSONException;
 import org.json.JSONObject;
 
+import java.io.File;
 import java.math.BigDecimal;
 import java.util.ArrayList;
 import java.util.List;
@@ -113,6 +114,8 @@ public class RvnWalletManager extends BRCoreWalletManager implements BaseWalletM
     private boolean isBurnAsset = false;
     private int mSyncRetryCount = 0;
     private static final int SYNC_MAX_RETRY = 6;
+    private static final String SNAPSHOT_FILE_SUFFIX = "_peer_snapshot";
+    private boolean snapshotRestored;
 
     private boolean isInitiatingWallet;
 
@@ -283,6 +286,8 @@ public class RvnWalletManager extends BRCoreWalletManager implements BaseWalletM
         BRExecutor.getInstance().forBackgroundTasks().execute(new Runnable() {
             @Override
             public void run() {
+                restoreSnapshot(app);
+                getPeerManager().setMeteredSync(WalletsMaster.getInstance(app).isNetworkMetered(app), 0);
                 getPeerManager().connect();
             }
         });
@@ -290,6 +295,23 @@ public class RvnWalletManager extends BRCoreWalletManager implements BaseWalletM
         return true;
     }
 
+    private String getSnapshotPath(Context app) {
+        return app.getFilesDir().getAbsolutePath() + "/" + getIso(app) + SNAPSHOT_FILE_SUFFIX;
+    }
+
+    //resume from the last session's snapshot, only once and before the first connect()
+    private synchronized void restoreSnapshot(Context app) {
+        if (snapshotRestored || app == null) return;
+        snapshotRestored = true;
+        File file = new File(getSnapshotPath(app));
+        if (!file.exists()) return;
+        byte[] snapshot = BRKeyStore.readBytesFromFile(file.getAbsolutePath());
+        if (Utils.isNullOrEmpty(snapshot) || !getPeerManager().restoreSnapshot(snapshot)) {
+            Log.e(TAG, "restoreSnapshot: snapshot rejected, syncing from saved blocks");
+            file.delete();
+        }
+    }
+
 
     @Override
     public String getSymbol(Context app) {
@@ -391,6 +413,7 @@ public class RvnWalletManager extends BRCoreWalletManager implements BaseWalletM
         RvnTransactionDataStore.getInstance(app).deleteAllTransactions(app, getIso(app));
         MerkleBlockDataSource.getInstance(app).deleteAllBlocks(app, getIso(app));
         PeerDataSource.getInstance(app).deleteAllPeers(app, getIso(app));
+        new File(getSnapshotPath(app)).delete();
         AssetsRepository.getInstance(app).deleteAllAssets();
         AddressBookRepository.getInstance(app).deleteAll();
         BRSharedPrefs.clearAllPrefs(app);
@@ -692,6 +715,17 @@ public class RvnWalletManager extends BRCoreWalletManager implements BaseWalletM
 
     }
 
+    @Override
+    public void saveSnapshot(byte[] snapshot) {
+        super.saveSnapshot(snapshot);
+        Context app = RavenApp.getRvnContext();
+        if (app == null || Utils.isNullOrEmpty(snapshot)) return;
+        //write then rename, so a crash mid-write leaves the previous snapshot in place
+        String path = getSnapshotPath(app);
+        if (BRKeyStore.writeBytesToFile(path + ".tmp", snapshot) && !new File(path + ".tmp").renameTo(new File(path)))
+            Log.e(TAG, "saveSnapshot: failed to replace " + path);
+    }
+
     @Override
     public boolean networkIsReachable() {
         Context app = RavenApp.getRvnContext();
@@ -14,6 +14,7 @@ import com.ravenwallet.RavenApp;
 import com.ravenwallet.R;
 import com.ravenwallet.core.BRCoreKey;
 import com.ravenwallet.core.BRCoreMasterPubKey;
+import com.ravenwallet.core.BRCorePeerManager;
 import com.ravenwallet.presenter.customviews.BRDialogView;
 import com.ravenwallet.tools.animation.BRAnimator;
 import com.ravenwallet.tools.animation.BRDialog;
@@ -199,6 +200,23 @@ public class WalletsMaster {
 
     }
 
+    public boolean isNetworkMetered(Context ctx) {
+        if (ctx == null) return false;
+        ConnectivityManager cm = (ConnectivityManager) ctx.getSystemService(Context.CONNECTIVITY_SERVICE);
+        return cm.isActiveNetworkMetered();
+    }
+
+    /**
+     * Sync with less data while the active network is metered, called whenever it changes.
+     */
+    public void updateMeteredSync(Context ctx) {
+        boolean metered = isNetworkMetered(ctx);
+        for (BaseWalletManager wallet : mWallets) {
+            BRCorePeerManager peerManager = wallet.getPeerManager();
+            if (peerManager != null) peerManager.setMeteredSync(metered, 0);
+        }
+    }
+
     public void wipeWalletButKeystore(final Context ctx) {
         Log.d(TAG, "wipeWalletButKeystore");
         BRExecutor.getInstance().forLightWeightBackgroundTasks().execute(new Runnable() {
@@ -103,4 +103,30 @@ transactionAssetCopy (BRAsset *target,
     target->name = source->name;*/
 }
 
+extern uint8_t *
+getDirectBufferBytes (JNIEnv *env,
+                      jobject buffer,
+                      jint offset,
+                      jint length) {
+    uint8_t *bytes = (NULL == buffer) ? NULL : (*env)->GetDirectBufferAddress (env, buffer);
+    jlong capacity = (NULL == bytes) ? -1 : (*env)->GetDirectBufferCapacity (env, buffer);
+
+    if (NULL == bytes || offset < 0 || length < 0 || (jlong) offset + length > capacity) return NULL;
+    return &bytes[offset];
+}
+
+extern int
+getByteArrayExact (JNIEnv *env,
+                   jbyteArray array,
+                   void *bytes,
+                   size_t length) {
+    if (NULL == array || (size_t) (*env)->GetArrayLength (env, array) != length) {
+        jclass exceptionClass = (*env)->FindClass (env, "java/lang/IllegalArgumentException");
 
+        if (NULL != exceptionClass) (*env)->ThrowNew (env, exceptionClass, "unexpected byte array length");
+        return 0;
+    }
+
+    (*env)->GetByteArrayRegion (env, array, 0, (jsize) length, (jbyte *) bytes);
+    return 1;
+}
@@ -62,4 +62,31 @@ extern void
 transactionAssetCopy (BRAsset *target,
                        const BRAsset *source);
 
+/**
+ * The bytes of a direct ByteBuffer, read and written in place instead of copied across JNI.
+ *
+ * @param buffer a direct java.nio.ByteBuffer
+ * @param offset usually the buffer's position()
+ * @param length usually the buffer's remaining()
+ * @return the address of the length bytes at offset, or NULL if buffer isn't direct or is too
+ * small
+ */
+extern uint8_t *
+getDirectBufferBytes (JNIEnv *env,
+                      jobject buffer,
+                      jint offset,
+                      jint length);
+
+/**
+ * Copy exactly length bytes of a Java byte array into bytes.
+ *
+ * @return 1 on success, or 0 with an IllegalArgumentException pending if array doesn't hold
+ * exactly length bytes, in which case the caller must return to Java without further JNI calls
+ */
+extern int
+getByteArrayExact (JNIEnv *env,
+                   jbyteArray array,
+                   void *bytes,
+                   size_t length);
+
 #endif //COREJNI_BRCOREJVM_H
@@ -63,10 +63,11 @@ JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreAddress_createCoreAddres
     BRAddress *address = (BRAddress *) calloc (1, sizeof (BRAddress));
 
     size_t scriptLen = (size_t) (*env)->GetArrayLength (env, scriptByteArray);
-    const uint8_t *script = (const uint8_t *) (*env)->GetByteArrayElements (env, scriptByteArray, 0);
+    uint8_t *script = (uint8_t *) (*env)->GetPrimitiveArrayCritical (env, scriptByteArray, NULL);
 
     // TODO: Error handling
     BRAddressFromScriptPubKey(address->s, sizeof(address->s), script, scriptLen);
+    (*env)->ReleasePrimitiveArrayCritical (env, scriptByteArray, script, JNI_ABORT);
 
     return (jlong) address;
 }
@@ -81,10 +82,11 @@ JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreAddress_createCoreAddres
     BRAddress *address = (BRAddress *) calloc(1, sizeof(BRAddress));
 
     size_t scriptLen = (size_t) (*env)->GetArrayLength(env, scriptByteArray);
-    const uint8_t *script = (const uint8_t *) (*env)->GetByteArrayElements(env, scriptByteArray, 0);
+    uint8_t *script = (uint8_t *) (*env)->GetPrimitiveArrayCritical(env, scriptByteArray, NULL);
 
     // TODO: Error handling
     BRAddressFromScriptSig(address->s, sizeof(address->s), script, scriptLen);
+    (*env)->ReleasePrimitiveArrayCritical(env, scriptByteArray, script, JNI_ABORT);
 
     return (jlong) address;
 }
@@ -29,6 +29,7 @@
 #include <BRBIP39Mnemonic.h>
 #include <BRBIP38Key.h>
 #include <BRBIP44Sequence.h>
+#include <BRCrypto.h>
 #include "com_ravencoin_core_BRCoreKey.h"
 
 /*
@@ -132,13 +133,18 @@ JNIEXPORT jbyteArray JNICALL
 Java_com_ravenwallet_core_BRCoreKey_getSeedFromPhrase
         (JNIEnv *env, jclass thisClass, jbyteArray phrase) {
 
-    jbyte *bytePhrase = (*env)->GetByteArrayElements(env, phrase, 0);
+    size_t phraseLen = (size_t) (*env)->GetArrayLength(env, phrase);
+    char charPhrase[phraseLen + 1];
     UInt512 key = UINT512_ZERO;
-    char *charPhrase = (char *) bytePhrase;
+
+    (*env)->GetByteArrayRegion(env, phrase, 0, (jsize) phraseLen, (jbyte *) charPhrase);
+    charPhrase[phraseLen] = '\0';
     BRBIP39DeriveKey(key.u8, charPhrase, NULL);
+    mem_clean(charPhrase, sizeof(charPhrase));
 
     jbyteArray result = (*env)->NewByteArray(env, (jsize) sizeof(key));
     (*env)->SetByteArrayRegion(env, result, 0, (jsize) sizeof(key), (jbyte *) &key);
+    mem_clean(&key, sizeof(key));
 
     return result;
 }
@@ -151,12 +157,15 @@ Java_com_ravenwallet_core_BRCoreKey_getSeedFromPhrase
 JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreKey_getAuthPrivKeyForAPI
         (JNIEnv *env, jclass thisClass, jbyteArray seed) {
     //__android_log_print(ANDROID_LOG_DEBUG, "Message from C: ", "getAuthPrivKeyForAPI");
-    jbyte *bytesSeed = (*env)->GetByteArrayElements(env, seed, 0);
     size_t seedLen = (size_t) (*env)->GetArrayLength(env, seed);
+    uint8_t bytesSeed[seedLen];
     //__android_log_print(ANDROID_LOG_DEBUG, "Message from C: ", "seedLen: %d", (int) seedLen);
 
+    (*env)->GetByteArrayRegion(env, seed, 0, (jsize) seedLen, (jbyte *) bytesSeed);
+
     BRKey key;
     BRBIP32APIAuthKey(&key, bytesSeed, seedLen);
+    mem_clean(bytesSeed, seedLen);
     char rawKey[BRKeyPrivKey(&key, NULL, 0)];
     BRKeyPrivKey(&key, rawKey, sizeof(rawKey));
 
@@ -175,9 +184,14 @@ JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreKey_getAuthPrivKeyF
 JNIEXPORT jstring JNICALL Java_com_ravenwallet_core_BRCoreKey_getAuthPublicKeyForAPI
         (JNIEnv *env, jclass thisClass, jbyteArray privKey) {
     //__android_log_print(ANDROID_LOG_DEBUG, "Message from C: ", "getAuthPublicKeyForAPI");
-    jbyte *bytePrivKey = (*env)->GetByteArrayElements(env, privKey, 0);
+    size_t privKeyLen = (size_t) (*env)->GetArrayLength(env, privKey);
+    char bytePrivKey[privKeyLen + 1];
     BRKey key;
-    BRKeySetPrivKey(&key, (const char *) bytePrivKey);
+
+    (*env)->GetByteArrayRegion(env, privKey, 0, (jsize) privKeyLen, (jbyte *) bytePrivKey);
+    bytePrivKey[privKeyLen] = '\0';
+    BRKeySetPrivKey(&key, bytePrivKey);
+    mem_clean(bytePrivKey, sizeof(bytePrivKey));
 
     size_t len = BRKeyPubKey(&key, NULL, 0);
     uint8_t pubKey[len];
@@ -236,9 +250,11 @@ JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreKey_createCoreKeyForBIP3
     BRKey *key = (BRKey *) calloc (1, sizeof(BRKey));
 
     size_t seedLen = (size_t) (*env)->GetArrayLength (env, seedByteArray);
-    const void *seed = (const void *) (*env)->GetByteArrayElements (env, seedByteArray, 0);
+    uint8_t seed[seedLen];
 
+    (*env)->GetByteArrayRegion (env, seedByteArray, 0, (jsize) seedLen, (jbyte *) seed);
     BRBIP32PrivKey (key, seed, seedLen, (uint32_t) chain, (uint32_t) index);
+    mem_clean (seed, seedLen);
     return (jlong) key;
 }
 
@@ -268,10 +284,14 @@ Java_com_ravenwallet_core_BRCoreKey_setSecret
         (JNIEnv *env, jobject thisObject, jbyteArray secretByteArray, jboolean compressed) {
     BRKey *key = (BRKey *) getJNIReference(env, thisObject);
 
-    const char *secretKey = (const char *)
-            (*env)->GetByteArrayElements(env, secretByteArray, 0);
+    UInt256 secret;
+    int r;
 
-    return (jboolean) (1 == BRKeySetSecret(key, (const UInt256 *) secretKey, JNI_TRUE == compressed)
+    if (!getByteArrayExact(env, secretByteArray, &secret, sizeof(secret))) return JNI_FALSE;
+    r = BRKeySetSecret(key, &secret, JNI_TRUE == compressed);
+    var_clean(&secret);
+
+    return (jboolean) (1 == r
                        ? JNI_TRUE
                        : JNI_FALSE);
 }
@@ -286,8 +306,9 @@ Java_com_ravenwallet_core_BRCoreKey_compactSign
         (JNIEnv *env, jobject thisObject, jbyteArray dataByteArray) {
     BRKey *key = (BRKey *) getJNIReference(env, thisObject);
 
-    uint8_t *data = (uint8_t *) (*env)->GetByteArrayElements(env, dataByteArray, 0);
-    UInt256 md32 = UInt256Get(data);
+    UInt256 md32;
+
+    if (!getByteArrayExact(env, dataByteArray, &md32, sizeof(md32))) return NULL;
 
     size_t sigLen = BRKeyCompactSign(key, NULL, 0, md32);
     uint8_t compactSig[sigLen];
@@ -309,14 +330,13 @@ Java_com_ravenwallet_core_BRCoreKey_encryptNative
         (JNIEnv *env, jobject thisObject, jbyteArray dataByteArray, jbyteArray nonceByteArray) {
     BRKey *key = (BRKey *) getJNIReference(env, thisObject);
 
-    jbyte *data = (*env)->GetByteArrayElements(env, dataByteArray, NULL);
     jsize dataSize = (*env)->GetArrayLength(env, dataByteArray);
-
-    jbyte *nonce = (*env)->GetByteArrayElements(env, nonceByteArray, NULL);
-    jsize nonceSize = (*env)->GetArrayLength(env, nonceByteArray);
-
     uint8_t out[16 + dataSize];
 
+    // read in place, the cipher neither blocks nor calls back into the VM
+    jbyte *data = (*env)->GetPrimitiveArrayCritical(env, dataByteArray, NULL);
+    jbyte *nonce = (*env)->GetPrimitiveArrayCritical(env, nonceByteArray, NULL);
+
     size_t outSize = Chacha20Poly1305AEADEncrypt(out, sizeof(out), key,
                                                    (uint8_t *) nonce,
                                                    (uint8_t *) data,
@@ -324,12 +344,12 @@ Java_com_ravenwallet_core_BRCoreKey_encryptNative
                                                    NULL,
                                                    0);
 
+    (*env)->ReleasePrimitiveArrayCritical(env, nonceByteArray, nonce, JNI_ABORT);
+    (*env)->ReleasePrimitiveArrayCritical(env, dataByteArray, data, JNI_ABORT);
+
     jbyteArray result = (*env)->NewByteArray(env, (jsize) outSize);
     (*env)->SetByteArrayRegion(env, result, 0, (jsize) outSize, (const jbyte *) out);
 
-    (*env)->ReleaseByteArrayElements(env, dataByteArray, data, 0);
-    (*env)->ReleaseByteArrayElements(env, nonceByteArray, nonce, 0);
-
     return result;
 }
 
@@ -343,14 +363,13 @@ Java_com_ravenwallet_core_BRCoreKey_decryptNative
         (JNIEnv *env, jobject thisObject, jbyteArray dataByteArray, jbyteArray nonceByteArray) {
     BRKey *key = (BRKey *) getJNIReference(env, thisObject);
 
-    jbyte *data = (*env)->GetByteArrayElements(env, dataByteArray, NULL);
     jsize dataSize = (*env)->GetArrayLength(env, dataByteArray);
-
-    jbyte *nonce = (*env)->GetByteArrayElements(env, nonceByteArray, NULL);
-    jsize nonceSize = (*env)->GetArrayLength(env, nonceByteArray);
-
     uint8_t out[dataSize];
 
+    // read in place, the cipher neither blocks nor calls back into the VM
+    jbyte *data = (*env)->GetPrimitiveArrayCritical(env, dataByteArray, NULL);
+    jbyte *nonce = (*env)->GetPrimitiveArrayCritical(env, nonceByteArray, NULL);
+
     size_t outSize = Chacha20Poly1305AEADDecrypt(out, sizeof(out), key,
                                                    (uint8_t *) nonce,
                                                    (uint8_t *) data,
@@ -358,16 +377,62 @@ Java_com_ravenwallet_core_BRCoreKey_decryptNative
                                                    NULL,
                                                    0);
 
+    (*env)->ReleasePrimitiveArrayCritical(env, nonceByteArray, nonce, JNI_ABORT);
+    (*env)->ReleasePrimitiveArrayCritical(env, dataByteArray, data, JNI_ABORT);
+
     if (sizeof(out) == 0) return NULL;
 
     jbyteArray result = (*env)->NewByteArray(env, (jsize) outSize);
     (*env)->SetByteArrayRegion(env, result, 0, (jsize) outSize, (const jbyte *) out);
 
-    (*env)->ReleaseByteArrayElements(env, dataByteArray, data, 0);
-    (*env)->ReleaseByteArrayElements(env, nonceByteArray, nonce, 0);
-
     return result;
 }
+/*
+ * Class:     com_ravencoin_core_BRCoreKey
+ * Method:    jniEncryptDirect
+ * Signature: (Ljava/nio/ByteBuffer;II[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL
+Java_com_ravenwallet_core_BRCoreKey_jniEncryptDirect
+        (JNIEnv *env, jobject thisObject,
+         jobject dataBuffer, jint dataOffset, jint dataLength,
+         jbyteArray nonceByteArray,
+         jobject outBuffer, jint outOffset, jint outLength) {
+    BRKey *key = (BRKey *) getJNIReference(env, thisObject);
+    uint8_t *data = getDirectBufferBytes(env, dataBuffer, dataOffset, dataLength);
+    uint8_t *out = getDirectBufferBytes(env, outBuffer, outOffset, outLength);
+    uint8_t nonce[12];
+
+    if (NULL == data || NULL == out || (*env)->GetArrayLength(env, nonceByteArray) != sizeof(nonce)) return 0;
+    (*env)->GetByteArrayRegion(env, nonceByteArray, 0, sizeof(nonce), (jbyte *) nonce);
+
+    return (jint) Chacha20Poly1305AEADEncrypt(out, (size_t) outLength, key, nonce,
+                                              data, (size_t) dataLength, NULL, 0);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreKey
+ * Method:    jniDecryptDirect
+ * Signature: (Ljava/nio/ByteBuffer;II[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL
+Java_com_ravenwallet_core_BRCoreKey_jniDecryptDirect
+        (JNIEnv *env, jobject thisObject,
+         jobject dataBuffer, jint dataOffset, jint dataLength,
+         jbyteArray nonceByteArray,
+         jobject outBuffer, jint outOffset, jint outLength) {
+    BRKey *key = (BRKey *) getJNIReference(env, thisObject);
+    uint8_t *data = getDirectBufferBytes(env, dataBuffer, dataOffset, dataLength);
+    uint8_t *out = getDirectBufferBytes(env, outBuffer, outOffset, outLength);
+    uint8_t nonce[12];
+
+    if (NULL == data || NULL == out || (*env)->GetArrayLength(env, nonceByteArray) != sizeof(nonce)) return 0;
+    (*env)->GetByteArrayRegion(env, nonceByteArray, 0, sizeof(nonce), (jbyte *) nonce);
+
+    return (jint) Chacha20Poly1305AEADDecrypt(out, (size_t) outLength, key, nonce,
+                                              data, (size_t) dataLength, NULL, 0);
+}
+
 /*
  * Class:     com_ravencoin_core_BRCoreKey
  * Method:    address
@@ -447,11 +512,9 @@ Java_com_ravenwallet_core_BRCoreKey_sign
          jbyteArray messageDigestByteArray) {
     BRKey *key = (BRKey *) getJNIReference(env, thisObject);
 
-    size_t messageDigestLen = (size_t) (*env)->GetArrayLength (env, messageDigestByteArray);
-    assert (32 == messageDigestLen);
-    const uint8_t *messageDigest = (const uint8_t *) (*env)->GetByteArrayElements (env, messageDigestByteArray, 0);
+    UInt256 md;
 
-    UInt256 md = UInt256Get(messageDigest);
+    if (!getByteArrayExact (env, messageDigestByteArray, &md, sizeof (md))) return NULL;
 
     uint8_t signature[256];
     size_t signatureLen = BRKeySign(key, signature, sizeof(signature), md);
@@ -475,14 +538,17 @@ Java_com_ravenwallet_core_BRCoreKey_verify
          jbyteArray signatureByteArray) {
     BRKey *key = (BRKey *) getJNIReference(env, thisObject);
 
-    size_t messageDigestLen = (size_t) (*env)->GetArrayLength(env, messageDigestByteArray);
-    assert (32 == messageDigestLen);
-    UInt256 *messageDigest = (UInt256 *) (*env)->GetByteArrayElements(env, messageDigestByteArray, 0);
+    UInt256 messageDigest;
+
+    if (!getByteArrayExact(env, messageDigestByteArray, &messageDigest, sizeof(messageDigest))) return JNI_FALSE;
 
     size_t signatureLen = (size_t) (*env)->GetArrayLength(env, signatureByteArray);
-    const void *signature = (const void *) (*env)->GetByteArrayElements(env, signatureByteArray, 0);
+    uint8_t signature[72]; // the longest DER encoded signature
+
+    if (signatureLen > sizeof(signature)) return JNI_FALSE; // can't be a valid signature
+    (*env)->GetByteArrayRegion(env, signatureByteArray, 0, (jsize) signatureLen, (jbyte *) signature);
 
-    return (jboolean) (1 == BRKeyVerify(key, *messageDigest, signature, signatureLen)
+    return (jboolean) (1 == BRKeyVerify(key, messageDigest, signature, signatureLen)
                        ? JNI_TRUE
                        : JNI_FALSE);
 }
@@ -127,6 +127,22 @@ JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreKey_encryptNative
 JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreKey_decryptNative
   (JNIEnv *, jobject, jbyteArray, jbyteArray);
 
+/*
+ * Class:     com_ravencoin_core_BRCoreKey
+ * Method:    jniEncryptDirect
+ * Signature: (Ljava/nio/ByteBuffer;II[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreKey_jniEncryptDirect
+  (JNIEnv *, jobject, jobject, jint, jint, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreKey
+ * Method:    jniDecryptDirect
+ * Signature: (Ljava/nio/ByteBuffer;II[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreKey_jniDecryptDirect
+  (JNIEnv *, jobject, jobject, jint, jint, jbyteArray, jobject, jint, jint);
+
 /*
  * Class:     com_ravencoin_core_BRCoreKey
  * Method:    address
@@ -37,10 +37,11 @@ Java_com_ravenwallet_core_BRCoreMerkleBlock_createJniCoreMerkleBlock
          jint blockHeight) {
 
     int blockLength   = (*env)->GetArrayLength(env, blockArray);
-    jbyte *blockBytes = (*env)->GetByteArrayElements(env, blockArray, 0);
+    jbyte *blockBytes = (*env)->GetPrimitiveArrayCritical(env, blockArray, NULL);
 
     assert (NULL != blockBytes);
     BRMerkleBlock *block = BRMerkleBlockParse((const uint8_t *) blockBytes, (size_t) blockLength, NULL);
+    (*env)->ReleasePrimitiveArrayCritical(env, blockArray, blockBytes, JNI_ABORT);
     assert (NULL != block);
     if (blockHeight != -1)
         block->height = (uint32_t) blockHeight;
@@ -48,6 +49,36 @@ Java_com_ravenwallet_core_BRCoreMerkleBlock_createJniCoreMerkleBlock
     return (jlong) block;
 }
 
+/*
+ * Class:     com_ravencoin_core_BRCoreMerkleBlock
+ * Method:    createJniCoreMerkleBlockDirect
+ * Signature: (Ljava/nio/ByteBuffer;III[I)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCoreMerkleBlock_createJniCoreMerkleBlockDirect
+        (JNIEnv *env, jclass thisClass,
+         jobject buffer,
+         jint offset,
+         jint length,
+         jint blockHeight,
+         jintArray consumed) {
+    const uint8_t *blockBytes = getDirectBufferBytes(env, buffer, offset, length);
+    BRMerkleBlock *block = (NULL == blockBytes ? NULL
+                            : BRMerkleBlockParse(blockBytes, (size_t) length, NULL));
+    jint blockSize;
+
+    if (NULL == block) return 0;
+
+    // measured before the height is overwritten, KAWPOW headers carry their own height
+    blockSize = (jint) BRMerkleBlockSerializedSize(block);
+    (*env)->SetIntArrayRegion(env, consumed, 0, 1, &blockSize);
+
+    if (blockHeight != -1)
+        block->height = (uint32_t) blockHeight;
+
+    return (jlong) block;
+}
+
 /*
  * Class:     com_ravencoin_core_BRCoreMerkleBlock
  * Method:    createJniCoreMerkleBlockEmpty
@@ -196,16 +227,30 @@ JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreMerkleBlock_seriali
 
     size_t      byteArraySize     = BRMerkleBlockSerialize(block, NULL, 0);
     jbyteArray  byteArray         = (*env)->NewByteArray (env, (jsize) byteArraySize);
-    jbyte      *byteArrayElements = (*env)->GetByteArrayElements (env, byteArray, JNI_FALSE);
+    jbyte      *byteArrayElements = (*env)->GetPrimitiveArrayCritical (env, byteArray, NULL);
 
+    // Serialize straight into the array; no JNI calls until released
     BRMerkleBlockSerialize(block, (uint8_t *) byteArrayElements, byteArraySize);
-
-    // Ensure ELEMENTS 'written' back to byteArray
-    (*env)->ReleaseByteArrayElements (env, byteArray, byteArrayElements, JNI_COMMIT);
+    (*env)->ReleasePrimitiveArrayCritical (env, byteArray, byteArrayElements, 0);
 
     return byteArray;
 }
 
+/*
+ * Class:     com_ravencoin_core_BRCoreMerkleBlock
+ * Method:    jniSerializeDirect
+ * Signature: (Ljava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreMerkleBlock_jniSerializeDirect
+        (JNIEnv *env, jobject thisObject, jobject buffer, jint offset, jint length) {
+    BRMerkleBlock *block = (BRMerkleBlock *) getJNIReference(env, thisObject);
+    uint8_t *bytes = getDirectBufferBytes(env, buffer, offset, length);
+    size_t blockSize = BRMerkleBlockSerialize(block, NULL, 0);
+
+    if (NULL == bytes || blockSize > (size_t) length) return 0;
+    return (jint) BRMerkleBlockSerialize(block, bytes, (size_t) length);
+}
+
 
 /*
  * Class:     com_ravencoin_core_BRCoreMerkleBlock
@@ -229,8 +274,10 @@ Java_com_ravenwallet_core_BRCoreMerkleBlock_containsTransactionHash
         (JNIEnv *env, jobject thisObject, jbyteArray hashByteArray) {
     BRMerkleBlock *block = (BRMerkleBlock *) getJNIReference(env, thisObject);
 
-    UInt256 *hash = (UInt256 *) (*env)->GetByteArrayElements (env, hashByteArray, JNI_FALSE);
-    return (jboolean) MerkleBlockContainsTxHash (block, *hash);
+    UInt256 hash;
+
+    (*env)->GetByteArrayRegion (env, hashByteArray, 0, (jsize) sizeof (hash), (jbyte *) &hash);
+    return (jboolean) MerkleBlockContainsTxHash (block, hash);
 }
 
 /*
@@ -15,6 +15,14 @@ extern "C" {
 JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreMerkleBlock_createJniCoreMerkleBlock
   (JNIEnv *, jclass, jbyteArray, jint);
 
+/*
+ * Class:     com_ravencoin_core_BRCoreMerkleBlock
+ * Method:    createJniCoreMerkleBlockDirect
+ * Signature: (Ljava/nio/ByteBuffer;III[I)J
+ */
+JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreMerkleBlock_createJniCoreMerkleBlockDirect
+  (JNIEnv *, jclass, jobject, jint, jint, jint, jintArray);
+
 /*
  * Class:     com_ravencoin_core_BRCoreMerkleBlock
  * Method:    createJniCoreMerkleBlockEmpty
@@ -103,6 +111,14 @@ JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreMerkleBlock_getHeight
 JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreMerkleBlock_serialize
   (JNIEnv *, jobject);
 
+/*
+ * Class:     com_ravencoin_core_BRCoreMerkleBlock
+ * Method:    jniSerializeDirect
+ * Signature: (Ljava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreMerkleBlock_jniSerializeDirect
+  (JNIEnv *, jobject, jobject, jint, jint);
+
 /*
  * Class:     com_ravencoin_core_BRCoreMerkleBlock
  * Method:    isValid
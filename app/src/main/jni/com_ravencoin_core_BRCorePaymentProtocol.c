@@ -255,12 +255,12 @@ JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRequ
     BRPaymentProtocolRequest *request =
             (BRPaymentProtocolRequest *) getJNIReference(env, thisObject);
 
-    size_t digestCount = BRPaymentProtocolRequestDigest (request, NULL, 0);
-    jbyteArray digestData = (*env)->NewByteArray (env, digestCount);
-    uint8_t *digest = (uint8_t *) (*env)->GetByteArrayElements (env, digestData, 0);
+    // The digest is computed once and cached by the request; this copies it out.
+    uint8_t digest[256/8];
+    size_t digestCount = BRPaymentProtocolRequestDigest (request, digest, sizeof (digest));
 
-    BRPaymentProtocolRequestDigest (request, digest, digestCount);
-    (*env)->SetByteArrayRegion (env, digestData, 0, digestCount, (const jbyte *) digest);
+    jbyteArray digestData = (*env)->NewByteArray (env, (jsize) digestCount);
+    (*env)->SetByteArrayRegion (env, digestData, 0, (jsize) digestCount, (const jbyte *) digest);
     return digestData;
 }
 
@@ -274,9 +274,7 @@ JNIEXPORT jobjectArray JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRe
     BRPaymentProtocolRequest *request =
             (BRPaymentProtocolRequest *) getJNIReference(env, thisObject);
 
-    size_t numberOfCerts = 0;
-    while (0 != BRPaymentProtocolRequestCert (request, NULL, 0, numberOfCerts))
-        numberOfCerts++;
+    size_t numberOfCerts = BRPaymentProtocolRequestCertCount (request);
 
     jbyteArray byteArray  = (*env)->NewByteArray (env, 0);
     jclass byteArrayClass = (*env)->GetObjectClass (env, byteArray);
@@ -286,11 +284,13 @@ JNIEXPORT jobjectArray JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRe
 
     for (size_t index = 0; index < numberOfCerts; index++) {
         size_t certLen = (size_t) BRPaymentProtocolRequestCert (request, NULL, 0, index);
-        jbyteArray certByteArray = (*env)->NewByteArray (env, (jsize) certLen);
-        uint8_t *certData = (uint8_t *) (*env)->GetByteArrayElements (env, certByteArray, 0);
+        uint8_t *certData = (uint8_t *) malloc (certLen);
 
         BRPaymentProtocolRequestCert (request, certData, certLen, index);
+
+        jbyteArray certByteArray = (*env)->NewByteArray (env, (jsize) certLen);
         (*env)->SetByteArrayRegion (env, certByteArray, 0, (jsize) certLen, (jbyte *) certData);
+        free (certData);
 
         (*env)->SetObjectArrayElement (env, result, (jsize) index, certByteArray);
         (*env)->DeleteLocalRef (env, certByteArray);
@@ -300,6 +300,32 @@ JNIEXPORT jobjectArray JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRe
 
 }
 
+/*
+ * Class:     com_ravencoin_core_BRCorePaymentProtocolRequest
+ * Method:    getVerified
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRequest_getVerified
+        (JNIEnv *env, jobject thisObject) {
+    BRPaymentProtocolRequest *request =
+            (BRPaymentProtocolRequest *) getJNIReference(env, thisObject);
+
+    return (jint) BRPaymentProtocolRequestVerified (request);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCorePaymentProtocolRequest
+ * Method:    setVerified
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRequest_setVerified
+        (JNIEnv *env, jobject thisObject, jboolean verified) {
+    BRPaymentProtocolRequest *request =
+            (BRPaymentProtocolRequest *) getJNIReference(env, thisObject);
+
+    BRPaymentProtocolRequestSetVerified (request, JNI_TRUE == verified);
+}
+
 
 /*
  * Class:     com_ravencoin_core_BRCorePaymentProtocolRequest
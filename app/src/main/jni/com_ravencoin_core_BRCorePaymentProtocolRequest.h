@@ -111,6 +111,22 @@ JNIEXPORT jbyteArray JNICALL Java_com_breadwallet_core_BRCorePaymentProtocolRequ
 JNIEXPORT jobjectArray JNICALL Java_com_breadwallet_core_BRCorePaymentProtocolRequest_getCerts
   (JNIEnv *, jobject);
 
+/*
+ * Class:     com_ravenwallet_core_BRCorePaymentProtocolRequest
+ * Method:    getVerified
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRequest_getVerified
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_ravenwallet_core_BRCorePaymentProtocolRequest
+ * Method:    setVerified
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCorePaymentProtocolRequest_setVerified
+  (JNIEnv *, jobject, jboolean);
+
 /*
  * Class:     com_breadwallet_core_BRCorePaymentProtocolRequest
  * Method:    createPaymentProtocolRequest
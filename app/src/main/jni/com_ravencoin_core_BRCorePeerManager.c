@@ -50,6 +50,7 @@ static void saveBlocks(void *info, int replace, BRMerkleBlock *blocks[], size_t
 static void savePeers(void *info, int replace, const BRPeer peers[], size_t count);
 static int networkIsReachable(void *info);
 static void threadCleanup(void *info);
+static void saveSnapshot(void *info, const uint8_t *snapshot, size_t snapshotLen);
 
 static void txPublished (void *info, int error);
 
@@ -249,6 +250,109 @@ Java_com_ravenwallet_core_BRCorePeerManager_getDownloadPeerName
     return (*env)->NewStringUTF (env, name);
 }
 
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    setMeteredSync
+ * Signature: (ZJ)V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCorePeerManager_setMeteredSync
+        (JNIEnv *env, jobject thisObject, jboolean metered, jlong byteBudget) {
+    BRPeerManager *peerManager = (BRPeerManager *) getJNIReference(env, thisObject);
+    BRSyncPolicy policy = metered ? BR_SYNC_POLICY_METERED : BR_SYNC_POLICY_DEFAULT;
+
+    policy.byteBudget = (byteBudget > 0) ? (uint64_t) byteBudget : 0;
+    BRPeerManagerSetSyncPolicy(peerManager, policy);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    getSessionBytesSent
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCorePeerManager_getSessionBytesSent
+        (JNIEnv *env, jobject thisObject) {
+    BRPeerManager *peerManager = (BRPeerManager *) getJNIReference(env, thisObject);
+    uint64_t sent = 0;
+
+    BRPeerManagerByteCount(peerManager, &sent, NULL);
+    return (jlong) sent;
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    getSessionBytesReceived
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCorePeerManager_getSessionBytesReceived
+        (JNIEnv *env, jobject thisObject) {
+    BRPeerManager *peerManager = (BRPeerManager *) getJNIReference(env, thisObject);
+    uint64_t received = 0;
+
+    BRPeerManagerByteCount(peerManager, NULL, &received);
+    return (jlong) received;
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    resetSessionBytes
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCorePeerManager_resetSessionBytes
+        (JNIEnv *env, jobject thisObject) {
+    BRPeerManager *peerManager = (BRPeerManager *) getJNIReference(env, thisObject);
+    BRPeerManagerResetByteCount(peerManager);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    getSnapshot
+ * Signature: ()[B
+ */
+JNIEXPORT jbyteArray JNICALL
+Java_com_ravenwallet_core_BRCorePeerManager_getSnapshot
+        (JNIEnv *env, jobject thisObject) {
+    BRPeerManager *peerManager = (BRPeerManager *) getJNIReference(env, thisObject);
+    size_t bufLen = BRPeerManagerSnapshot (peerManager, NULL, 0);
+    uint8_t *buf = malloc (bufLen), *newBuf;
+    size_t snapshotLen = 0;
+
+    // the chain may grow between sizing and writing the snapshot, so size it again until it fits
+    while (NULL != buf && 0 == (snapshotLen = BRPeerManagerSnapshot (peerManager, buf, bufLen))) {
+        bufLen = BRPeerManagerSnapshot (peerManager, NULL, 0);
+        newBuf = realloc (buf, bufLen);
+        if (NULL == newBuf) free (buf);
+        buf = newBuf;
+    }
+
+    if (NULL == buf) return NULL;
+    jbyteArray byteArray = (*env)->NewByteArray (env, (jsize) snapshotLen);
+    (*env)->SetByteArrayRegion (env, byteArray, 0, (jsize) snapshotLen, (const jbyte *) buf);
+
+    free (buf);
+    return byteArray;
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    restoreSnapshot
+ * Signature: ([B)Z
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_ravenwallet_core_BRCorePeerManager_restoreSnapshot
+        (JNIEnv *env, jobject thisObject, jbyteArray snapshotByteArray) {
+    BRPeerManager *peerManager = (BRPeerManager *) getJNIReference(env, thisObject);
+    size_t snapshotLen = (size_t) (*env)->GetArrayLength (env, snapshotByteArray);
+    jbyte *snapshot = (*env)->GetByteArrayElements (env, snapshotByteArray, 0);
+    int restored = BRPeerManagerRestoreSnapshot (peerManager, (const uint8_t *) snapshot, snapshotLen);
+
+    (*env)->ReleaseByteArrayElements (env, snapshotByteArray, snapshot, JNI_ABORT);
+    return restored ? JNI_TRUE : JNI_FALSE;
+}
+
 /*
  * Class:     com_ravencoin_core_BRCorePeerManager
  * Method:    publishTransaction
@@ -432,6 +536,8 @@ JNICALL Java_com_ravenwallet_core_BRCorePeerManager_installListener
                                savePeers,
                                networkIsReachable,
                                threadCleanup);
+
+    BRPeerManagerSetSnapshotCallback (peerManager, saveSnapshot);
 }
 
 /*
@@ -603,6 +709,28 @@ savePeers(void *info, int replace, const BRPeer peers[], size_t count) {
     (*env)->DeleteLocalRef (env, peerArray);
 }
 
+static void
+saveSnapshot(void *info, const uint8_t *snapshot, size_t snapshotLen) {
+    JNIEnv *env = getEnv();
+    if (NULL == env) return;
+
+    jobject listener = (*env)->NewLocalRef(env, (jobject) info);
+    if ((*env)->IsSameObject (env, listener, NULL)) return; // GC reclaimed
+
+    jmethodID listenerMethod =
+            lookupListenerMethod(env, listener,
+                                 "saveSnapshot",
+                                 "([B)V");
+    assert (NULL != listenerMethod);
+
+    jbyteArray snapshotArray = (*env)->NewByteArray (env, (jsize) snapshotLen);
+    (*env)->SetByteArrayRegion (env, snapshotArray, 0, (jsize) snapshotLen, (const jbyte *) snapshot);
+
+    (*env)->CallVoidMethod(env, listener, listenerMethod, snapshotArray);
+    (*env)->DeleteLocalRef(env, listener);
+    (*env)->DeleteLocalRef(env, snapshotArray);
+}
+
 static int
 networkIsReachable(void *info) {
     JNIEnv *env = getEnv();
@@ -109,6 +109,54 @@ JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCorePeerManager_getPeerCount
 JNIEXPORT jstring JNICALL Java_com_ravenwallet_core_BRCorePeerManager_getDownloadPeerName
         (JNIEnv *, jobject);
 
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    setMeteredSync
+ * Signature: (ZJ)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCorePeerManager_setMeteredSync
+        (JNIEnv *, jobject, jboolean, jlong);
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    getSessionBytesSent
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCorePeerManager_getSessionBytesSent
+        (JNIEnv *, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    getSessionBytesReceived
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCorePeerManager_getSessionBytesReceived
+        (JNIEnv *, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    resetSessionBytes
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCorePeerManager_resetSessionBytes
+        (JNIEnv *, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    getSnapshot
+ * Signature: ()[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCorePeerManager_getSnapshot
+        (JNIEnv *, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCorePeerManager
+ * Method:    restoreSnapshot
+ * Signature: ([B)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_ravenwallet_core_BRCorePeerManager_restoreSnapshot
+        (JNIEnv *, jobject, jbyteArray);
+
 /*
  * Class:     com_ravencoin_core_BRCorePeerManager
  * Method:    publishTransactionWithListener
@@ -220,16 +220,42 @@ JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreTransaction_seriali
 
     size_t byteArraySize = BRTransactionSerialize(transaction, NULL, 0);
     jbyteArray  byteArray         = (*env)->NewByteArray (env, (jsize) byteArraySize);
-    jbyte      *byteArrayElements = (*env)->GetByteArrayElements (env, byteArray, JNI_FALSE);
+    jbyte      *byteArrayElements = (*env)->GetPrimitiveArrayCritical (env, byteArray, NULL);
 
+    // Serialize straight into the array; no JNI calls until released
     BRTransactionSerialize(transaction, (uint8_t *) byteArrayElements, byteArraySize);
-
-    // Ensure ELEMENTS 'written' back to byteArray
-    (*env)->ReleaseByteArrayElements (env, byteArray, byteArrayElements, JNI_COMMIT);
+    (*env)->ReleasePrimitiveArrayCritical (env, byteArray, byteArrayElements, 0);
 
     return byteArray;
 }
 
+/*
+ * Class:     com_ravencoin_core_BRCoreTransaction
+ * Method:    getSerializedSize
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreTransaction_getSerializedSize
+        (JNIEnv *env, jobject thisObject) {
+    BRTransaction *transaction = (BRTransaction *) getJNIReference (env, thisObject);
+    return (jint) BRTransactionSerialize (transaction, NULL, 0);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreTransaction
+ * Method:    jniSerializeDirect
+ * Signature: (Ljava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreTransaction_jniSerializeDirect
+        (JNIEnv *env, jobject thisObject, jobject buffer, jint offset, jint length) {
+    BRTransaction *transaction = (BRTransaction *) getJNIReference (env, thisObject);
+    uint8_t *bytes = getDirectBufferBytes (env, buffer, offset, length);
+
+    if (NULL == bytes) return 0;
+
+    // BRTransactionSerialize() returns 0 when length is too small
+    return (jint) BRTransactionSerialize (transaction, bytes, (size_t) length);
+}
+
 /*
  * Class:     com_ravencoin_core_BRCoreTransaction
  * Method:    addInput
@@ -429,9 +455,10 @@ Java_com_ravenwallet_core_BRCoreTransaction_createJniCoreTransaction
 
     // static native long createJniCoreTransaction (byte[] buffer, long blockHeight, long timeStamp);
     size_t transactionSize = (size_t) (*env)->GetArrayLength (env, transactionByteArray);
-    const uint8_t *transactionData = (const uint8_t *) (*env)->GetByteArrayElements (env, transactionByteArray, 0);
+    uint8_t *transactionData = (uint8_t *) (*env)->GetPrimitiveArrayCritical (env, transactionByteArray, NULL);
 
     BRTransaction *transaction = BRTransactionParse(transactionData, transactionSize);
+    (*env)->ReleasePrimitiveArrayCritical (env, transactionByteArray, transactionData, JNI_ABORT);
     assert (NULL != transaction);
 
     transaction->blockHeight = (uint32_t) blockHeight;
@@ -440,6 +467,37 @@ Java_com_ravenwallet_core_BRCoreTransaction_createJniCoreTransaction
     return (jlong) transaction;
 }
 
+/*
+ * Class:     com_ravencoin_core_BRCoreTransaction
+ * Method:    createJniCoreTransactionDirect
+ * Signature: (Ljava/nio/ByteBuffer;IIJJ[I)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCoreTransaction_createJniCoreTransactionDirect
+        (JNIEnv *env, jclass thisClass,
+         jobject buffer,
+         jint offset,
+         jint length,
+         jlong blockHeight,
+         jlong timestamp,
+         jintArray consumed) {
+    const uint8_t *transactionData = getDirectBufferBytes (env, buffer, offset, length);
+    BRTransaction *transaction = (NULL == transactionData ? NULL
+                                  : BRTransactionParse (transactionData, (size_t) length));
+    jint transactionSize;
+
+    if (NULL == transaction) return 0;
+
+    transaction->blockHeight = (uint32_t) blockHeight;
+    transaction->timestamp = (uint32_t) timestamp;
+
+    // the parsed transaction re-serializes to exactly the bytes it was parsed from
+    transactionSize = (jint) BRTransactionSerialize (transaction, NULL, 0);
+    (*env)->SetIntArrayRegion (env, consumed, 0, 1, &transactionSize);
+
+    return (jlong) transaction;
+}
+
 /*
  * Class:     com_ravencoin_core_BRCoreTransaction
  * Method:    createJniCoreTransactionSerialized
@@ -450,9 +508,10 @@ JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreTransaction_createJniCor
 
     // static native long createJniCoreTransaction (byte[] buffer, long blockHeight, long timeStamp);
     size_t transactionSize = (size_t) (*env)->GetArrayLength (env, transactionByteArray);
-    const uint8_t *transactionData = (const uint8_t *) (*env)->GetByteArrayElements (env, transactionByteArray, 0);
+    uint8_t *transactionData = (uint8_t *) (*env)->GetPrimitiveArrayCritical (env, transactionByteArray, NULL);
 
     BRTransaction *transaction = BRTransactionParse(transactionData, transactionSize);
+    (*env)->ReleasePrimitiveArrayCritical (env, transactionByteArray, transactionData, JNI_ABORT);
     assert (NULL != transaction);
 
     return (jlong) transaction;
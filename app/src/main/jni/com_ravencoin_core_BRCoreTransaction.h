@@ -89,6 +89,22 @@ JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreTransaction_setTimestamp
 JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreTransaction_serialize
   (JNIEnv *, jobject);
 
+/*
+ * Class:     com_ravencoin_core_BRCoreTransaction
+ * Method:    getSerializedSize
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreTransaction_getSerializedSize
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreTransaction
+ * Method:    jniSerializeDirect
+ * Signature: (Ljava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_ravenwallet_core_BRCoreTransaction_jniSerializeDirect
+  (JNIEnv *, jobject, jobject, jint, jint);
+
 /*
  * Class:     com_ravencoin_core_BRCoreTransaction
  * Method:    addInput
@@ -193,6 +209,14 @@ JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreTransaction_initializeNat
 JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreTransaction_createJniCoreTransaction
   (JNIEnv *, jclass, jbyteArray, jlong, jlong);
 
+/*
+ * Class:     com_ravencoin_core_BRCoreTransaction
+ * Method:    createJniCoreTransactionDirect
+ * Signature: (Ljava/nio/ByteBuffer;IIJJ[I)J
+ */
+JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreTransaction_createJniCoreTransactionDirect
+  (JNIEnv *, jclass, jobject, jint, jint, jlong, jlong, jintArray);
+
 /*
  * Class:     com_ravencoin_core_BRCoreTransaction
  * Method:    createJniCoreTransactionSerialized
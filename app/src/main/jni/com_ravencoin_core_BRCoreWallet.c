@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <malloc.h>
 #include <assert.h>
+#include <unistd.h>
 #include <BRBIP39Mnemonic.h>
 #include "BRWallet.h"
 #include "BRAddress.h"
@@ -31,6 +32,7 @@
 #include "com_ravencoin_core_BRCoreWallet.h"
 #include "com_ravencoin_core_BRCoreTransaction.h"
 #include "BRAssets.h"
+#include "BRWorkQueue.h"
 
 static BRTransaction *
 JNI_COPY_TRANSACTION(BRTransaction *tx) {
@@ -73,16 +75,18 @@ static jmethodID assetConstructor;
 
 static jclass keyClass;
 static jmethodID keyConstructor;
-/*
- * Class:     com_ravencoin_core_BRCoreWallet
- * Method:    createJniCoreWallet
- * Signature: ([Lcom/ravenwallet/core/BRCoreTransaction;Lcom/ravenwallet/core/BRCoreMasterPubKey;Lcom/ravenwallet/core/BRCoreWallet/Listener;)J
- */
-JNIEXPORT jlong JNICALL
-Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWallet
-        (JNIEnv *env, jclass thisClass,
-         jobjectArray objTransactionsArray,
-         jobject objMasterPubKey) {
+
+static jclass booleanClass;
+static jmethodID booleanValueOf;
+
+// runs the *Async operations off the calling thread
+static BRWorkQueue *operationQueue;
+static BRWallet *
+createWallet (JNIEnv *env,
+              jobjectArray objTransactionsArray,
+              jobject objMasterPubKey,
+              const uint8_t *cache,
+              size_t cacheLen) {
 
     BRMasterPubKey *masterPubKey = (BRMasterPubKey *) getJNIReference(env, objMasterPubKey);
 
@@ -98,13 +102,183 @@ Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWallet
         (*env)->DeleteLocalRef(env, objTransaction);
     }
 
-    BRWallet *wallet = BRWalletNew(transactions, transactionsCount, *masterPubKey);
+    BRWallet *wallet = BRWalletNewWithAddressCache(transactions, transactionsCount, *masterPubKey,
+                                                   cache, cacheLen);
 
     if (NULL != transactions) free(transactions);
 
+    return wallet;
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createJniCoreWallet
+ * Signature: ([Lcom/ravenwallet/core/BRCoreTransaction;Lcom/ravenwallet/core/BRCoreMasterPubKey;Lcom/ravenwallet/core/BRCoreWallet/Listener;)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWallet
+        (JNIEnv *env, jclass thisClass,
+         jobjectArray objTransactionsArray,
+         jobject objMasterPubKey) {
+    return (jlong) createWallet (env, objTransactionsArray, objMasterPubKey, NULL, 0);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createJniCoreWalletWithAddressCache
+ * Signature: ([Lcom/ravenwallet/core/BRCoreTransaction;Lcom/ravenwallet/core/BRCoreMasterPubKey;[B)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWalletWithAddressCache
+        (JNIEnv *env, jclass thisClass,
+         jobjectArray objTransactionsArray,
+         jobject objMasterPubKey,
+         jbyteArray addressCacheByteArray) {
+    if (NULL == addressCacheByteArray)
+        return (jlong) createWallet (env, objTransactionsArray, objMasterPubKey, NULL, 0);
+
+    size_t cacheLen = (size_t) (*env)->GetArrayLength (env, addressCacheByteArray);
+    jbyte *cache = (*env)->GetByteArrayElements (env, addressCacheByteArray, 0);
+
+    BRWallet *wallet = createWallet (env, objTransactionsArray, objMasterPubKey,
+                                     (const uint8_t *) cache, cacheLen);
+
+    (*env)->ReleaseByteArrayElements (env, addressCacheByteArray, cache, JNI_ABORT);
     return (jlong) wallet;
 }
 
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createJniCoreWalletFromTxStore
+ * Signature: (Ljava/lang/String;Lcom/ravenwallet/core/BRCoreMasterPubKey;[B)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWalletFromTxStore
+        (JNIEnv *env, jclass thisClass,
+         jstring txStorePathString,
+         jobject objMasterPubKey,
+         jbyteArray addressCacheByteArray) {
+    BRMasterPubKey *masterPubKey = (BRMasterPubKey *) getJNIReference(env, objMasterPubKey);
+
+    const char *txStorePath = (*env)->GetStringUTFChars (env, txStorePathString, NULL);
+    BRTxStore *store = BRTxStoreOpen (txStorePath);
+    (*env)->ReleaseStringUTFChars (env, txStorePathString, txStorePath);
+
+    if (NULL == store) return (jlong) NULL;
+
+    size_t cacheLen = (NULL == addressCacheByteArray ? 0
+                       : (size_t) (*env)->GetArrayLength (env, addressCacheByteArray));
+    jbyte *cache = (NULL == addressCacheByteArray ? NULL
+                    : (*env)->GetByteArrayElements (env, addressCacheByteArray, 0));
+
+    BRWallet *wallet = BRWalletNewWithTxStore (store, *masterPubKey, (const uint8_t *) cache, cacheLen);
+
+    if (NULL != cache) (*env)->ReleaseByteArrayElements (env, addressCacheByteArray, cache, JNI_ABORT);
+    if (NULL == wallet) BRTxStoreClose (store);
+
+    return (jlong) wallet;
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    getAddressCache
+ * Signature: ()[B
+ */
+JNIEXPORT jbyteArray JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_getAddressCache
+        (JNIEnv *env, jobject thisObject) {
+    BRWallet *wallet = (BRWallet *) getJNIReference(env, thisObject);
+    size_t cacheLen = BRWalletAddressCache (wallet, NULL, 0);
+    uint8_t *cache = malloc (cacheLen);
+
+    // the chains may grow between sizing and writing the cache, so size it again until it fits
+    while (NULL != cache && 0 == BRWalletAddressCache (wallet, cache, cacheLen)) {
+        cacheLen = BRWalletAddressCache (wallet, NULL, 0);
+        cache = realloc (cache, cacheLen);
+    }
+
+    assert (NULL != cache);
+    jbyteArray byteArray = (*env)->NewByteArray (env, (jsize) cacheLen);
+    (*env)->SetByteArrayRegion (env, byteArray, 0, (jsize) cacheLen, (const jbyte *) cache);
+
+    free (cache);
+    return byteArray;
+}
+
+// a record is txHash, blockHeight, timestamp, received, sent, fee and assetAmount, little endian
+#define TX_RECORD_SIZE (sizeof (UInt256) + 2 * sizeof (uint32_t) + 4 * sizeof (uint64_t))
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    queryTransactions
+ * Signature: (Ljava/lang/String;Ljava/lang/String;JJJJ[BI)[B
+ */
+JNIEXPORT jbyteArray JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_queryTransactions
+        (JNIEnv *env, jobject thisObject,
+         jstring addressString,
+         jstring assetNameString,
+         jlong fromHeight,
+         jlong toHeight,
+         jlong fromTime,
+         jlong toTime,
+         jbyteArray afterRecordArray,
+         jint limit) {
+    BRWallet *wallet = (BRWallet *) getJNIReference(env, thisObject);
+    BRTxQuery query = BR_TX_QUERY_ALL;
+    BRTxCursor cursor = BR_TX_CURSOR_START;
+    size_t count = (limit > 0) ? (size_t) limit : 0;
+
+    query.address = (NULL == addressString) ? NULL
+                    : (*env)->GetStringUTFChars (env, addressString, 0);
+    query.assetName = (NULL == assetNameString) ? NULL
+                      : (*env)->GetStringUTFChars (env, assetNameString, 0);
+    query.fromHeight = (uint32_t) fromHeight;
+    query.toHeight = (uint32_t) toHeight;
+    query.fromTime = (uint32_t) fromTime;
+    query.toTime = (uint32_t) toTime;
+
+    // continue after the last record of the previous page
+    if (NULL != afterRecordArray &&
+        (*env)->GetArrayLength (env, afterRecordArray) >= sizeof (UInt256) + 2 * sizeof (uint32_t)) {
+        uint8_t after[sizeof (UInt256) + 2 * sizeof (uint32_t)];
+
+        (*env)->GetByteArrayRegion (env, afterRecordArray, 0, sizeof (after), (jbyte *) after);
+        cursor.txHash = UInt256Get (after);
+        cursor.blockHeight = UInt32GetLE (&after[sizeof (UInt256)]);
+        cursor.timestamp = UInt32GetLE (&after[sizeof (UInt256) + sizeof (uint32_t)]);
+    }
+
+    BRTxRecord *records = calloc (count + 1, sizeof (BRTxRecord));
+    assert (NULL != records);
+    count = BRWalletQueryTransactions (wallet, &query, &cursor, records, count);
+
+    if (NULL != query.address) (*env)->ReleaseStringUTFChars (env, addressString, query.address);
+    if (NULL != query.assetName) (*env)->ReleaseStringUTFChars (env, assetNameString, query.assetName);
+
+    uint8_t *buf = malloc (count * TX_RECORD_SIZE + 1);
+    assert (NULL != buf);
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t *r = &buf[i * TX_RECORD_SIZE];
+
+        UInt256Set (r, records[i].txHash);
+        UInt32SetLE (&r[32], records[i].blockHeight);
+        UInt32SetLE (&r[36], records[i].timestamp);
+        UInt64SetLE (&r[40], records[i].received);
+        UInt64SetLE (&r[48], records[i].sent);
+        UInt64SetLE (&r[56], records[i].fee);
+        UInt64SetLE (&r[64], records[i].assetAmount);
+    }
+
+    jbyteArray byteArray = (*env)->NewByteArray (env, (jsize) (count * TX_RECORD_SIZE));
+    (*env)->SetByteArrayRegion (env, byteArray, 0, (jsize) (count * TX_RECORD_SIZE), (const jbyte *) buf);
+
+    free (buf);
+    free (records);
+    return byteArray;
+}
+
 /*
  * Class:     com_ravencoin_core_BRCoreWallet
  * Method:    installListener
@@ -508,6 +682,34 @@ Java_com_ravenwallet_core_BRCoreWallet_createUniqueAssetTransaction(JNIEnv *env,
            : (*env)->NewObject(env, transactionClass, transactionConstructor, (jlong) transaction);
 }
 
+JNIEXPORT jobject JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_createUniqueAssetsTransaction(JNIEnv *env, jobject instance,
+                                                                     jobject addressObject,
+                                                                     jobjectArray assetObjects,
+                                                                     jobject rootAssetObject) {
+    BRWallet *wallet = (BRWallet *) getJNIReference(env, instance);
+    BRAddress *address = (BRAddress *) getJNIReference(env, addressObject);
+    BRAsset *rootAsset = (BRAsset *) getJNIReference(env, rootAssetObject);
+
+    size_t assetCount = (size_t) (*env)->GetArrayLength(env, assetObjects);
+    if (0 == assetCount) return NULL;
+
+    BRAsset assets[assetCount];
+    for (int index = 0; index < assetCount; index++) {
+        jobject assetObject = (*env)->GetObjectArrayElement(env, assetObjects, index);
+        assets[index] = *(BRAsset *) getJNIReference(env, assetObject);
+        (*env)->DeleteLocalRef(env, assetObject);
+    }
+
+    BRTransaction *transaction = BRWalletCreateTxForUniqueAssetsCreation(wallet,
+                                                                         (const char *) address->s,
+                                                                         assets, assetCount,
+                                                                         rootAsset);
+    return NULL == transaction
+           ? NULL
+           : (*env)->NewObject(env, transactionClass, transactionConstructor, (jlong) transaction);
+}
+
 JNIEXPORT jobject JNICALL
 Java_com_ravenwallet_core_BRCoreWallet_burnAsset(JNIEnv *env, jobject instance,
                                                  jobject assetObject) {
@@ -525,9 +727,9 @@ Java_com_ravenwallet_core_BRCoreWallet_decomposeTransaction(JNIEnv *env, jobject
                                                             jobject tx) {
     BRWallet *wallet = (BRWallet *) getJNIReference(env, instance);
     BRTransaction *transaction = getJNIReference(env, tx);
-    size_t txsCount = BRTransactionDecompose(wallet, transaction, NULL, 0);
-    BRTransaction *transactions = BRTransactionNew(txsCount);
-    txsCount = BRTransactionDecompose(wallet, transaction, transactions, txsCount);
+    size_t txsCapacity = BRTransactionDecompose(wallet, transaction, NULL, 0);
+    BRTransaction *transactions = BRTransactionNew(txsCapacity);
+    size_t txsCount = BRTransactionDecompose(wallet, transaction, transactions, txsCapacity);
 
     jobjectArray transactionArray = (*env)->NewObjectArray(env, (jsize) txsCount, transactionClass,
                                                            0);
@@ -543,7 +745,7 @@ Java_com_ravenwallet_core_BRCoreWallet_decomposeTransaction(JNIEnv *env, jobject
         (*env)->DeleteLocalRef(env, transactionObject);
     }
 
-    if (NULL != transactions) free(transactions);
+    BRTransactionFreeArray(transactions, txsCapacity);
 
     return transactionArray;
 }
@@ -660,6 +862,335 @@ Java_com_ravenwallet_core_BRCoreWallet_signTransaction
                        : JNI_FALSE);
 }
 
+//
+// Asynchronous Operations
+//
+typedef enum {
+    OPERATION_SIGN_TRANSACTION,
+    OPERATION_PRIVATE_KEY_BIP44,
+    OPERATION_PRIVATE_KEY_BIP32,
+    OPERATION_CREATE_TRANSACTION,
+    OPERATION_CREATE_ASSET_TRANSACTION,
+    OPERATION_TRANSFER_ASSET
+} OperationType;
+
+typedef struct {
+    OperationType type;
+    jobject walletObject, listener, argumentObject; // global refs, keep the native objects alive until done
+    BRWallet *wallet;
+    BRTransaction *transaction; // to sign, or the created transaction
+    BRAsset *asset;
+    BRAddress address;
+    uint64_t amount;
+    uint32_t index, chain;
+    char *phrase;
+    BRKey *key;
+    int signedOk;
+} Operation;
+
+static Operation *
+operationNew (JNIEnv *env, OperationType type, jobject walletObject, jobject listener,
+              jobject argumentObject, jbyteArray phraseByteArray) {
+    Operation *operation = calloc (1, sizeof (Operation));
+    assert (NULL != operation);
+
+    operation->type = type;
+    operation->walletObject = (*env)->NewGlobalRef (env, walletObject);
+    operation->listener = (*env)->NewGlobalRef (env, listener);
+    operation->argumentObject = (NULL == argumentObject) ? NULL
+                                : (*env)->NewGlobalRef (env, argumentObject);
+    operation->wallet = (BRWallet *) getJNIReference (env, walletObject);
+
+    if (NULL != phraseByteArray) {
+        size_t phraseLen = (size_t) (*env)->GetArrayLength (env, phraseByteArray);
+
+        operation->phrase = calloc (1 + phraseLen, 1);
+        assert (NULL != operation->phrase);
+        (*env)->GetByteArrayRegion (env, phraseByteArray, 0, (jsize) phraseLen,
+                                    (jbyte *) operation->phrase);
+    }
+
+    return operation;
+}
+
+static void
+operationRun (void *info) {
+    Operation *operation = (Operation *) info;
+    UInt512 seed;
+
+    switch (operation->type) {
+        case OPERATION_SIGN_TRANSACTION:
+            BRBIP39DeriveKey (&seed, operation->phrase, NULL);
+            operation->signedOk = BRWalletSignTransaction (operation->wallet, operation->transaction,
+                                                           &seed, sizeof (seed));
+            mem_clean (&seed, sizeof (seed));
+            break;
+
+        case OPERATION_PRIVATE_KEY_BIP44:
+        case OPERATION_PRIVATE_KEY_BIP32:
+            BRBIP39DeriveKey (&seed, operation->phrase, NULL);
+            operation->key = malloc (sizeof (BRKey));
+            assert (NULL != operation->key);
+
+            if (OPERATION_PRIVATE_KEY_BIP44 == operation->type)
+                BRBIP44PrivKeyList (operation->key, 1, &seed, sizeof (UInt512), BIP44_RVN_COINTYPE,
+                                    BIP44_DEFAULT_ACCOUNT, operation->chain, &operation->index);
+            else
+                BRBIP32PrivKeyList (operation->key, 1, &seed, sizeof (UInt512), operation->chain,
+                                    &operation->index);
+
+            mem_clean (&seed, sizeof (seed));
+            break;
+
+        case OPERATION_CREATE_TRANSACTION:
+            operation->transaction = BRWalletCreateTransaction (operation->wallet, operation->amount,
+                                                                operation->address.s);
+            break;
+
+        case OPERATION_CREATE_ASSET_TRANSACTION:
+            operation->transaction = BRWalletCreateTxForRootAssetCreation (operation->wallet,
+                                                                           operation->amount,
+                                                                           operation->address.s,
+                                                                           operation->asset);
+            break;
+
+        case OPERATION_TRANSFER_ASSET:
+            operation->transaction = BRWalletCreateTxForRootAssetTransfer (operation->wallet,
+                                                                           operation->amount,
+                                                                           operation->address.s,
+                                                                           operation->asset);
+            break;
+    }
+}
+
+// delivers the result to OperationListener.onOperationComplete(), on a worker thread, or on the
+// cancelling thread for an operation cancelled before it started
+static void
+operationDone (void *info, uint64_t operationId, int cancelled) {
+    Operation *operation = (Operation *) info;
+    int createsTransaction = (OPERATION_CREATE_TRANSACTION == operation->type ||
+                              OPERATION_CREATE_ASSET_TRANSACTION == operation->type ||
+                              OPERATION_TRANSFER_ASSET == operation->type);
+    JNIEnv *env = getEnv();
+
+    // a cancelled operation's result is dropped
+    if (cancelled || NULL == env) {
+        if (NULL != operation->key) {
+            BRKeyClean (operation->key);
+            free (operation->key);
+        }
+        if (createsTransaction && NULL != operation->transaction)
+            BRTransactionFree (operation->transaction);
+        operation->key = NULL;
+        operation->transaction = NULL;
+    }
+
+    if (NULL != env && JNI_OK == (*env)->PushLocalFrame (env, 4)) {
+        jobject result = NULL;
+
+        if (!cancelled) {
+            switch (operation->type) {
+                case OPERATION_SIGN_TRANSACTION:
+                    result = (*env)->CallStaticObjectMethod (env, booleanClass, booleanValueOf,
+                                                             (jboolean) (1 == operation->signedOk));
+                    break;
+
+                case OPERATION_PRIVATE_KEY_BIP44:
+                case OPERATION_PRIVATE_KEY_BIP32:
+                    result = (*env)->NewObject (env, keyClass, keyConstructor, (jlong) operation->key);
+                    break;
+
+                default:
+                    result = NULL == operation->transaction
+                             ? NULL
+                             : (*env)->NewObject (env, transactionClass, transactionConstructor,
+                                                  (jlong) operation->transaction);
+                    break;
+            }
+        }
+
+        jmethodID listenerMethod =
+                (*env)->GetMethodID (env, (*env)->GetObjectClass (env, operation->listener),
+                                     "onOperationComplete", "(JLjava/lang/Object;Z)V");
+        assert (NULL != listenerMethod);
+
+        (*env)->CallVoidMethod (env, operation->listener, listenerMethod,
+                                (jlong) operationId, result, (jboolean) (0 != cancelled));
+        (*env)->PopLocalFrame (env, NULL);
+    }
+
+    if (NULL != env) {
+        (*env)->DeleteGlobalRef (env, operation->walletObject);
+        (*env)->DeleteGlobalRef (env, operation->listener);
+        if (NULL != operation->argumentObject)
+            (*env)->DeleteGlobalRef (env, operation->argumentObject);
+    }
+
+    if (NULL != operation->phrase) {
+        mem_clean (operation->phrase, strlen (operation->phrase));
+        free (operation->phrase);
+    }
+
+    free (operation);
+}
+
+static void
+operationThreadCleanup (void *info) {
+    releaseEnv ();
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    signTransactionAsync
+ * Signature: (JLcom/ravenwallet/core/BRCoreTransaction;I[BLcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_signTransactionAsync
+        (JNIEnv *env, jobject thisObject,
+         jlong operationId,
+         jobject transactionObject,
+         jint forkId,
+         jbyteArray phraseByteArray,
+         jobject listener) {
+    Operation *operation = operationNew (env, OPERATION_SIGN_TRANSACTION, thisObject, listener,
+                                         transactionObject, phraseByteArray);
+
+    operation->transaction = (BRTransaction *) getJNIReference (env, transactionObject);
+    BRWorkQueueAddWithId (operationQueue, (uint64_t) operationId, operation, operationRun, operationDone);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    generatePrivateKeyBip44Async
+ * Signature: (J[BIILcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_generatePrivateKeyBip44Async
+        (JNIEnv *env, jobject thisObject,
+         jlong operationId,
+         jbyteArray phraseByteArray,
+         jint index,
+         jint chain,
+         jobject listener) {
+    Operation *operation = operationNew (env, OPERATION_PRIVATE_KEY_BIP44, thisObject, listener,
+                                         NULL, phraseByteArray);
+
+    operation->index = (uint32_t) index;
+    operation->chain = (uint32_t) chain;
+    BRWorkQueueAddWithId (operationQueue, (uint64_t) operationId, operation, operationRun, operationDone);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    generatePrivateKeyBip32Async
+ * Signature: (J[BIILcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_generatePrivateKeyBip32Async
+        (JNIEnv *env, jobject thisObject,
+         jlong operationId,
+         jbyteArray phraseByteArray,
+         jint index,
+         jint chain,
+         jobject listener) {
+    Operation *operation = operationNew (env, OPERATION_PRIVATE_KEY_BIP32, thisObject, listener,
+                                         NULL, phraseByteArray);
+
+    operation->index = (uint32_t) index;
+    operation->chain = (uint32_t) chain;
+    BRWorkQueueAddWithId (operationQueue, (uint64_t) operationId, operation, operationRun, operationDone);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createTransactionAsync
+ * Signature: (JJLcom/ravenwallet/core/BRCoreAddress;Lcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_createTransactionAsync
+        (JNIEnv *env, jobject thisObject,
+         jlong operationId,
+         jlong amount,
+         jobject addressObject,
+         jobject listener) {
+    Operation *operation = operationNew (env, OPERATION_CREATE_TRANSACTION, thisObject, listener,
+                                         NULL, NULL);
+
+    operation->amount = (uint64_t) amount;
+    operation->address = *(BRAddress *) getJNIReference (env, addressObject);
+    BRWorkQueueAddWithId (operationQueue, (uint64_t) operationId, operation, operationRun, operationDone);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createAssetTransactionAsync
+ * Signature: (JJLcom/ravenwallet/core/BRCoreAddress;Lcom/ravenwallet/core/BRCoreTransactionAsset;Lcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_createAssetTransactionAsync
+        (JNIEnv *env, jobject thisObject,
+         jlong operationId,
+         jlong amount,
+         jobject addressObject,
+         jobject assetObject,
+         jobject listener) {
+    Operation *operation = operationNew (env, OPERATION_CREATE_ASSET_TRANSACTION, thisObject,
+                                         listener, assetObject, NULL);
+
+    operation->amount = (uint64_t) amount;
+    operation->address = *(BRAddress *) getJNIReference (env, addressObject);
+    operation->asset = (BRAsset *) getJNIReference (env, assetObject);
+    BRWorkQueueAddWithId (operationQueue, (uint64_t) operationId, operation, operationRun, operationDone);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    transferAssetAsync
+ * Signature: (JDLjava/lang/String;Lcom/ravenwallet/core/BRCoreTransactionAsset;Lcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_transferAssetAsync
+        (JNIEnv *env, jobject thisObject,
+         jlong operationId,
+         jdouble amount,
+         jstring addressString,
+         jobject assetObject,
+         jobject listener) {
+    Operation *operation = operationNew (env, OPERATION_TRANSFER_ASSET, thisObject, listener,
+                                         assetObject, NULL);
+    const char *address = (*env)->GetStringUTFChars (env, addressString, 0);
+
+    operation->amount = (uint64_t) amount;
+    strncpy (operation->address.s, address, sizeof (operation->address.s) - 1);
+    (*env)->ReleaseStringUTFChars (env, addressString, address);
+    operation->asset = (BRAsset *) getJNIReference (env, assetObject);
+    BRWorkQueueAddWithId (operationQueue, (uint64_t) operationId, operation, operationRun, operationDone);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    newOperationId
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_newOperationId
+        (JNIEnv *env, jclass thisClass) {
+    return (jlong) BRWorkQueueNewId (operationQueue);
+}
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    cancelOperation
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_cancelOperation
+        (JNIEnv *env, jclass thisClass, jlong operationId) {
+    return (jboolean) (BRWorkQueueCancel (operationQueue, (uint64_t) operationId)
+                       ? JNI_TRUE
+                       : JNI_FALSE);
+}
+
 /*
  * Class:     com_ravencoin_core_BRCoreWallet
  * Method:    containsTransaction
@@ -684,7 +1215,7 @@ Java_com_ravenwallet_core_BRCoreWallet_jniRegisterTransaction
     BRWallet *wallet = (BRWallet *) getJNIReference(env, thisObject);
     BRTransaction *transaction = (BRTransaction *) getJNIReference(env, transactionObject);
 
-    // The `transaction` is now owned by Core; it may be freed.
+    // If registered, the `transaction` is now owned by Core; it may be freed.  Otherwise Java still owns it.
     return (jboolean) BRWalletRegisterTransaction(wallet, transaction);
 }
 
@@ -938,6 +1469,21 @@ JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreWallet_initializeNative
 
     keyConstructor = (*env)->GetMethodID(env, keyClass, "<init>", "(J)V");
     assert (NULL != keyConstructor);
+
+    booleanClass = (*env)->FindClass(env, "java/lang/Boolean");
+    assert (NULL != booleanClass);
+    booleanClass = (*env)->NewGlobalRef(env, booleanClass);
+
+    booleanValueOf = (*env)->GetStaticMethodID(env, booleanClass, "valueOf", "(Z)Ljava/lang/Boolean;");
+    assert (NULL != booleanValueOf);
+
+    if (NULL == operationQueue) {
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+        // at least two, so a slow key derivation doesn't hold up coin selection
+        operationQueue = BRWorkQueueNew((cpuCount < 2) ? 2 : (cpuCount > 4) ? 4 : (size_t) cpuCount,
+                                        NULL, operationThreadCleanup);
+    }
 }
 
 //
@@ -15,6 +15,38 @@ extern "C" {
 JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWallet
         (JNIEnv *, jclass, jobjectArray, jobject);
 
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createJniCoreWalletWithAddressCache
+ * Signature: ([Lcom/ravenwallet/core/BRCoreTransaction;Lcom/ravenwallet/core/BRCoreMasterPubKey;[B)J
+ */
+JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWalletWithAddressCache
+        (JNIEnv *, jclass, jobjectArray, jobject, jbyteArray);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createJniCoreWalletFromTxStore
+ * Signature: (Ljava/lang/String;Lcom/ravenwallet/core/BRCoreMasterPubKey;[B)J
+ */
+JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreWallet_createJniCoreWalletFromTxStore
+        (JNIEnv *, jclass, jstring, jobject, jbyteArray);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    getAddressCache
+ * Signature: ()[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreWallet_getAddressCache
+        (JNIEnv *, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    queryTransactions
+ * Signature: (Ljava/lang/String;Ljava/lang/String;JJJJ[BI)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_com_ravenwallet_core_BRCoreWallet_queryTransactions
+        (JNIEnv *, jobject, jstring, jstring, jlong, jlong, jlong, jlong, jbyteArray, jint);
+
 /*
  * Class:     com_ravencoin_core_BRCoreWallet
  * Method:    installListener
@@ -172,6 +204,12 @@ Java_com_ravenwallet_core_BRCoreWallet_createUniqueAssetTransaction(JNIEnv *env,
                                                                   jobject assetObject,
                                                                   jobject rootAssetObject);
 
+JNIEXPORT jobject JNICALL
+Java_com_ravenwallet_core_BRCoreWallet_createUniqueAssetsTransaction(JNIEnv *env, jobject instance,
+                                                                   jobject addressObject,
+                                                                   jobjectArray assetObjects,
+                                                                   jobject rootAssetObject);
+
 JNIEXPORT jobject JNICALL
 Java_com_ravenwallet_core_BRCoreWallet_burnAsset(JNIEnv *env, jobject instance, jobject assetObject);
 
@@ -202,6 +240,70 @@ JNIEXPORT jobject JNICALL Java_com_ravenwallet_core_BRCoreWallet_createTransacti
 JNIEXPORT jboolean JNICALL Java_com_ravenwallet_core_BRCoreWallet_signTransaction
         (JNIEnv *, jobject, jobject, jint, jbyteArray);
 
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    signTransactionAsync
+ * Signature: (JLcom/ravenwallet/core/BRCoreTransaction;I[BLcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreWallet_signTransactionAsync
+        (JNIEnv *, jobject, jlong, jobject, jint, jbyteArray, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    generatePrivateKeyBip44Async
+ * Signature: (J[BIILcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreWallet_generatePrivateKeyBip44Async
+        (JNIEnv *, jobject, jlong, jbyteArray, jint, jint, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    generatePrivateKeyBip32Async
+ * Signature: (J[BIILcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreWallet_generatePrivateKeyBip32Async
+        (JNIEnv *, jobject, jlong, jbyteArray, jint, jint, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createTransactionAsync
+ * Signature: (JJLcom/ravenwallet/core/BRCoreAddress;Lcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreWallet_createTransactionAsync
+        (JNIEnv *, jobject, jlong, jlong, jobject, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    createAssetTransactionAsync
+ * Signature: (JJLcom/ravenwallet/core/BRCoreAddress;Lcom/ravenwallet/core/BRCoreTransactionAsset;Lcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreWallet_createAssetTransactionAsync
+        (JNIEnv *, jobject, jlong, jlong, jobject, jobject, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    transferAssetAsync
+ * Signature: (JDLjava/lang/String;Lcom/ravenwallet/core/BRCoreTransactionAsset;Lcom/ravenwallet/core/BRCoreWallet/OperationListener;)V
+ */
+JNIEXPORT void JNICALL Java_com_ravenwallet_core_BRCoreWallet_transferAssetAsync
+        (JNIEnv *, jobject, jlong, jdouble, jstring, jobject, jobject);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    newOperationId
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_com_ravenwallet_core_BRCoreWallet_newOperationId
+        (JNIEnv *, jclass);
+
+/*
+ * Class:     com_ravencoin_core_BRCoreWallet
+ * Method:    cancelOperation
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_ravenwallet_core_BRCoreWallet_cancelOperation
+        (JNIEnv *, jclass, jlong);
+
 /*
  * Class:     com_ravencoin_core_BRCoreWallet
  * Method:    containsTransaction
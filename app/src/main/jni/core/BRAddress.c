@@ -218,6 +218,23 @@ size_t BRScriptPushData(uint8_t *script, size_t scriptLen, const uint8_t *data,
 // we are unable to correctly sign later, then the entire wallet balance after that point would become stuck with the
 // current coin selection code
 
+// writes the pay-to-pubkey-hash ravenwallet address for the 20 byte hash160 md20 to addr
+// returns the number of bytes written, or addrLen needed if addr is NULL
+size_t BRAddressFromHash160(char *addr, size_t addrLen, const void *md20)
+{
+    uint8_t data[21];
+
+    assert(md20 != NULL);
+    data[0] = RAVENCOIN_PUBKEY_ADDRESS;
+#if TESTNET
+    data[0] = RAVENCOIN_PUBKEY_ADDRESS_TEST;
+#elif REGTEST
+    data[0] = RAVENCOIN_PUBKEY_ADDRESS_REGTEST;
+#endif
+    memcpy(&data[1], md20, 20);
+    return BRBase58CheckEncode(addr, addrLen, data, sizeof(data));
+}
+
 // writes the ravenwallet address for a scriptPubKey to addr
 // returns the number of bytes written, or addrLen needed if addr is NULL
 size_t BRAddressFromScriptPubKey(char *addr, size_t addrLen, const uint8_t *script, size_t scriptLen)
@@ -229,20 +246,13 @@ size_t BRAddressFromScriptPubKey(char *addr, size_t addrLen, const uint8_t *scri
     const uint8_t *elems[BRScriptElements(NULL, 0, script, scriptLen)], *d = NULL;
     size_t count = BRScriptElements(elems, sizeof(elems) / sizeof(*elems), script, scriptLen), l = 0;
     
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS;
-#if TESTNET
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS_TEST;
-#elif REGTEST
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS_REGTEST;
-#endif
-    
     // TODO count doesn't trigger/ for regular tx count =5 for assets tx =8
     if ((count == 5 || count == 8) && *elems[0] == OP_DUP && *elems[1] == OP_HASH160 && *elems[2] == 20 && *elems[3] == OP_EQUALVERIFY
         && *elems[4] == OP_CHECKSIG) {
         // pay-to-pubkey-hash scriptPubKey
         d = BRScriptData(elems[2], &l);
         if (l != 20) d = NULL;
-        if (d) memcpy(&data[1], d, 20);
+        if (d) return BRAddressFromHash160(addr, addrLen, d);
     }
 #warning TODO: doesn't support PSH count for assets tx will be >3
     else if (count == 3 && *elems[0] == OP_HASH160 && *elems[1] == 20 && *elems[2] == OP_EQUAL) {
@@ -262,6 +272,7 @@ size_t BRAddressFromScriptPubKey(char *addr, size_t addrLen, const uint8_t *scri
         d = BRScriptData(elems[0], &l);
         if (l != 65 && l != 33) d = NULL;
         if (d) Hash160(&data[1], d, l);
+        if (d) return BRAddressFromHash160(addr, addrLen, &data[1]);
     }
 
     return (d) ? BRBase58CheckEncode(addr, addrLen, data, sizeof(data)) : 0;
@@ -278,18 +289,12 @@ size_t BRAddressFromScriptSig(char *addr, size_t addrLen, const uint8_t *script,
     const uint8_t *elems[BRScriptElements(NULL, 0, script, scriptLen)], *d = NULL;
     size_t count = BRScriptElements(elems, sizeof(elems) / sizeof(*elems), script, scriptLen), l = 0;
 
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS;
-#if TESTNET
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS_TEST;
-#elif REGTEST
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS_REGTEST;
-#endif
-    
     if (count >= 2 && *elems[count - 2] <= OP_PUSHDATA4 &&
         (*elems[count - 1] == 65 || *elems[count - 1] == 33)) { // pay-to-pubkey-hash scriptSig
         d = BRScriptData(elems[count - 1], &l);
         if (l != 65 && l != 33) d = NULL;
         if (d) Hash160(&data[1], d, l);
+        if (d) return BRAddressFromHash160(addr, addrLen, &data[1]);
     }
     else if (count >= 2 && *elems[count - 2] <= OP_PUSHDATA4 && *elems[count - 1] <= OP_PUSHDATA4 &&
              *elems[count - 1] > 0) { // pay-to-script-hash scriptSig
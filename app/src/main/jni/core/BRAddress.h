@@ -92,6 +92,10 @@ typedef struct {
 
 #define ADDRESS_NONE ((const BRAddress) { "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0" })
 
+// writes the pay-to-pubkey-hash ravenwallet address for the 20 byte hash160 md20 to addr
+// returns the number of bytes written, or addrLen needed if addr is NULL
+size_t BRAddressFromHash160(char *addr, size_t addrLen, const void *md20);
+
 // writes the ravenwallet address for a scriptPubKey to addr
 // returns the number of bytes written, or addrLen needed if addr is NULL
 size_t BRAddressFromScriptPubKey(char *addr, size_t addrLen, const uint8_t *script, size_t scriptLen);
@@ -0,0 +1,393 @@
+//
+//  BRAllocator.c
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "BRAllocator.h"
+#include "BRArray.h"
+#include <pthread.h>
+
+#define ALLOC_ALIGN 16
+
+typedef struct {
+    BRAllocator allocator; // must be first, the allocator handed out is cast back to its counting allocator
+    const BRAllocator *parent;
+    size_t bytes, count, peakBytes; // atomic
+    uint64_t allocations; // atomic
+} BRCountingAllocator;
+
+typedef struct {
+    uint8_t *buf;
+    size_t size, used;
+} BRArenaBlock;
+
+typedef struct {
+    BRAllocator allocator;
+    const BRAllocator *parent;
+    size_t blockSize;
+    BRArenaBlock *blocks; // the last block is the one being carved up
+    void *last; // most recent allocation, the only one that can be resized in place or given back
+    size_t lastSize;
+    pthread_mutex_t lock;
+} BRArenaAllocator;
+
+typedef struct {
+    BRAllocator allocator;
+    const BRAllocator *parent;
+    size_t objectSize, slabCount;
+    void **slabs;
+    void *freeList; // free objects, linked through their first word
+    pthread_mutex_t lock;
+} BRSlabAllocator;
+
+static void *_parentAlloc(const BRAllocator *parent, size_t size) {
+    return (parent) ? parent->alloc(parent->context, size) : malloc(size);
+}
+
+static void *_BRCountingAlloc(void *context, size_t size);
+static void *_BRCountingRealloc(void *context, void *ptr, size_t oldSize, size_t newSize);
+static void _BRCountingFree(void *context, void *ptr, size_t size);
+
+#define SUBSYSTEM_ALLOCATOR(i) \
+    { { &_subsystems[i], _BRCountingAlloc, _BRCountingRealloc, _BRCountingFree }, NULL, 0, 0, 0, 0 }
+
+static BRCountingAllocator _subsystems[BR_ALLOC_SUBSYSTEM_COUNT] = {
+    SUBSYSTEM_ALLOCATOR(BR_ALLOC_PEER),
+    SUBSYSTEM_ALLOCATOR(BR_ALLOC_CHAIN),
+    SUBSYSTEM_ALLOCATOR(BR_ALLOC_WALLET),
+    SUBSYSTEM_ALLOCATOR(BR_ALLOC_TX)
+};
+
+static void _BRCountingAdd(BRCountingAllocator *counting, size_t size) {
+    size_t bytes = __atomic_add_fetch(&counting->bytes, size, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&counting->peakBytes, __ATOMIC_RELAXED);
+
+    while (bytes > peak &&
+           ! __atomic_compare_exchange_n(&counting->peakBytes, &peak, bytes, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    __atomic_add_fetch(&counting->allocations, 1, __ATOMIC_RELAXED);
+}
+
+static void *_BRCountingAlloc(void *context, size_t size) {
+    BRCountingAllocator *counting = context;
+    void *ptr = _parentAlloc(counting->parent, size);
+
+    if (ptr) {
+        __atomic_add_fetch(&counting->count, 1, __ATOMIC_RELAXED);
+        _BRCountingAdd(counting, size);
+    }
+
+    return ptr;
+}
+
+static void *_BRCountingRealloc(void *context, void *ptr, size_t oldSize, size_t newSize) {
+    BRCountingAllocator *counting = context;
+    void *newPtr;
+
+    if (! ptr) return _BRCountingAlloc(context, newSize);
+    newPtr = BRAllocatorRealloc(counting->parent, ptr, oldSize, newSize);
+
+    if (newPtr) {
+        __atomic_sub_fetch(&counting->bytes, oldSize, __ATOMIC_RELAXED);
+        _BRCountingAdd(counting, newSize);
+    }
+
+    return newPtr;
+}
+
+static void _BRCountingFree(void *context, void *ptr, size_t size) {
+    BRCountingAllocator *counting = context;
+
+    BRAllocatorFree(counting->parent, ptr, size);
+    __atomic_sub_fetch(&counting->count, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&counting->bytes, size, __ATOMIC_RELAXED);
+}
+
+static BRAllocatorStats _BRCountingStats(const BRCountingAllocator *counting) {
+    BRAllocatorStats stats;
+
+    stats.bytes = __atomic_load_n(&counting->bytes, __ATOMIC_RELAXED);
+    stats.count = __atomic_load_n(&counting->count, __ATOMIC_RELAXED);
+    stats.peakBytes = __atomic_load_n(&counting->peakBytes, __ATOMIC_RELAXED);
+    stats.allocations = __atomic_load_n(&counting->allocations, __ATOMIC_RELAXED);
+    return stats;
+}
+
+// returns the counting allocator of subsystem
+const BRAllocator *BRAllocatorForSubsystem(BRAllocatorSubsystem subsystem) {
+    assert(subsystem < BR_ALLOC_SUBSYSTEM_COUNT);
+    return &_subsystems[subsystem].allocator;
+}
+
+// sets the allocator that the subsystem's counting allocator draws from, NULL for the system heap, this must be done
+// before any object of the subsystem is created, since its memory is freed to the parent it was allocated from
+void BRAllocatorSetSubsystemParent(BRAllocatorSubsystem subsystem, const BRAllocator *parent) {
+    assert(subsystem < BR_ALLOC_SUBSYSTEM_COUNT);
+    assert(__atomic_load_n(&_subsystems[subsystem].count, __ATOMIC_RELAXED) == 0);
+    _subsystems[subsystem].parent = parent;
+}
+
+// returns current allocation stats of subsystem
+BRAllocatorStats BRAllocatorSubsystemStats(BRAllocatorSubsystem subsystem) {
+    assert(subsystem < BR_ALLOC_SUBSYSTEM_COUNT);
+    return _BRCountingStats(&_subsystems[subsystem]);
+}
+
+// returns a newly allocated allocator that counts the bytes and allocations it passes on to parent, and that must be
+// freed by calling CountingAllocatorFree() once everything allocated from it is freed
+BRAllocator *BRCountingAllocatorNew(const BRAllocator *parent) {
+    BRCountingAllocator *counting = calloc(1, sizeof(*counting));
+
+    assert(counting != NULL);
+    counting->allocator = (BRAllocator) { counting, _BRCountingAlloc, _BRCountingRealloc, _BRCountingFree };
+    counting->parent = parent;
+    return &counting->allocator;
+}
+
+// returns current allocation stats of counting
+BRAllocatorStats BRCountingAllocatorStats(const BRAllocator *counting) {
+    assert(counting != NULL);
+    assert(counting->alloc == _BRCountingAlloc);
+    return _BRCountingStats(counting->context);
+}
+
+// frees memory allocated for counting
+void BRCountingAllocatorFree(BRAllocator *counting) {
+    assert(counting != NULL);
+    assert(counting->alloc == _BRCountingAlloc);
+    free(counting->context);
+}
+
+static void *_BRArenaAlloc(void *context, size_t size) {
+    BRArenaAllocator *arena = context;
+    BRArenaBlock block, *last;
+    void *ptr = NULL;
+
+    size = (size + ALLOC_ALIGN - 1) & ~(size_t) (ALLOC_ALIGN - 1);
+    pthread_mutex_lock(&arena->lock);
+    last = (array_count(arena->blocks) > 0) ? &arena->blocks[array_count(arena->blocks) - 1] : NULL;
+
+    if (! last || last->used + size > last->size) {
+        block.size = (size > arena->blockSize) ? size : arena->blockSize;
+        block.buf = _parentAlloc(arena->parent, block.size);
+        block.used = 0;
+        if (block.buf) array_add(arena->blocks, block);
+        last = (block.buf) ? &arena->blocks[array_count(arena->blocks) - 1] : NULL;
+    }
+
+    if (last) {
+        ptr = &last->buf[last->used];
+        last->used += size;
+        arena->last = ptr;
+        arena->lastSize = size;
+    }
+
+    pthread_mutex_unlock(&arena->lock);
+    return ptr;
+}
+
+static void *_BRArenaRealloc(void *context, void *ptr, size_t oldSize, size_t newSize) {
+    BRArenaAllocator *arena = context;
+    BRArenaBlock *last;
+    void *newPtr = NULL;
+    size_t size = (newSize + ALLOC_ALIGN - 1) & ~(size_t) (ALLOC_ALIGN - 1);
+
+    if (! ptr) return _BRArenaAlloc(context, newSize);
+    pthread_mutex_lock(&arena->lock);
+    last = &arena->blocks[array_count(arena->blocks) - 1];
+
+    if (ptr == arena->last && last->used - arena->lastSize + size <= last->size) { // resize in place
+        last->used = last->used - arena->lastSize + size;
+        arena->lastSize = size;
+        newPtr = ptr;
+    }
+
+    pthread_mutex_unlock(&arena->lock);
+
+    if (! newPtr) {
+        newPtr = _BRArenaAlloc(context, newSize);
+        if (newPtr) memcpy(newPtr, ptr, (oldSize < newSize) ? oldSize : newSize);
+    }
+
+    return newPtr;
+}
+
+static void _BRArenaFree(void *context, void *ptr, size_t size) {
+    BRArenaAllocator *arena = context;
+
+    pthread_mutex_lock(&arena->lock);
+
+    if (ptr == arena->last) { // give back the most recent allocation
+        arena->blocks[array_count(arena->blocks) - 1].used -= arena->lastSize;
+        arena->last = NULL;
+        arena->lastSize = 0;
+    }
+
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// returns a newly allocated arena allocator that carves allocations out of blockSize blocks taken from parent, frees
+// are ignored and all memory is released at once by ArenaAllocatorReset() or ArenaAllocatorFree()
+BRAllocator *BRArenaAllocatorNew(size_t blockSize, const BRAllocator *parent) {
+    BRArenaAllocator *arena = calloc(1, sizeof(*arena));
+
+    assert(arena != NULL);
+    assert(blockSize > 0);
+    arena->allocator = (BRAllocator) { arena, _BRArenaAlloc, _BRArenaRealloc, _BRArenaFree };
+    arena->parent = parent;
+    arena->blockSize = blockSize;
+    array_new(arena->blocks, 10);
+    pthread_mutex_init(&arena->lock, NULL);
+    return &arena->allocator;
+}
+
+// releases everything allocated from arena, keeping its first block for reuse
+void BRArenaAllocatorReset(BRAllocator *allocator) {
+    BRArenaAllocator *arena;
+
+    assert(allocator != NULL);
+    assert(allocator->alloc == _BRArenaAlloc);
+    arena = allocator->context;
+    pthread_mutex_lock(&arena->lock);
+
+    while (array_count(arena->blocks) > 1) {
+        BRArenaBlock *block = &arena->blocks[array_count(arena->blocks) - 1];
+
+        BRAllocatorFree(arena->parent, block->buf, block->size);
+        array_rm_last(arena->blocks);
+    }
+
+    if (array_count(arena->blocks) > 0) arena->blocks[0].used = 0;
+    arena->last = NULL;
+    arena->lastSize = 0;
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// frees all memory allocated from arena and the arena itself
+void BRArenaAllocatorFree(BRAllocator *allocator) {
+    BRArenaAllocator *arena;
+
+    assert(allocator != NULL);
+    assert(allocator->alloc == _BRArenaAlloc);
+    arena = allocator->context;
+
+    for (size_t i = array_count(arena->blocks); i > 0; i--) {
+        BRAllocatorFree(arena->parent, arena->blocks[i - 1].buf, arena->blocks[i - 1].size);
+    }
+
+    array_free(arena->blocks);
+    pthread_mutex_destroy(&arena->lock);
+    free(arena);
+}
+
+static void *_BRSlabAlloc(void *context, size_t size) {
+    BRSlabAllocator *slab = context;
+    uint8_t *buf;
+    void *ptr;
+
+    if (size > slab->objectSize) return _parentAlloc(slab->parent, size);
+    pthread_mutex_lock(&slab->lock);
+
+    if (! slab->freeList) { // carve a new slab into free objects
+        buf = _parentAlloc(slab->parent, slab->objectSize*slab->slabCount);
+
+        if (buf) {
+            array_add(slab->slabs, buf);
+
+            for (size_t i = slab->slabCount; i > 0; i--) {
+                *(void **) &buf[(i - 1)*slab->objectSize] = slab->freeList;
+                slab->freeList = &buf[(i - 1)*slab->objectSize];
+            }
+        }
+    }
+
+    ptr = slab->freeList;
+    if (ptr) slab->freeList = *(void **) ptr;
+    pthread_mutex_unlock(&slab->lock);
+    return ptr;
+}
+
+static void _BRSlabFree(void *context, void *ptr, size_t size) {
+    BRSlabAllocator *slab = context;
+
+    if (size > slab->objectSize) {
+        BRAllocatorFree(slab->parent, ptr, size);
+    }
+    else {
+        pthread_mutex_lock(&slab->lock);
+        *(void **) ptr = slab->freeList;
+        slab->freeList = ptr;
+        pthread_mutex_unlock(&slab->lock);
+    }
+}
+
+static void *_BRSlabRealloc(void *context, void *ptr, size_t oldSize, size_t newSize) {
+    BRSlabAllocator *slab = context;
+    void *newPtr;
+
+    if (! ptr) return _BRSlabAlloc(context, newSize);
+    if (oldSize <= slab->objectSize && newSize <= slab->objectSize) return ptr;
+    if (oldSize > slab->objectSize && newSize > slab->objectSize)
+        return BRAllocatorRealloc(slab->parent, ptr, oldSize, newSize);
+
+    newPtr = _BRSlabAlloc(context, newSize); // moving between a slab and parent
+
+    if (newPtr) {
+        memcpy(newPtr, ptr, (oldSize < newSize) ? oldSize : newSize);
+        _BRSlabFree(context, ptr, oldSize);
+    }
+
+    return newPtr;
+}
+
+// returns a newly allocated slab allocator that hands out objectSize or smaller allocations from slabs of slabCount
+// objects taken from parent and reuses freed ones, larger allocations are passed on to parent
+BRAllocator *BRSlabAllocatorNew(size_t objectSize, size_t slabCount, const BRAllocator *parent) {
+    BRSlabAllocator *slab = calloc(1, sizeof(*slab));
+
+    assert(slab != NULL);
+    assert(objectSize > 0);
+    assert(slabCount > 0);
+    slab->allocator = (BRAllocator) { slab, _BRSlabAlloc, _BRSlabRealloc, _BRSlabFree };
+    slab->parent = parent;
+    slab->objectSize = (objectSize + ALLOC_ALIGN - 1) & ~(size_t) (ALLOC_ALIGN - 1);
+    slab->slabCount = slabCount;
+    array_new(slab->slabs, 10);
+    pthread_mutex_init(&slab->lock, NULL);
+    return &slab->allocator;
+}
+
+// frees the slabs of slab and slab itself, everything allocated from it must be freed first
+void BRSlabAllocatorFree(BRAllocator *allocator) {
+    BRSlabAllocator *slab;
+
+    assert(allocator != NULL);
+    assert(allocator->alloc == _BRSlabAlloc);
+    slab = allocator->context;
+
+    for (size_t i = array_count(slab->slabs); i > 0; i--) {
+        BRAllocatorFree(slab->parent, slab->slabs[i - 1], slab->objectSize*slab->slabCount);
+    }
+
+    array_free(slab->slabs);
+    pthread_mutex_destroy(&slab->lock);
+    free(slab);
+}
@@ -0,0 +1,129 @@
+//
+//  BRAllocator.h
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef BRAllocator_h
+#define BRAllocator_h
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a source of memory for core objects, callers pass the size back when they resize or free memory, so allocators
+// don't need per allocation headers
+// a NULL allocator means the system heap (calloc, realloc and free)
+typedef struct {
+    void *context;
+    void *(*alloc)(void *context, size_t size); // returns size bytes, or NULL
+    void *(*realloc)(void *context, void *ptr, size_t oldSize, size_t newSize); // like realloc(), ptr may be NULL
+    void (*free)(void *context, void *ptr, size_t size); // size is what ptr was last allocated with
+} BRAllocator;
+
+typedef struct {
+    size_t bytes; // bytes currently allocated
+    size_t count; // allocations currently live
+    size_t peakBytes; // most bytes allocated at once
+    uint64_t allocations; // allocations made in total, including resizes
+} BRAllocatorStats;
+
+// core subsystems that allocate through their own counting allocator
+typedef enum {
+    BR_ALLOC_PEER = 0, // peers and the peer manager
+    BR_ALLOC_CHAIN, // merkle blocks and the block chain
+    BR_ALLOC_WALLET, // wallets and their address chains and indexes
+    BR_ALLOC_TX, // transactions, their inputs, outputs and scripts
+    BR_ALLOC_SUBSYSTEM_COUNT
+} BRAllocatorSubsystem;
+
+// returns size bytes of zeroed memory from allocator
+inline static void *BRAllocatorCalloc(const BRAllocator *allocator, size_t size)
+{
+    void *ptr;
+
+    if (! allocator) return calloc(1, size);
+    ptr = allocator->alloc(allocator->context, size);
+    if (ptr) memset(ptr, 0, size);
+    return ptr;
+}
+
+// resizes ptr, which was allocated from allocator with oldSize bytes, to newSize bytes, and returns its new location
+inline static void *BRAllocatorRealloc(const BRAllocator *allocator, void *ptr, size_t oldSize, size_t newSize)
+{
+    return (allocator) ? allocator->realloc(allocator->context, ptr, oldSize, newSize) : realloc(ptr, newSize);
+}
+
+// returns ptr, which was allocated from allocator with size bytes, to allocator
+inline static void BRAllocatorFree(const BRAllocator *allocator, void *ptr, size_t size)
+{
+    if (! allocator) free(ptr);
+    else if (ptr) allocator->free(allocator->context, ptr, size);
+}
+
+// returns the counting allocator of subsystem
+const BRAllocator *BRAllocatorForSubsystem(BRAllocatorSubsystem subsystem);
+
+// sets the allocator that the subsystem's counting allocator draws from, NULL for the system heap, this must be done
+// before any object of the subsystem is created, since its memory is freed to the parent it was allocated from
+void BRAllocatorSetSubsystemParent(BRAllocatorSubsystem subsystem, const BRAllocator *parent);
+
+// returns current allocation stats of subsystem
+BRAllocatorStats BRAllocatorSubsystemStats(BRAllocatorSubsystem subsystem);
+
+// returns a newly allocated allocator that counts the bytes and allocations it passes on to parent, and that must be
+// freed by calling CountingAllocatorFree() once everything allocated from it is freed
+BRAllocator *BRCountingAllocatorNew(const BRAllocator *parent);
+
+// returns current allocation stats of counting
+BRAllocatorStats BRCountingAllocatorStats(const BRAllocator *counting);
+
+// frees memory allocated for counting
+void BRCountingAllocatorFree(BRAllocator *counting);
+
+// returns a newly allocated arena allocator that carves allocations out of blockSize blocks taken from parent, frees
+// are ignored and all memory is released at once by ArenaAllocatorReset() or ArenaAllocatorFree()
+BRAllocator *BRArenaAllocatorNew(size_t blockSize, const BRAllocator *parent);
+
+// releases everything allocated from arena, keeping its first block for reuse
+void BRArenaAllocatorReset(BRAllocator *arena);
+
+// frees all memory allocated from arena and the arena itself
+void BRArenaAllocatorFree(BRAllocator *arena);
+
+// returns a newly allocated slab allocator that hands out objectSize or smaller allocations from slabs of slabCount
+// objects taken from parent and reuses freed ones, larger allocations are passed on to parent
+BRAllocator *BRSlabAllocatorNew(size_t objectSize, size_t slabCount, const BRAllocator *parent);
+
+// frees the slabs of slab and slab itself, everything allocated from it must be freed first
+void BRSlabAllocatorFree(BRAllocator *slab);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRAllocator_h
@@ -25,6 +25,7 @@
 #ifndef Array_h
 #define Array_h
 
+#include "BRAllocator.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -58,23 +59,37 @@ extern "C" {
 //
 // NOTE: when new items are added to an array past its current capacity, its memory location may change, so other
 // references to it or its members must be updated
+//
+// an array remembers the allocator it was created with, array_new() uses the system heap and
+// array_new_with_allocator() any BRAllocator, and it grows and is freed through that allocator
+
+// allocator, unused word that keeps items 16 byte aligned on 32bit, capacity, count
+#define _ARRAY_HEADER_SIZE (sizeof(size_t)*4)
 
-#define array_new(array, capacity) do {\
+#define array_new(array, capacity) array_new_with_allocator(array, capacity, NULL)
+
+#define array_new_with_allocator(array, capacity, allocator) do {\
     size_t _array_cap = (capacity);\
+    const BRAllocator *_array_alloc = (allocator);\
     assert(_array_cap >= 0);\
-    (array) = (void *)((size_t *)calloc(1, _array_cap*sizeof(*(array)) + sizeof(size_t)*2) + 2);\
+    (array) = (void *)((size_t *)BRAllocatorCalloc(_array_alloc, _array_cap*sizeof(*(array)) + _ARRAY_HEADER_SIZE) + 4);\
     assert((array) != NULL);\
+    array_allocator(array) = _array_alloc;\
     array_capacity(array) = _array_cap;\
     array_count(array) = 0;\
 } while (0)
 
+#define array_allocator(array) (*(const BRAllocator **)((size_t *)(array) - 4))
+
 #define array_capacity(array) (((size_t *)(array))[-2])
 
 #define array_set_capacity(array, capacity) do {\
     size_t _array_cap = (capacity);\
     assert((array) != NULL);\
     assert(_array_cap >= array_count(array));\
-    (array) = (void *)((size_t *)realloc((size_t *)(array) - 2, _array_cap*sizeof(*(array)) + sizeof(size_t)*2) + 2);\
+    (array) = (void *)((size_t *)BRAllocatorRealloc(array_allocator(array), (size_t *)(array) - 4,\
+                                                    array_capacity(array)*sizeof(*(array)) + _ARRAY_HEADER_SIZE,\
+                                                    _array_cap*sizeof(*(array)) + _ARRAY_HEADER_SIZE) + 4);\
     assert((array) != NULL);\
     if (_array_cap > array_capacity(array))\
         memset((array) + array_capacity(array), 0, (_array_cap - array_capacity(array))*sizeof(*(array)));\
@@ -174,7 +189,8 @@ extern "C" {
 
 #define array_free(array) do {\
     assert((array) != NULL);\
-    free((size_t *)(array) - 2);\
+    BRAllocatorFree(array_allocator(array), (size_t *)(array) - 4,\
+                    array_capacity(array)*sizeof(*(array)) + _ARRAY_HEADER_SIZE);\
 } while (0)
 
 #ifdef __cplusplus
@@ -778,7 +778,7 @@ void showAsset(BRAsset* asset){
 
 void CopyAsset(BRAsset *asst, BRTransaction *tx) {
     tx->asset = NewAsset();
-    tx->asset->name = malloc(asst->nameLen);
+    tx->asset->name = malloc(asst->nameLen + 1);
     strcpy(tx->asset->name, asst->name);
     tx->asset->nameLen = asst->nameLen;
     tx->asset->amount = asst->amount;
@@ -34,48 +34,75 @@
 
 // bech32 address format: https://github.com/bitcoin/bips/blob/master/bip-0173.mediawiki
 
-#define polymod(x) ((((x) & 0x1ffffff) << 5) ^ (-(((x) >> 25) & 1) & 0x3b6a57b2) ^\
-                    (-(((x) >> 26) & 1) & 0x26508e6d) ^ (-(((x) >> 27) & 1) & 0x1ea119fa) ^\
-                    (-(((x) >> 28) & 1) & 0x3d4233dd) ^ (-(((x) >> 29) & 1) & 0x2a1462b3))
+// generator terms for the top 5 bits of the checksum, so each polymod step is one shift, one lookup and one xor
+static const uint32_t _polymodTable[32] = {
+    0x00000000, 0x3b6a57b2, 0x26508e6d, 0x1d3ad9df, 0x1ea119fa, 0x25cb4e48, 0x38f19797, 0x039bc025,
+    0x3d4233dd, 0x0628646f, 0x1b12bdb0, 0x2078ea02, 0x23e32a27, 0x18897d95, 0x05b3a44a, 0x3ed9f3f8,
+    0x2a1462b3, 0x117e3501, 0x0c44ecde, 0x372ebb6c, 0x34b57b49, 0x0fdf2cfb, 0x12e5f524, 0x298fa296,
+    0x1756516e, 0x2c3c06dc, 0x3106df03, 0x0a6c88b1, 0x09f74894, 0x329d1f26, 0x2fa7c6f9, 0x14cd914b
+};
 
-// returns the number of bytes written to data42 (maximum of 42)
-size_t BRBech32Decode(char *hrp84, uint8_t *data42, const char *addr)
+#define polymod(x) ((((x) & 0x1ffffff) << 5) ^ _polymodTable[((x) >> 25) & 0x1f])
+
+static const char _chars[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+// bech32 digit for each ascii character, either case, or -1 if it isn't a bech32 digit
+static const int8_t _charsRev[128] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    15, -1, 10, 17, 21, 20, 26, 30,  7,  5, -1, -1, -1, -1, -1, -1,
+    -1, 29, -1, 24, 13, 25,  9,  8, 23, -1, 18, 22, 31, 27, 19, -1,
+     1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1,
+    -1, 29, -1, 24, 13, 25,  9,  8, 23, -1, 18, 22, 31, 27, 19, -1,
+     1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1
+};
+
+// checksum state after the expanded human readable part, hrp may be in either case
+static uint32_t _BRBech32HrpChk(const char *hrp, size_t hrpLen)
 {
-    size_t i, j, bufLen, addrLen, sep;
-    uint32_t x, chk = 1;
-    uint8_t c, ver = 0xff, buf[52], upper = 0, lower = 0;
+    uint32_t chk = 1;
+    size_t i;
+    
+    for (i = 0; i < hrpLen; i++) chk = polymod(chk) ^ (tolower(hrp[i]) >> 5);
+    chk = polymod(chk);
+    for (i = 0; i < hrpLen; i++) chk = polymod(chk) ^ (hrp[i] & 0x1f);
+    return chk;
+}
 
-    assert(hrp84 != NULL);
-    assert(data42 != NULL);
-    assert(addr != NULL);
+// checks addr for invalid characters, mixed case and length, and finds the separator
+// returns the length of addr, or 0 if it isn't a well formed bech32 string
+static size_t _BRBech32Scan(const char *addr, size_t *sep)
+{
+    size_t i, addrLen;
+    uint8_t upper = 0, lower = 0;
     
     for (i = 0; addr && addr[i]; i++) {
         if (addr[i] < 33 || addr[i] > 126) return 0;
-        if (islower(addr[i])) lower = 1;
-        if (isupper(addr[i])) upper = 1;
+        if (addr[i] >= 'a' && addr[i] <= 'z') lower = 1;
+        if (addr[i] >= 'A' && addr[i] <= 'Z') upper = 1;
     }
+    
+    addrLen = *sep = i;
+    while (*sep > 0 && addr[*sep] != '1') (*sep)--;
+    if (addrLen < 8 || addrLen > 90 || *sep < 1 || *sep + 2 + 6 > addrLen || (upper && lower)) return 0;
+    return addrLen;
+}
 
-    addrLen = sep = i;
-    while (sep > 0 && addr[sep] != '1') sep--;
-    if (addrLen < 8 || addrLen > 90 || sep < 1 || sep + 2 + 6 > addrLen || (upper && lower)) return 0;
-    for (i = 0; i < sep; i++) chk = polymod(chk) ^ (tolower(addr[i]) >> 5);
-    chk = polymod(chk);
-    for (i = 0; i < sep; i++) chk = polymod(chk) ^ (addr[i] & 0x1f);
+// decodes the data part of addr following the separator, chk is the checksum state after the human readable part
+// returns the number of bytes written to data42 (maximum of 42), or 0 if the data or checksum is invalid
+static size_t _BRBech32DecodeData(uint8_t *data42, uint32_t chk, const char *addr, size_t sep, size_t addrLen)
+{
+    size_t i, j, bufLen;
+    uint32_t x;
+    int8_t c;
+    uint8_t ver = 0xff, buf[52];
+    
     memset(buf, 0, sizeof(buf));
-
+    
     for (i = sep + 1, j = -1; i < addrLen; i++, j++) {
-        switch (tolower(addr[i])) {
-            case 'q': c = 0;  break; case 'p': c = 1;  break; case 'z': c = 2;  break; case 'r': c = 3;  break;
-            case 'y': c = 4;  break; case '9': c = 5;  break; case 'x': c = 6;  break; case '8': c = 7;  break;
-            case 'g': c = 8;  break; case 'f': c = 9;  break; case '2': c = 10; break; case 't': c = 11; break;
-            case 'v': c = 12; break; case 'd': c = 13; break; case 'w': c = 14; break; case '0': c = 15; break;
-            case 's': c = 16; break; case '3': c = 17; break; case 'j': c = 18; break; case 'n': c = 19; break;
-            case '5': c = 20; break; case '4': c = 21; break; case 'k': c = 22; break; case 'h': c = 23; break;
-            case 'c': c = 24; break; case 'e': c = 25; break; case '6': c = 26; break; case 'm': c = 27; break;
-            case 'u': c = 28; break; case 'a': c = 29; break; case '7': c = 30; break; case 'l': c = 31; break;
-            default: return 0; // invalid bech32 digit
-        }
-        
+        c = _charsRev[(uint8_t)addr[i] & 0x7f];
+        if (c < 0) return 0; // invalid bech32 digit
         chk = polymod(chk) ^ c;
         if (j == -1) ver = c;
         if (j == -1 || i + 6 >= addrLen) continue;
@@ -85,61 +112,145 @@ size_t BRBech32Decode(char *hrp84, uint8_t *data42, const char *addr)
     }
     
     bufLen = (addrLen - (sep + 2 + 6))*5/8;
-    if (hrp84 == NULL || data42 == NULL || chk != 1 || ver > 16 || bufLen < 2 || bufLen > 40) return 0;
-    assert(sep < 84);
-    for (i = 0; i < sep; i++) hrp84[i] = tolower(addr[i]);
-    hrp84[sep] = '\0';
+    if (chk != 1 || ver > 16 || bufLen < 2 || bufLen > 40) return 0;
     data42[0] = (ver == 0) ? OP_0 : ver + OP_1 - 1;
     data42[1] = bufLen;
-    assert(bufLen <= 40);
     memcpy(&data42[2], buf, bufLen);
     return 2 + bufLen;
 }
 
-// data must contain a valid BIP141 witness program
-// returns the number of bytes written to addr91 (maximum of 91)
-size_t BRBech32Encode(char *addr91, const char *hrp, const uint8_t data[])
+// returns the number of bytes written to data42 (maximum of 42)
+size_t BRBech32Decode(char *hrp84, uint8_t *data42, const char *addr)
 {
-    static const char chars[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
-    char addr[91];
-    uint32_t x, chk = 1;
-    uint8_t ver, a, b = 0, c = 0;
-    size_t i, j, len;
+    size_t i, addrLen, sep, len;
 
-    assert(addr91 != NULL);
+    assert(hrp84 != NULL);
+    assert(data42 != NULL);
+    assert(addr != NULL);
+    
+    addrLen = _BRBech32Scan(addr, &sep);
+    if (addrLen == 0 || hrp84 == NULL || data42 == NULL) return 0;
+    len = _BRBech32DecodeData(data42, _BRBech32HrpChk(addr, sep), addr, sep, addrLen);
+    if (len == 0) return 0;
+    assert(sep < 84);
+    for (i = 0; i < sep; i++) hrp84[i] = tolower(addr[i]);
+    hrp84[sep] = '\0';
+    return len;
+}
+
+// decodes count addresses that all have the human readable part hrp, which is only checksummed once
+// writes each witness program to data42s[i] and its length to dataLens[i], or 0 if addrs[i] is invalid or has another hrp
+// returns the number of addresses successfully decoded
+size_t BRBech32DecodeBatch(uint8_t data42s[][42], size_t dataLens[], const char *hrp, const char *addrs[], size_t count)
+{
+    size_t i, j, addrLen, sep, hrpLen, n = 0;
+    uint32_t chk;
+    
+    assert(data42s != NULL || count == 0);
+    assert(dataLens != NULL || count == 0);
     assert(hrp != NULL);
-    assert(data != NULL);
+    assert(addrs != NULL || count == 0);
     
-    for (i = 0; hrp && hrp[i]; i++) {
-        if (i > 83 || hrp[i] < 33 || hrp[i] > 126 || isupper(hrp[i])) return 0;
-        chk = polymod(chk) ^ (hrp[i] >> 5);
-        addr[i] = hrp[i];
+    hrpLen = strlen(hrp);
+    chk = _BRBech32HrpChk(hrp, hrpLen);
+    
+    for (i = 0; i < count; i++) {
+        dataLens[i] = 0;
+        addrLen = _BRBech32Scan(addrs[i], &sep);
+        if (addrLen == 0 || sep != hrpLen) continue;
+        for (j = 0; j < sep && tolower(addrs[i][j]) == hrp[j]; j++);
+        if (j < sep) continue;
+        dataLens[i] = _BRBech32DecodeData(data42s[i], chk, addrs[i], sep, addrLen);
+        if (dataLens[i] > 0) n++;
     }
     
-    chk = polymod(chk);
-    for (j = 0; j < i; j++) chk = polymod(chk) ^ (hrp[j] & 0x1f);
-    addr[i++] = '1';
-    if (i < 1 || data == NULL || (data[0] > OP_0 && data[0] < OP_1)) return 0;
+    return n;
+}
+
+// writes the data part and checksum of a witness program to addr starting at off, chk is the checksum state after hrp
+// returns the total number of bytes written to addr including the terminating NULL, or 0 if data is invalid
+static size_t _BRBech32EncodeData(char *addr, size_t off, uint32_t chk, const uint8_t data[])
+{
+    uint32_t x;
+    uint8_t ver, a, b = 0, c = 0;
+    size_t i = off, j, len;
+    
+    if (data == NULL || (data[0] > OP_0 && data[0] < OP_1)) return 0;
     ver = (data[0] >= OP_1) ? data[0] + 1 - OP_1 : 0;
     len = data[1];
     if (ver > 16 || len < 2 || len > 40 || i + 1 + len + 6 >= 91) return 0;
     chk = polymod(chk) ^ ver;
-    addr[i++] = chars[ver];
+    addr[i++] = _chars[ver];
     
     for (j = 0; j <= len; j++) {
         a = b, b = (j < len) ? data[2 + j] : 0;
         x = (j % 5)*8 - ((j % 5)*8/5)*5;
         c = ((a << (5 - x)) | (b >> (3 + x))) & 0x1f;
-        if (j < len || j % 5 > 0) chk = polymod(chk) ^ c, addr[i++] = chars[c];
+        if (j < len || j % 5 > 0) chk = polymod(chk) ^ c, addr[i++] = _chars[c];
         if (x >= 2) c = (b >> (x - 2)) & 0x1f;
-        if (x >= 2 && j < len) chk = polymod(chk) ^ c, addr[i++] = chars[c];
+        if (x >= 2 && j < len) chk = polymod(chk) ^ c, addr[i++] = _chars[c];
     }
     
     for (j = 0; j < 6; j++) chk = polymod(chk);
     chk ^= 1;
-    for (j = 0; j < 6; ++j) addr[i++] = chars[(chk >> ((5 - j)*5)) & 0x1f];
+    for (j = 0; j < 6; ++j) addr[i++] = _chars[(chk >> ((5 - j)*5)) & 0x1f];
     addr[i++] = '\0';
-    memcpy(addr91, addr, i);
     return i;
 }
 
+// writes hrp and the separator to addr, returns the number of bytes written, or 0 if hrp is invalid
+static size_t _BRBech32EncodeHrp(char *addr, const char *hrp)
+{
+    size_t i;
+    
+    for (i = 0; hrp && hrp[i]; i++) {
+        if (i > 83 || hrp[i] < 33 || hrp[i] > 126 || isupper(hrp[i])) return 0;
+        addr[i] = hrp[i];
+    }
+    
+    if (i < 1) return 0;
+    addr[i++] = '1';
+    return i;
+}
+
+// data must contain a valid BIP141 witness program
+// returns the number of bytes written to addr91 (maximum of 91)
+size_t BRBech32Encode(char *addr91, const char *hrp, const uint8_t data[])
+{
+    char addr[91];
+    size_t i;
+
+    assert(addr91 != NULL);
+    assert(hrp != NULL);
+    assert(data != NULL);
+    
+    i = _BRBech32EncodeHrp(addr, hrp);
+    if (i > 0) i = _BRBech32EncodeData(addr, i, _BRBech32HrpChk(hrp, i - 1), data);
+    if (i > 0) memcpy(addr91, addr, i);
+    return i;
+}
+
+// encodes count BIP141 witness programs with the same human readable part, which is only checksummed once
+// writes each address to addrs91[i], or an empty string if data[i] isn't a valid witness program
+// returns the number of addresses successfully encoded
+size_t BRBech32EncodeBatch(char addrs91[][91], const char *hrp, const uint8_t *data[], size_t count)
+{
+    char addr[91];
+    size_t i, len, hrpLen, n = 0;
+    uint32_t chk;
+    
+    assert(addrs91 != NULL || count == 0);
+    assert(hrp != NULL);
+    assert(data != NULL || count == 0);
+    
+    hrpLen = _BRBech32EncodeHrp(addr, hrp);
+    chk = (hrpLen > 0) ? _BRBech32HrpChk(hrp, hrpLen - 1) : 0;
+    
+    for (i = 0; i < count; i++) {
+        len = (hrpLen > 0) ? _BRBech32EncodeData(addr, hrpLen, chk, data[i]) : 0;
+        if (len > 0) memcpy(addrs91[i], addr, len), n++;
+        else addrs91[i][0] = '\0';
+    }
+    
+    return n;
+}
@@ -38,10 +38,20 @@ extern "C" {
 // returns the number of bytes written to data42 (maximum of 42)
 size_t BRBech32Decode(char *hrp84, uint8_t *data42, const char *addr);
 
+// decodes count addresses that all have the human readable part hrp, which is only checksummed once
+// writes each witness program to data42s[i] and its length to dataLens[i], or 0 if addrs[i] is invalid or has another hrp
+// returns the number of addresses successfully decoded
+size_t BRBech32DecodeBatch(uint8_t data42s[][42], size_t dataLens[], const char *hrp, const char *addrs[], size_t count);
+
 // data must contain a valid BIP141 witness program
 // returns the number of bytes written to addr91 (maximum of 91)
 size_t BRBech32Encode(char *addr91, const char *hrp, const uint8_t data[]);
 
+// encodes count BIP141 witness programs with the same human readable part, which is only checksummed once
+// writes each address to addrs91[i], or an empty string if data[i] isn't a valid witness program
+// returns the number of addresses successfully encoded
+size_t BRBech32EncodeBatch(char addrs91[][91], const char *hrp, const uint8_t *data[], size_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -97,13 +97,18 @@ BRBloomFilter *BRBloomFilterParse(const uint8_t *buf, size_t bufLen)
     return filter;
 }
 
+// returns the exact length of BloomFilterSerialize() output without serializing
+size_t BRBloomFilterSerializedSize(const BRBloomFilter *filter)
+{
+    assert(filter != NULL);
+    return BRVarIntSize(filter->length) + filter->length + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t);
+}
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL
 size_t BRBloomFilterSerialize(const BRBloomFilter *filter, uint8_t *buf, size_t bufLen)
 {
-    size_t off = 0,
-           len = BRVarIntSize(filter->length) + filter->length + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t);
+    size_t off = 0, len = BRBloomFilterSerializedSize(filter);
     
-    assert(filter != NULL);
     assert(buf != NULL || bufLen == 0);
     
     if (buf && len <= bufLen) {
@@ -62,6 +62,9 @@ BRBloomFilter *BRBloomFilterNew(double falsePositiveRate, size_t elemCount, uint
 // returns a bloom filter struct that must be freed by calling BloomFilterFree()
 BRBloomFilter *BRBloomFilterParse(const uint8_t *buf, size_t bufLen);
 
+// returns the exact length of BloomFilterSerialize() output without serializing
+size_t BRBloomFilterSerializedSize(const BRBloomFilter *filter);
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL
 size_t BRBloomFilterSerialize(const BRBloomFilter *filter, uint8_t *buf, size_t bufLen);
 
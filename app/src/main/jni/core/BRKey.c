@@ -295,25 +295,11 @@ UInt160 BRKeyHash160(BRKey *key)
 size_t BRKeyAddress(BRKey *key, char *addr, size_t addrLen)
 {
     UInt160 hash;
-    uint8_t data[21];
 
     assert(key != NULL);
     
     hash = BRKeyHash160(key);
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS;
-#if TESTNET
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS_TEST;
-#elif REGTEST
-    data[0] = RAVENCOIN_PUBKEY_ADDRESS_REGTEST;
-#endif
-    UInt160Set(&data[1], hash);
-
-    if (! UInt160IsZero(hash)) {
-        addrLen = BRBase58CheckEncode(addr, addrLen, data, sizeof(data));
-    }
-    else addrLen = 0;
-    
-    return addrLen;
+    return (! UInt160IsZero(hash)) ? BRAddressFromHash160(addr, addrLen, &hash) : 0;
 }
 
 // signs md with key and writes signature to sig
@@ -25,6 +25,7 @@
 #include "BRMerkleBlock.h"
 #include "BRCrypto.h"
 #include "BRAddress.h"
+#include "BRAllocator.h"
 #include <stdlib.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -33,6 +34,8 @@
 #include "crypto/ethash/progpow.hpp"
 #include "BRPeer.h"
 
+#define CHAIN_ALLOCATOR BRAllocatorForSubsystem(BR_ALLOC_CHAIN)
+
 #ifdef TESTNET
 #define MAX_PROOF_OF_WORK       0x207fffff  // highest value for difficulty target (higher values are less difficult)
 #elif REGTEST
@@ -84,7 +87,7 @@ inline static int _ceil_log2(int x) {
 
 // returns a newly allocated merkle block struct that must be freed by calling MerkleBlockFree()
 BRMerkleBlock *BRMerkleBlockNew(void) {
-    BRMerkleBlock *block = calloc(1, sizeof(*block));
+    BRMerkleBlock *block = BRAllocatorCalloc(CHAIN_ALLOCATOR, sizeof(*block));
 
     assert(block != NULL);
 
@@ -142,13 +145,13 @@ BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen, void* peer)
             block->hashesCount = (size_t) BRVarInt(&buf[off], (off <= bufLen ? bufLen - off : 0), &len);
             off += len;
             len = block->hashesCount * sizeof(UInt256);
-            block->hashes = (off + len <= bufLen) ? malloc(len) : NULL;
+            block->hashes = (off + len <= bufLen) ? BRAllocatorRealloc(CHAIN_ALLOCATOR, NULL, 0, len) : NULL;
             if (block->hashes) memcpy(block->hashes, &buf[off], len);
             off += len;
             block->flagsLen = (size_t) BRVarInt(&buf[off], (off <= bufLen ? bufLen - off : 0), &len);
             off += len;
             len = block->flagsLen;
-            block->flags = (off + len <= bufLen) ? malloc(len) : NULL;
+            block->flags = (off + len <= bufLen) ? BRAllocatorRealloc(CHAIN_ALLOCATOR, NULL, 0, len) : NULL;
             if (block->flags) memcpy(block->flags, &buf[off], len);
         }
 
@@ -202,9 +205,33 @@ BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen, void* peer)
     return block;
 }
 
-// returns number of bytes written to buf, or total bufLen needed if buf is NULL (block->height is not serialized)
-size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t bufLen) {
-    size_t off = 0, len = 80;
+// decodes the count headers of a headers message body in one pass, each an 80 byte header, or a 120 byte KAWPOW header
+// if its timestamp is past KAWPOW_ActivationTime, followed by a varint tx count, and fills in a view of each
+// returns number of bytes decoded, or 0 if the headers don't fit in bufLen
+size_t BRMerkleBlockDecodeHeaders(BRMerkleBlockHeaderView views[], size_t count, const uint8_t *buf, size_t bufLen) {
+    size_t off = 0, len = 0;
+
+    assert(views != NULL || count == 0);
+    assert(buf != NULL || bufLen == 0);
+
+    for (size_t i = 0; i < count; i++) {
+        if (off + 80 > bufLen) return 0;
+        views[i].offset = off;
+        views[i].timestamp = UInt32GetLE(&buf[off + 68]);
+        views[i].len = (views[i].timestamp < KAWPOW_ActivationTime) ? 80 : 120;
+        off += views[i].len;
+        if (off >= bufLen) return 0;
+        BRVarInt(&buf[off], bufLen - off, &len);
+        if (len == 0) return 0;
+        off += len;
+    }
+
+    return off;
+}
+
+// returns the exact length of MerkleBlockSerialize() output without serializing
+size_t BRMerkleBlockSerializedSize(const BRMerkleBlock *block) {
+    size_t len = 80;
 
     assert(block != NULL);
 
@@ -216,6 +243,13 @@ size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t b
                 BRVarIntSize(block->flagsLen) + block->flagsLen;
     }
 
+    return len;
+}
+
+// returns number of bytes written to buf, or total bufLen needed if buf is NULL (block->height is not serialized)
+size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t bufLen) {
+    size_t off = 0, len = BRMerkleBlockSerializedSize(block);
+
     if (buf && len <= bufLen) {
         UInt32SetLE(&buf[off], block->version);
         off += sizeof(uint32_t);
@@ -296,12 +330,14 @@ void BRMerkleBlockSetTxHashes(BRMerkleBlock *block, const UInt256 *hashes, size_
     assert(hashes != NULL || hashesCount == 0);
     assert(flags != NULL || flagsLen == 0);
 
-    if (block->hashes) free(block->hashes);
-    block->hashes = (hashesCount > 0) ? malloc(hashesCount * sizeof(UInt256)) : NULL;
+    BRAllocatorFree(CHAIN_ALLOCATOR, block->hashes, block->hashesCount*sizeof(UInt256));
+    block->hashes = (hashesCount > 0) ? BRAllocatorRealloc(CHAIN_ALLOCATOR, NULL, 0, hashesCount*sizeof(UInt256)) : NULL;
     if (block->hashes) memcpy(block->hashes, hashes, hashesCount * sizeof(UInt256));
-    if (block->flags) free(block->flags);
-    block->flags = (flagsLen > 0) ? malloc(flagsLen) : NULL;
+    block->hashesCount = hashesCount;
+    BRAllocatorFree(CHAIN_ALLOCATOR, block->flags, block->flagsLen);
+    block->flags = (flagsLen > 0) ? BRAllocatorRealloc(CHAIN_ALLOCATOR, NULL, 0, flagsLen) : NULL;
     if (block->flags) memcpy(block->flags, flags, flagsLen);
+    block->flagsLen = flagsLen;
 }
 
 // recursively walks the merkle tree to calculate the merkle root
@@ -363,6 +399,42 @@ int BRMerkleBlockIsValid(const BRMerkleBlock *block, uint32_t currentTime) {
     return r;
 }
 
+// true if block->mix_hash is the KAWPOW mix of the header, recomputed from the epoch's light cache, or if the block
+// predates KAWPOW
+// NOTE: MerkleBlockIsValid() only checks the final hash, which light_verify() derives from the stated mix_hash, so a
+// header with a forged mix passes it - this recomputes the mix, at the cost of a ~70MB light cache for the current epoch
+int BRMerkleBlockVerifyMix(const BRMerkleBlock *block) {
+    const struct ethash_epoch_context *context;
+    union ethash_hash256 header_hash, mix_hash;
+    uint8_t buf[80];
+    UInt256 hash;
+    size_t off = 0;
+
+    assert(block != NULL);
+    if (block->timestamp < KAWPOW_ActivationTime) return 1;
+    if (block->height == BLOCK_UNKNOWN_HEIGHT) return 0;
+
+    UInt32SetLE(&buf[off], block->version);
+    off += sizeof(uint32_t);
+    UInt256Set(&buf[off], block->prevBlock);
+    off += sizeof(UInt256);
+    UInt256Set(&buf[off], block->merkleRoot);
+    off += sizeof(UInt256);
+    UInt32SetLE(&buf[off], block->timestamp);
+    off += sizeof(uint32_t);
+    UInt32SetLE(&buf[off], block->target);
+    off += sizeof(uint32_t);
+    UInt32SetLE(&buf[off], block->height);
+    SHA256_2(&hash, buf, sizeof(buf));
+    memcpy(header_hash.bytes, UInt256Reverse(hash).u8, sizeof(header_hash));
+    memcpy(mix_hash.bytes, UInt256Reverse(block->mix_hash).u8, sizeof(mix_hash));
+
+    // the global context is kept for the last epoch asked for, and the period's program is cached in progpow.cpp, so a
+    // batch of headers in height order only rebuilds either when it crosses an epoch or period boundary
+    context = ethash_get_global_epoch_context((int) (block->height / ETHASH_EPOCH_LENGTH));
+    return (context && progpow_verify(context, (int) block->height, &header_hash, &mix_hash, block->nonce64));
+}
+
 // true if the given tx hash is known to be included in the block
 int MerkleBlockContainsTxHash(const BRMerkleBlock *block, UInt256 txHash) {
     int r = 0;
@@ -504,7 +576,7 @@ int DarkGravityWaveTarget(const BRMerkleBlock *previous, const BRSet *blockSet)
 void BRMerkleBlockFree(BRMerkleBlock *block) {
     assert(block != NULL);
 
-    if (block->hashes) free(block->hashes);
-    if (block->flags) free(block->flags);
-    free(block);
+    BRAllocatorFree(CHAIN_ALLOCATOR, block->hashes, block->hashesCount*sizeof(UInt256));
+    BRAllocatorFree(CHAIN_ALLOCATOR, block->flags, block->flagsLen);
+    BRAllocatorFree(CHAIN_ALLOCATOR, block, sizeof(*block));
 }
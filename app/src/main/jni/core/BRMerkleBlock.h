@@ -74,6 +74,13 @@ typedef struct {
     uint32_t height;
 } BRMerkleBlock;
 
+// a header inside a headers message, decoded by MerkleBlockDecodeHeaders() without copying it
+typedef struct {
+    size_t offset; // from the start of the decoded buffer
+    size_t len; // 80, or 120 for a KAWPOW header
+    uint32_t timestamp;
+} BRMerkleBlockHeaderView;
+
 #define BR_MERKLE_BLOCK_NONE\
     ((const BRMerkleBlock) { UINT256_ZERO, 0, UINT256_ZERO, UINT256_ZERO, 0, 0, 0, 0, NULL, 0, NULL, 0, 0 })
 
@@ -87,6 +94,14 @@ BRMerkleBlock *BRMerkleBlockCopy(const BRMerkleBlock *block);
 // returns a merkle block struct that must be freed by calling MerkleBlockFree()
 BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen, void* peer);
 
+// decodes the count headers of a headers message body in one pass, each an 80 byte header, or a 120 byte KAWPOW header
+// if its timestamp is past KAWPOW_ActivationTime, followed by a varint tx count, and fills in a view of each
+// returns number of bytes decoded, or 0 if the headers don't fit in bufLen
+size_t BRMerkleBlockDecodeHeaders(BRMerkleBlockHeaderView views[], size_t count, const uint8_t *buf, size_t bufLen);
+
+// returns the exact length of MerkleBlockSerialize() output without serializing
+size_t BRMerkleBlockSerializedSize(const BRMerkleBlock *block);
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL (block->height is not serialized)
 size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t bufLen);
 
@@ -103,6 +118,10 @@ void BRMerkleBlockSetTxHashes(BRMerkleBlock *block, const UInt256 *hashes, size_
 // target is correct for the block's height in the chain - use MerkleBlockVerifyDifficulty() for that
 int BRMerkleBlockIsValid(const BRMerkleBlock *block, uint32_t currentTime);
 
+// true if block->mix_hash is the KAWPOW mix of the header, recomputed from the epoch's light cache, or if the block
+// predates KAWPOW
+int BRMerkleBlockVerifyMix(const BRMerkleBlock *block);
+
 // true if the given tx hash is known to be included in the block
 int MerkleBlockContainsTxHash(const BRMerkleBlock *block, UInt256 txHash);
 
@@ -28,6 +28,8 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <time.h>
 
 // BIP70 payment protocol: https://github.com/bitcoin/bips/blob/master/bip-0070.mediawiki
 // BIP75 payment protocol encryption: https://github.com/bitcoin/bips/blob/master/bip-0075.mediawiki
@@ -42,6 +44,33 @@ typedef struct {
     uint8_t *unknown;
 } ProtoBufContext;
 
+// payment requests are displayed, validated and then paid, so the results of walking the certificate chain and
+// hashing the request are kept alongside the protobuf context and computed at most once per request
+typedef struct {
+    ProtoBufContext proto; // must be first, request functions cast &req[1] to a ProtoBufContext
+    size_t *certs; // offset and length pairs of each certificate in pkiData, built on first use
+    uint8_t md[256/8]; // request digest with an empty signature, computed on first use
+    size_t mdLen;
+    int mdCached;
+    UInt256 hash; // sha256 of the serialized request, set when the request is parsed
+    int hashCached;
+} RequestContext;
+
+#define REQUEST_VERIFIED_CACHE_SIZE 64
+#define REQUEST_VERIFIED_MAX_AGE    (10*60) // seconds a validation result is used before the chain is checked again
+
+// validation results of recently seen requests keyed by request hash, so a request that is parsed again (to show it,
+// then to pay it) doesn't need its certificate chain and signature checked again, entries are ignored once they are
+// older than REQUEST_VERIFIED_MAX_AGE or the request they were recorded for has expired
+static struct {
+    UInt256 hash;
+    int verified;
+    uint64_t verifiedTime; // when the result was recorded, seconds since unix epoch
+    uint64_t expires; // when the result should no longer be used, seconds since unix epoch
+} _requestVerified[REQUEST_VERIFIED_CACHE_SIZE];
+static size_t _requestVerifiedCount = 0;
+static pthread_mutex_t _requestVerifiedLock = PTHREAD_MUTEX_INITIALIZER;
+
 static uint64_t _ProtoBufVarInt(const uint8_t *buf, size_t bufLen, size_t *off)
 {
     uint64_t varInt = 0;
@@ -490,7 +519,7 @@ BRPaymentProtocolRequest *BRPaymentProtocolRequestNew(uint32_t version, const ch
                                                       size_t pkiDataLen, BRPaymentProtocolDetails *details,
                                                       const uint8_t *signature, size_t sigLen)
 {
-    BRPaymentProtocolRequest *req = calloc(1, sizeof(*req) + sizeof(ProtoBufContext));
+    BRPaymentProtocolRequest *req = calloc(1, sizeof(*req) + sizeof(RequestContext));
     ProtoBufContext *ctx = (ProtoBufContext *)&req[1];
 
     assert(req != NULL);
@@ -527,8 +556,9 @@ BRPaymentProtocolRequest *BRPaymentProtocolRequestNew(uint32_t version, const ch
 // returns a request struct that must be freed by calling PaymentProtocolRequestFree()
 BRPaymentProtocolRequest *BRPaymentProtocolRequestParse(const uint8_t *buf, size_t bufLen)
 {
-    BRPaymentProtocolRequest *req = calloc(1, sizeof(*req) + sizeof(ProtoBufContext));
-    ProtoBufContext *ctx = (ProtoBufContext *)&req[1];
+    BRPaymentProtocolRequest *req = calloc(1, sizeof(*req) + sizeof(RequestContext));
+    RequestContext *reqCtx = (RequestContext *)&req[1];
+    ProtoBufContext *ctx = &reqCtx->proto;
     size_t off = 0;
     
     assert(req != NULL);
@@ -563,6 +593,10 @@ BRPaymentProtocolRequest *BRPaymentProtocolRequestParse(const uint8_t *buf, size
         BRPaymentProtocolRequestFree(req);
         req = NULL;
     }
+    else {
+        SHA256(&reqCtx->hash, buf, bufLen);
+        reqCtx->hashCached = 1;
+    }
 
     return req;
 }
@@ -600,67 +634,174 @@ size_t BRPaymentProtocolRequestSerialize(const BRPaymentProtocolRequest *req, ui
     return (! buf || off <= bufLen) ? off : 0;
 }
 
+// builds the list of certificate offsets and lengths in pkiData in a single pass
+static size_t *_PaymentProtocolRequestCerts(const BRPaymentProtocolRequest *req)
+{
+    RequestContext *reqCtx = (RequestContext *)&req[1];
+    size_t off = 0;
+
+    if (! reqCtx->certs) {
+        array_new(reqCtx->certs, 2*3);
+
+        while (req->pkiData && off < req->pkiDataLen) {
+            const uint8_t *data = NULL;
+            size_t dataLen = req->pkiDataLen;
+            uint64_t i = 0, key = _ProtoBufField(&i, &data, req->pkiData, &dataLen, &off);
+
+            if ((key >> 3) == certificates_cert && data) {
+                array_add(reqCtx->certs, (size_t)(data - req->pkiData));
+                array_add(reqCtx->certs, dataLen);
+            }
+        }
+    }
+
+    return reqCtx->certs;
+}
+
+// returns the number of DER encoded certificates in the request's pkiData
+size_t BRPaymentProtocolRequestCertCount(const BRPaymentProtocolRequest *req)
+{
+    assert(req != NULL);
+    return array_count(_PaymentProtocolRequestCerts(req))/2;
+}
+
 // writes the DER encoded certificate corresponding to index to cert
 // returns the number of bytes written to cert, or the total certLen needed if cert is NULL
 // returns 0 if index is out-of-bounds
 size_t BRPaymentProtocolRequestCert(const BRPaymentProtocolRequest *req, uint8_t *cert, size_t certLen, size_t idx)
 {
-    size_t off = 0, len = 0;
+    const size_t *certs;
+    size_t len = 0;
     
     assert(req != NULL);
+    certs = _PaymentProtocolRequestCerts(req);
     
-    while (req->pkiData && off < req->pkiDataLen) {
-        const uint8_t *data = NULL;
-        size_t dataLen = req->pkiDataLen;
-        uint64_t i = 0, key = _ProtoBufField(&i, &data, req->pkiData, &dataLen, &off);
-        
-        if ((key >> 3) == certificates_cert && data) {
-            if (idx == 0) {
-                len = dataLen;
-                if (cert && len <= certLen) memcpy(cert, data, len);
-                break;
-            }
-            else idx--;
-        }
+    if (idx < array_count(certs)/2) {
+        len = certs[idx*2 + 1];
+        if (cert && len <= certLen) memcpy(cert, &req->pkiData[certs[idx*2]], len);
     }
     
-    return (idx == 0 && (! cert || len <= certLen)) ? len : 0;
+    return (! cert || len <= certLen) ? len : 0;
 }
 
 // writes the hash of the request to md needed to sign or verify the request
 // returns the number of bytes written, or the total mdLen needed if md is NULL
 size_t BRPaymentProtocolRequestDigest(BRPaymentProtocolRequest *req, uint8_t *md, size_t mdLen)
 {
+    RequestContext *reqCtx = (RequestContext *)&req[1];
     uint8_t *buf;
     size_t bufLen;
     
     assert(req != NULL);
 
-    req->sigLen = 0; // set signature to 0 bytes, a signature can't sign itself
+    if (! reqCtx->mdCached) {
+        if (req->pkiType && strncmp(req->pkiType, "x509+sha256", strlen("x509+sha256") + 1) == 0) {
+            reqCtx->mdLen = 256/8;
+        }
+        else if (req->pkiType && strncmp(req->pkiType, "x509+sha1", strlen("x509+sha1") + 1) == 0) {
+            reqCtx->mdLen = 160/8;
+        }
+        else reqCtx->mdLen = 0;
+
+        if (reqCtx->mdLen > 0) {
+            req->sigLen = 0; // set signature to 0 bytes, a signature can't sign itself
+            bufLen = BRPaymentProtocolRequestSerialize(req, NULL, 0);
+            buf = malloc(bufLen);
+            assert(buf != NULL);
+            bufLen = BRPaymentProtocolRequestSerialize(req, buf, bufLen);
+            if (reqCtx->mdLen == 256/8) SHA256(reqCtx->md, buf, bufLen);
+            else SHA1(reqCtx->md, buf, bufLen);
+            free(buf);
+            if (req->signature) req->sigLen = array_count(req->signature);
+        }
+
+        reqCtx->mdCached = 1;
+    }
+    
+    if (md && reqCtx->mdLen <= mdLen) memcpy(md, reqCtx->md, reqCtx->mdLen);
+    return (! md || reqCtx->mdLen <= mdLen) ? reqCtx->mdLen : 0;
+}
+
+// returns the sha256 hash of the serialized request, used to recognize repeat copies of the same request
+UInt256 BRPaymentProtocolRequestHash(const BRPaymentProtocolRequest *req)
+{
+    const RequestContext *reqCtx = (const RequestContext *)&req[1];
+    UInt256 hash = UINT256_ZERO;
+    uint8_t *buf;
+    size_t bufLen;
+
+    assert(req != NULL);
+    if (reqCtx->hashCached) return reqCtx->hash;
+
+    // requests that weren't parsed may still have their signature set by the caller, so they're hashed each time
     bufLen = BRPaymentProtocolRequestSerialize(req, NULL, 0);
     buf = malloc(bufLen);
     assert(buf != NULL);
     bufLen = BRPaymentProtocolRequestSerialize(req, buf, bufLen);
-    
-    if (req->pkiType && strncmp(req->pkiType, "x509+sha256", strlen("x509+sha256") + 1) == 0) {
-        if (md && 256/8 <= mdLen) SHA256(md, buf, bufLen);
-        bufLen = 256/8;
+    SHA256(&hash, buf, bufLen);
+    free(buf);
+    return hash;
+}
+
+// records the result of validating the request's certificate chain and signature, keyed by request hash, until the
+// result is REQUEST_VERIFIED_MAX_AGE old or the request expires, whichever is first
+void BRPaymentProtocolRequestSetVerified(const BRPaymentProtocolRequest *req, int verified)
+{
+    UInt256 hash;
+    uint64_t now = (uint64_t)time(NULL), expires = now + REQUEST_VERIFIED_MAX_AGE;
+    size_t i;
+
+    assert(req != NULL);
+    hash = BRPaymentProtocolRequestHash(req);
+    if (req->details && req->details->expires != 0 && req->details->expires < expires) expires = req->details->expires;
+    pthread_mutex_lock(&_requestVerifiedLock);
+
+    for (i = 0; i < _requestVerifiedCount && i < REQUEST_VERIFIED_CACHE_SIZE; i++) {
+        if (UInt256Eq(_requestVerified[i].hash, hash)) break;
     }
-    else if (req->pkiType && strncmp(req->pkiType, "x509+sha1", strlen("x509+sha1") + 1) == 0) {
-        if (md && 160/8 <= mdLen) SHA1(md, buf, bufLen);
-        bufLen = 160/8;
+
+    // replace the oldest entry once the cache is full
+    if (i == _requestVerifiedCount || i == REQUEST_VERIFIED_CACHE_SIZE) {
+        i = _requestVerifiedCount++ % REQUEST_VERIFIED_CACHE_SIZE;
     }
-    else bufLen = 0;
-    
-    free(buf);
-    if (req->signature) req->sigLen = array_count(req->signature);
-    return (! md || bufLen <= mdLen) ? bufLen : 0;
+
+    _requestVerified[i].hash = hash;
+    _requestVerified[i].verified = (verified) ? 1 : 0;
+    _requestVerified[i].verifiedTime = now;
+    _requestVerified[i].expires = expires;
+    pthread_mutex_unlock(&_requestVerifiedLock);
+}
+
+// returns 1 if a request with the same hash passed validation, 0 if it failed, or -1 if it hasn't been validated or
+// the recorded result is stale
+int BRPaymentProtocolRequestVerified(const BRPaymentProtocolRequest *req)
+{
+    UInt256 hash;
+    uint64_t now = (uint64_t)time(NULL);
+    int verified = -1;
+
+    assert(req != NULL);
+    hash = BRPaymentProtocolRequestHash(req);
+    pthread_mutex_lock(&_requestVerifiedLock);
+
+    for (size_t i = 0; i < _requestVerifiedCount && i < REQUEST_VERIFIED_CACHE_SIZE; i++) {
+        if (! UInt256Eq(_requestVerified[i].hash, hash)) continue;
+        // a clock that moved backwards can't vouch for the entry's age
+        if (now >= _requestVerified[i].verifiedTime && now < _requestVerified[i].expires) {
+            verified = _requestVerified[i].verified;
+        }
+        break;
+    }
+
+    pthread_mutex_unlock(&_requestVerifiedLock);
+    return verified;
 }
 
 // frees memory allocated for request struct
 void BRPaymentProtocolRequestFree(BRPaymentProtocolRequest *req)
 {
-    ProtoBufContext *ctx = (ProtoBufContext *)&req[1];
+    RequestContext *reqCtx = (RequestContext *)&req[1];
+    ProtoBufContext *ctx = &reqCtx->proto;
 
     assert(req != NULL);
     
@@ -670,6 +811,7 @@ void BRPaymentProtocolRequestFree(BRPaymentProtocolRequest *req)
     if (req->signature) array_free(req->signature);
     if (ctx->defaults) array_free(ctx->defaults);
     if (ctx->unknown) array_free(ctx->unknown);
+    if (reqCtx->certs) array_free(reqCtx->certs);
     free(req);
 }
 
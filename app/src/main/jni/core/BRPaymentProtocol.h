@@ -87,15 +87,32 @@ BRPaymentProtocolRequest *BRPaymentProtocolRequestParse(const uint8_t *buf, size
 // writes serialized request struct to buf and returns number of bytes written, or total bufLen needed if buf is NULL
 size_t BRPaymentProtocolRequestSerialize(const BRPaymentProtocolRequest *req, uint8_t *buf, size_t bufLen);
 
+// returns the number of DER encoded certificates in the request's pkiData
+size_t BRPaymentProtocolRequestCertCount(const BRPaymentProtocolRequest *req);
+
 // writes the DER encoded certificate corresponding to index to cert
 // returns the number of bytes written to cert, or the total certLen needed if cert is NULL
 // returns 0 if index is out-of-bounds
+// certificate offsets are found on the first call and cached, so pkiData must not be changed afterwards
 size_t BRPaymentProtocolRequestCert(const BRPaymentProtocolRequest *req, uint8_t *cert, size_t certLen, size_t idx);
 
 // writes the hash of the request to md needed to sign or verify the request
 // returns the number of bytes written, or the total mdLen needed if md is NULL
+// the digest is computed on the first call and cached, so the request must not be changed afterwards
 size_t BRPaymentProtocolRequestDigest(BRPaymentProtocolRequest *req, uint8_t *md, size_t mdLen);
 
+// returns the sha256 hash of the serialized request, used to recognize repeat copies of the same request
+UInt256 BRPaymentProtocolRequestHash(const BRPaymentProtocolRequest *req);
+
+// records the result of validating the request's certificate chain and signature, keyed by request hash, so that
+// later copies of the same request don't need to be validated again while the request is unexpired and the result is
+// less than ten minutes old
+void BRPaymentProtocolRequestSetVerified(const BRPaymentProtocolRequest *req, int verified);
+
+// returns 1 if a request with the same hash passed validation, 0 if it failed, or -1 if it hasn't been validated or
+// the result is stale
+int BRPaymentProtocolRequestVerified(const BRPaymentProtocolRequest *req);
+
 // frees memory allocated for request struct
 void BRPaymentProtocolRequestFree(BRPaymentProtocolRequest *req);
 
@@ -27,8 +27,10 @@
 #include "BRAddress.h"
 #include "BRSet.h"
 #include "BRArray.h"
+#include "BRAllocator.h"
 #include "BRCrypto.h"
 #include "BRInt.h"
+#include "BRWriter.h"
 #include <stdlib.h>
 #include <float.h>
 #include <inttypes.h>
@@ -39,10 +41,10 @@
 #include <errno.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <core/crypto/ethash/hash_types.h>
 #include "BRScript.h"
 #include "BRAssets.h"
 #include "BRPeerManager.h"
@@ -58,12 +60,15 @@
 #define HEADER_LENGTH      24
 #define MAX_MSG_LENGTH     0x02000000
 #define MAX_GETDATA_HASHES 50000
+#define MAX_HEADERS_ANNOUNCE 8 // most headers a peer announces at once after sendheaders
 #define ENABLED_SERVICES   0ULL  // we don't provide full blocks to remote nodes
 #define PROTOCOL_VERSION   70027
 #define MIN_PROTO_VERSION  70026 // peers earlier than this protocol version not supported (need v0.9 txFee relay rules)
 #define LOCAL_HOST         ((UInt128) { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 0x7f, 0x00, 0x00, 0x01 })
 #define CONNECT_TIMEOUT    3.0
 #define MESSAGE_TIMEOUT    10.0
+#define VERIFY_KAWPOW_MIX  0     // recompute the mix of every KAWPOW header, needs the epoch's ~70MB light cache
+#define PEER_ALLOCATOR     BRAllocatorForSubsystem(BR_ALLOC_PEER)
 
 // the standard blockchain download protocol works as follows (for SPV mode):
 // - local peer sends getblocks
@@ -106,12 +111,12 @@ typedef struct {
     BRPeerStatus status;
     int waitingForNetwork;
     volatile int needsFilterUpdate;
-    uint64_t nonce, feePerKb;
+    uint64_t nonce, feePerKb, sentFeePerKb, bytesSent, bytesReceived;
     char *useragent;
     uint32_t version, lastblock, earliestKeyTime, currentBlockHeight;
     double startTime, pingTime;
     volatile double disconnectTime, mempoolTime;
-    int sentVerack, gotVerack, sentGetaddr, sentFilter, sentGetdata, sentMempool, sentGetblocks;
+    int sentVerack, gotVerack, sentGetaddr, sentFilter, sentGetdata, sentMempool, sentGetblocks, sentSendheaders;
     UInt256 lastBlockHash;
     BRMerkleBlock *currentBlock;
     UInt256 *currentBlockTxHashes, *knownBlockHashes, *knownTxHashes;
@@ -275,6 +280,7 @@ static int _PeerAcceptVerackMessage(BRPeer *peer, const uint8_t *msg, size_t msg
         ctx->startTime = 0;
         peer_log(peer, "got verack in %fs", ctx->pingTime);
         ctx->gotVerack = 1;
+        BRPeerSendSendheaders(peer); // all peers from MIN_PROTO_VERSION up support it
         _PeerDidConnect(peer);
     }
 
@@ -596,272 +602,115 @@ static int _PeerAcceptTxMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
     return r;
 }
 
-static int _PeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen) {
+// fetches announced headers as filtered blocks right away, instead of waiting for an inv and sending getdata for it
+static int _PeerAcceptHeadersAnnouncement(BRPeer *peer, const uint8_t *msg, const BRMerkleBlockHeaderView *views,
+                                          size_t count) {
     BRPeerContext *ctx = (BRPeerContext *) peer;
-    size_t off = 0, count = (size_t) BRVarInt(msg, msgLen, &off);
+    UInt256 blockHashes[count];
+    time_t now = time(NULL);
+    size_t i;
     int r = 1;
 
-    if (off == 0 || off + 81 * count > msgLen) {
-        peer_log(peer, "malformed headers message, length is %zu, should be %zu for %zu header(s)", msgLen,
-                 BRVarIntSize(count) + 81 * count, count);
-        r = 0;
-    } else {
-        peer_log(peer, "got %zu header(s)", count);
+    for (i = 0; r && i < count; i++) {
+        BRMerkleBlock *block = BRMerkleBlockParse(&msg[views[i].offset], views[i].len, peer);
 
-        // To improve chain download performance, if this message contains 2000 headers then request the next 2000
-        // headers immediately, and switch to requesting blocks when we receive a header newer than earliestKeyTime
-        uint32_t timestamp = (count > 0) ? UInt32GetLE(&msg[off + 81 * (count - 1) + 68]) : 0;
+        // announced headers get the same checks as the headers downloaded during sync
+        if (!BRMerkleBlockIsValid(block, (uint32_t) now) || (VERIFY_KAWPOW_MIX && !BRMerkleBlockVerifyMix(block))) {
+            peer_log(peer, "invalid block header: %s", u256_hex_encode(block->blockHash));
+            r = 0;
+        } else blockHashes[i] = block->blockHash;
 
-        // Used to determine if a block is a kawpow timestamp and hold the state of when in the msg it switches from 80 byte headers to 120 byte headers
-        uint32_t timestamp_first = (count > 0) ? UInt32GetLE(&msg[off + 68]) : 0;
-        uint32_t timestamp_last = timestamp_first;
-        int startNewHeader = count + 1;
-        int startNewHeaderSize = 0;
+        BRMerkleBlockFree(block);
+    }
 
-        int next = 0;
+    if (r && !(count == 1 && UInt256Eq(ctx->lastBlockHash, blockHashes[0]))) {
+        ctx->lastBlockHash = blockHashes[count - 1];
 
+        for (i = 0; i < count; i++) {
+            // remember blockHashes in case we need to re-request them with an updated bloom filter
+            array_add(ctx->knownBlockHashes, blockHashes[i]);
+        }
 
-        // If this is true, we know that the msg contains some number of 120 bytes headers
-        if (off + 81 * (count +1) < msgLen) {
+        while (array_count(ctx->knownBlockHashes) > MAX_GETDATA_HASHES) {
+            array_rm_range(ctx->knownBlockHashes, 0, array_count(ctx->knownBlockHashes) / 3);
+        }
 
-            // Loop until you find where in the msg is switches from 80 to 120 byte headers
-            while (timestamp_last > 0 && timestamp_last < KAWPOW_ActivationTime) {
-                if (++next < count) {
-                    timestamp_last = UInt32GetLE(&msg[off + 81 * next + 68]);
-                } else {
-                    break;
-                }
-            }
+        if (!ctx->needsFilterUpdate) BRPeerSendGetdata(peer, NULL, 0, blockHashes, count);
+    }
 
-            // If next is count all headers where 80 byte headers after all
-            if (next == count) {
-                peer_log(peer, "all headers where 80 bytes headers");
-            } else {
-                // Set the start count and location in the msg of when the new 120 byte headers started in the message
-                startNewHeader = next;
-                startNewHeaderSize = off + 81 * next;
-
-                peer_log(peer,
-                         "header message included some new 120 byte headers: index: %d starting at %d",
-                         next, timestamp_last);
-
-                // Using the new header length, make way to the last header in the list and get the timestamp
-                // TODO - we might be able to make this faster by just going to the msg[msgLen-53] 53 should be the start of the timestamp
-                int new_count = 0;
-                while (timestamp_last >= KAWPOW_ActivationTime) {
-                    if (++next < count) {
-                        timestamp_last = UInt32GetLE(
-                                &msg[startNewHeaderSize + 121 * new_count++ + 68]);
-                    } else {
-                        break;
-                    }
-                }
+    return r;
+}
 
-                peer_log(peer,
-                         "header message included some new 120 byte headers: index: %d, ending at time %d",
-                         next, timestamp_last);
-                peer_log(peer, "Reading headers: full length read was %d -> %d",
-                         startNewHeaderSize + 121 * new_count, msgLen);
-            }
+static int _PeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen) {
+    BRPeerContext *ctx = (BRPeerContext *) peer;
+    size_t off = 0, count = (size_t) BRVarInt(msg, msgLen, &off);
+    BRMerkleBlockHeaderView *views = NULL;
+    int r = 1;
 
-            // Set the timestamp to the last timestamp in the header
-            timestamp = timestamp_last;
-        }
+    // headers are 80 bytes before KAWPOW activation and 120 after, a message can straddle the switch, so every header's
+    // size is picked from its own timestamp in a single pass that must end exactly at the end of the message
+    if (off > 0 && off + 81 * count <= msgLen) {
+        views = malloc(count * sizeof(*views));
+        assert(views != NULL || count == 0);
+    }
+
+    if (off == 0 || off + 81 * count > msgLen ||
+        off + BRMerkleBlockDecodeHeaders(views, count, &msg[off], msgLen - off) != msgLen) {
+        peer_log(peer, "malformed headers message, length is %zu, should be at least %zu for %zu header(s)", msgLen,
+                 BRVarIntSize(count) + 81 * count, count);
+        r = 0;
+    } else if (ctx->sentSendheaders && ctx->sentFilter && count > 0 && count <= MAX_HEADERS_ANNOUNCE &&
+               views[0].timestamp + 7 * 24 * 60 * 60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime) {
+        // a new block announced after sendheaders, or the tail of a getheaders reply, either way past earliestKeyTime
+        // where the wallet wants filtered blocks, so skip the getblocks and inv round trips
+        peer_log(peer, "got %zu announced header(s)", count);
+        r = _PeerAcceptHeadersAnnouncement(peer, &msg[off], views, count);
+    } else {
+        peer_log(peer, "got %zu header(s)", count);
 
+        // To improve chain download performance, if this message contains 2000 headers then request the next 2000
+        // headers immediately, and switch to requesting blocks when we receive a header newer than earliestKeyTime
+        uint32_t timestamp = (count > 0) ? views[count - 1].timestamp : 0;
 
         if (count >= 2000 ||
             (timestamp > 0 && timestamp + 7 * 24 * 60 * 60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime)) {
+            BRMerkleBlock **blocks = calloc(count, sizeof(*blocks));
             size_t last = 0;
             time_t now = time(NULL);
             UInt256 locators[2];
 
-            if (timestamp_first >= KAWPOW_ActivationTime && timestamp_last >= KAWPOW_ActivationTime) {
-                // Create the two objects needed for light_verify function
-                union ethash_hash256 header_hash;
-                union ethash_hash256 mix_hash;
-
-                // Create the header and mix_hash serialized objects
-                UInt256 header_int;
-                UInt256 mix_int;
-
-                // Get the header_hash
-                SHA256_2(&header_int, &msg[msgLen - 121], 80);
-                memcpy(header_hash.word32s, UInt256Reverse(header_int).u8, 32);
-
-                // Get the mix_hash
-                mix_int = UInt256Get(&msg[msgLen - 33]);
-                memcpy(mix_hash.word32s, UInt256Reverse(mix_int).u8, 32);
-
-                uint64_t nonce = UInt64GetLE(&msg[msgLen-41]);
-                uint32_t height  = UInt32GetLE(&msg[msgLen-45]);
-
-                // Allocate space for the final block hash
-                uint8_t* hash_temp = malloc(32);
-
-                // Get the final block hash
-                light_verify(header_hash, mix_hash, nonce, hash_temp);
-
-                // Get the final hash into a UInt256 object
-                UInt256 get_hash;
-                memcpy(get_hash.u8, hash_temp, 32);
-
-                // Set the locator[0] to the get_hash
-                memcpy(&locators[0], UInt256Reverse(get_hash).u8, 32);
-
-                // ------Locator 1----------
-
-                // Get the header_hash
-                SHA256_2(&header_int, &msg[off], 80);
-                memcpy(header_hash.word32s, UInt256Reverse(header_int).u8, 32);
-
-                // Get the mix_hash
-                mix_int = UInt256Get(&msg[off + 88]);
-                memcpy(mix_hash.word32s, UInt256Reverse(mix_int).u8, 32);
-
-                nonce = UInt64GetLE(&msg[off + 80]);
-                height  = UInt32GetLE(&msg[off + 76]);
-
-                // Get the final block hash
-                light_verify(header_hash, mix_hash, nonce, hash_temp);
-
-                // Get the final hash into a UInt256 object
-                memcpy(get_hash.u8, hash_temp, 32);
-
-                // Set the locator[0] to the get_hash
-                memcpy(&locators[1], UInt256Reverse(get_hash).u8, 32);
-
-                // Free the allocated memory
-                free(hash_temp);
-            } else if (timestamp_first < KAWPOW_ActivationTime && timestamp_last >= KAWPOW_ActivationTime) {
-                if (timestamp_first >= X16RV2ActivationTime) {
-                    X16Rv2(&locators[1], &msg[off], 80);
-                } else {
-                    X16R(&locators[1], &msg[off], 80);
-                }
-
-                // Create the two objects needed for light_verify function
-                union ethash_hash256 header_hash;
-                union ethash_hash256 mix_hash;
+            assert(blocks != NULL || count == 0);
 
-                // Create the header and mix_hash serialized objects
-                UInt256 header_int;
-                UInt256 mix_int;
-
-                // Get the header_hash
-                SHA256_2(&header_int, &msg[msgLen - 121], 80);
-                memcpy(header_hash.word32s, UInt256Reverse(header_int).u8, 32);
-
-                // Get the mix_hash
-                mix_int = UInt256Get(&msg[msgLen - 33]);
-                memcpy(mix_hash.word32s, UInt256Reverse(mix_int).u8, 32);
-
-                uint64_t nonce = UInt64GetLE(&msg[msgLen-41]);
-                uint32_t height  = UInt32GetLE(&msg[msgLen-45]);
-
-                // Allocate space for the final block hash
-                uint8_t* hash_temp = malloc(32);
-
-                // Get the final block hash
-                light_verify(header_hash, mix_hash, nonce, hash_temp);
-
-                // Get the final hash into a UInt256 object
-                UInt256 get_hash;
-                memcpy(get_hash.u8, hash_temp, 32);
-
-                // Set the locator[0] to the get_hash
-                memcpy(&locators[0], UInt256Reverse(get_hash).u8, 32);
-
-                // Free the allocated memory
-                free(hash_temp);
+            // parsing hashes each header once, with X16R, X16Rv2 or KAWPOW by its timestamp, and the locators reuse it
+            for (size_t i = 0; i < count; i++) {
+                blocks[i] = BRMerkleBlockParse(&msg[off + views[i].offset], views[i].len, peer);
             }
-            else if(timestamp >= X16RV2ActivationTime) {
-                X16Rv2(&locators[0], &msg[off + 81 * (count - 1)], 80);
-                X16Rv2(&locators[1], &msg[off], 80);
-            } else {
-                X16R(&locators[0], &msg[off + 81 * (count - 1)], 80);
-                X16R(&locators[1], &msg[off], 80);
+
+            if (count > 0) {
+                locators[0] = blocks[count - 1]->blockHash;
+                locators[1] = blocks[0]->blockHash;
             }
 
             if (timestamp > 0 && timestamp + 7 * 24 * 60 * 60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime) {
                 // request blocks for the remainder of the chain
-                if (last < startNewHeader) {
-                    timestamp = (++last < count) ? UInt32GetLE(&msg[off + 81 * last + 68]) : 0;
-                } else
-                    timestamp = (++last < count) ? UInt32GetLE(&msg[startNewHeaderSize + 121 * (last - startNewHeader) + 68]) : 0;
+                timestamp = (++last < count) ? views[last].timestamp : 0;
 
                 while (timestamp > 0 && timestamp + 7 * 24 * 60 * 60 + BLOCK_MAX_TIME_DRIFT < ctx->earliestKeyTime) {
-                    if (last < startNewHeader) {
-                        timestamp = (++last < count) ? UInt32GetLE(&msg[off + 81 * last + 68]) : 0;
-                    } else
-                        timestamp = (++last < count) ? UInt32GetLE(&msg[startNewHeaderSize + 121 * (last - startNewHeader) + 68]) : 0;
+                    timestamp = (++last < count) ? views[last].timestamp : 0;
                 }
 
-                if (timestamp >= KAWPOW_ActivationTime) {
-
-                    // Create the two objects needed for light_verify function
-                    union ethash_hash256 header_hash;
-                    union ethash_hash256 mix_hash;
-
-                    // Create the header and mix_hash serialized objects
-                    UInt256 header_int;
-                    UInt256 mix_int;
-
-                    // Get the header_hash
-                    SHA256_2(&header_int, &msg[startNewHeaderSize + 121 * (last - startNewHeader)], 80);
-                    memcpy(header_hash.word32s, UInt256Reverse(header_int).u8, 32);
-
-                    // Get the mix_hash
-                    mix_int = UInt256Get(&msg[startNewHeaderSize + 121 * (last - startNewHeader) + 88]);
-                    memcpy(mix_hash.word32s, UInt256Reverse(mix_int).u8, 32);
-
-                    uint64_t nonce = UInt64GetLE(&msg[startNewHeaderSize + 121 * (last - startNewHeader) + 80]);
-                    uint32_t height  = UInt32GetLE(&msg[startNewHeaderSize + 121 * (last - startNewHeader) + 76]);
-
-                    // Allocate space for the final block hash
-                    uint8_t* hash_temp = malloc(32);
-
-                    // Get the final block hash
-                    light_verify(header_hash, mix_hash, nonce, hash_temp);
-
-                    // Get the final hash into a UInt256 object
-                    UInt256 get_hash;
-                    memcpy(get_hash.u8, hash_temp, 32);
-
-                    // Set the locator[0] to the get_hash
-                    memcpy(&locators[0], UInt256Reverse(get_hash).u8, 32);
-
-                    // Free the allocated memory
-                    free(hash_temp);
-                }
-                else if(timestamp >= X16RV2ActivationTime) {
-                    X16Rv2(&locators[0], &msg[off + 81 * (last - 1)], 80);
-                }
-                else {
-                    X16R(&locators[0], &msg[off + 81 * (last - 1)], 80);
-                }
+                locators[0] = blocks[last - 1]->blockHash;
                 BRPeerSendGetblocks(peer, locators, 2, UINT256_ZERO);
             } else BRPeerSendGetheaders(peer, locators, 2, UINT256_ZERO);
 
+            for (size_t i = 0; i < count; i++) {
+                BRMerkleBlock *block = blocks[i];
 
-            for (size_t i = 0; r && i < count; i++) {
-                uint32_t timestamp;
-                int headerSize = 81;
-                if (i >= startNewHeader) {
-                    timestamp = (count > 0) ? UInt32GetLE(&msg[startNewHeaderSize + 121 * (i - startNewHeader) + 68]) : 0;
-                } else {
-                   timestamp = (count > 0) ? UInt32GetLE(&msg[off + 81 * i + 68]) : 0;
-                }
-
-                int location = off + 81 * i;
-
-                if (i >= startNewHeader) {
-                    headerSize = 121;
-                    location = startNewHeaderSize + 121 * (i - startNewHeader);
-                }
-
-                BRMerkleBlock *block = BRMerkleBlockParse(&msg[location], headerSize, &peer);
-
-                if (!BRMerkleBlockIsValid(block, (uint32_t) now)) {
+                // headers arrive in height order, so consecutive mix checks share the cached program of their period
+                if (! r) {
+                    BRMerkleBlockFree(block);
+                } else if (!BRMerkleBlockIsValid(block, (uint32_t) now) ||
+                           (VERIFY_KAWPOW_MIX && !BRMerkleBlockVerifyMix(block))) {
                     peer_log(peer, "invalid block header: %s", u256_hex_encode(block->blockHash));
                     BRMerkleBlockFree(block);
                     r = 0;
@@ -869,12 +718,15 @@ static int _PeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t ms
                     ctx->relayedBlock(ctx->info, block);
                 } else BRMerkleBlockFree(block);
             }
+
+            if (blocks) free(blocks);
         } else {
             peer_log(peer, "non-standard headers message, %zu is fewer header(s) than expected", count);
             r = 0;
         }
     }
 
+    if (views) free(views);
     return r;
 }
 
@@ -912,16 +764,20 @@ static int _PeerAcceptGetdataMessage(BRPeer *peer, const uint8_t *msg, size_t ms
                     if (ctx->requestedTx) tx = ctx->requestedTx(ctx->info, hash);
 
                     if (tx && BRTransactionSize(tx) < TX_MAX_SIZE) {
-                        uint8_t buf[BRTransactionSerialize(tx, NULL, 0)];
-                        size_t bufLen = BRTransactionSerialize(tx, buf, sizeof(buf));
-                        char txHex[bufLen * 2 + 1];
+                        BRWriter buf;
+
+                        BRWriterInit(&buf, BRTransactionSerializedSize(tx));
+                        BRWriterTransaction(&buf, tx);
+
+                        char txHex[buf.len * 2 + 1];
 
-                        for (size_t j = 0; j < bufLen; j++) {
-                            sprintf(&txHex[j * 2], "%02x", buf[j]);
+                        for (size_t j = 0; j < buf.len; j++) {
+                            sprintf(&txHex[j * 2], "%02x", buf.data[j]);
                         }
 
                         peer_log(peer, "publishing tx: %s", txHex);
-                        BRPeerSendMessage(peer, buf, bufLen, MSG_TX);
+                        BRPeerSendMessage(peer, buf.data, buf.len, MSG_TX);
+                        BRWriterFree(&buf);
                         break;
                     }
 
@@ -1299,7 +1155,10 @@ static void *_peerThreadRoutine(void *arg) {
 
                 while (socket >= 0 && !error && len < HEADER_LENGTH) {
                     n = read(socket, &header[len], sizeof(header) - len);
-                    if (n > 0) len += n;
+                    if (n > 0) {
+                        len += n;
+                        __atomic_add_fetch(&ctx->bytesReceived, n, __ATOMIC_RELAXED);
+                    }
                     if (n == 0) error = ECONNRESET;
                     if (n < 0 && errno != EWOULDBLOCK) error = errno;
                     gettimeofday(&tv, NULL);
@@ -1345,7 +1204,10 @@ static void *_peerThreadRoutine(void *arg) {
 
                         while (socket >= 0 && !error && len < msgLen) {
                             n = read(socket, &payload[len], msgLen - len);
-                            if (n > 0) len += n;
+                            if (n > 0) {
+                                len += n;
+                                __atomic_add_fetch(&ctx->bytesReceived, n, __ATOMIC_RELAXED);
+                            }
                             if (n == 0) error = ECONNRESET;
                             if (n < 0 && errno != EWOULDBLOCK) error = errno;
                             gettimeofday(&tv, NULL);
@@ -1402,16 +1264,16 @@ static void _dummyThreadCleanup(void *info) {
 
 // returns a newly allocated Peer struct that must be freed by calling BRPeerFree()
 BRPeer *BRPeerNew(void) {
-    BRPeerContext *ctx = calloc(1, sizeof(*ctx));
+    BRPeerContext *ctx = BRAllocatorCalloc(PEER_ALLOCATOR, sizeof(*ctx));
 
     assert(ctx != NULL);
-    array_new(ctx->useragent, 40);
-    array_new(ctx->knownBlockHashes, 10);
-    array_new(ctx->currentBlockTxHashes, 10);
-    array_new(ctx->knownTxHashes, 10);
-    ctx->knownTxHashSet = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
-    array_new(ctx->pongInfo, 10);
-    array_new(ctx->pongCallback, 10);
+    array_new_with_allocator(ctx->useragent, 40, PEER_ALLOCATOR);
+    array_new_with_allocator(ctx->knownBlockHashes, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(ctx->currentBlockTxHashes, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(ctx->knownTxHashes, 10, PEER_ALLOCATOR);
+    ctx->knownTxHashSet = BRSetNewWithAllocator(BRTransactionHash, BRTransactionEq, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(ctx->pongInfo, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(ctx->pongCallback, 10, PEER_ALLOCATOR);
     ctx->pingTime = DBL_MAX;
     ctx->mempoolTime = DBL_MAX;
     ctx->disconnectTime = DBL_MAX;
@@ -1578,41 +1440,72 @@ uint64_t BRPeerFeePerKb(BRPeer *peer) {
     return ((BRPeerContext *) peer)->feePerKb;
 }
 
+// total bytes written to the peer socket since the peer was created, including message headers
+uint64_t BRPeerBytesSent(BRPeer *peer) {
+    return __atomic_load_n(&((BRPeerContext *) peer)->bytesSent, __ATOMIC_RELAXED);
+}
+
+// total bytes read from the peer socket since the peer was created, including message headers
+uint64_t BRPeerBytesReceived(BRPeer *peer) {
+    return __atomic_load_n(&((BRPeerContext *) peer)->bytesReceived, __ATOMIC_RELAXED);
+}
+
 #ifndef MSG_NOSIGNAL   // linux based systems have a MSG_NOSIGNAL send flag, useful for supressing SIGPIPE signals
 #define MSG_NOSIGNAL 0 // set to 0 if undefined (BSD has the SO_NOSIGPIPE sockopt, and windows has no signals at all)
 #endif
 
 // sends a raven protocol message to peer
+// the header and payload are gathered by sendmsg() so msg is never copied into a header+payload buffer
 void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const char *type) {
     if (msgLen > MAX_MSG_LENGTH) {
         peer_log(peer, "failed to send %s, length %zu is too long", type, msgLen);
     } else {
         BRPeerContext *ctx = (BRPeerContext *) peer;
-        uint8_t buf[HEADER_LENGTH + msgLen], hash[32];
-        size_t off = 0;
+        uint8_t header[HEADER_LENGTH], hash[32];
+        struct iovec iov[2] = {{header, sizeof(header)}, {(void *) msg, msgLen}};
+        struct msghdr mh;
+        size_t off = 0, sent = 0;
         ssize_t n = 0;
         struct timeval tv;
         int socket, error = 0;
 
-        UInt32SetLE(&buf[off], MAGIC_NUMBER);
+        UInt32SetLE(&header[off], MAGIC_NUMBER);
         off += sizeof(uint32_t);
-        strncpy((char *) &buf[off], type, 12);
+        strncpy((char *) &header[off], type, 12);
         off += 12;
-        UInt32SetLE(&buf[off], (uint32_t) msgLen);
+        UInt32SetLE(&header[off], (uint32_t) msgLen);
         off += sizeof(uint32_t);
         SHA256_2(hash, msg, msgLen);
-        memcpy(&buf[off], hash, sizeof(uint32_t));
+        memcpy(&header[off], hash, sizeof(uint32_t));
         off += sizeof(uint32_t);
-        memcpy(&buf[off], msg, msgLen);
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = iov;
+        mh.msg_iovlen = (msgLen > 0) ? 2 : 1;
         peer_log(peer, "synsending %s", type);
-        msgLen = 0;
         socket = ctx->socket;
         if (socket < 0) error = ENOTCONN;
 
-        while (socket >= 0 && !error && msgLen < sizeof(buf)) {
-            n = send(socket, &buf[msgLen], sizeof(buf) - msgLen, MSG_NOSIGNAL);
-            if (n >= 0) msgLen += n;
+        while (socket >= 0 && !error && sent < HEADER_LENGTH + msgLen) {
+            n = sendmsg(socket, &mh, MSG_NOSIGNAL);
             if (n < 0 && errno != EWOULDBLOCK) error = errno;
+
+            if (n > 0) { // skip past what was sent, a partial write may end inside either buffer
+                sent += n;
+                __atomic_add_fetch(&ctx->bytesSent, n, __ATOMIC_RELAXED);
+
+                while (n > 0 && mh.msg_iovlen > 0) {
+                    if ((size_t) n >= mh.msg_iov->iov_len) {
+                        n -= mh.msg_iov->iov_len;
+                        mh.msg_iov++;
+                        mh.msg_iovlen--;
+                    } else {
+                        mh.msg_iov->iov_base = (uint8_t *) mh.msg_iov->iov_base + n;
+                        mh.msg_iov->iov_len -= n;
+                        n = 0;
+                    }
+                }
+            }
+
             gettimeofday(&tv, NULL);
             if (!error && tv.tv_sec + (double) tv.tv_usec / 1000000 >= ctx->disconnectTime) error = ETIMEDOUT;
             socket = ctx->socket;
@@ -1679,6 +1572,17 @@ void BRPeerSendFilterload(BRPeer *peer, const uint8_t *filter, size_t filterLen)
     BRPeerSendMessage(peer, filter, filterLen, MSG_FILTERLOAD);
 }
 
+void BRPeerSendFeefilter(BRPeer *peer, uint64_t feePerKb) {
+    BRPeerContext *ctx = (BRPeerContext *) peer;
+    uint8_t msg[sizeof(uint64_t)];
+
+    if (feePerKb != ctx->sentFeePerKb) {
+        ctx->sentFeePerKb = feePerKb;
+        UInt64SetLE(msg, feePerKb);
+        BRPeerSendMessage(peer, msg, sizeof(msg), MSG_FEEFILTER);
+    }
+}
+
 void BRPeerSendMempool(BRPeer *peer, const UInt256 *knownTxHashes, size_t knownTxCount, void *info,
                        void (*completionCallback)(void *info, int success)) {
     BRPeerContext *ctx = (BRPeerContext *) peer;
@@ -1762,50 +1666,46 @@ void BRPeerSendInv(BRPeer *peer, const UInt256 *txHashes, size_t txCount) {
     txCount = array_count(ctx->knownTxHashes) - knownCount;
 
     if (txCount > 0) {
-        size_t i, off = 0, msgLen = BRVarIntSize(txCount) + (sizeof(uint32_t) + sizeof(*txHashes)) * txCount;
-        uint8_t msg[msgLen];
+        BRWriter msg;
 
-        off += BRVarIntSet(&msg[off], (off <= msgLen ? msgLen - off : 0), txCount);
+        BRWriterInit(&msg, BRVarIntSize(txCount) + (sizeof(uint32_t) + sizeof(*txHashes)) * txCount);
+        BRWriterVarInt(&msg, txCount);
 
-        for (i = 0; i < txCount; i++) {
-            UInt32SetLE(&msg[off], inv_tx);
-            off += sizeof(uint32_t);
-            UInt256Set(&msg[off], ctx->knownTxHashes[knownCount + i]);
-            off += sizeof(UInt256);
+        for (size_t i = 0; i < txCount; i++) {
+            BRWriterUInt32LE(&msg, inv_tx);
+            BRWriterUInt256(&msg, ctx->knownTxHashes[knownCount + i]);
         }
 
-        BRPeerSendMessage(peer, msg, off, MSG_INV);
+        BRPeerSendMessage(peer, msg.data, msg.len, MSG_INV);
+        BRWriterFree(&msg);
     }
 }
 
 void BRPeerSendGetdata(BRPeer *peer, const UInt256 *txHashes, size_t txCount, const UInt256 *blockHashes,
                        size_t blockCount) {
-    size_t i, off = 0, count = txCount + blockCount;
+    size_t i, count = txCount + blockCount;
 
     if (count > MAX_GETDATA_HASHES) { // limit total hash count to MAX_GETDATA_HASHES
         peer_log(peer, "couldn't send getdata, %zu is too many items, max is %d", count, MAX_GETDATA_HASHES);
     } else if (count > 0) {
-        size_t msgLen = BRVarIntSize(count) + (sizeof(uint32_t) + sizeof(UInt256)) * (count);
-        uint8_t msg[msgLen];
+        BRWriter msg; // up to 1.8MB, too large for a thread stack
 
-        off += BRVarIntSet(&msg[off], (off <= msgLen ? msgLen - off : 0), count);
+        BRWriterInit(&msg, BRVarIntSize(count) + (sizeof(uint32_t) + sizeof(UInt256)) * count);
+        BRWriterVarInt(&msg, count);
 
         for (i = 0; i < txCount; i++) {
-            UInt32SetLE(&msg[off], inv_tx);
-            off += sizeof(uint32_t);
-            UInt256Set(&msg[off], txHashes[i]);
-            off += sizeof(UInt256);
+            BRWriterUInt32LE(&msg, inv_tx);
+            BRWriterUInt256(&msg, txHashes[i]);
         }
 
         for (i = 0; i < blockCount; i++) {
-            UInt32SetLE(&msg[off], inv_filtered_block);
-            off += sizeof(uint32_t);
-            UInt256Set(&msg[off], blockHashes[i]);
-            off += sizeof(UInt256);
+            BRWriterUInt32LE(&msg, inv_filtered_block);
+            BRWriterUInt256(&msg, blockHashes[i]);
         }
 
         ((BRPeerContext *) peer)->sentGetdata = 1;
-        BRPeerSendMessage(peer, msg, off, MSG_GETDATA);
+        BRPeerSendMessage(peer, msg.data, msg.len, MSG_GETDATA);
+        BRWriterFree(&msg);
     }
 }
 
@@ -1831,6 +1731,11 @@ void BRPeerSendGetAsset(BRPeer *peer, char *assetName, size_t nameLen,
     BRPeerSendMessage(peer, msg, sizeof(msg), MSG_GETASSETDATA);
 }
 
+void BRPeerSendSendheaders(BRPeer *peer) {
+    ((BRPeerContext *) peer)->sentSendheaders = 1;
+    BRPeerSendMessage(peer, NULL, 0, MSG_SENDHEADERS);
+}
+
 void BRPeerSendGetaddr(BRPeer *peer) {
     ((BRPeerContext *) peer)->sentGetaddr = 1;
     BRPeerSendMessage(peer, NULL, 0, MSG_GETADDR);
@@ -1873,7 +1778,7 @@ void BRPeerFree(BRPeer *peer) {
     if (ctx->knownTxHashSet) BRSetFree(ctx->knownTxHashSet);
     if (ctx->pongInfo) array_free(ctx->pongInfo);
     if (ctx->pongCallback) array_free(ctx->pongCallback);
-    free(ctx);
+    BRAllocatorFree(PEER_ALLOCATOR, ctx, sizeof(*ctx));
 }
 
 void PeerAcceptMessageTest(BRPeer *peer, const uint8_t *msg, size_t msgLen, const char *type) {
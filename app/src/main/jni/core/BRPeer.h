@@ -89,6 +89,7 @@ extern "C" {
 #define MSG_ALERT       "alert"
 #define MSG_REJECT      "reject"   // described in BIP61: https://github.com/bitcoin/bips/blob/master/bip-0061.mediawiki
 #define MSG_FEEFILTER   "feefilter"// described in BIP133 https://github.com/bitcoin/bips/blob/master/bip-0133.mediawiki
+#define MSG_SENDHEADERS "sendheaders" // described in BIP130 https://github.com/bitcoin/bips/blob/master/bip-0130.mediawiki
 
 #define MSG_GETASSETDATA "getassetdata"
 #define MSG_ASSETDATA    "assetdata"
@@ -185,12 +186,18 @@ uint32_t BRPeerLastBlock(BRPeer *peer);
 // minimum tx fee rate peer will accept
 uint64_t BRPeerFeePerKb(BRPeer *peer);
 
+// total bytes written to and read from the peer socket, including message headers
+uint64_t BRPeerBytesSent(BRPeer *peer);
+uint64_t BRPeerBytesReceived(BRPeer *peer);
+
 // average ping time for connected peer
 double BRPeerPingTime(BRPeer *peer);
 
 // sends a Ravencoin protocol message to peer
 void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const char *type);
 void BRPeerSendFilterload(BRPeer *peer, const uint8_t *filter, size_t filterLen);
+// asks peer not to relay tx paying less than feePerKb, see BIP133, does nothing if that rate was already sent
+void BRPeerSendFeefilter(BRPeer *peer, uint64_t feePerKb);
 void BRPeerSendMempool(BRPeer *peer, const UInt256 *knownTxHashes, size_t knownTxCount, void *info,
                        void (*completionCallback)(void *info, int success));
 void BRPeerSendGetheaders(BRPeer *peer, const UInt256 *locators, size_t locatorsCount, UInt256 hashStop);
@@ -200,6 +207,8 @@ void BRPeerSendInv(BRPeer *peer, const UInt256 *txHashes, size_t txCount);
 void BRPeerSendGetdata(BRPeer *peer, const UInt256 *txHashes, size_t txCount, const UInt256 *blockHashes,
                        size_t blockCount);
 void BRPeerSendGetaddr(BRPeer *peer);
+// asks peer to announce new blocks with headers instead of inv, see BIP130
+void BRPeerSendSendheaders(BRPeer *peer);
 void BRPeerSendPing(BRPeer *peer, void *info, void (*pongCallback)(void *info, int success));
 // useful to get additional tx after a bloom filter update
 void BRPeerRerequestBlocks(BRPeer *peer, UInt256 fromBlock);
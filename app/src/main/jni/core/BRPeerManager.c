@@ -2,11 +2,15 @@
 #include "BRBloomFilter.h"
 #include "BRSet.h"
 #include "BRArray.h"
+#include "BRAllocator.h"
 #include "BRInt.h"
+#include "BRWriter.h"
+#include "BRCrypto.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <math.h>
 #include <time.h>
 #include <pthread.h>
 #include <errno.h>
@@ -22,6 +26,12 @@
 #define PEER_FLAG_SYNCED        0x01
 #define PEER_FLAG_NEEDSUPDATE   0x02
 #define OLDEST_INTERVAL         1 * 24 * 60 * 60
+#define FEE_FILTER_RATIO        2 // peers don't relay tx paying less than 1/FEE_FILTER_RATIO of the wallet fee rate
+#define SNAPSHOT_VERSION        2
+#define SNAPSHOT_INTERVAL       (10 * 60) // seconds between periodic snapshots once synced
+#define SNAPSHOT_PEERS          50 // most peers kept in a snapshot
+#define PEER_ALLOCATOR          BRAllocatorForSubsystem(BR_ALLOC_PEER)
+#define CHAIN_ALLOCATOR         BRAllocatorForSubsystem(BR_ALLOC_CHAIN)
 
 #if TESTNET
 
@@ -150,7 +160,7 @@ static size_t _TxPeerListAddPeer(TxPeerList **list, UInt256 txHash, const BRPeer
     }
 
     array_add(*list, ((const TxPeerList) {txHash, NULL}));
-    array_new((*list)[array_count(*list) - 1].peers, PEER_MAX_CONNECTIONS);
+    array_new_with_allocator((*list)[array_count(*list) - 1].peers, PEER_MAX_CONNECTIONS, PEER_ALLOCATOR);
     array_add((*list)[array_count(*list) - 1].peers, *peer);
     return 1;
 }
@@ -204,18 +214,24 @@ inline static int _BlockHeightEq(const void *block, const void *otherBlock) {
 
 struct PeerManagerStruct {
     const ChainParams *params;
-    BRWallet *wallet;
+    BRWallet *wallet, **watchedWallets;
     int isConnected, connectFailureCount, misbehavinCount, dnsThreadCount, maxConnectCount;
     BRPeer *peers, *downloadPeer, fixedPeer, **connectedPeers;
     char downloadPeerName[INET6_ADDRSTRLEN + 6];
-    uint32_t earliestKeyTime, syncStartHeight, filterUpdateHeight, estimatedHeight;
+    uint32_t earliestKeyTime, syncStartHeight, filterUpdateHeight, estimatedHeight, savedBlockHeight, snapshotTime;
     BRBloomFilter *bloomFilter;
+    size_t filterElemCount, resumePeerCount;
+    UInt256 filterDigest; // chained hash of the elements the bloom filter was built from
+    int filterRestored;
+    int budgetStopped; // sync stopped after using up the sync policy byte budget, don't reconnect until asked to
     double fpRate, averageTxPerBlock;
+    BRSyncPolicy policy;
+    uint64_t bytesSent, bytesReceived; // bytes used by disconnected peers since the last byte count reset
     BRSet *blocks, *orphans, *checkpoints;
     BRMerkleBlock *lastBlock, *lastOrphan;
     TxPeerList *txRelays, *txRequests;
     PublishedTx *publishedTx;
-    UInt256 *publishedTxHashes;
+    UInt256 *publishedTxHashes, *knownTxHashes;
     void *info;
 
     void (*syncStarted)(void *info);
@@ -232,6 +248,8 @@ struct PeerManagerStruct {
 
     void (*threadCleanup)(void *info);
 
+    void (*saveSnapshot)(void *info, const uint8_t *snapshot, size_t snapshotLen);
+
     pthread_mutex_t lock;
 };
 
@@ -306,38 +324,83 @@ static void _setApplyFreeBlock(void *info, void *block) {
     BRMerkleBlockFree(block);
 }
 
-static void _PeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer) {
-    // every time a new wallet address is added, the bloom filter has to be rebuilt, and each address is only used
-    // for one transaction, so here we generate some spare addresses to avoid rebuilding the filter each time a
-    // wallet transaction is encountered during the chain sync
-    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL + 100, 0);
-    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL + 100, 1);
+// returns the fee rate below which mempool tx aren't worth relaying to us
+// unconfirmed wallet tx paying this little are unlikely to confirm soon, and spam waves pay the minimum relay fee, so
+// this cuts inbound tx traffic without hiding payments, which still arrive in merkleblocks once confirmed
+// the wallet rate is floored at TX_FEE_PER_KB, the least any tx the wallet creates pays (see _txFee() in BRWallet.c)
+static uint64_t _PeerManagerFeeFilter(BRPeerManager *manager) {
+    uint64_t feePerKb = BRWalletFeePerKb(manager->wallet);
 
-    BRSetApply(manager->orphans, NULL, _setApplyFreeBlock);
-    BRSetClear(manager->orphans); // clear out orphans that may have been received on an old filter
-    manager->lastOrphan = NULL;
-    manager->filterUpdateHeight = manager->lastBlock->height;
-    manager->fpRate = BLOOM_REDUCED_FALSEPOSITIVE_RATE;
+    return ((feePerKb > TX_FEE_PER_KB) ? feePerKb : TX_FEE_PER_KB) / FEE_FILTER_RATIO;
+}
 
-    size_t addrsCount = BRWalletAllAddrs(manager->wallet, NULL, 0);
+// bytes used by connected and disconnected peers since the last byte count reset
+static void _PeerManagerByteCount(BRPeerManager *manager, uint64_t *sent, uint64_t *received) {
+    *sent = manager->bytesSent;
+    *received = manager->bytesReceived;
+
+    for (size_t i = array_count(manager->connectedPeers); i > 0; i--) {
+        *sent += BRPeerBytesSent(manager->connectedPeers[i - 1]);
+        *received += BRPeerBytesReceived(manager->connectedPeers[i - 1]);
+    }
+}
+
+// true if the sync policy has a byte budget and this session has used it up
+static int _PeerManagerBudgetExceeded(BRPeerManager *manager) {
+    uint64_t sent, received;
+
+    if (manager->policy.byteBudget == 0) return 0;
+    _PeerManagerByteCount(manager, &sent, &received);
+    return (sent + received >= manager->policy.byteBudget);
+}
+
+// returns true if txHash is a tx registered with wallet, rather than a non-wallet tx kept in its unconfirmed pool
+static int _WalletHasTx(BRWallet *wallet, UInt256 txHash) {
+    BRTransaction *tx = BRWalletTransactionForHash(wallet, txHash);
+
+    return (tx && BRWalletContainsTransaction(wallet, tx));
+}
+
+// returns the wallet with the given tx, the manager's own wallet first and then any watched wallets, or NULL if none
+static BRWallet *_PeerManagerWalletForTx(BRPeerManager *manager, UInt256 txHash) {
+    if (_WalletHasTx(manager->wallet, txHash)) return manager->wallet;
+
+    for (size_t i = 0; i < array_count(manager->watchedWallets); i++) {
+        if (_WalletHasTx(manager->watchedWallets[i], txHash)) return manager->watchedWallets[i];
+    }
+
+    return NULL;
+}
+
+// adds data to filter if it's not already matched, and chains it into digest, either may be NULL
+static void _BloomFilterAddElement(BRBloomFilter *filter, UInt256 *digest, const uint8_t *data, size_t len) {
+    uint8_t buf[sizeof(UInt256) + sizeof(UInt256) + sizeof(uint32_t)];
+
+    assert(len <= sizeof(buf) - sizeof(UInt256));
+    if (filter && !BRBloomFilterContainsData(filter, data, len)) BRBloomFilterInsertData(filter, data, len);
+
+    if (digest) {
+        UInt256Set(buf, *digest);
+        memcpy(&buf[sizeof(UInt256)], data, len);
+        SHA256(digest, buf, sizeof(UInt256) + len);
+    }
+}
+
+// adds wallet addresses, UTXOs and TXOs spent since blockHeight to filter and digest
+static void _BloomFilterAddWallet(BRBloomFilter *filter, UInt256 *digest, BRWallet *wallet, uint32_t blockHeight) {
+    size_t addrsCount = BRWalletAllAddrs(wallet, NULL, 0);
     BRAddress *addrs = malloc(addrsCount * sizeof(*addrs));
-    size_t utxosCount = BRWalletUTXOs(manager->wallet, NULL, 0);
+    size_t utxosCount = BRWalletUTXOs(wallet, NULL, 0);
     UTXO *utxos = malloc(utxosCount * sizeof(*utxos));
-    uint32_t blockHeight = (manager->lastBlock->height > 100) ? manager->lastBlock->height - 100
-                                                              : 0;
-    size_t txCount = BRWalletTxUnconfirmedBefore(manager->wallet, NULL, 0, blockHeight);
+    size_t txCount = BRWalletTxUnconfirmedBefore(wallet, NULL, 0, blockHeight);
     BRTransaction **transactions = malloc(txCount * sizeof(*transactions));
-    BRBloomFilter *filter;
 
     assert(addrs != NULL);
     assert(utxos != NULL);
     assert(transactions != NULL);
-    addrsCount = BRWalletAllAddrs(manager->wallet, addrs, addrsCount);
-    utxosCount = BRWalletUTXOs(manager->wallet, utxos, utxosCount);
-    txCount = BRWalletTxUnconfirmedBefore(manager->wallet, transactions, txCount, blockHeight);
-    filter = BRBloomFilterNew(manager->fpRate, addrsCount + utxosCount + txCount + 100,
-                              (uint32_t) BRPeerHash(peer),
-                              BLOOM_UPDATE_ALL); // BUG: XXX txCount not the same as number of spent wallet outputs
+    addrsCount = BRWalletAllAddrs(wallet, addrs, addrsCount);
+    utxosCount = BRWalletUTXOs(wallet, utxos, utxosCount);
+    txCount = BRWalletTxUnconfirmedBefore(wallet, transactions, txCount, blockHeight);
 
     for (size_t i = 0;
          i < addrsCount; i++) { // add addresses to watch for tx receiveing money to the wallet
@@ -345,9 +408,7 @@ static void _PeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer) {
 
         BRAddressHash160(&hash, addrs[i].s);
 
-        if (!UInt160IsZero(hash) && !BRBloomFilterContainsData(filter, hash.u8, sizeof(hash))) {
-            BRBloomFilterInsertData(filter, hash.u8, sizeof(hash));
-        }
+        if (!UInt160IsZero(hash)) _BloomFilterAddElement(filter, digest, hash.u8, sizeof(hash));
     }
 
     free(addrs);
@@ -358,8 +419,7 @@ static void _PeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer) {
 
         UInt256Set(o, utxos[i].hash);
         UInt32SetLE(&o[sizeof(UInt256)], utxos[i].n);
-        if (!BRBloomFilterContainsData(filter, o, sizeof(o)))
-            BRBloomFilterInsertData(filter, o, sizeof(o));
+        _BloomFilterAddElement(filter, digest, o, sizeof(o));
     }
 
     free(utxos);
@@ -367,28 +427,107 @@ static void _PeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer) {
     for (size_t i = 0; i < txCount; i++) { // also add TXOs spent within the last 100 blocks
         for (size_t j = 0; j < transactions[i]->inCount; j++) {
             BRTxInput *input = &transactions[i]->inputs[j];
-            BRTransaction *tx = BRWalletTransactionForHash(manager->wallet, input->txHash);
+            BRTransaction *tx = BRWalletTransactionForHash(wallet, input->txHash);
             uint8_t o[sizeof(UInt256) + sizeof(uint32_t)];
 
             if (tx && input->index < tx->outCount &&
-                BRWalletContainsAddress(manager->wallet, tx->outputs[input->index].address)) {
+                BRWalletContainsAddress(wallet, tx->outputs[input->index].address)) {
                 UInt256Set(o, input->txHash);
                 UInt32SetLE(&o[sizeof(UInt256)], input->index);
-                if (!BRBloomFilterContainsData(filter, o, sizeof(o)))
-                    BRBloomFilterInsertData(filter, o, sizeof(o));
+                _BloomFilterAddElement(filter, digest, o, sizeof(o));
             }
         }
     }
 
     free(transactions);
-    if (manager->bloomFilter) BRBloomFilterFree(manager->bloomFilter);
-    manager->bloomFilter = filter;
-    // TODO: XXX if already synced, recursively add inputs of unconfirmed receives
+}
+
+// returns the number of filter elements _BloomFilterAddWallet() adds for wallet
+static size_t _BloomFilterWalletElements(BRWallet *wallet, uint32_t blockHeight) {
+    // BUG: XXX txCount not the same as number of spent wallet outputs
+    return BRWalletAllAddrs(wallet, NULL, 0) + BRWalletUTXOs(wallet, NULL, 0) +
+           BRWalletTxUnconfirmedBefore(wallet, NULL, 0, blockHeight);
+}
+
+// returns the most elements a bloom filter holds at fpRate within BLOOM_MAX_FILTER_LENGTH bytes, past that
+// BRBloomFilterNew() caps the length and the false positive rate rises instead
+static size_t _BloomFilterMaxElements(double fpRate) {
+    return (size_t) (BLOOM_MAX_FILTER_LENGTH*8.0*M_LN2*M_LN2/-log(fpRate));
+}
 
-    uint8_t data[BRBloomFilterSerialize(filter, NULL, 0)];
-    size_t len = BRBloomFilterSerialize(filter, data, sizeof(data));
+// returns the number of elements a bloom filter for all wallets since blockHeight is sized for
+static size_t _PeerManagerFilterElements(BRPeerManager *manager, uint32_t blockHeight) {
+    size_t elemCount = 100;
 
-    BRPeerSendFilterload(peer, data, len);
+    // every time a new wallet address is added, the bloom filter has to be rebuilt, and each address is only used
+    // for one transaction, so here we generate some spare addresses to avoid rebuilding the filter each time a
+    // wallet transaction is encountered during the chain sync
+    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL + manager->policy.filterLookahead, 0);
+    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL + manager->policy.filterLookahead, 1);
+    elemCount += _BloomFilterWalletElements(manager->wallet, blockHeight);
+
+    for (size_t i = 0; i < array_count(manager->watchedWallets); i++) {
+        BRWallet *wallet = manager->watchedWallets[i];
+
+        BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL + manager->policy.filterLookahead, 0);
+        BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL + manager->policy.filterLookahead, 1);
+        elemCount += _BloomFilterWalletElements(wallet, blockHeight);
+    }
+
+    return elemCount;
+}
+
+// returns the digest of the elements a bloom filter for all wallets since blockHeight would be built from, call
+// _PeerManagerFilterElements() first so the spare addresses are included
+static UInt256 _PeerManagerFilterDigest(BRPeerManager *manager, uint32_t blockHeight) {
+    UInt256 digest = UINT256_ZERO;
+
+    _BloomFilterAddWallet(NULL, &digest, manager->wallet, blockHeight);
+
+    for (size_t i = 0; i < array_count(manager->watchedWallets); i++) {
+        _BloomFilterAddWallet(NULL, &digest, manager->watchedWallets[i], blockHeight);
+    }
+
+    return digest;
+}
+
+static void _PeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer) {
+    uint32_t blockHeight = (manager->lastBlock->height > 100) ? manager->lastBlock->height - 100 : 0;
+    BRBloomFilter *filter = manager->bloomFilter;
+
+    BRSetApply(manager->orphans, NULL, _setApplyFreeBlock);
+    BRSetClear(manager->orphans); // clear out orphans that may have been received on an old filter
+    manager->lastOrphan = NULL;
+
+    // a filter restored from a snapshot still matches the wallets it was checked against, so it's sent as is
+    if (!filter || !manager->filterRestored) {
+        manager->filterRestored = 0;
+        manager->filterElemCount = _PeerManagerFilterElements(manager, blockHeight);
+        manager->filterUpdateHeight = manager->lastBlock->height;
+        manager->fpRate = manager->policy.fpRate;
+        manager->filterDigest = UINT256_ZERO;
+
+        // one filter covers every wallet, so each peer streams a single set of merkleblocks for all of them
+        filter = BRBloomFilterNew(manager->fpRate, manager->filterElemCount, (uint32_t) BRPeerHash(peer),
+                                  BLOOM_UPDATE_ALL);
+        _BloomFilterAddWallet(filter, &manager->filterDigest, manager->wallet, blockHeight);
+
+        for (size_t i = 0; i < array_count(manager->watchedWallets); i++) {
+            _BloomFilterAddWallet(filter, &manager->filterDigest, manager->watchedWallets[i], blockHeight);
+        }
+
+        if (manager->bloomFilter) BRBloomFilterFree(manager->bloomFilter);
+        manager->bloomFilter = filter;
+        // TODO: XXX if already synced, recursively add inputs of unconfirmed receives
+    }
+
+    BRWriter data;
+
+    BRWriterInit(&data, BRBloomFilterSerializedSize(filter));
+    BRWriterBloomFilter(&data, filter);
+    BRPeerSendFilterload(peer, data.data, data.len);
+    BRWriterFree(&data);
+    BRPeerSendFeefilter(peer, _PeerManagerFeeFilter(manager));
 }
 
 static void _updateFilterRerequestDone(void *info, int success) {
@@ -491,6 +630,37 @@ static void _PeerManagerUpdateFilter(BRPeerManager *manager) {
     }
 }
 
+// updates the block height and timestamp of the given tx in every wallet that has them
+static void _PeerManagerUpdateWalletTx(BRPeerManager *manager, const UInt256 *txHashes, size_t txCount,
+                                       uint32_t blockHeight, uint32_t timestamp) {
+    BRWalletUpdateTransactions(manager->wallet, txHashes, txCount, blockHeight, timestamp);
+
+    for (size_t i = 0; i < array_count(manager->watchedWallets); i++) {
+        BRWalletUpdateTransactions(manager->watchedWallets[i], txHashes, txCount, blockHeight, timestamp);
+    }
+}
+
+// a wallet tx likely consumed one or more wallet addresses, so check that at least the next <gap limit> unused
+// addresses of wallet are still matched by the bloom filter, and rebuild the filter if they aren't
+static void _PeerManagerCheckFilterAddrs(BRPeerManager *manager, BRWallet *wallet) {
+    BRAddress addrs[SEQUENCE_GAP_LIMIT_EXTERNAL + SEQUENCE_GAP_LIMIT_INTERNAL];
+    UInt160 hash;
+
+    if (manager->bloomFilter == NULL) return; // bloom filter is already being updated
+    BRWalletUnusedAddrs(wallet, addrs, SEQUENCE_GAP_LIMIT_EXTERNAL, 0);
+    BRWalletUnusedAddrs(wallet, addrs + SEQUENCE_GAP_LIMIT_EXTERNAL, SEQUENCE_GAP_LIMIT_INTERNAL, 1);
+
+    for (size_t i = 0; i < SEQUENCE_GAP_LIMIT_EXTERNAL + SEQUENCE_GAP_LIMIT_INTERNAL; i++) {
+        if (!BRAddressHash160(&hash, addrs[i].s) ||
+            BRBloomFilterContainsData(manager->bloomFilter, hash.u8, sizeof(hash)))
+            continue;
+        BRBloomFilterFree(manager->bloomFilter);
+        manager->bloomFilter = NULL; // reset bloom filter so it's recreated with new wallet addresses
+        _PeerManagerUpdateFilter(manager);
+        break;
+    }
+}
+
 static void _PeerManagerUpdateTx(BRPeerManager *manager, const UInt256 *txHashes, size_t txCount,
                                  uint32_t blockHeight, uint32_t timestamp) {
     if (blockHeight != TX_UNCONFIRMED) { // remove confirmed tx from publish list and relay counts
@@ -512,7 +682,7 @@ static void _PeerManagerUpdateTx(BRPeerManager *manager, const UInt256 *txHashes
         }
     }
 
-    BRWalletUpdateTransactions(manager->wallet, txHashes, txCount, blockHeight, timestamp);
+    _PeerManagerUpdateWalletTx(manager, txHashes, txCount, blockHeight, timestamp);
 }
 
 // unconfirmed transactions that aren't in the mempools of any of connected peers have likely dropped off the network
@@ -606,10 +776,129 @@ static void _PeerManagerPublishPendingTx(BRPeerManager *manager, BRPeer *peer) {
     BRPeerSendInv(peer, manager->publishedTxHashes, array_count(manager->publishedTxHashes));
 }
 
+// requests the mempool with published tx and tx restored from a snapshot marked as known, so they aren't downloaded
+static void _PeerManagerSendMempool(BRPeerManager *manager, BRPeer *peer, void *info,
+                                    void (*callback)(void *info, int success)) {
+    size_t publishedCount = array_count(manager->publishedTxHashes), count = array_count(manager->knownTxHashes);
+    UInt256 *txHashes = malloc((publishedCount + count) * sizeof(*txHashes));
+
+    assert(txHashes != NULL || publishedCount + count == 0);
+    if (publishedCount > 0) memcpy(txHashes, manager->publishedTxHashes, publishedCount * sizeof(*txHashes));
+    if (count > 0) memcpy(&txHashes[publishedCount], manager->knownTxHashes, count * sizeof(*txHashes));
+    BRPeerSendMempool(peer, txHashes, publishedCount + count, info, callback);
+    free(txHashes);
+}
+
+// appends the state needed to resume syncing to writer, see BRPeerManagerSnapshot()
+static void _PeerManagerWriteSnapshot(BRPeerManager *manager, BRWriter *writer) {
+    BRMerkleBlock *block, *blocks[BLOCK_DIFFICULTY_INTERVAL];
+    BRPeer *peers[SNAPSHOT_PEERS], *p;
+    size_t i, j, blocksCount = 0, peersCount = 0, connectedCount, txCount = 0, txCountOff, start = writer->len;
+    uint32_t blockHeight = (manager->filterUpdateHeight > 100) ? manager->filterUpdateHeight - 100 : 0;
+    uint64_t fpRate;
+    uint8_t md[32];
+
+    manager->snapshotTime = (uint32_t) time(NULL);
+    BRWriterUInt32LE(writer, SNAPSHOT_VERSION);
+    BRWriterUInt32LE(writer, manager->snapshotTime);
+    BRWriterUInt256(writer, GENESIS_BLOCK_HASH);
+
+    // main chain blocks not yet passed to saveBlocks(), checkpoints have no header to serialize
+    for (block = manager->lastBlock; block && block->height > manager->savedBlockHeight &&
+         blocksCount < BLOCK_DIFFICULTY_INTERVAL && BRSetGet(manager->checkpoints, block) != block;
+         block = BRSetGet(manager->blocks, &block->prevBlock)) {
+        blocks[blocksCount++] = block;
+    }
+
+    BRWriterUInt32LE(writer, (uint32_t) blocksCount);
+
+    for (i = blocksCount; i > 0; i--) {
+        BRWriterUInt32LE(writer, blocks[i - 1]->height);
+        BRWriterUInt32LE(writer, (uint32_t) BRMerkleBlockSerializedSize(blocks[i - 1]));
+        BRWriterMerkleBlock(writer, blocks[i - 1]);
+    }
+
+    // the filter is left out once the wallets have elements it wasn't built with
+    memcpy(&fpRate, &manager->fpRate, sizeof(fpRate));
+    BRWriterUInt64LE(writer, fpRate);
+    BRWriterUInt32LE(writer, manager->filterUpdateHeight);
+    BRWriterUInt32LE(writer, (uint32_t) manager->filterElemCount);
+    BRWriterUInt256(writer, manager->filterDigest);
+
+    if (manager->bloomFilter && _PeerManagerFilterElements(manager, blockHeight) == manager->filterElemCount &&
+        UInt256Eq(_PeerManagerFilterDigest(manager, blockHeight), manager->filterDigest)) {
+        BRWriterUInt32LE(writer, (uint32_t) BRBloomFilterSerializedSize(manager->bloomFilter));
+        BRWriterBloomFilter(writer, manager->bloomFilter);
+    } else BRWriterUInt32LE(writer, 0);
+
+    // connected peers first, lowest ping time first, then the most recently seen of the rest
+    for (i = array_count(manager->connectedPeers); i > 0 && peersCount < SNAPSHOT_PEERS; i--) {
+        if (BRPeerConnectStatus(manager->connectedPeers[i - 1]) != BRPeerStatusConnected) continue;
+        peers[peersCount++] = manager->connectedPeers[i - 1];
+    }
+
+    connectedCount = peersCount;
+
+    for (i = 1; i < connectedCount; i++) {
+        for (j = i; j > 0 && BRPeerPingTime(peers[j - 1]) > BRPeerPingTime(peers[j]); j--) {
+            p = peers[j - 1];
+            peers[j - 1] = peers[j];
+            peers[j] = p;
+        }
+    }
+
+    for (i = 0; i < array_count(manager->peers) && peersCount < SNAPSHOT_PEERS; i++) {
+        for (j = connectedCount; j > 0 && !BRPeerEq(&manager->peers[i], peers[j - 1]); j--);
+        if (j == 0) peers[peersCount++] = &manager->peers[i];
+    }
+
+    BRWriterUInt32LE(writer, (uint32_t) peersCount);
+
+    for (i = 0; i < peersCount; i++) {
+        double pingTime = (i < connectedCount) ? BRPeerPingTime(peers[i]) * 1000 : UINT32_MAX;
+
+        BRWriterAppend(writer, &peers[i]->address, sizeof(UInt128));
+        UInt16SetLE(BRWriterReserve(writer, sizeof(uint16_t)), peers[i]->port);
+        BRWriterUInt64LE(writer, peers[i]->services);
+        BRWriterUInt64LE(writer, peers[i]->timestamp);
+        BRWriterUInt32LE(writer, (pingTime < UINT32_MAX) ? (uint32_t) pingTime : UINT32_MAX);
+    }
+
+    // tx peers have relayed, and restored ones no peer has relayed yet this session
+    txCountOff = writer->len;
+    BRWriterUInt32LE(writer, 0);
+
+    for (i = 0; i < array_count(manager->txRelays); i++, txCount++) {
+        BRWriterUInt256(writer, manager->txRelays[i].txHash);
+    }
+
+    for (i = 0; i < array_count(manager->knownTxHashes); i++) {
+        for (j = array_count(manager->txRelays); j > 0; j--) {
+            if (UInt256Eq(manager->txRelays[j - 1].txHash, manager->knownTxHashes[i])) break;
+        }
+
+        if (j > 0) continue;
+        BRWriterUInt256(writer, manager->knownTxHashes[i]);
+        txCount++;
+    }
+
+    UInt32SetLE(&writer->data[txCountOff], (uint32_t) txCount);
+    BRWriterUInt32LE(writer, (uint32_t) array_count(manager->publishedTx));
+
+    for (i = 0; i < array_count(manager->publishedTx); i++) {
+        BRWriterUInt32LE(writer, (uint32_t) BRTransactionSerializedSize(manager->publishedTx[i].tx));
+        BRWriterTransaction(writer, manager->publishedTx[i].tx);
+    }
+
+    SHA256_2(md, &writer->data[start], writer->len - start);
+    BRWriterAppend(writer, md, sizeof(uint32_t)); // checksum
+}
+
 static void _mempoolDone(void *info, int success) {
     BRPeer *peer = ((PeerCallbackInfo *) info)->peer;
     BRPeerManager *manager = ((PeerCallbackInfo *) info)->manager;
     int syncFinished = 0;
+    BRWriter snapshot = BR_WRITER_NONE;
 
     free(info);
 
@@ -620,13 +909,16 @@ static void _mempoolDone(void *info, int success) {
             peer_log(peer, "sync succeeded");
             syncFinished = 1;
             _PeerManagerSyncStopped(manager);
+            if (manager->saveSnapshot) _PeerManagerWriteSnapshot(manager, &snapshot);
         }
 
         _PeerManagerRequestUnrelayedTx(manager, peer);
-        BRPeerSendGetaddr(peer); // request a list of other ravenwallet peers
+        if (manager->policy.getaddr) BRPeerSendGetaddr(peer); // request a list of other ravenwallet peers
         pthread_mutex_unlock(&manager->lock);
         if (manager->txStatusUpdate) manager->txStatusUpdate(manager->info);
         if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
+        if (snapshot.len > 0) manager->saveSnapshot(manager->info, snapshot.data, snapshot.len);
+        BRWriterFree(&snapshot);
     } else
         peer_log(peer, "mempool request failed");
 }
@@ -637,10 +929,12 @@ static void _loadBloomFilterDone(void *info, int success) {
 
     pthread_mutex_lock(&manager->lock);
 
-    if (success) {
-        BRPeerSendMempool(peer, manager->publishedTxHashes, array_count(manager->publishedTxHashes),
-                          info,
-                          _mempoolDone);
+    if (success && manager->policy.singleMempoolPeer && peer != manager->downloadPeer) {
+        // the download peer's mempool already covers the wallet, this peer only needs the filter to relay new tx
+        pthread_mutex_unlock(&manager->lock);
+        _mempoolDone(info, success);
+    } else if (success) {
+        _PeerManagerSendMempool(manager, peer, info, _mempoolDone);
         pthread_mutex_unlock(&manager->lock);
     } else {
         free(info);
@@ -667,15 +961,13 @@ static void _PeerManagerLoadMempools(BRPeerManager *manager) {
         info->manager = manager;
 
         if (peer != manager->downloadPeer ||
-            manager->fpRate > BLOOM_REDUCED_FALSEPOSITIVE_RATE * 5.0) {
+            manager->fpRate > manager->policy.fpRate * 5.0) {
             _PeerManagerLoadBloomFilter(manager, peer);
             _PeerManagerPublishPendingTx(manager, peer);
             BRPeerSendPing(peer, info,
                            _loadBloomFilterDone); // load mempool after updating bloomfilter
         } else
-            BRPeerSendMempool(peer, manager->publishedTxHashes,
-                              array_count(manager->publishedTxHashes), info,
-                              _mempoolDone);
+            _PeerManagerSendMempool(manager, peer, info, _mempoolDone);
     }
 }
 
@@ -900,7 +1192,9 @@ static void _peerDisconnected(void *info, int error) {
             manager->connectFailureCount = MAX_CONNECT_FAILURES;
     }
 
-    if (!manager->isConnected && manager->connectFailureCount == MAX_CONNECT_FAILURES) {
+    if (manager->budgetStopped) {
+        // peers were disconnected on purpose, keep the peer list and pending tx for the next session
+    } else if (!manager->isConnected && manager->connectFailureCount == MAX_CONNECT_FAILURES) {
         _PeerManagerSyncStopped(manager);
 
         // clear out stored peers so we get a fresh list from DNS on next connect attempt
@@ -929,6 +1223,8 @@ static void _peerDisconnected(void *info, int error) {
         break;
     }
 
+    manager->bytesSent += BRPeerBytesSent(peer);
+    manager->bytesReceived += BRPeerBytesReceived(peer);
     BRPeerFree(peer);
     pthread_mutex_unlock(&manager->lock);
 
@@ -1007,9 +1303,32 @@ static void _peerRelayedTx(void *info, BRTransaction *tx) {
         BRPeerScheduleDisconnect(peer, -1); // cancel publish tx timeout
     }
 
+    // watched wallets each get their own copy, the manager's wallet below takes ownership of tx as before
+    for (size_t i = 0; i < array_count(manager->watchedWallets); i++) {
+        BRWallet *wallet = manager->watchedWallets[i];
+        BRTransaction *copy;
+
+        if (!BRWalletContainsTransaction(wallet, tx) || BRWalletTransactionForHash(wallet, tx->txHash)) continue;
+        copy = BRTransactionCopy(tx);
+        if (!BRWalletRegisterTransaction(wallet, copy)) BRTransactionFree(copy);
+
+        // reschedule sync timeout
+        if (manager->syncStartHeight > 0 && peer == manager->downloadPeer) {
+            BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT);
+        }
+
+        _PeerManagerCheckFilterAddrs(manager, wallet);
+    }
+
     if (manager->syncStartHeight == 0 || BRWalletContainsTransaction(manager->wallet, tx)) {
         isWalletTx = BRWalletRegisterTransaction(manager->wallet, tx);
-        if (isWalletTx) tx = BRWalletTransactionForHash(manager->wallet, tx->txHash);
+
+        if (isWalletTx) {
+            BRTransaction *walletTx = BRWalletTransactionForHash(manager->wallet, tx->txHash);
+
+            if (walletTx != tx) BRTransactionFree(tx); // already registered, the wallet kept the first copy
+            tx = walletTx;
+        }
     } else {
         BRTransactionFree(tx);
         tx = NULL;
@@ -1034,26 +1353,7 @@ static void _peerRelayedTx(void *info, BRTransaction *tx) {
 
         _TxPeerListRemovePeer(manager->txRequests, tx->txHash, peer);
 
-        if (manager->bloomFilter != NULL) { // check if bloom filter is already being updated
-            BRAddress addrs[SEQUENCE_GAP_LIMIT_EXTERNAL + SEQUENCE_GAP_LIMIT_INTERNAL];
-            UInt160 hash;
-
-            // the transaction likely consumed one or more wallet addresses, so check that at least the next <gap limit>
-            // unused addresses are still matched by the bloom filter
-            BRWalletUnusedAddrs(manager->wallet, addrs, SEQUENCE_GAP_LIMIT_EXTERNAL, 0);
-            BRWalletUnusedAddrs(manager->wallet, addrs + SEQUENCE_GAP_LIMIT_EXTERNAL,
-                                SEQUENCE_GAP_LIMIT_INTERNAL, 1);
-
-            for (size_t i = 0; i < SEQUENCE_GAP_LIMIT_EXTERNAL + SEQUENCE_GAP_LIMIT_INTERNAL; i++) {
-                if (!BRAddressHash160(&hash, addrs[i].s) ||
-                    BRBloomFilterContainsData(manager->bloomFilter, hash.u8, sizeof(hash)))
-                    continue;
-                if (manager->bloomFilter) BRBloomFilterFree(manager->bloomFilter);
-                manager->bloomFilter = NULL; // reset bloom filter so it's recreated with new wallet addresses
-                _PeerManagerUpdateFilter(manager);
-                break;
-            }
-        }
+        _PeerManagerCheckFilterAddrs(manager, manager->wallet);
     }
 
     // set timestamp when tx is verified
@@ -1062,6 +1362,7 @@ static void _peerRelayedTx(void *info, BRTransaction *tx) {
         _PeerManagerUpdateTx(manager, &tx->txHash, 1, TX_UNCONFIRMED, (uint32_t) time(NULL));
     }
 
+    if (tx && !isWalletTx) BRTransactionFree(tx); // the wallet only kept a copy of it in its unconfirmed pool
     pthread_mutex_unlock(&manager->lock);
     if (txCallback) txCallback(txInfo, 0);
 }
@@ -1232,6 +1533,8 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
     size_t i, j, fpCount = 0, saveCount = 0;
     BRMerkleBlock orphan, *b, *b2, *prev, *next = NULL;
     uint32_t txTime = 0;
+    int overBudget = 0;
+    BRWriter snapshot = BR_WRITER_NONE;
 
     assert(txHashes != NULL);
     txCount = BRMerkleBlockTxHashes(block, txHashes, txCount);
@@ -1246,7 +1549,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
     // track the observed bloom filter false positive rate using a low pass filter to smooth out variance
     if (peer == manager->downloadPeer && block->totalTx > 0) {
         for (i = 0; i < txCount; i++) { // wallet tx are not false-positives
-            if (!BRWalletTransactionForHash(manager->wallet, txHashes[i])) fpCount++;
+            if (!_PeerManagerWalletForTx(manager, txHashes[i])) fpCount++;
         }
 
         // moving average number of tx-per-block
@@ -1266,7 +1569,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
                      manager->fpRate, manager->lastBlock->height + 1 - manager->filterUpdateHeight);
             BRPeerDisconnect(peer);
         } else if (manager->lastBlock->height + 500 < BRPeerLastBlock(peer) &&
-                   manager->fpRate > BLOOM_REDUCED_FALSEPOSITIVE_RATE * 10.0) {
+                   manager->fpRate > manager->policy.fpRate * 10.0) {
             _PeerManagerUpdateFilter(manager); // rebuild bloom filter when it starts to degrade
         }
     }
@@ -1331,9 +1634,18 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
         if (manager->downloadPeer)
             BRPeerSetCurrentBlockHeight(manager->downloadPeer, block->height);
 
+        // once synced, follow wallet fee rate changes, the peer only sends feefilter if the rate changed
+        if (block->height >= BRPeerLastBlock(peer)) BRPeerSendFeefilter(peer, _PeerManagerFeeFilter(manager));
+
+        if (manager->saveSnapshot && block->height >= BRPeerLastBlock(peer) && manager->syncStartHeight == 0 &&
+            manager->snapshotTime + SNAPSHOT_INTERVAL <= time(NULL)) {
+            _PeerManagerWriteSnapshot(manager, &snapshot);
+        }
+
         if (block->height < manager->estimatedHeight && peer == manager->downloadPeer) {
             BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
             manager->connectFailureCount = 0; // reset failure count once we know our initial request didn't timeout
+            overBudget = _PeerManagerBudgetExceeded(manager);
         }
 
         if ((block->height % BLOCK_DIFFICULTY_INTERVAL) == 0)
@@ -1407,6 +1719,10 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
             BRWalletSetTxUnconfirmedAfter(manager->wallet,
                                           b->height); // mark tx after the join point as unconfirmed
 
+            for (i = 0; i < array_count(manager->watchedWallets); i++) {
+                BRWalletSetTxUnconfirmedAfter(manager->watchedWallets[i], b->height);
+            }
+
             b = block;
 
             while (b && b2 &&
@@ -1425,8 +1741,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
                 count = BRMerkleBlockTxHashes(b, txHashes, count);
                 b = BRSetGet(manager->blocks, &b->prevBlock);
                 if (b) timestamp = timestamp / 2 + b->timestamp / 2;
-                if (count > 0)
-                    BRWalletUpdateTransactions(manager->wallet, txHashes, count, height, timestamp);
+                if (count > 0) _PeerManagerUpdateWalletTx(manager, txHashes, count, height, timestamp);
             }
 
             manager->lastBlock = block;
@@ -1441,6 +1756,21 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
 
     if (txHashes != _txHashes) free(txHashes);
 
+    if (overBudget) { // leave the rest of the chain for a later session, keeping what was downloaded so far
+        peer_log(peer, "sync byte budget of %"
+                PRIu64
+                " used up at block #%"
+                PRIu32
+                ", disconnecting...", manager->policy.byteBudget, block->height);
+        saveCount = (block->height % BLOCK_DIFFICULTY_INTERVAL) + BLOCK_DIFFICULTY_INTERVAL + 1;
+        _PeerManagerSyncStopped(manager);
+        manager->budgetStopped = 1; // prevent automatic reconnect attempts
+
+        for (i = array_count(manager->connectedPeers); i > 0; i--) {
+            BRPeerDisconnect(manager->connectedPeers[i - 1]);
+        }
+    }
+
     if (block && block->height != BLOCK_UNKNOWN_HEIGHT) {
         if (block->height > manager->estimatedHeight) manager->estimatedHeight = block->height;
 
@@ -1461,9 +1791,13 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block) {
     j = (i > 0) ? saveBlocks[i - 1]->height % BLOCK_DIFFICULTY_INTERVAL : 0;
     if (j > 0) i -= (i > BLOCK_DIFFICULTY_INTERVAL - j) ? BLOCK_DIFFICULTY_INTERVAL - j : i;
     assert(i == 0 || (saveBlocks[i - 1]->height % BLOCK_DIFFICULTY_INTERVAL) == 0);
+    if (i > 0) manager->savedBlockHeight = saveBlocks[0]->height;
     pthread_mutex_unlock(&manager->lock);
     if (i > 0 && manager->saveBlocks)
         manager->saveBlocks(manager->info, (i > 1 ? 1 : 0), saveBlocks, i);
+    if (snapshot.len > 0) manager->saveSnapshot(manager->info, snapshot.data, snapshot.len);
+    BRWriterFree(&snapshot);
+    if (overBudget && manager->syncStopped) manager->syncStopped(manager->info, EDQUOT);
 
     if (block && block->height != BLOCK_UNKNOWN_HEIGHT && block->height >= BRPeerLastBlock(peer) &&
         manager->txStatusUpdate) {
@@ -1587,7 +1921,7 @@ static void _dummyThreadCleanup(void *info) {
 BRPeerManager *BRPeerManagerNew(BRWallet *wallet, uint32_t earliestKeyTime, BRMerkleBlock **blocks,
                                 size_t blocksCount,
                                 const BRPeer *peers, size_t peersCount) {
-    BRPeerManager *manager = calloc(1, sizeof(*manager));
+    BRPeerManager *manager = BRAllocatorCalloc(PEER_ALLOCATOR, sizeof(*manager));
     BRMerkleBlock orphan, *block = NULL;
 
     assert(manager != NULL);
@@ -1598,16 +1932,18 @@ BRPeerManager *BRPeerManagerNew(BRWallet *wallet, uint32_t earliestKeyTime, BRMe
     manager->earliestKeyTime = earliestKeyTime;
     manager->averageTxPerBlock = 1400;
     manager->maxConnectCount = PEER_MAX_CONNECTIONS;
-    array_new(manager->peers, peersCount);
+    manager->policy = BR_SYNC_POLICY_DEFAULT;
+    array_new_with_allocator(manager->watchedWallets, 0, PEER_ALLOCATOR);
+    array_new_with_allocator(manager->peers, peersCount, PEER_ALLOCATOR);
     if (peers) array_add_array(manager->peers, peers, peersCount);
     qsort(manager->peers, array_count(manager->peers), sizeof(*manager->peers),
           _peerTimestampCompare);
-    array_new(manager->connectedPeers, PEER_MAX_CONNECTIONS);
-    manager->blocks = BRSetNew(BRMerkleBlockHash, BRMerkleBlockEq, blocksCount);
-    manager->orphans = BRSetNew(_PrevBlockHash, _PrevBlockEq,
-                                blocksCount); // orphans are indexed by prevBlock
-    manager->checkpoints = BRSetNew(_BlockHeightHash, _BlockHeightEq,
-                                    100); // checkpoints are indexed by height
+    array_new_with_allocator(manager->connectedPeers, PEER_MAX_CONNECTIONS, PEER_ALLOCATOR);
+    manager->blocks = BRSetNewWithAllocator(BRMerkleBlockHash, BRMerkleBlockEq, blocksCount, CHAIN_ALLOCATOR);
+    manager->orphans = BRSetNewWithAllocator(_PrevBlockHash, _PrevBlockEq, blocksCount,
+                                             CHAIN_ALLOCATOR); // orphans are indexed by prevBlock
+    manager->checkpoints = BRSetNewWithAllocator(_BlockHeightHash, _BlockHeightEq, 100,
+                                                 CHAIN_ALLOCATOR); // checkpoints are indexed by height
 
     for (size_t i = 0; i < CHECKPOINT_COUNT; i++) {
         block = BRMerkleBlockNew();
@@ -1642,10 +1978,12 @@ BRPeerManager *BRPeerManagerNew(BRWallet *wallet, uint32_t earliestKeyTime, BRMe
         block = BRSetGet(manager->orphans, &orphan);
     }
 
-    array_new(manager->txRelays, 10);
-    array_new(manager->txRequests, 10);
-    array_new(manager->publishedTx, 10);
-    array_new(manager->publishedTxHashes, 10);
+    manager->savedBlockHeight = manager->lastBlock->height;
+    array_new_with_allocator(manager->txRelays, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(manager->txRequests, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(manager->publishedTx, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(manager->publishedTxHashes, 10, PEER_ALLOCATOR);
+    array_new_with_allocator(manager->knownTxHashes, 0, PEER_ALLOCATOR);
     pthread_mutex_init(&manager->lock, NULL);
     manager->threadCleanup = _dummyThreadCleanup;
     return manager;
@@ -1683,10 +2021,255 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
     manager->threadCleanup = (threadCleanup) ? threadCleanup : _dummyThreadCleanup;
 }
 
+// not thread-safe, set the callback once before calling PeerManagerConnect()
+// void saveSnapshot(void *, const uint8_t *, size_t) - called with a new BRPeerManagerSnapshot() once sync completes,
+// every few minutes after that, and on BRPeerManagerDisconnect(), the app should store it in place of the last one
+void BRPeerManagerSetSnapshotCallback(BRPeerManager *manager,
+                                      void (*saveSnapshot)(void *info, const uint8_t *snapshot, size_t snapshotLen)) {
+    assert(manager != NULL);
+    manager->saveSnapshot = saveSnapshot;
+}
+
+// writes the state needed to resume syncing where this session left off to buf: the main chain blocks not yet passed to
+// saveBlocks(), the bloom filter, the best peers with their ping times, known tx hashes and pending tx publishes
+// returns number of bytes written, or total bufLen needed if buf is NULL
+size_t BRPeerManagerSnapshot(BRPeerManager *manager, uint8_t *buf, size_t bufLen) {
+    BRWriter writer;
+    size_t len;
+
+    assert(manager != NULL);
+    BRWriterInit(&writer, 0x1000);
+    pthread_mutex_lock(&manager->lock);
+    _PeerManagerWriteSnapshot(manager, &writer);
+    pthread_mutex_unlock(&manager->lock);
+    len = writer.len;
+    if (buf && len <= bufLen) memcpy(buf, writer.data, len);
+    BRWriterFree(&writer);
+    return (!buf || len <= bufLen) ? len : 0;
+}
+
+// resumes from a snapshot taken by a previous session, call after BRPeerManagerNew() and before PeerManagerConnect()
+// parts that no longer match the chain or the wallet are skipped and rebuilt as usual
+// returns true if the snapshot was used, false if it was corrupt or made for another chain or snapshot version
+int BRPeerManagerRestoreSnapshot(BRPeerManager *manager, const uint8_t *snapshot, size_t snapshotLen) {
+    static const size_t peerLen = sizeof(UInt128) + sizeof(uint16_t) + sizeof(uint64_t)*2 + sizeof(uint32_t);
+    BRMerkleBlock **blocks = NULL, orphan, *b;
+    BRBloomFilter *filter = NULL;
+    BRTransaction **txs = NULL, *tx;
+    BRPeer *peers = NULL;
+    const uint8_t *txHashes = NULL;
+    size_t i, j, off = 0, len = 0, blocksCount = 0, peersCount = 0, resumeCount = 0, txHashesCount = 0, txCount = 0;
+    uint32_t snapshotTime = 0, filterUpdateHeight = 0, filterElemCount = 0, blockHeight;
+    uint64_t fpRateBits = 0;
+    UInt256 filterDigest = UINT256_ZERO;
+    double fpRate;
+    uint8_t md[32];
+    int r = 1;
+
+    assert(manager != NULL);
+    assert(snapshot != NULL || snapshotLen == 0);
+    if (snapshotLen < sizeof(uint32_t)*2 + sizeof(UInt256) + sizeof(uint32_t)) return 0;
+    snapshotLen -= sizeof(uint32_t);
+    SHA256_2(md, snapshot, snapshotLen);
+
+    if (memcmp(md, &snapshot[snapshotLen], sizeof(uint32_t)) != 0 || UInt32GetLE(snapshot) != SNAPSHOT_VERSION ||
+        !UInt256Eq(UInt256Get(&snapshot[sizeof(uint32_t)*2]), GENESIS_BLOCK_HASH)) return 0;
+
+    snapshotTime = UInt32GetLE(&snapshot[sizeof(uint32_t)]);
+    off = sizeof(uint32_t)*2 + sizeof(UInt256);
+    if (off + sizeof(uint32_t) <= snapshotLen) blocksCount = UInt32GetLE(&snapshot[off]);
+    off += sizeof(uint32_t);
+    if (off > snapshotLen || blocksCount > BLOCK_DIFFICULTY_INTERVAL) r = 0;
+    if (r && blocksCount > 0) blocks = calloc(blocksCount, sizeof(*blocks));
+    assert(blocks != NULL || !r || blocksCount == 0);
+
+    for (i = 0; r && i < blocksCount; i++) { // the blocks are one chain, in ascending order
+        uint32_t height = 0;
+
+        if (off + sizeof(uint32_t)*2 <= snapshotLen) {
+            height = UInt32GetLE(&snapshot[off]);
+            len = UInt32GetLE(&snapshot[off + sizeof(uint32_t)]);
+            off += sizeof(uint32_t)*2;
+        } else r = 0;
+
+        if (r && len <= snapshotLen - off) blocks[i] = BRMerkleBlockParse(&snapshot[off], len, NULL);
+        off += len;
+        if (blocks[i]) blocks[i]->height = height;
+        if (!blocks[i] || (i > 0 && (blocks[i]->height != blocks[i - 1]->height + 1 ||
+                                     !UInt256Eq(blocks[i]->prevBlock, blocks[i - 1]->blockHash)))) r = 0;
+    }
+
+    if (r && off + sizeof(uint64_t) + sizeof(uint32_t)*3 + sizeof(UInt256) <= snapshotLen) {
+        fpRateBits = UInt64GetLE(&snapshot[off]);
+        filterUpdateHeight = UInt32GetLE(&snapshot[off + sizeof(uint64_t)]);
+        filterElemCount = UInt32GetLE(&snapshot[off + sizeof(uint64_t) + sizeof(uint32_t)]);
+        filterDigest = UInt256Get(&snapshot[off + sizeof(uint64_t) + sizeof(uint32_t)*2]);
+        len = UInt32GetLE(&snapshot[off + sizeof(uint64_t) + sizeof(uint32_t)*2 + sizeof(UInt256)]);
+        off += sizeof(uint64_t) + sizeof(uint32_t)*3 + sizeof(UInt256);
+        if (len > snapshotLen - off) r = 0;
+        if (r && len > 0 && !(filter = BRBloomFilterParse(&snapshot[off], len))) r = 0;
+        off += len;
+    } else r = 0;
+
+    if (r && off + sizeof(uint32_t) <= snapshotLen) {
+        peersCount = UInt32GetLE(&snapshot[off]);
+        off += sizeof(uint32_t);
+        if (peersCount > (snapshotLen - off)/peerLen) r = 0;
+    } else r = 0;
+
+    if (r && peersCount > 0) peers = calloc(peersCount, sizeof(*peers));
+    assert(peers != NULL || !r || peersCount == 0);
+
+    for (i = 0; r && i < peersCount; i++, off += peerLen) {
+        peers[i].address = UInt128Get(&snapshot[off]);
+        peers[i].port = UInt16GetLE(&snapshot[off + sizeof(UInt128)]);
+        peers[i].services = UInt64GetLE(&snapshot[off + sizeof(UInt128) + sizeof(uint16_t)]);
+        peers[i].timestamp = UInt64GetLE(&snapshot[off + sizeof(UInt128) + sizeof(uint16_t) + sizeof(uint64_t)]);
+
+        // peers that were connected have a ping time and are the first ones
+        if (UInt32GetLE(&snapshot[off + peerLen - sizeof(uint32_t)]) != UINT32_MAX && resumeCount == i) {
+            if (peers[i].timestamp < snapshotTime) peers[i].timestamp = snapshotTime;
+            resumeCount++;
+        }
+    }
+
+    if (r && off + sizeof(uint32_t) <= snapshotLen) {
+        txHashesCount = UInt32GetLE(&snapshot[off]);
+        off += sizeof(uint32_t);
+        if (txHashesCount > (snapshotLen - off)/sizeof(UInt256)) r = 0;
+        txHashes = &snapshot[off];
+        if (r) off += txHashesCount*sizeof(UInt256);
+    } else r = 0;
+
+    if (r && off + sizeof(uint32_t) <= snapshotLen) {
+        txCount = UInt32GetLE(&snapshot[off]);
+        off += sizeof(uint32_t);
+        if (txCount > (snapshotLen - off)/sizeof(uint32_t)) r = 0;
+    } else r = 0;
+
+    if (r && txCount > 0) txs = calloc(txCount, sizeof(*txs));
+    assert(txs != NULL || !r || txCount == 0);
+
+    for (i = 0; r && i < txCount; i++) {
+        len = (off + sizeof(uint32_t) <= snapshotLen) ? UInt32GetLE(&snapshot[off]) : 0;
+        off += sizeof(uint32_t);
+        if (off <= snapshotLen && len <= snapshotLen - off) txs[i] = BRTransactionParse(&snapshot[off], len);
+        off += len;
+        if (!txs[i] || !BRTransactionIsSigned(txs[i])) r = 0;
+    }
+
+    if (r && off != snapshotLen) r = 0;
+
+    if (r) {
+        pthread_mutex_lock(&manager->lock);
+        b = (blocksCount > 0) ? BRSetGet(manager->blocks, &blocks[0]->prevBlock) : NULL;
+
+        // the blocks are only used if they extend the chain loaded from the saved blocks
+        if (b && b->height + 1 == blocks[0]->height && blocks[blocksCount - 1]->height > manager->lastBlock->height) {
+            for (i = 0; i < blocksCount; i++) {
+                orphan.prevBlock = blocks[i]->prevBlock;
+                b = BRSetGet(manager->orphans, &orphan);
+
+                if (b && UInt256Eq(b->blockHash, blocks[i]->blockHash)) {
+                    BRSetRemove(manager->orphans, b);
+                    BRMerkleBlockFree(b);
+                }
+
+                b = BRSetGet(manager->blocks, blocks[i]);
+
+                if (b) { // keep the block that's already in the chain
+                    BRMerkleBlockFree(blocks[i]);
+                    blocks[i] = b;
+                } else BRSetAdd(manager->blocks, blocks[i]);
+            }
+
+            manager->lastBlock = blocks[blocksCount - 1];
+            if (manager->lastBlock->height > manager->estimatedHeight)
+                manager->estimatedHeight = manager->lastBlock->height;
+        } else {
+            for (i = 0; i < blocksCount; i++) BRMerkleBlockFree(blocks[i]);
+        }
+
+        // the filter is only used if the wallets still have the same elements it was built from
+        blockHeight = (filterUpdateHeight > 100) ? filterUpdateHeight - 100 : 0;
+        memcpy(&fpRate, &fpRateBits, sizeof(fpRate));
+
+        if (filter && filterUpdateHeight <= manager->lastBlock->height && fpRate >= 0.0 && fpRate < 1.0 &&
+            _PeerManagerFilterElements(manager, blockHeight) == filterElemCount &&
+            UInt256Eq(_PeerManagerFilterDigest(manager, blockHeight), filterDigest)) {
+            if (manager->bloomFilter) BRBloomFilterFree(manager->bloomFilter);
+            manager->bloomFilter = filter;
+            manager->filterRestored = 1;
+            manager->filterUpdateHeight = filterUpdateHeight;
+            manager->filterElemCount = filterElemCount;
+            manager->filterDigest = filterDigest;
+            manager->fpRate = fpRate;
+        } else if (filter) BRBloomFilterFree(filter);
+
+        // a fixed peer replaces the peer list, otherwise the restored peers go first, skipping the DNS lookup
+        if (UInt128IsZero(manager->fixedPeer.address) && peersCount > 0) {
+            for (i = array_count(manager->peers); i > 0; i--) {
+                for (j = peersCount; j > 0 && !BRPeerEq(&manager->peers[i - 1], &peers[j - 1]); j--);
+                if (j > 0) array_rm(manager->peers, i - 1);
+            }
+
+            array_insert_array(manager->peers, 0, peers, peersCount);
+            manager->resumePeerCount = (resumeCount < manager->maxConnectCount) ? resumeCount :
+                                       manager->maxConnectCount;
+        }
+
+        for (i = 0; i < txHashesCount; i++) { // only wallet tx can be reported back from a peer's mempool inv
+            UInt256 txHash = UInt256Get(&txHashes[i*sizeof(UInt256)]);
+
+            for (j = array_count(manager->knownTxHashes); j > 0; j--) {
+                if (UInt256Eq(manager->knownTxHashes[j - 1], txHash)) break;
+            }
+
+            if (j == 0 && BRWalletTransactionForHash(manager->wallet, txHash))
+                array_add(manager->knownTxHashes, txHash);
+        }
+
+        for (i = 0; i < txCount; i++) { // publish the wallet's own copy of a tx if it has one
+            tx = BRWalletTransactionForHash(manager->wallet, txs[i]->txHash);
+
+            if (tx) {
+                BRTransactionFree(txs[i]);
+                txs[i] = NULL;
+            } else tx = txs[i];
+
+            for (j = array_count(manager->publishedTx); j > 0; j--) {
+                if (UInt256Eq(manager->publishedTxHashes[j - 1], tx->txHash)) break;
+            }
+
+            if (j == 0 && tx->blockHeight == TX_UNCONFIRMED) {
+                _PeerManagerAddTxToPublishList(manager, tx, NULL, NULL);
+            } else if (txs[i]) BRTransactionFree(txs[i]);
+        }
+
+        pthread_mutex_unlock(&manager->lock);
+    } else {
+        for (i = 0; blocks && i < blocksCount; i++) {
+            if (blocks[i]) BRMerkleBlockFree(blocks[i]);
+        }
+
+        for (i = 0; txs && i < txCount; i++) {
+            if (txs[i]) BRTransactionFree(txs[i]);
+        }
+
+        if (filter) BRBloomFilterFree(filter);
+    }
+
+    if (blocks) free(blocks);
+    if (peers) free(peers);
+    if (txs) free(txs);
+    return r;
+}
+
 static int _PeerManagerRescan(BRPeerManager *manager, BRMerkleBlock *newLastBlock) {
     if (NULL == newLastBlock) return 0;
 
     manager->lastBlock = newLastBlock;
+    manager->filterRestored = 0; // a restored filter doesn't cover tx spent since the rescan height
 
     if (manager->downloadPeer) { // disconnect the current download peer so a new random one will be selected
         for (size_t i = array_count(manager->peers); i > 0; i--) {
@@ -1712,6 +2295,91 @@ void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t
     pthread_mutex_unlock(&manager->lock);
 }
 
+// adds a wallet to be synced alongside the manager's own wallet, sharing its header chain, peers and bloom filter
+// returns false, leaving the wallet unwatched, if the shared filter would then be over BLOOM_MAX_FILTER_LENGTH
+int BRPeerManagerAddWallet(BRPeerManager *manager, BRWallet *wallet, uint32_t earliestKeyTime) {
+    uint32_t blockHeight;
+    int r = 1;
+
+    assert(manager != NULL);
+    assert(wallet != NULL);
+    pthread_mutex_lock(&manager->lock);
+    blockHeight = (manager->lastBlock->height > 100) ? manager->lastBlock->height - 100 : 0;
+
+    for (size_t i = array_count(manager->watchedWallets); i > 0; i--) {
+        if (manager->watchedWallets[i - 1] == wallet) wallet = NULL;
+    }
+
+    if (wallet && wallet != manager->wallet) {
+        array_add(manager->watchedWallets, wallet);
+
+        // one filter can't be split across peers, they each match against all of it
+        if (_PeerManagerFilterElements(manager, blockHeight) > _BloomFilterMaxElements(manager->policy.fpRate)) {
+            array_rm_last(manager->watchedWallets);
+            wallet = NULL;
+            r = 0;
+        }
+    }
+
+    if (wallet && wallet != manager->wallet) {
+        if (earliestKeyTime < manager->earliestKeyTime) { // download full blocks far enough back for the new wallet
+            manager->earliestKeyTime = earliestKeyTime;
+
+            for (size_t i = array_count(manager->connectedPeers); i > 0; i--) {
+                BRPeerSetEarliestKeyTime(manager->connectedPeers[i - 1], earliestKeyTime);
+            }
+        }
+
+        if (manager->bloomFilter) { // reload the filter with the new wallet's addresses
+            BRBloomFilterFree(manager->bloomFilter);
+            manager->bloomFilter = NULL;
+            _PeerManagerUpdateFilter(manager);
+        }
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    return r;
+}
+
+// stops syncing a wallet added with BRPeerManagerAddWallet(), the wallet itself is left as is
+void BRPeerManagerRemoveWallet(BRPeerManager *manager, BRWallet *wallet) {
+    assert(manager != NULL);
+    assert(wallet != NULL);
+    pthread_mutex_lock(&manager->lock);
+
+    for (size_t i = array_count(manager->watchedWallets); i > 0; i--) {
+        if (manager->watchedWallets[i - 1] == wallet) array_rm(manager->watchedWallets, i - 1);
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+}
+
+// sets the policy used from the next bloom filter load on, the default is BR_SYNC_POLICY_DEFAULT
+void BRPeerManagerSetSyncPolicy(BRPeerManager *manager, BRSyncPolicy policy) {
+    assert(manager != NULL);
+    assert(policy.fpRate > 0.0 && policy.fpRate < 1.0);
+    pthread_mutex_lock(&manager->lock);
+    manager->policy = policy;
+    pthread_mutex_unlock(&manager->lock);
+}
+
+// the policy currently in use
+BRSyncPolicy BRPeerManagerSyncPolicy(BRPeerManager *manager) {
+    BRSyncPolicy policy;
+
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    policy = manager->policy;
+    pthread_mutex_unlock(&manager->lock);
+    return policy;
+}
+
+// the fee rate sent to peers in feefilter messages, mempool tx paying less aren't relayed to us
+uint64_t BRPeerManagerFeeFilter(BRPeerManager *manager) {
+    assert(manager != NULL);
+    return _PeerManagerFeeFilter(manager);
+}
+
 // current connect status
 BRPeerStatus BRPeerManagerConnectStatus(BRPeerManager *manager) {
     BRPeerStatus status = BRPeerStatusDisconnected;
@@ -1748,6 +2416,7 @@ void BRPeerManagerConnect(BRPeerManager *manager) {
     pthread_mutex_lock(&manager->lock);
     if (manager->connectFailureCount >= MAX_CONNECT_FAILURES)
         manager->connectFailureCount = 0; //this is a manual retry
+    manager->budgetStopped = 0;
 
     if ((!manager->downloadPeer || manager->lastBlock->height < manager->estimatedHeight) &&
         manager->syncStartHeight == 0) {
@@ -1784,6 +2453,11 @@ void BRPeerManagerConnect(BRPeerManager *manager) {
             i = i * i / array_count(
                     peers); // bias random peer selection toward peers with more recent timestamp
 
+            if (manager->resumePeerCount > 0) { // peers restored from a snapshot come first, lowest ping time first
+                manager->resumePeerCount--;
+                i = 0;
+            }
+
             for (size_t j = array_count(manager->connectedPeers); i != SIZE_MAX && j > 0; j--) {
                 if (!BRPeerEq(&peers[i], manager->connectedPeers[j - 1])) continue;
                 array_rm(peers, i); // already in connectedPeers
@@ -1823,12 +2497,16 @@ void BRPeerManagerConnect(BRPeerManager *manager) {
 void BRPeerManagerDisconnect(BRPeerManager *manager) {
     struct timespec ts;
     size_t peerCount, dnsThreadCount;
+    BRWriter snapshot = BR_WRITER_NONE;
 
     assert(manager != NULL);
     pthread_mutex_lock(&manager->lock);
     peerCount = array_count(manager->connectedPeers);
     dnsThreadCount = manager->dnsThreadCount;
 
+    // taken while the peers are still connected, so their ping times are kept
+    if (peerCount > 0 && manager->saveSnapshot) _PeerManagerWriteSnapshot(manager, &snapshot);
+
     for (size_t i = peerCount; i > 0; i--) {
         manager->connectFailureCount = MAX_CONNECT_FAILURES; // prevent futher automatic reconnect attempts
         BRPeerDisconnect(manager->connectedPeers[i - 1]);
@@ -1845,12 +2523,16 @@ void BRPeerManagerDisconnect(BRPeerManager *manager) {
         dnsThreadCount = manager->dnsThreadCount;
         pthread_mutex_unlock(&manager->lock);
     }
+
+    if (snapshot.len > 0) manager->saveSnapshot(manager->info, snapshot.data, snapshot.len);
+    BRWriterFree(&snapshot);
 }
 
 static int _BRPeerManagerRescan(BRPeerManager *manager, BRMerkleBlock *newLastBlock) {
     if (NULL == newLastBlock) return 0;
 
     manager->lastBlock = newLastBlock;
+    manager->filterRestored = 0; // a restored filter doesn't cover tx spent since the rescan height
 
     if (manager->downloadPeer) { // disconnect the current download peer so a new random one will be selected
         for (size_t i = array_count(manager->peers); i > 0; i--) {
@@ -2049,6 +2731,34 @@ const char *BRPeerManagerDownloadPeerName(BRPeerManager *manager) {
     return manager->downloadPeerName;
 }
 
+// bytes sent to and received from all peers since the manager was created or the byte count was last reset,
+// including peers that have since disconnected
+void BRPeerManagerByteCount(BRPeerManager *manager, uint64_t *sent, uint64_t *received) {
+    uint64_t s, r;
+
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    _PeerManagerByteCount(manager, &s, &r);
+    pthread_mutex_unlock(&manager->lock);
+    if (sent) *sent = s;
+    if (received) *received = r;
+}
+
+// starts a new byte accounting session, the policy byteBudget is measured from here
+void BRPeerManagerResetByteCount(BRPeerManager *manager) {
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    manager->bytesSent = manager->bytesReceived = 0;
+
+    // peer counters only grow, so offset the session totals by what connected peers used before the reset
+    for (size_t i = array_count(manager->connectedPeers); i > 0; i--) {
+        manager->bytesSent -= BRPeerBytesSent(manager->connectedPeers[i - 1]);
+        manager->bytesReceived -= BRPeerBytesReceived(manager->connectedPeers[i - 1]);
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+}
+
 static void _publishTxInvDone(void *info, int success) {
     BRPeer *peer = ((PeerCallbackInfo *) info)->peer;
     BRPeerManager *manager = ((PeerCallbackInfo *) info)->manager;
@@ -2192,7 +2902,99 @@ void BRPeerManagerFree(BRPeerManager *manager) {
 
     array_free(manager->publishedTx);
     array_free(manager->publishedTxHashes);
+    array_free(manager->knownTxHashes);
+    array_free(manager->watchedWallets);
     pthread_mutex_unlock(&manager->lock);
     pthread_mutex_destroy(&manager->lock);
-    free(manager);
+    BRAllocatorFree(PEER_ALLOCATOR, manager, sizeof(*manager));
+}
+
+// returns a new empty block header linked to the last block, manager->lock must be held
+static BRMerkleBlock *_PeerManagerTestBlock(BRPeerManager *manager, uint32_t timestamp, uint32_t nonce) {
+    BRMerkleBlock *block = BRMerkleBlockNew();
+
+    block->version = 0x20000000;
+    block->prevBlock = manager->lastBlock->blockHash;
+    block->timestamp = timestamp;
+    block->target = manager->lastBlock->target;
+    block->nonce = nonce;
+
+    uint8_t buf[BRMerkleBlockSerialize(block, NULL, 0)];
+    size_t len = BRMerkleBlockSerialize(block, buf, sizeof(buf));
+
+    BRMerkleBlockFree(block);
+    block = BRMerkleBlockParse(buf, len, NULL); // parsed, so it has the hash the next block links to
+    assert(block != NULL);
+    return block;
+}
+
+// extends the chain with an empty block header linked to the last block, as if it was downloaded but not yet saved
+void PeerManagerAddBlockTest(BRPeerManager *manager, uint32_t timestamp, uint32_t nonce) {
+    BRMerkleBlock *block;
+
+    pthread_mutex_lock(&manager->lock);
+    block = _PeerManagerTestBlock(manager, timestamp, nonce);
+    block->height = manager->lastBlock->height + 1;
+    BRSetAdd(manager->blocks, block);
+    manager->lastBlock = block;
+    pthread_mutex_unlock(&manager->lock);
+}
+
+// passes an empty block header linked to the last block to the manager as if peer had relayed it
+void PeerManagerRelayedBlockTest(BRPeerManager *manager, BRPeer *peer, uint32_t timestamp, uint32_t nonce) {
+    PeerCallbackInfo info = { peer, manager, UINT256_ZERO };
+    BRMerkleBlock *block;
+
+    pthread_mutex_lock(&manager->lock);
+    block = _PeerManagerTestBlock(manager, timestamp, nonce);
+    pthread_mutex_unlock(&manager->lock);
+    _peerRelayedBlock(&info, block);
+}
+
+// makes peer the connected download peer of a sync up to estimatedHeight, that already used bytesReceived this session
+void PeerManagerSyncTest(BRPeerManager *manager, BRPeer *peer, uint32_t estimatedHeight, uint64_t bytesReceived) {
+    pthread_mutex_lock(&manager->lock);
+    array_add(manager->connectedPeers, peer);
+    manager->downloadPeer = peer;
+    manager->isConnected = 1;
+    manager->estimatedHeight = estimatedHeight;
+    manager->syncStartHeight = manager->lastBlock->height + 1;
+    manager->bytesReceived = bytesReceived;
+    pthread_mutex_unlock(&manager->lock);
+}
+
+// tells the manager that peer disconnected with error, the manager frees peer
+void PeerManagerDisconnectedTest(BRPeerManager *manager, BRPeer *peer, int error) {
+    PeerCallbackInfo info = { peer, manager, UINT256_ZERO };
+
+    _peerDisconnected(&info, error);
+}
+
+// loads the bloom filter for the manager's wallets, sending it to peer if connected, returns true if it was the one
+// restored from a snapshot rather than a newly built one
+int PeerManagerLoadBloomFilterTest(BRPeerManager *manager, BRPeer *peer) {
+    int r;
+
+    pthread_mutex_lock(&manager->lock);
+    _PeerManagerLoadBloomFilter(manager, peer);
+    r = manager->filterRestored;
+    pthread_mutex_unlock(&manager->lock);
+    return r;
+}
+
+// passes tx to the manager as if peer had relayed it, the manager takes ownership of tx
+void PeerManagerRelayedTxTest(BRPeerManager *manager, BRPeer *peer, BRTransaction *tx) {
+    PeerCallbackInfo info = { peer, manager, UINT256_ZERO };
+
+    _peerRelayedTx(&info, tx);
+}
+
+// returns the wallet that registered the tx with txHash, or NULL if none
+BRWallet *PeerManagerWalletForTxTest(BRPeerManager *manager, UInt256 txHash) {
+    BRWallet *wallet;
+
+    pthread_mutex_lock(&manager->lock);
+    wallet = _PeerManagerWalletForTx(manager, txHash);
+    pthread_mutex_unlock(&manager->lock);
+    return wallet;
 }
@@ -26,6 +26,7 @@
 #define BRPeerManager_h
 
 #include "BRPeer.h"
+#include "BRBloomFilter.h"
 #include "BRMerkleBlock.h"
 #include "BRTransaction.h"
 #include "BRWallet.h"
@@ -41,6 +42,18 @@ extern "C" {
 
 typedef struct PeerManagerStruct BRPeerManager;
 
+// trades sync latency and privacy against the bytes a sync costs
+typedef struct {
+    double fpRate; // bloom filter false positive rate, lower means less false positive tx data but less privacy
+    uint32_t filterLookahead; // spare addresses per chain in the filter, more means fewer filter rebuilds during sync
+    int singleMempoolPeer; // true to request the mempool only from the download peer instead of every connected peer
+    int getaddr; // true to ask peers for the addresses of other peers after their mempool is loaded
+    uint64_t byteBudget; // stop the sync once this many bytes were used since the last byte count reset, 0 for no cap
+} BRSyncPolicy;
+
+#define BR_SYNC_POLICY_DEFAULT ((const BRSyncPolicy) { BLOOM_REDUCED_FALSEPOSITIVE_RATE, 100, 0, 1, 0 })
+#define BR_SYNC_POLICY_METERED ((const BRSyncPolicy) { BLOOM_REDUCED_FALSEPOSITIVE_RATE / 5, 500, 1, 0, 0 })
+
 // returns a newly allocated PeerManager struct that must be freed by calling PeerManagerFree()
 BRPeerManager *BRPeerManagerNew(BRWallet *wallet, uint32_t earliestKeyTime, BRMerkleBlock **blocks, size_t blocksCount,
                                 const BRPeer *peers, size_t peersCount);
@@ -65,10 +78,48 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
                                int (*networkIsReachable)(void *info),
                                void (*threadCleanup)(void *info));
 
+// not thread-safe, set the callback once before calling PeerManagerConnect()
+// void saveSnapshot(void *, const uint8_t *, size_t) - called with a new BRPeerManagerSnapshot() once sync completes,
+// every few minutes after that, and on BRPeerManagerDisconnect(), the app should store it in place of the last one
+void BRPeerManagerSetSnapshotCallback(BRPeerManager *manager,
+                                      void (*saveSnapshot)(void *info, const uint8_t *snapshot, size_t snapshotLen));
+
+// writes the state needed to resume syncing where this session left off to buf: the main chain blocks not yet passed to
+// saveBlocks(), the bloom filter, the best peers with their ping times, known tx hashes and pending tx publishes
+// returns number of bytes written, or total bufLen needed if buf is NULL
+size_t BRPeerManagerSnapshot(BRPeerManager *manager, uint8_t *buf, size_t bufLen);
+
+// resumes from a snapshot taken by a previous session, call after BRPeerManagerNew() and before PeerManagerConnect()
+// parts that no longer match the chain or the wallet are skipped and rebuilt as usual
+// returns true if the snapshot was used, false if it was corrupt or made for another chain or snapshot version
+int BRPeerManagerRestoreSnapshot(BRPeerManager *manager, const uint8_t *snapshot, size_t snapshotLen);
+
 // specifies a single fixed peer to use when connecting to the bitcoin network
 // set address to UINT128_ZERO to revert to default behavior
 void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t port);
 
+// adds a wallet to be synced alongside the manager's own wallet, sharing its header chain, peer connections and bloom
+// filter, so many wallets cost one set of peers instead of one each
+// matched tx are registered with each wallet they belong to, and reported through that wallet's own callbacks
+// tx from before the current chain tip are only found by a following BRPeerManagerRescan()
+// the wallet must not be freed until BRPeerManagerRemoveWallet() or BRPeerManagerFree() is called
+// all wallets share one BIP37 filter of at most BLOOM_MAX_FILTER_LENGTH bytes, so at the sync policy's fpRate this
+// returns false, without adding the wallet, if their addresses, utxos and spare filterLookahead addresses would no
+// longer fit, about ten wallets under BR_SYNC_POLICY_METERED, more wallets need a BRPeerManager of their own
+int BRPeerManagerAddWallet(BRPeerManager *manager, BRWallet *wallet, uint32_t earliestKeyTime);
+
+// stops syncing a wallet added with BRPeerManagerAddWallet(), the filter keeps matching it until next rebuilt
+void BRPeerManagerRemoveWallet(BRPeerManager *manager, BRWallet *wallet);
+
+// sets the policy used from the next bloom filter load on, the default is BR_SYNC_POLICY_DEFAULT
+void BRPeerManagerSetSyncPolicy(BRPeerManager *manager, BRSyncPolicy policy);
+
+// the policy currently in use
+BRSyncPolicy BRPeerManagerSyncPolicy(BRPeerManager *manager);
+
+// the fee rate sent to peers in feefilter messages, mempool tx paying less aren't relayed to us
+uint64_t BRPeerManagerFeeFilter(BRPeerManager *manager);
+
 // current connect status
 BRPeerStatus BRPeerManagerConnectStatus(BRPeerManager *manager);
 
@@ -111,6 +162,13 @@ size_t BRPeerManagerPeerCount(BRPeerManager *manager);
 // description of the peer most recently used to sync blockchain data
 const char *BRPeerManagerDownloadPeerName(BRPeerManager *manager);
 
+// bytes sent to and received from all peers since the manager was created or the byte count was last reset,
+// including peers that have since disconnected
+void BRPeerManagerByteCount(BRPeerManager *manager, uint64_t *sent, uint64_t *received);
+
+// starts a new byte accounting session, the policy byteBudget is measured from here
+void BRPeerManagerResetByteCount(BRPeerManager *manager);
+
 // publishes tx to RAVENCOIN network (do not call TransactionFree() on tx afterward)
 void BRPeerManagerPublishTx(BRPeerManager *manager, BRTransaction *tx, void *info,
                             void (*callback)(void *info, int error));
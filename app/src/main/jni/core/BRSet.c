@@ -44,9 +44,11 @@ struct SetStruct {
     size_t itemCount; // number of items in set
     size_t (*hash)(const void *); // hash function
     int (*eq)(const void *, const void *); // equality function
+    const BRAllocator *allocator; // allocator for the set and its table
 };
 
-static void _SetInit(BRSet *set, size_t (*hash)(const void *), int (*eq)(const void *, const void *), size_t capacity)
+static void _SetInit(BRSet *set, size_t (*hash)(const void *), int (*eq)(const void *, const void *), size_t capacity,
+                     const BRAllocator *allocator)
 {
     assert(set != NULL);
     assert(hash != NULL);
@@ -58,7 +60,7 @@ static void _SetInit(BRSet *set, size_t (*hash)(const void *), int (*eq)(const v
     while (i < TABLE_SIZES_LEN && tableSizes[i] < capacity) i++;
 
     if (i + 1 < TABLE_SIZES_LEN) { // use next larger table size to keep load factor below 2/3 at capacity
-        set->table = calloc(tableSizes[i + 1], sizeof(void *));
+        set->table = BRAllocatorCalloc(allocator, tableSizes[i + 1]*sizeof(void *));
         assert(set->table != NULL);
         set->size = tableSizes[i + 1];
     }
@@ -66,6 +68,7 @@ static void _SetInit(BRSet *set, size_t (*hash)(const void *), int (*eq)(const v
     set->itemCount = 0;
     set->hash = hash;
     set->eq = eq;
+    set->allocator = allocator;
 }
 
 // retruns a newly allocated empty set that must be freed by calling SetFree()
@@ -75,10 +78,17 @@ static void _SetInit(BRSet *set, size_t (*hash)(const void *), int (*eq)(const v
 // capacity is the maximum estimated number of items the set will need to hold
 BRSet *BRSetNew(size_t (*hash)(const void *), int (*eq)(const void *, const void *), size_t capacity)
 {
-    BRSet *set = calloc(1, sizeof(*set));
+    return BRSetNewWithAllocator(hash, eq, capacity, NULL);
+}
+
+// like SetNew(), but the set and its hashtable are allocated from allocator
+BRSet *BRSetNewWithAllocator(size_t (*hash)(const void *), int (*eq)(const void *, const void *), size_t capacity,
+                             const BRAllocator *allocator)
+{
+    BRSet *set = BRAllocatorCalloc(allocator, sizeof(*set));
     
     assert(set != NULL);
-    _SetInit(set, hash, eq, capacity);
+    _SetInit(set, hash, eq, capacity, allocator);
     return set;
 }
 
@@ -87,9 +97,9 @@ static void _SetGrow(BRSet *set, size_t capacity)
 {
     BRSet newSet;
 
-    _SetInit(&newSet, set->hash, set->eq, capacity);
+    _SetInit(&newSet, set->hash, set->eq, capacity, set->allocator);
     BRSetUnion(&newSet, set);
-    free(set->table);
+    BRAllocatorFree(set->allocator, set->table, set->size*sizeof(void *));
     set->table = newSet.table;
     set->size = newSet.size;
     set->itemCount = newSet.itemCount;
@@ -319,6 +329,6 @@ void BRSetFree(BRSet *set)
 {
     assert(set != NULL);
 
-    free(set->table);
-    free(set);
+    BRAllocatorFree(set->allocator, set->table, set->size*sizeof(void *));
+    BRAllocatorFree(set->allocator, set, sizeof(*set));
 }
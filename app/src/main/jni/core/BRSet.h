@@ -25,6 +25,7 @@
 #ifndef Set_h
 #define Set_h
 
+#include "BRAllocator.h"
 #include <stddef.h>
 #include <inttypes.h>
 
@@ -41,6 +42,10 @@ typedef struct SetStruct BRSet;
 // capacity is the initial number of items the set can hold, which will be auto-increased as needed
 BRSet *BRSetNew(size_t (*hash)(const void *), int (*eq)(const void *, const void *), size_t capacity);
 
+// like SetNew(), but the set and its hashtable are allocated from allocator
+BRSet *BRSetNewWithAllocator(size_t (*hash)(const void *), int (*eq)(const void *, const void *), size_t capacity,
+                             const BRAllocator *allocator);
+
 // adds given item to set or replaces an equivalent existing item and returns item replaced if any
 void *BRSetAdd(BRSet *set, void *item);
 
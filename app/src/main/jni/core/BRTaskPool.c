@@ -0,0 +1,486 @@
+//
+//  BRTaskPool.c
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "BRTaskPool.h"
+#include "BRArray.h"
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define TASK_POOL_MAX_WORKERS 64
+#define TASK_DEQUE_MIN_SIZE   64
+#define TASK_SCRATCH_SIZE     (64*1024)
+
+typedef struct {
+    BRTaskGroup *group;
+    void *info;
+    void (*run)(void *info);
+} BRTask;
+
+typedef struct {
+    BRTask *tasks; // ring buffer of size tasks, count of them starting at head, oldest first
+    size_t size, head, count;
+    pthread_mutex_t lock;
+} BRTaskDeque;
+
+typedef struct {
+    BRTaskPool *pool;
+    BRTaskDeque deque; // tasks spawned by this worker, it takes the newest and other threads steal the oldest
+    pthread_t thread;
+} BRTaskWorker;
+
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+} BRTaskScratchBlock;
+
+typedef struct {
+    BRTaskScratchBlock *blocks;
+    size_t block, offset, depth;
+} BRTaskScratchArena;
+
+struct BRTaskPoolStruct {
+    BRTaskWorker *workers;
+    size_t workerCount, threadCount;
+    BRTaskDeque injected; // tasks spawned by threads that aren't workers of this pool
+    size_t queued, sleeping, isolated, nextVictim; // atomic
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t cond, groupDone; // groupDone only wakes TaskGroupWaitIsolated(), so it can't take a spawn's signal
+};
+
+struct BRTaskGroupStruct {
+    BRTaskPool *pool;
+    size_t pending, skipped; // atomic
+    int cancelled; // atomic
+};
+
+static pthread_key_t _workerKey, _scratchKey;
+static pthread_once_t _keysOnce = PTHREAD_ONCE_INIT, _sharedOnce = PTHREAD_ONCE_INIT;
+static BRTaskPool *_sharedPool = NULL;
+
+static void _BRTaskScratchFree(void *arg) {
+    BRTaskScratchArena *arena = arg;
+
+    for (size_t i = array_count(arena->blocks); i > 0; i--) free(arena->blocks[i - 1].buf);
+    array_free(arena->blocks);
+    free(arena);
+}
+
+static void _BRTaskKeysInit(void) {
+    pthread_key_create(&_workerKey, NULL);
+    pthread_key_create(&_scratchKey, _BRTaskScratchFree);
+}
+
+static BRTaskScratchArena *_BRTaskScratchArena(void) {
+    BRTaskScratchArena *arena = pthread_getspecific(_scratchKey);
+
+    if (! arena) {
+        arena = calloc(1, sizeof(*arena));
+        assert(arena != NULL);
+        array_new(arena->blocks, 1);
+        pthread_setspecific(_scratchKey, arena);
+    }
+
+    return arena;
+}
+
+static void _BRTaskDequeInit(BRTaskDeque *deque) {
+    deque->tasks = NULL;
+    deque->size = deque->head = deque->count = 0;
+    pthread_mutex_init(&deque->lock, NULL);
+}
+
+static void _BRTaskDequeFree(BRTaskDeque *deque) {
+    pthread_mutex_destroy(&deque->lock);
+    if (deque->tasks) free(deque->tasks);
+}
+
+static void _BRTaskDequePush(BRTaskDeque *deque, BRTask task) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->count == deque->size) { // unwrap into a buffer twice the size
+        size_t size = (deque->size > 0) ? deque->size*2 : TASK_DEQUE_MIN_SIZE;
+        BRTask *tasks = malloc(size*sizeof(*tasks));
+
+        assert(tasks != NULL);
+        for (size_t i = 0; i < deque->count; i++) tasks[i] = deque->tasks[(deque->head + i) % deque->size];
+        if (deque->tasks) free(deque->tasks);
+        deque->tasks = tasks;
+        deque->size = size;
+        deque->head = 0;
+    }
+
+    deque->tasks[(deque->head + deque->count) % deque->size] = task;
+    __atomic_store_n(&deque->count, deque->count + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// takes the newest task if newest is true, otherwise the oldest, returns false if deque was empty
+static int _BRTaskDequeTake(BRTaskDeque *deque, BRTask *task, int newest) {
+    int r = 0;
+
+    if (__atomic_load_n(&deque->count, __ATOMIC_RELAXED) == 0) return 0; // skip the lock for an empty deque
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->count > 0) {
+        if (newest) {
+            *task = deque->tasks[(deque->head + deque->count - 1) % deque->size];
+        }
+        else {
+            *task = deque->tasks[deque->head];
+            deque->head = (deque->head + 1) % deque->size;
+        }
+
+        __atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+        r = 1;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return r;
+}
+
+// takes the newest task of group, returns false if deque has none
+static int _BRTaskDequeTakeGroup(BRTaskDeque *deque, BRTask *task, BRTaskGroup *group) {
+    size_t i, j;
+    int r = 0;
+
+    if (__atomic_load_n(&deque->count, __ATOMIC_RELAXED) == 0) return 0;
+    pthread_mutex_lock(&deque->lock);
+
+    for (i = deque->count; i > 0 && deque->tasks[(deque->head + i - 1) % deque->size].group != group; i--);
+
+    if (i > 0) {
+        *task = deque->tasks[(deque->head + i - 1) % deque->size];
+
+        for (j = i; j < deque->count; j++) { // close the gap
+            deque->tasks[(deque->head + j - 1) % deque->size] = deque->tasks[(deque->head + j) % deque->size];
+        }
+
+        __atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+        r = 1;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return r;
+}
+
+// returns the calling thread's worker if it is a worker thread of pool
+static BRTaskWorker *_BRTaskPoolCurrentWorker(BRTaskPool *pool) {
+    BRTaskWorker *worker = pthread_getspecific(_workerKey);
+
+    return (worker && worker->pool == pool) ? worker : NULL;
+}
+
+// takes the newest task of self, or else the oldest injected task, or else steals the oldest task of another worker
+static int _BRTaskPoolTake(BRTaskPool *pool, BRTaskWorker *self, BRTask *task) {
+    size_t i, start;
+    int r = 0;
+
+    if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0) return 0;
+    if (self) r = _BRTaskDequeTake(&self->deque, task, 1);
+    if (! r) r = _BRTaskDequeTake(&pool->injected, task, 0);
+    start = __atomic_fetch_add(&pool->nextVictim, 1, __ATOMIC_RELAXED);
+
+    for (i = 0; ! r && i < pool->workerCount; i++) {
+        BRTaskWorker *victim = &pool->workers[(start + i) % pool->workerCount];
+
+        if (victim != self) r = _BRTaskDequeTake(&victim->deque, task, 0);
+    }
+
+    if (r) __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    return r;
+}
+
+static void _BRTaskRun(BRTask *task) {
+    BRTaskGroup *group = task->group;
+    BRTaskPool *pool = group->pool;
+    BRTaskScratchArena *arena = _BRTaskScratchArena();
+    size_t block = arena->block, offset = arena->offset;
+
+    if (__atomic_load_n(&group->cancelled, __ATOMIC_ACQUIRE)) {
+        __atomic_add_fetch(&group->skipped, 1, __ATOMIC_RELAXED);
+    }
+    else {
+        arena->depth++;
+        task->run(task->info);
+        arena->depth--;
+        arena->block = block; // release the task's scratch memory
+        arena->offset = offset;
+    }
+
+    // group may be freed as soon as pending reaches zero
+    if (__atomic_sub_fetch(&group->pending, 1, __ATOMIC_SEQ_CST) == 0 &&
+        (__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST) > 0 ||
+         __atomic_load_n(&pool->isolated, __ATOMIC_SEQ_CST) > 0)) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->cond);
+        pthread_cond_broadcast(&pool->groupDone);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *_BRTaskWorkerRoutine(void *arg) {
+    BRTaskWorker *self = arg;
+    BRTaskPool *pool = self->pool;
+    BRTask task;
+    int stop = 0;
+
+    pthread_setspecific(_workerKey, self);
+
+    while (! stop) {
+        if (_BRTaskPoolTake(pool, self, &task)) {
+            _BRTaskRun(&task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+
+        while (! pool->stopping && __atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+
+        __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+        stop = (pool->stopping && __atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+// returns a newly allocated task pool with workerCount threads, or one per online CPU if workerCount is 0, that must
+// be freed by calling TaskPoolFree()
+BRTaskPool *BRTaskPoolNew(size_t workerCount) {
+    BRTaskPool *pool = calloc(1, sizeof(*pool));
+    long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+    assert(pool != NULL);
+    pthread_once(&_keysOnce, _BRTaskKeysInit);
+    if (workerCount == 0) workerCount = (cpuCount > 0) ? (size_t) cpuCount : 1;
+    if (workerCount > TASK_POOL_MAX_WORKERS) workerCount = TASK_POOL_MAX_WORKERS;
+    pool->workers = calloc(workerCount, sizeof(*pool->workers));
+    assert(pool->workers != NULL);
+    pool->workerCount = workerCount;
+    _BRTaskDequeInit(&pool->injected);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pthread_cond_init(&pool->groupDone, NULL);
+
+    for (size_t i = 0; i < workerCount; i++) {
+        pool->workers[i].pool = pool;
+        _BRTaskDequeInit(&pool->workers[i].deque);
+    }
+
+    // workers that fail to start leave an empty deque behind, and waiting threads run the tasks themselves
+    while (pool->threadCount < workerCount &&
+           pthread_create(&pool->workers[pool->threadCount].thread, NULL, _BRTaskWorkerRoutine,
+                          &pool->workers[pool->threadCount]) == 0) pool->threadCount++;
+
+    return pool;
+}
+
+static void _BRTaskPoolSharedInit(void) {
+    _sharedPool = BRTaskPoolNew(0);
+}
+
+// returns the pool shared by the core library, created on first use with one worker per online CPU and never freed
+BRTaskPool *BRTaskPoolShared(void) {
+    pthread_once(&_sharedOnce, _BRTaskPoolSharedInit);
+    return _sharedPool;
+}
+
+// number of worker threads in pool
+size_t BRTaskPoolWorkerCount(BRTaskPool *pool) {
+    assert(pool != NULL);
+    return pool->threadCount;
+}
+
+// waits for worker threads to finish and frees memory allocated for pool, all of its groups must have been freed
+void BRTaskPoolFree(BRTaskPool *pool) {
+    assert(pool != NULL);
+    assert(pool != _sharedPool);
+    assert(__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0);
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < pool->threadCount; i++) pthread_join(pool->workers[i].thread, NULL);
+    for (size_t i = 0; i < pool->workerCount; i++) _BRTaskDequeFree(&pool->workers[i].deque);
+    _BRTaskDequeFree(&pool->injected);
+    pthread_cond_destroy(&pool->cond);
+    pthread_cond_destroy(&pool->groupDone);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+// returns a newly allocated task group that must be freed by calling TaskGroupFree()
+BRTaskGroup *BRTaskGroupNew(BRTaskPool *pool) {
+    BRTaskGroup *group = calloc(1, sizeof(*group));
+
+    assert(pool != NULL);
+    assert(group != NULL);
+    group->pool = pool;
+    return group;
+}
+
+// queues run(info) in group, it may be called on any worker thread, or on a thread waiting on any group of the pool
+void BRTaskGroupSpawn(BRTaskGroup *group, void *info, void (*run)(void *info)) {
+    BRTaskPool *pool;
+    BRTaskWorker *self;
+    BRTask task = { group, info, run };
+
+    assert(group != NULL);
+    assert(run != NULL);
+    pool = group->pool;
+    self = _BRTaskPoolCurrentWorker(pool);
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST); // counted before it's pushed so queued never underflows
+    _BRTaskDequePush((self) ? &self->deque : &pool->injected, task);
+
+    if (__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// tasks in group that haven't started are skipped, running tasks may check TaskGroupIsCancelled() to stop early
+void BRTaskGroupCancel(BRTaskGroup *group) {
+    assert(group != NULL);
+    __atomic_store_n(&group->cancelled, 1, __ATOMIC_RELEASE);
+}
+
+// true if TaskGroupCancel() was called on group
+int BRTaskGroupIsCancelled(BRTaskGroup *group) {
+    assert(group != NULL);
+    return __atomic_load_n(&group->cancelled, __ATOMIC_ACQUIRE);
+}
+
+// waits for every task spawned in group to finish, running queued tasks of the pool on the calling thread meanwhile
+// returns true if every task ran, or false if some were skipped because group was cancelled
+int BRTaskGroupWait(BRTaskGroup *group) {
+    BRTaskPool *pool;
+    BRTaskWorker *self;
+    BRTask task;
+
+    assert(group != NULL);
+    pool = group->pool;
+    self = _BRTaskPoolCurrentWorker(pool);
+
+    while (__atomic_load_n(&group->pending, __ATOMIC_SEQ_CST) > 0) {
+        if (_BRTaskPoolTake(pool, self, &task)) {
+            _BRTaskRun(&task);
+            continue;
+        }
+
+        // the rest of group is running on other threads, sleep until it finishes or there's more to help with
+        pthread_mutex_lock(&pool->lock);
+        __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+
+        while (__atomic_load_n(&group->pending, __ATOMIC_SEQ_CST) > 0 &&
+               __atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+
+        __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return (__atomic_load_n(&group->skipped, __ATOMIC_RELAXED) == 0);
+}
+
+// like TaskGroupWait(), but only runs tasks of group on the calling thread, which may hold locks that other tasks need
+// returns true if every task ran, or false if some were skipped because group was cancelled
+int BRTaskGroupWaitIsolated(BRTaskGroup *group) {
+    BRTaskPool *pool;
+    BRTaskWorker *self;
+    BRTaskDeque *deque;
+    BRTask task;
+
+    assert(group != NULL);
+    pool = group->pool;
+    self = _BRTaskPoolCurrentWorker(pool);
+    deque = (self) ? &self->deque : &pool->injected; // where TaskGroupSpawn() put the tasks of group
+
+    while (_BRTaskDequeTakeGroup(deque, &task, group)) {
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+        _BRTaskRun(&task);
+    }
+
+    // the rest of group was taken by other threads, sleep until it finishes
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->isolated, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&group->pending, __ATOMIC_SEQ_CST) > 0) {
+        pthread_cond_wait(&pool->groupDone, &pool->lock);
+    }
+
+    __atomic_sub_fetch(&pool->isolated, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pool->lock);
+    return (__atomic_load_n(&group->skipped, __ATOMIC_RELAXED) == 0);
+}
+
+// waits for group and frees memory allocated for it
+void BRTaskGroupFree(BRTaskGroup *group) {
+    assert(group != NULL);
+    BRTaskGroupWait(group);
+    free(group);
+}
+
+// returns size bytes of 16 byte aligned scratch memory private to the thread running the current task, valid until
+// the task returns, must only be called from a task
+void *BRTaskScratch(size_t size) {
+    BRTaskScratchArena *arena;
+    BRTaskScratchBlock block;
+    void *buf = NULL;
+
+    pthread_once(&_keysOnce, _BRTaskKeysInit);
+    arena = pthread_getspecific(_scratchKey);
+    assert(arena != NULL && arena->depth > 0);
+    size = (size + 15) & ~(size_t) 15;
+
+    while (arena->block < array_count(arena->blocks)) {
+        if (arena->offset + size <= arena->blocks[arena->block].size) {
+            buf = &arena->blocks[arena->block].buf[arena->offset];
+            arena->offset += size;
+            return buf;
+        }
+
+        arena->block++;
+        arena->offset = 0;
+    }
+
+    block.size = (size > TASK_SCRATCH_SIZE) ? size : TASK_SCRATCH_SIZE;
+    if (posix_memalign(&buf, 16, block.size) != 0) buf = NULL;
+    assert(buf != NULL);
+    block.buf = buf;
+    array_add(arena->blocks, block);
+    arena->block = array_count(arena->blocks) - 1;
+    arena->offset = size;
+    return buf;
+}
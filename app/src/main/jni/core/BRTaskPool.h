@@ -0,0 +1,89 @@
+//
+//  BRTaskPool.h
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef BRTaskPool_h
+#define BRTaskPool_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a fixed set of worker threads with a work-stealing deque each, for splitting CPU bound work like key derivation,
+// signing and proof of work verification into short tasks
+// a worker runs the tasks it spawned newest first and steals the oldest tasks of other workers when it runs out
+typedef struct BRTaskPoolStruct BRTaskPool;
+
+// tasks are spawned into a group, and a group is waited on or cancelled as a whole
+typedef struct BRTaskGroupStruct BRTaskGroup;
+
+// returns a newly allocated task pool with workerCount threads, or one per online CPU if workerCount is 0, that must
+// be freed by calling TaskPoolFree()
+BRTaskPool *BRTaskPoolNew(size_t workerCount);
+
+// returns the pool shared by the core library, created on first use with one worker per online CPU and never freed
+BRTaskPool *BRTaskPoolShared(void);
+
+// number of worker threads in pool
+size_t BRTaskPoolWorkerCount(BRTaskPool *pool);
+
+// waits for worker threads to finish and frees memory allocated for pool, all of its groups must have been freed
+void BRTaskPoolFree(BRTaskPool *pool);
+
+// returns a newly allocated task group that must be freed by calling TaskGroupFree()
+BRTaskGroup *BRTaskGroupNew(BRTaskPool *pool);
+
+// queues run(info) in group, it may be called on any worker thread, or on a thread waiting on any group of the pool
+// a task may spawn more tasks and wait on other groups, but must not block on anything else for long, and since a
+// waiting thread runs other queued tasks, a task must not lock anything that a spawning or waiting thread may hold
+void BRTaskGroupSpawn(BRTaskGroup *group, void *info, void (*run)(void *info));
+
+// tasks in group that haven't started are skipped, running tasks may check TaskGroupIsCancelled() to stop early
+void BRTaskGroupCancel(BRTaskGroup *group);
+
+// true if TaskGroupCancel() was called on group
+int BRTaskGroupIsCancelled(BRTaskGroup *group);
+
+// waits for every task spawned in group to finish, running queued tasks of the pool on the calling thread meanwhile
+// returns true if every task ran, or false if some were skipped because group was cancelled
+int BRTaskGroupWait(BRTaskGroup *group);
+
+// like TaskGroupWait(), but only runs tasks of group on the calling thread, for a thread that holds a lock other queued
+// tasks may need, tasks spawned into group by other threads are left to the workers
+// returns true if every task ran, or false if some were skipped because group was cancelled
+int BRTaskGroupWaitIsolated(BRTaskGroup *group);
+
+// waits for group and frees memory allocated for it
+void BRTaskGroupFree(BRTaskGroup *group);
+
+// returns size bytes of 16 byte aligned scratch memory private to the thread running the current task, valid until
+// the task returns, must only be called from a task
+void *BRTaskScratch(size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRTaskPool_h
@@ -42,6 +42,8 @@
 #define SIGHASH_ANYONECANPAY    0x80 // let other people add inputs, I don't care where the rest of the bitcoins come from
 #define SIGHASH_FORKID          0x40 // use BIP143 digest method (for b-cash signatures)
 
+#define TX_ALLOCATOR BRAllocatorForSubsystem(BR_ALLOC_TX)
+
 // returns a random number less than upperBound, for non-cryptographic use only
 uint32_t BRRand(uint32_t upperBound) {
     static int first = 1;
@@ -71,7 +73,7 @@ void BRTxInputSetAddress(BRTxInput *input, const char *address) {
     if (address) {
         strncpy(input->address, address, sizeof(input->address) - 1);
         input->scriptLen = BRAddressScriptPubKey(NULL, 0, address);
-        array_new(input->script, input->scriptLen);
+        array_new_with_allocator(input->script, input->scriptLen, TX_ALLOCATOR);
         array_set_count(input->script, input->scriptLen);
         BRAddressScriptPubKey(input->script, input->scriptLen, address);
     }
@@ -87,7 +89,7 @@ void BRTxInputSetScript(BRTxInput *input, const uint8_t *script, size_t scriptLe
     
     if (script) {
         input->scriptLen = scriptLen;
-        array_new(input->script, scriptLen);
+        array_new_with_allocator(input->script, scriptLen, TX_ALLOCATOR);
         array_add_array(input->script, script, scriptLen);
         BRAddressFromScriptPubKey(input->address, sizeof(input->address), script, scriptLen);
     }
@@ -102,7 +104,7 @@ void BRTxInputSetSignature(BRTxInput *input, const uint8_t *signature, size_t si
     
     if (signature) {
         input->sigLen = sigLen;
-        array_new(input->signature, sigLen);
+        array_new_with_allocator(input->signature, sigLen, TX_ALLOCATOR);
         array_add_array(input->signature, signature, sigLen);
         if (!input->address[0]) BRAddressFromScriptSig(input->address, sizeof(input->address), signature, sigLen);
     }
@@ -141,7 +143,7 @@ void BRTxOutputSetAddress(BRTxOutput *output, const char *address) {
     if (address) {
         strncpy(output->address, address, sizeof(output->address) - 1);
         output->scriptLen = BRAddressScriptPubKey(NULL, 0, address);
-        array_new(output->script, output->scriptLen);
+        array_new_with_allocator(output->script, output->scriptLen, TX_ALLOCATOR);
         array_set_count(output->script, output->scriptLen);
         BRAddressScriptPubKey(output->script, output->scriptLen, address);
     }
@@ -156,7 +158,7 @@ void BRTxOutputSetScript(BRTxOutput *output, const uint8_t *script, size_t scrip
     
     if (script) {
         output->scriptLen = scriptLen;
-        array_new(output->script, scriptLen);
+        array_new_with_allocator(output->script, scriptLen, TX_ALLOCATOR);
         array_add_array(output->script, script, scriptLen);
         BRAddressFromScriptPubKey(output->address, sizeof(output->address), script, scriptLen);
     }
@@ -308,17 +310,90 @@ static size_t _TransactionData(const BRTransaction *tx, uint8_t *data, size_t da
     return (!data || off <= dataLen) ? off : 0;
 }
 
-// returns a newly allocated empty transaction that must be freed by calling TransactionFree()
+// writes the SIGHASH_ALL signature pre-image shared by every input of tx, with all input scripts left empty
+// the pre-image for input i is this template with the input's scriptPubKey spliced in at scriptOffs[i], where an
+// empty script's single zero length byte sits, so a multi-input tx serializes its outputs once rather than per input
+// returns number of bytes written, or total dataLen needed if data is NULL
+static size_t _TransactionSigHashTemplate(const BRTransaction *tx, uint8_t *data, size_t dataLen, size_t *scriptOffs) {
+    BRTxInput input;
+    size_t i, off = 0;
+    
+    if (data && off + sizeof(uint32_t) <= dataLen) UInt32SetLE(&data[off], tx->version); // tx version
+    off += sizeof(uint32_t);
+    off += BRVarIntSet((data ? &data[off] : NULL), (off <= dataLen ? dataLen - off : 0), tx->inCount);
+    
+    for (i = 0; i < tx->inCount; i++) { // inputs
+        input = tx->inputs[i];
+        input.signature = NULL;
+        input.sigLen = 0;
+        input.amount = 0;
+        if (scriptOffs) scriptOffs[i] = off + sizeof(UInt256) + sizeof(uint32_t);
+        off += _TxInputData(&input, (data ? &data[off] : NULL), (off <= dataLen ? dataLen - off : 0));
+    }
+    
+    off += BRVarIntSet((data ? &data[off] : NULL), (off <= dataLen ? dataLen - off : 0), tx->outCount);
+    off += _TransactionOutputData(tx, (data ? &data[off] : NULL), (off <= dataLen ? dataLen - off : 0), SIZE_MAX);
+    if (data && off + sizeof(uint32_t) <= dataLen) UInt32SetLE(&data[off], tx->lockTime); // locktime
+    off += sizeof(uint32_t);
+    if (data && off + sizeof(uint32_t) <= dataLen) UInt32SetLE(&data[off], SIGHASH_ALL); // hash type
+    off += sizeof(uint32_t);
+    return (!data || off <= dataLen) ? off : 0;
+}
+
+// writes the SIGHASH_ALL pre-image for input at index from a template made by _TransactionSigHashTemplate()
+// data must have room for templateLen + 8 + the input's scriptLen, returns number of bytes written
+static size_t _TransactionSigHashData(const BRTransaction *tx, const uint8_t *template, size_t templateLen,
+                                      size_t scriptOff, size_t index, uint8_t *data) {
+    const BRTxInput *input = &tx->inputs[index];
+    size_t off = scriptOff;
+    
+    memcpy(data, template, scriptOff);
+    off += BRVarIntSet(&data[off], BRVarIntSize(input->scriptLen), input->scriptLen);
+    memcpy(&data[off], input->script, input->scriptLen);
+    off += input->scriptLen;
+    memcpy(&data[off], &template[scriptOff + 1], templateLen - (scriptOff + 1));
+    return off + templateLen - (scriptOff + 1);
+}
+
+// contribution of input to BRTransactionSize(), exact if signed, or TX_INPUT_SIZE estimate if not
+inline static size_t _TxInputSize(const BRTxInput *input) {
+    if (! input->signature) return TX_INPUT_SIZE;
+    return sizeof(UInt256) + sizeof(uint32_t) + BRVarIntSize(input->sigLen) + input->sigLen + sizeof(uint32_t);
+}
+
+inline static size_t _TxOutputSize(const BRTxOutput *output) {
+    return sizeof(uint64_t) + BRVarIntSize(output->scriptLen) + output->scriptLen;
+}
+
+// walks all inputs and outputs, use BRTransactionSize() to get the cached value
+static size_t _TransactionSize(const BRTransaction *tx) {
+    size_t i, size = 8 + BRVarIntSize(tx->inCount) + BRVarIntSize(tx->outCount);
+    
+    for (i = 0; i < tx->inCount; i++) size += _TxInputSize(&tx->inputs[i]);
+    for (i = 0; i < tx->outCount; i++) size += _TxOutputSize(&tx->outputs[i]);
+    return size;
+}
+
+// drops cached serialized bytes, must be called by anything that changes the inputs or outputs of tx
+static void _TransactionClearSerialized(BRTransaction *tx) {
+    if (tx->serialized) BRAllocatorFree(TX_ALLOCATOR, tx->serialized, tx->serializedLen);
+    tx->serialized = NULL;
+    tx->serializedLen = 0;
+}
+
+// returns a newly allocated empty transaction that must be freed by calling TransactionFree(), or txCount of them in
+// one block that must be freed by calling TransactionFreeArray()
 BRTransaction *BRTransactionNew(size_t txCount) {
-    BRTransaction *tx = calloc(txCount, sizeof(*tx));
+    BRTransaction *tx = BRAllocatorCalloc(TX_ALLOCATOR, txCount*sizeof(*tx));
     
     assert(tx != NULL);
     for(int i = 0; i < txCount; i++) {
         tx[i].version = TX_VERSION;
-        array_new(tx[i].inputs, 1);
-        array_new(tx[i].outputs, 2);
+        array_new_with_allocator(tx[i].inputs, 1, TX_ALLOCATOR);
+        array_new_with_allocator(tx[i].outputs, 2, TX_ALLOCATOR);
         tx[i].lockTime = TX_LOCKTIME;
         tx[i].blockHeight = TX_UNCONFIRMED;
+        tx[i].size = _TransactionSize(&tx[i]);
     }
     
     return tx;
@@ -335,6 +410,9 @@ BRTransaction *BRTransactionCopy(const BRTransaction *tx) {
     cpy->inputs = inputs;
     cpy->outputs = outputs;
     cpy->inCount = cpy->outCount = 0;
+    cpy->size = _TransactionSize(cpy);
+    cpy->serialized = NULL;
+    cpy->serializedLen = 0;
     
     /* RVN Start */
     cpy->asset = tx->asset;
@@ -432,15 +510,52 @@ BRTransaction *BRTransactionParse(const uint8_t *buf, size_t bufLen) {
     if (tx->inCount == 0 || off > bufLen) {
         BRTransactionFree(tx);
         tx = NULL;
-    } else if (isSigned) SHA256_2(&tx->txHash, buf, off);
+    } else {
+        tx->size = _TransactionSize(tx);
+        if (isSigned) SHA256_2(&tx->txHash, buf, off);
+    }
     
     return tx;
 }
 
+// returns the exact length of BRTransactionSerialize() output without serializing
+// unsigned inputs are written with their scriptPubKey and amount in place of a signature, matching _TransactionData()
+size_t BRTransactionSerializedSize(const BRTransaction *tx) {
+    const BRTxInput *input;
+    size_t i, sigLen, size;
+    
+    assert(tx != NULL);
+    if (! tx) return 0;
+    size = sizeof(uint32_t) + BRVarIntSize(tx->inCount) + BRVarIntSize(tx->outCount) + sizeof(uint32_t);
+    
+    for (i = 0; i < tx->inCount; i++) {
+        input = &tx->inputs[i];
+        sigLen = (input->signature) ? input->sigLen : input->scriptLen;
+        size += sizeof(UInt256) + sizeof(uint32_t) + BRVarIntSize(sigLen) + sigLen + sizeof(uint32_t);
+        if (! input->signature && input->amount != 0) size += sizeof(uint64_t);
+    }
+    
+    for (i = 0; i < tx->outCount; i++) {
+        size += sizeof(uint64_t) + BRVarIntSize(tx->outputs[i].scriptLen) + tx->outputs[i].scriptLen;
+    }
+    
+    return size;
+}
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL
 // (tx->blockHeight and tx->timestamp are not serialized)
 size_t BRTransactionSerialize(const BRTransaction *tx, uint8_t *buf, size_t bufLen) {
     assert(tx != NULL);
+    if (tx && ! buf) return (tx->serialized) ? tx->serializedLen : BRTransactionSerializedSize(tx);
+    
+    // version and lockTime can be assigned directly, so check them before trusting bytes cached by TransactionSign()
+    if (tx && tx->serialized && UInt32GetLE(tx->serialized) == tx->version &&
+        UInt32GetLE(&tx->serialized[tx->serializedLen - sizeof(uint32_t)]) == tx->lockTime) {
+        if (tx->serializedLen > bufLen) return 0;
+        memcpy(buf, tx->serialized, tx->serializedLen);
+        return tx->serializedLen;
+    }
+    
     return (tx) ? _TransactionData(tx, buf, bufLen, SIZE_MAX, SIGHASH_ALL) : 0;
 }
 
@@ -460,6 +575,8 @@ void BRTransactionAddInput(BRTransaction *tx, UInt256 txHash, uint32_t index, ui
         if (signature) BRTxInputSetSignature(&input, signature, sigLen);
         array_add(tx->inputs, input);
         tx->inCount = array_count(tx->inputs);
+        if (tx->size) tx->size += _TxInputSize(&input) + BRVarIntSize(tx->inCount) - BRVarIntSize(tx->inCount - 1);
+        _TransactionClearSerialized(tx);
     }
 }
 
@@ -474,12 +591,15 @@ void BRTransactionAddOutput(BRTransaction *tx, uint64_t amount, const uint8_t *s
         BRTxOutputSetScript(&output, script, scriptLen);
         array_add(tx->outputs, output);
         tx->outCount = array_count(tx->outputs);
+        if (tx->size) tx->size += _TxOutputSize(&output) + BRVarIntSize(tx->outCount) - BRVarIntSize(tx->outCount - 1);
+        _TransactionClearSerialized(tx);
     }
 }
 
 // shuffles order of tx outputs
 void BRTransactionShuffleOutputs(BRTransaction *tx) {
     assert(tx != NULL);
+    if (tx) _TransactionClearSerialized(tx);
     
     for (uint32_t i = 0; tx && i + 1 < tx->outCount; i++) { // fischer-yates shuffle
         uint32_t j = i + BRRand((uint32_t) tx->outCount - i);
@@ -494,26 +614,11 @@ void BRTransactionShuffleOutputs(BRTransaction *tx) {
 }
 
 // size in bytes if signed, or estimated size assuming compact pubkey sigs
+// kept up to date by the tx mutators, so this doesn't walk the inputs and outputs
 size_t BRTransactionSize(const BRTransaction *tx) {
-    BRTxInput *input;
-    size_t size;
-    
     assert(tx != NULL);
-    size = (tx) ? 8 + BRVarIntSize(tx->inCount) + BRVarIntSize(tx->outCount) : 0;
-    
-    for (size_t i = 0; tx && i < tx->inCount; i++) {
-        input = &tx->inputs[i];
-        
-        if (input->signature) {
-            size += sizeof(UInt256) + sizeof(uint32_t) + BRVarIntSize(input->sigLen) + input->sigLen + sizeof(uint32_t);
-        } else size += TX_INPUT_SIZE;
-    }
-    
-    for (size_t i = 0; tx && i < tx->outCount; i++) {
-        size += sizeof(uint64_t) + BRVarIntSize(tx->outputs[i].scriptLen) + tx->outputs[i].scriptLen;
-    }
-    
-    return size;
+    if (! tx) return 0;
+    return (tx->size) ? tx->size : _TransactionSize(tx);
 }
 
 // minimum transaction fee needed for tx to relay across the bitcoin network
@@ -538,10 +643,12 @@ int BRTransactionIsSigned(const BRTransaction *tx) {
 // returns true if tx is signed
 int BRTransactionSign(BRTransaction *tx, BRKey *keys, size_t keysCount) {
     BRAddress addrs[keysCount], address;
-    size_t i, j;
+    uint8_t *template = NULL, *data = NULL;
+    size_t i, j, templateLen = 0, dataLen, scriptOffs[(tx) ? tx->inCount : 0], maxScriptLen = 0;
     
     assert(tx != NULL);
     assert(keys != NULL || keysCount == 0);
+    if (tx) _TransactionClearSerialized(tx);
     
     for (i = 0; tx && i < keysCount; i++) {
         if (!BRKeyAddress(&keys[i], addrs[i].s, sizeof(addrs[i]))) addrs[i] = ADDRESS_NONE;
@@ -563,36 +670,43 @@ int BRTransactionSign(BRTransaction *tx, BRKey *keys, size_t keysCount) {
         size_t sigLen, scriptLen;
         UInt256 md = UINT256_ZERO;
         
+        if (! template) { // the pre-image template is built once, the first time an input needs signing
+            for (size_t k = 0; k < tx->inCount; k++) {
+                if (tx->inputs[k].scriptLen > maxScriptLen) maxScriptLen = tx->inputs[k].scriptLen;
+            }
+            
+            templateLen = _TransactionSigHashTemplate(tx, NULL, 0, NULL);
+            template = malloc(templateLen);
+            data = malloc(templateLen + sizeof(uint64_t) + maxScriptLen);
+            assert(template != NULL && data != NULL);
+            templateLen = _TransactionSigHashTemplate(tx, template, templateLen, scriptOffs);
+        }
+        
+        dataLen = _TransactionSigHashData(tx, template, templateLen, scriptOffs[i], i, data);
+        SHA256_2(&md, data, dataLen);
+        sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
+        sig[sigLen++] = 0 | SIGHASH_ALL;
+        scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
+        
 #warning TODO: OP_EQUALVERIFY condition doesn't trigger for assets input
         if (elemsCount >= 2 && (*elems[elemsCount - 2] == OP_EQUALVERIFY || *elems[elemsCount - 5] == OP_EQUALVERIFY)) { // pay-to-pubkey-hash
             //        if (elemsCount >= 2 /*&& *elems[elemsCount - 2] == OP_EQUALVERIFY*/) { // pay-to-pubkey-hash
-            uint8_t data[_TransactionData(tx, NULL, 0, i, 0 | SIGHASH_ALL)];
-            size_t dataLen = _TransactionData(tx, data, sizeof(data), i, 0 | SIGHASH_ALL);
-            
-            SHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = 0 | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
             scriptLen += BRScriptPushData(&script[scriptLen], sizeof(script) - scriptLen, pubKey, pkLen);
-            BRTxInputSetSignature(input, script, scriptLen);
-            
-        } else { // pay-to-pubkey
-            uint8_t data[_TransactionData(tx, NULL, 0, i, 0 | SIGHASH_ALL)];
-            size_t dataLen = _TransactionData(tx, data, sizeof(data), i, 0 | SIGHASH_ALL);
-            
-            SHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = 0 | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
-            BRTxInputSetSignature(input, script, scriptLen);
-        }
+        } // else pay-to-pubkey
+        
+        BRTxInputSetSignature(input, script, scriptLen);
     }
     
-    if (tx && BRTransactionIsSigned(tx)) {
-        uint8_t data[_TransactionData(tx, NULL, 0, SIZE_MAX, 0)];
-        size_t len = _TransactionData(tx, data, sizeof(data), SIZE_MAX, 0);
-        
-        SHA256_2(&tx->txHash, data, len);
+    if (template) free(template);
+    if (data) free(data);
+    if (tx) tx->size = _TransactionSize(tx); // signatures replace the TX_INPUT_SIZE estimates
+    
+    if (tx && BRTransactionIsSigned(tx)) { // keep the signed bytes, they're about to be published and stored
+        tx->serializedLen = _TransactionData(tx, NULL, 0, SIZE_MAX, 0);
+        tx->serialized = BRAllocatorCalloc(TX_ALLOCATOR, tx->serializedLen);
+        assert(tx->serialized != NULL);
+        _TransactionData(tx, tx->serialized, tx->serializedLen, SIZE_MAX, 0);
+        SHA256_2(&tx->txHash, tx->serialized, tx->serializedLen);
         return 1;
     } else
         return 0;
@@ -607,23 +721,37 @@ int BRTransactionIsStandard(const BRTransaction *tx) {
     return r;
 }
 
+static void _TransactionFreeContents(BRTransaction *tx) {
+    for (size_t i = 0; i < tx->inCount; i++) {
+        BRTxInputSetScript(&tx->inputs[i], NULL, 0);
+        BRTxInputSetSignature(&tx->inputs[i], NULL, 0);
+    }
+    
+    for (size_t i = 0; i < tx->outCount; i++) {
+        BRTxOutputSetScript(&tx->outputs[i], NULL, 0);
+    }
+    
+    array_free(tx->outputs);
+    array_free(tx->inputs);
+    _TransactionClearSerialized(tx);
+}
+
 // frees memory allocated for tx
 void BRTransactionFree(BRTransaction *tx) {
     assert(tx != NULL);
     
     if (tx) {
-        for (size_t i = 0; i < tx->inCount; i++) {
-            BRTxInputSetScript(&tx->inputs[i], NULL, 0);
-            BRTxInputSetSignature(&tx->inputs[i], NULL, 0);
-        }
-        
-        for (size_t i = 0; i < tx->outCount; i++) {
-            BRTxOutputSetScript(&tx->outputs[i], NULL, 0);
-        }
-        
-        array_free(tx->outputs);
-        array_free(tx->inputs);
-        
-        free(tx);
+        _TransactionFreeContents(tx);
+        BRAllocatorFree(TX_ALLOCATOR, tx, sizeof(*tx));
+    }
+}
+
+// frees memory allocated for the txCount transactions returned together by TransactionNew(txCount)
+void BRTransactionFreeArray(BRTransaction *txs, size_t txCount) {
+    assert(txs != NULL || txCount == 0);
+    
+    if (txs) {
+        for (size_t i = 0; i < txCount; i++) _TransactionFreeContents(&txs[i]);
+        BRAllocatorFree(TX_ALLOCATOR, txs, txCount*sizeof(*txs));
     }
 }
@@ -131,9 +131,13 @@ extern "C" {
         uint32_t blockHeight;
         uint32_t timestamp; // time interval since unix epoch
         BRAsset *asset;
+        size_t size; // cached BRTransactionSize(), updated by AddInput()/AddOutput()/Sign()
+        uint8_t *serialized; // signed tx bytes cached by Sign(), dropped when inputs or outputs change
+        size_t serializedLen;
     } BRTransaction;
     
-    // returns a newly allocated empty transaction that must be freed by calling TransactionFree()
+    // returns a newly allocated empty transaction that must be freed by calling TransactionFree(), or txCount of them
+    // in one block that must be freed by calling TransactionFreeArray()
     BRTransaction *BRTransactionNew(size_t txCount);
     
     // returns a deep copy of tx and that must be freed by calling TransactionFree()
@@ -143,6 +147,9 @@ extern "C" {
     // retuns a transaction that must be freed by calling TransactionFree()
     BRTransaction *BRTransactionParse(const uint8_t *buf, size_t bufLen);
     
+    // returns the exact length of BRTransactionSerialize() output without serializing
+    size_t BRTransactionSerializedSize(const BRTransaction *tx);
+    
     // returns number of bytes written to buf, or total bufLen needed if buf is NULL
     // (tx->blockHeight and tx->timestamp are not serialized)
     size_t BRTransactionSerialize(const BRTransaction *tx, uint8_t *buf, size_t bufLen);
@@ -190,6 +197,9 @@ extern "C" {
     // frees memory allocated for tx
     void BRTransactionFree(BRTransaction *tx);
     
+    // frees memory allocated for the txCount transactions returned together by TransactionNew(txCount)
+    void BRTransactionFreeArray(BRTransaction *txs, size_t txCount);
+    
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,584 @@
+//
+//  BRTxStore.c
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "BRTxStore.h"
+#include "BRCrypto.h"
+#include "BRWriter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TXSTORE_INDEX_MAGIC    0x32584449 // "IDX2"
+#define TXSTORE_MIN_CAPACITY   1024
+#define TXSTORE_INDEX_SYNC     (256*1024) // log bytes indexed between index syncs
+#define TXSTORE_COMPACT_MIN    (64*1024) // superseded log bytes worth compacting on open
+#define TXSTORE_MAX_DATA       (32*1000*1000) // larger than any tx, bounds what a corrupt record can claim
+#define TXSTORE_UPDATE         0 // dataLen of a record that only sets a tx's block height and timestamp
+#define TXSTORE_REMOVE         UINT32_MAX // dataLen of a record that removes a tx
+#define TXSTORE_REMOVED        UINT64_MAX // index offset of a removed tx
+#define TXSTORE_HEADER_SIZE    (3*sizeof(uint32_t) + sizeof(UInt256)) // dataLen, blockHeight, timestamp, txHash
+#define TXSTORE_CHECKSUM_SIZE  sizeof(uint32_t) // first bytes of the SHA256 of the header and data
+
+typedef struct {
+    UInt256 txHash; // UINT256_ZERO for an empty slot
+    uint64_t offset; // log offset of the latest full record of the tx, or TXSTORE_REMOVED
+    uint64_t size; // bytes of that record
+    uint32_t blockHeight;
+    uint32_t timestamp;
+} BRTxStoreEntry;
+
+// the index file is this header followed by capacity entries, an open addressed hash table in native byte order
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t capacity; // a power of 2
+    uint64_t count; // used slots, including removed tx
+    uint64_t logLen; // log bytes reflected in the entries on disk, 0 while they're changed so a crash forces a rebuild
+    uint64_t liveBytes; // bytes of the log records the index points to
+    UInt256 logId; // SHA256 of the first log record, so an index left next to a different log is rebuilt
+} BRTxStoreIndex;
+
+struct BRTxStoreStruct {
+    char *logPath;
+    int logFd, idxFd;
+    uint64_t logLen;
+    uint64_t idxLogLen; // log bytes reflected in the mapped index
+    uint64_t syncLen; // idxLogLen as of the last index sync
+    UInt256 logId;
+    BRTxStoreIndex *idx;
+    size_t idxLen;
+    BRWriter writer; // reused to build the records of one append
+    pthread_mutex_t lock;
+};
+
+// log records are the header, then dataLen bytes of serialized tx (none for an update or removal), then the checksum
+inline static uint32_t _BRTxStoreDataLen(uint32_t dataLen) {
+    return (dataLen == TXSTORE_UPDATE || dataLen == TXSTORE_REMOVE) ? 0 : dataLen;
+}
+
+inline static BRTxStoreEntry *_BRTxStoreEntries(BRTxStoreIndex *idx) {
+    return (BRTxStoreEntry *) (idx + 1);
+}
+
+// returns the index slot for txHash, which is empty if the tx was never stored
+static BRTxStoreEntry *_BRTxStoreSlot(BRTxStoreIndex *idx, UInt256 txHash) {
+    BRTxStoreEntry *entries = _BRTxStoreEntries(idx);
+    uint64_t mask = idx->capacity - 1, i = txHash.u64[0] & mask; // txHash is already uniformly distributed
+
+    while (!UInt256IsZero(entries[i].txHash) && !UInt256Eq(entries[i].txHash, txHash)) i = (i + 1) & mask;
+    return &entries[i];
+}
+
+// maps the index file, sized for capacity slots, returns 0 on success or an errno value
+static int _BRTxStoreMapIndex(BRTxStore *store, uint64_t capacity) {
+    size_t len = sizeof(BRTxStoreIndex) + capacity*sizeof(BRTxStoreEntry);
+    void *idx;
+
+    if (store->idx) munmap(store->idx, store->idxLen);
+    store->idx = NULL;
+    if (ftruncate(store->idxFd, len) != 0) return errno;
+    idx = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, store->idxFd, 0);
+    if (idx == MAP_FAILED) return errno;
+    store->idx = idx;
+    store->idxLen = len;
+    return 0;
+}
+
+// marks the index on disk as not reflecting the log before its entries change, returns 0 on success or an errno value
+// the entries are written back by the kernel in no particular order, so only _BRTxStoreSyncIndex() vouches for them
+static int _BRTxStoreDirtyIndex(BRTxStore *store) {
+    if (store->idx->logLen == 0) return 0;
+    store->idx->logLen = 0;
+    return (msync(store->idx, sizeof(*store->idx), MS_SYNC) == 0) ? 0 : errno;
+}
+
+// writes the index entries to disk, then the header saying which log they reflect, returns 0 on success or an errno
+// value
+static int _BRTxStoreSyncIndex(BRTxStore *store) {
+    if (store->idx->logLen != 0 || store->idxLogLen == 0) return 0; // already synced, or nothing to vouch for
+    if (msync(store->idx, store->idxLen, MS_SYNC) != 0) return errno;
+    store->idx->logId = store->logId;
+    store->idx->logLen = store->idxLogLen;
+    if (msync(store->idx, sizeof(*store->idx), MS_SYNC) != 0) return errno;
+    store->syncLen = store->idxLogLen;
+    return 0;
+}
+
+// empties the index, sized for capacity slots, returns 0 on success or an errno value
+static int _BRTxStoreResetIndex(BRTxStore *store, uint64_t capacity) {
+    int r = _BRTxStoreMapIndex(store, capacity);
+
+    if (r == 0) { // the header may still vouch for an older index, so it's cleared on disk before the entries
+        store->idx->logLen = 0;
+        if (msync(store->idx, sizeof(*store->idx), MS_SYNC) != 0) r = errno;
+    }
+
+    if (r == 0) {
+        memset(store->idx, 0, store->idxLen);
+        store->idx->magic = TXSTORE_INDEX_MAGIC;
+        store->idx->capacity = capacity;
+    }
+
+    return r;
+}
+
+// sets store->logId from the first log record, or to UINT256_ZERO if there is no complete one
+static void _BRTxStoreUpdateLogId(BRTxStore *store) {
+    uint8_t header[TXSTORE_HEADER_SIZE], *buf;
+    uint32_t len = 0;
+
+    store->logId = UINT256_ZERO;
+    if (pread(store->logFd, header, sizeof(header), 0) == sizeof(header)) len = _BRTxStoreDataLen(UInt32GetLE(header));
+    if (len > TXSTORE_MAX_DATA || TXSTORE_HEADER_SIZE + len + TXSTORE_CHECKSUM_SIZE > store->logLen) return;
+    len += TXSTORE_HEADER_SIZE + TXSTORE_CHECKSUM_SIZE;
+    buf = malloc(len);
+    assert(buf != NULL);
+    if (pread(store->logFd, buf, len, 0) == (ssize_t) len) SHA256(&store->logId, buf, len);
+    free(buf);
+}
+
+// doubles the index capacity and rehashes the used slots, returns 0 on success or an errno value
+static int _BRTxStoreGrowIndex(BRTxStore *store) {
+    BRTxStoreIndex header = *store->idx;
+    BRTxStoreEntry *entries = malloc(header.capacity*sizeof(*entries));
+    int r;
+
+    if (!entries) return ENOMEM;
+    memcpy(entries, _BRTxStoreEntries(store->idx), header.capacity*sizeof(*entries));
+    r = _BRTxStoreResetIndex(store, header.capacity*2);
+
+    if (r == 0) {
+        for (uint64_t i = 0; i < header.capacity; i++) {
+            if (!UInt256IsZero(entries[i].txHash)) *_BRTxStoreSlot(store->idx, entries[i].txHash) = entries[i];
+        }
+
+        store->idx->count = header.count;
+        store->idx->liveBytes = header.liveBytes;
+    }
+
+    free(entries);
+    return r;
+}
+
+// applies the log record at offset off to the index, returns 0 on success or an errno value
+static int _BRTxStoreIndexRecord(BRTxStore *store, uint64_t off, uint32_t dataLen, UInt256 txHash,
+                                 uint32_t blockHeight, uint32_t timestamp) {
+    BRTxStoreEntry *e;
+    int r = _BRTxStoreDirtyIndex(store);
+
+    if (r == 0 && store->idx->count + 1 > store->idx->capacity/2) r = _BRTxStoreGrowIndex(store); // keep probes short
+    if (r != 0) return r;
+    e = _BRTxStoreSlot(store->idx, txHash);
+
+    if (UInt256IsZero(e->txHash)) {
+        if (dataLen == TXSTORE_UPDATE || dataLen == TXSTORE_REMOVE) return 0; // nothing stored to update or remove
+        e->txHash = txHash;
+        e->offset = TXSTORE_REMOVED;
+        store->idx->count++;
+    }
+
+    if (dataLen == TXSTORE_UPDATE) {
+        if (e->offset == TXSTORE_REMOVED) return 0;
+    } else {
+        if (e->offset != TXSTORE_REMOVED) store->idx->liveBytes -= e->size;
+        e->offset = TXSTORE_REMOVED;
+        e->size = 0;
+        if (dataLen == TXSTORE_REMOVE) return 0;
+        e->offset = off;
+        e->size = TXSTORE_HEADER_SIZE + dataLen + TXSTORE_CHECKSUM_SIZE;
+        store->idx->liveBytes += e->size;
+    }
+
+    e->blockHeight = blockHeight;
+    e->timestamp = timestamp;
+    return 0;
+}
+
+// indexes the log from where the index left off, dropping a torn or corrupt record from the end of the log along
+// with anything after it, returns 0 on success or an errno value
+static int _BRTxStoreReplay(BRTxStore *store) {
+    uint64_t off = store->idxLogLen;
+    const uint8_t *log;
+    int r = 0;
+
+    if (off >= store->logLen) return 0;
+    log = mmap(NULL, store->logLen, PROT_READ, MAP_PRIVATE, store->logFd, 0);
+    if (log == MAP_FAILED) return errno;
+    madvise((void *) log, store->logLen, MADV_SEQUENTIAL);
+
+    while (r == 0 && off + TXSTORE_HEADER_SIZE + TXSTORE_CHECKSUM_SIZE <= store->logLen) {
+        uint32_t dataLen = UInt32GetLE(&log[off]), len = _BRTxStoreDataLen(dataLen);
+        UInt256 md;
+
+        if (len > TXSTORE_MAX_DATA || off + TXSTORE_HEADER_SIZE + len + TXSTORE_CHECKSUM_SIZE > store->logLen) break;
+        SHA256(&md, &log[off], TXSTORE_HEADER_SIZE + len);
+        if (UInt32GetLE(&log[off + TXSTORE_HEADER_SIZE + len]) != UInt32GetLE(md.u8)) break;
+        r = _BRTxStoreIndexRecord(store, off, dataLen, UInt256Get(&log[off + 3*sizeof(uint32_t)]),
+                                  UInt32GetLE(&log[off + sizeof(uint32_t)]),
+                                  UInt32GetLE(&log[off + 2*sizeof(uint32_t)]));
+        if (r == 0) off += TXSTORE_HEADER_SIZE + len + TXSTORE_CHECKSUM_SIZE;
+    }
+
+    munmap((void *) log, store->logLen);
+
+    if (r == 0 && off < store->logLen) {
+        if (ftruncate(store->logFd, off) == 0) store->logLen = off;
+        else r = errno;
+    }
+
+    if (r == 0) store->idxLogLen = off;
+    return r;
+}
+
+// writes the records built in store->writer to the end of the log with a single fsync, and indexes them, syncing the
+// index once TXSTORE_INDEX_SYNC log bytes were indexed since it was last synced, returns 0 on success or an errno value
+static int _BRTxStoreAppend(BRTxStore *store) {
+    BRWriter *w = &store->writer;
+    size_t off = 0, len;
+    ssize_t n;
+    int r = 0;
+
+    if (!store->idx) return EIO;
+
+    // a record left partly written by an earlier failure must go before anything is appended after it
+    if (lseek(store->logFd, 0, SEEK_END) != (off_t) store->logLen && ftruncate(store->logFd, store->logLen) != 0)
+        return errno;
+
+    while (r == 0 && off < w->len) {
+        n = write(store->logFd, &w->data[off], w->len - off);
+        if (n > 0) off += n;
+        else if (n == 0) r = EIO;
+        else if (errno != EINTR) r = errno;
+    }
+
+    if (r == 0 && fsync(store->logFd) != 0) r = errno;
+
+    if (r != 0) { // leave no partial record behind
+        ftruncate(store->logFd, store->logLen);
+        return r;
+    }
+
+    // the records are durable now, so the log keeps them even if indexing fails, and the next open replays them
+    for (off = 0; r == 0 && off < w->len; off += len) {
+        uint32_t dataLen = UInt32GetLE(&w->data[off]);
+
+        len = TXSTORE_HEADER_SIZE + _BRTxStoreDataLen(dataLen) + TXSTORE_CHECKSUM_SIZE;
+        r = _BRTxStoreIndexRecord(store, store->logLen + off, dataLen, UInt256Get(&w->data[off + 3*sizeof(uint32_t)]),
+                                  UInt32GetLE(&w->data[off + sizeof(uint32_t)]),
+                                  UInt32GetLE(&w->data[off + 2*sizeof(uint32_t)]));
+        if (r == 0) store->idxLogLen = store->logLen + off + len;
+    }
+
+    if (store->logLen == 0) store->logLen += w->len, _BRTxStoreUpdateLogId(store);
+    else store->logLen += w->len;
+    if (r == 0 && store->idxLogLen - store->syncLen >= TXSTORE_INDEX_SYNC) r = _BRTxStoreSyncIndex(store);
+    return r;
+}
+
+// starts building a record after any others in store->writer, returns the writer offset it starts at
+static size_t _BRTxStoreBeginRecord(BRTxStore *store, uint32_t dataLen, UInt256 txHash, uint32_t blockHeight,
+                                    uint32_t timestamp) {
+    size_t start = store->writer.len;
+
+    BRWriterUInt32LE(&store->writer, dataLen);
+    BRWriterUInt32LE(&store->writer, blockHeight);
+    BRWriterUInt32LE(&store->writer, timestamp);
+    BRWriterUInt256(&store->writer, txHash);
+    return start;
+}
+
+// finishes the record started at writer offset start with its checksum
+static void _BRTxStoreEndRecord(BRTxStore *store, size_t start) {
+    UInt256 md;
+
+    SHA256(&md, &store->writer.data[start], store->writer.len - start);
+    BRWriterUInt32LE(&store->writer, UInt32GetLE(md.u8));
+}
+
+// rewrites the log with only the latest record of each stored tx, then reindexes it
+static int _BRTxStoreCompact(BRTxStore *store) {
+    char tmpPath[strlen(store->logPath) + sizeof(".tmp")];
+    const uint8_t *log = NULL;
+    uint64_t off, len = 0;
+    int fd, r = 0;
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", store->logPath);
+    fd = open(tmpPath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return errno;
+
+    if (store->logLen > 0) {
+        log = mmap(NULL, store->logLen, PROT_READ, MAP_PRIVATE, store->logFd, 0);
+        if (log == MAP_FAILED) r = errno, log = NULL;
+        else madvise((void *) log, store->logLen, MADV_SEQUENTIAL);
+    }
+
+    for (off = 0; r == 0 && log && off < store->idxLogLen; off += len) {
+        uint32_t dataLen = UInt32GetLE(&log[off]);
+        BRTxStoreEntry *e = _BRTxStoreSlot(store->idx, UInt256Get(&log[off + 3*sizeof(uint32_t)]));
+        UInt256 md;
+
+        len = TXSTORE_HEADER_SIZE + _BRTxStoreDataLen(dataLen) + TXSTORE_CHECKSUM_SIZE;
+        if (_BRTxStoreDataLen(dataLen) == 0 || UInt256IsZero(e->txHash) || e->offset != off) continue; // superseded
+
+        // the record takes the latest block height and timestamp from any update records that followed it
+        BRWriterReset(&store->writer);
+        BRWriterAppend(&store->writer, &log[off], len - TXSTORE_CHECKSUM_SIZE);
+        UInt32SetLE(&store->writer.data[sizeof(uint32_t)], e->blockHeight);
+        UInt32SetLE(&store->writer.data[2*sizeof(uint32_t)], e->timestamp);
+        SHA256(&md, store->writer.data, store->writer.len);
+        BRWriterUInt32LE(&store->writer, UInt32GetLE(md.u8));
+        if (write(fd, store->writer.data, store->writer.len) != (ssize_t) store->writer.len) r = (errno) ? errno : EIO;
+    }
+
+    if (log) munmap((void *) log, store->logLen);
+    if (r == 0 && fsync(fd) != 0) r = errno;
+    if (r == 0 && rename(tmpPath, store->logPath) != 0) r = errno;
+
+    if (r != 0) {
+        close(fd);
+        unlink(tmpPath);
+        return r;
+    }
+
+    close(store->logFd);
+    store->logFd = fd;
+    fcntl(fd, F_SETFL, O_APPEND);
+    store->logLen = lseek(fd, 0, SEEK_END);
+    store->idxLogLen = 0;
+    _BRTxStoreUpdateLogId(store);
+    r = _BRTxStoreResetIndex(store, store->idx->capacity);
+    if (r == 0) r = _BRTxStoreReplay(store);
+    return (r == 0) ? _BRTxStoreSyncIndex(store) : r;
+}
+
+// opens the store at path, creating it if needed, and compacts it if most of the log is superseded records
+// returns NULL and sets errno on failure, the store must be closed by calling TxStoreClose()
+BRTxStore *BRTxStoreOpen(const char *path) {
+    BRTxStore *store = calloc(1, sizeof(*store));
+    char idxPath[strlen(path) + sizeof(".idx")];
+    BRTxStoreIndex header;
+    struct stat st;
+    int r = 0;
+
+    assert(path != NULL);
+    assert(store != NULL);
+    store->logPath = strdup(path);
+    assert(store->logPath != NULL);
+    snprintf(idxPath, sizeof(idxPath), "%s.idx", path);
+    BRWriterInit(&store->writer, 1024);
+    pthread_mutex_init(&store->lock, NULL);
+    store->logFd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+    store->idxFd = (store->logFd >= 0) ? open(idxPath, O_RDWR | O_CREAT, 0600) : -1;
+    if (store->logFd < 0 || store->idxFd < 0 || fstat(store->logFd, &st) != 0) r = errno;
+    if (r == 0) store->logLen = st.st_size, _BRTxStoreUpdateLogId(store);
+
+    // the index is only trusted if it was synced after its last change, and for this same log
+    if (r == 0 && fstat(store->idxFd, &st) == 0 &&
+        pread(store->idxFd, &header, sizeof(header), 0) == sizeof(header) &&
+        header.magic == TXSTORE_INDEX_MAGIC && header.capacity >= TXSTORE_MIN_CAPACITY &&
+        (header.capacity & (header.capacity - 1)) == 0 && header.count < header.capacity &&
+        st.st_size == sizeof(header) + header.capacity*sizeof(BRTxStoreEntry) && header.logLen > 0 &&
+        header.logLen <= store->logLen && UInt256Eq(header.logId, store->logId)) {
+        r = _BRTxStoreMapIndex(store, header.capacity);
+        if (r == 0) store->idxLogLen = store->syncLen = header.logLen;
+    } else if (r == 0) r = _BRTxStoreResetIndex(store, TXSTORE_MIN_CAPACITY);
+
+    if (r == 0) r = _BRTxStoreReplay(store);
+    if (r == 0 && store->logLen == 0) store->logId = UINT256_ZERO; // a torn first record was dropped
+    if (r == 0) r = _BRTxStoreSyncIndex(store);
+
+    if (r == 0 && store->logLen - store->idx->liveBytes >= TXSTORE_COMPACT_MIN &&
+        store->logLen - store->idx->liveBytes > store->idx->liveBytes) {
+        _BRTxStoreCompact(store); // the store stays usable if compacting fails, it's only larger
+        if (!store->idx) r = EIO;
+    }
+
+    if (r != 0) {
+        BRTxStoreClose(store);
+        store = NULL;
+        errno = r;
+    }
+
+    return store;
+}
+
+// appends tx with its current block height and timestamp, returns 0 on success or an errno value
+int BRTxStoreAdd(BRTxStore *store, const BRTransaction *tx) {
+    size_t start, len;
+    int r = EINVAL;
+
+    assert(store != NULL);
+    assert(tx != NULL);
+    pthread_mutex_lock(&store->lock);
+    BRWriterReset(&store->writer);
+    start = _BRTxStoreBeginRecord(store, TXSTORE_UPDATE, tx->txHash, tx->blockHeight, tx->timestamp);
+    len = BRWriterTransaction(&store->writer, tx);
+
+    if (len > 0 && len <= TXSTORE_MAX_DATA) {
+        UInt32SetLE(&store->writer.data[start], (uint32_t) len); // dataLen, now that it's known
+        _BRTxStoreEndRecord(store, start);
+        r = _BRTxStoreAppend(store);
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return r;
+}
+
+// appends new block heights and timestamps for the given transactions with a single fsync, returns 0 on success or an
+// errno value
+int BRTxStoreUpdate(BRTxStore *store, const UInt256 txHashes[], size_t txCount, uint32_t blockHeight,
+                    uint32_t timestamp) {
+    int r = 0;
+
+    assert(store != NULL);
+    assert(txHashes != NULL || txCount == 0);
+    pthread_mutex_lock(&store->lock);
+    BRWriterReset(&store->writer);
+
+    for (size_t i = 0; i < txCount; i++) {
+        _BRTxStoreEndRecord(store, _BRTxStoreBeginRecord(store, TXSTORE_UPDATE, txHashes[i], blockHeight, timestamp));
+    }
+
+    if (txCount > 0) r = _BRTxStoreAppend(store);
+    pthread_mutex_unlock(&store->lock);
+    return r;
+}
+
+// appends the removal of a tx, returns 0 on success or an errno value
+int BRTxStoreRemove(BRTxStore *store, UInt256 txHash) {
+    int r;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    BRWriterReset(&store->writer);
+    _BRTxStoreEndRecord(store, _BRTxStoreBeginRecord(store, TXSTORE_REMOVE, txHash, 0, 0));
+    r = _BRTxStoreAppend(store);
+    pthread_mutex_unlock(&store->lock);
+    return r;
+}
+
+// returns a newly parsed copy of the stored tx with the given hash, or NULL if there is none
+// result must be freed by calling TransactionFree()
+BRTransaction *BRTxStoreGet(BRTxStore *store, UInt256 txHash) {
+    BRTransaction *tx = NULL;
+    BRTxStoreEntry *e;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    e = (store->idx) ? _BRTxStoreSlot(store->idx, txHash) : NULL;
+
+    if (e && !UInt256IsZero(e->txHash) && e->offset != TXSTORE_REMOVED) {
+        size_t len = e->size - TXSTORE_HEADER_SIZE - TXSTORE_CHECKSUM_SIZE;
+        uint8_t *buf = malloc(len);
+
+        assert(buf != NULL);
+
+        if (pread(store->logFd, buf, len, e->offset + TXSTORE_HEADER_SIZE) == (ssize_t) len) {
+            tx = BRTransactionParse(buf, len);
+            if (tx) tx->blockHeight = e->blockHeight, tx->timestamp = e->timestamp;
+        }
+
+        free(buf);
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return tx;
+}
+
+// parses the stored transactions, in the order they were last added, to txs and returns the number written, or the
+// number stored if txs is NULL, each tx written must be freed by calling TransactionFree()
+size_t BRTxStoreLoad(BRTxStore *store, BRTransaction *txs[], size_t txCount) {
+    const uint8_t *log = NULL;
+    BRTxStoreEntry *entries;
+    size_t count = 0;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+
+    if (store->idx && !txs) {
+        entries = _BRTxStoreEntries(store->idx);
+
+        for (uint64_t i = 0; i < store->idx->capacity; i++) {
+            if (!UInt256IsZero(entries[i].txHash) && entries[i].offset != TXSTORE_REMOVED) count++;
+        }
+    } else if (store->idx && store->logLen > 0) {
+        // txs are parsed straight from the mapped log, one sequential pass with no intermediate copies
+        log = mmap(NULL, store->logLen, PROT_READ, MAP_PRIVATE, store->logFd, 0);
+        if (log == MAP_FAILED) log = NULL;
+        if (log) madvise((void *) log, store->logLen, MADV_SEQUENTIAL);
+
+        for (uint64_t off = 0, len = 0; log && off < store->idxLogLen && count < txCount; off += len) {
+            uint32_t dataLen = _BRTxStoreDataLen(UInt32GetLE(&log[off]));
+            BRTxStoreEntry *e;
+            BRTransaction *tx;
+
+            len = TXSTORE_HEADER_SIZE + dataLen + TXSTORE_CHECKSUM_SIZE;
+            if (dataLen == 0) continue;
+            e = _BRTxStoreSlot(store->idx, UInt256Get(&log[off + 3*sizeof(uint32_t)]));
+            if (UInt256IsZero(e->txHash) || e->offset != off) continue; // superseded or removed
+            tx = BRTransactionParse(&log[off + TXSTORE_HEADER_SIZE], dataLen);
+            if (!tx) continue;
+            tx->blockHeight = e->blockHeight;
+            tx->timestamp = e->timestamp;
+            txs[count++] = tx;
+        }
+
+        if (log) munmap((void *) log, store->logLen);
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return count;
+}
+
+// rewrites the log with only the latest record of each stored tx, returns 0 on success or an errno value
+int BRTxStoreCompact(BRTxStore *store) {
+    int r;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    r = (store->idx) ? _BRTxStoreCompact(store) : EIO;
+    pthread_mutex_unlock(&store->lock);
+    return r;
+}
+
+// syncs the index, closes the store files and frees memory allocated for store
+void BRTxStoreClose(BRTxStore *store) {
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    if (store->idx) _BRTxStoreSyncIndex(store); // a failed sync only means the next open replays the log
+    if (store->idx) munmap(store->idx, store->idxLen);
+    if (store->idxFd >= 0) close(store->idxFd);
+    if (store->logFd >= 0) close(store->logFd);
+    BRWriterFree(&store->writer);
+    free(store->logPath);
+    pthread_mutex_unlock(&store->lock);
+    pthread_mutex_destroy(&store->lock);
+    free(store);
+}
@@ -0,0 +1,76 @@
+//
+//  BRTxStore.h
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef BRTxStore_h
+#define BRTxStore_h
+
+#include "BRInt.h"
+#include "BRTransaction.h"
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// an append-only log of serialized transactions with their block heights and timestamps, and a memory mapped txid
+// index of the log, kept next to it in a file with the same path plus ".idx"
+// later records of a tx supersede earlier ones, the index is only a cache of the log and is rebuilt from it whenever
+// it's missing, behind, built from a different log, or wasn't synced to disk since it last changed, and a record torn
+// by a crash is dropped from the end of the log when the store is opened
+typedef struct BRTxStoreStruct BRTxStore;
+
+// opens the store at path, creating it if needed, and compacts it if most of the log is superseded records
+// returns NULL and sets errno on failure, the store must be closed by calling TxStoreClose()
+BRTxStore *BRTxStoreOpen(const char *path);
+
+// appends tx with its current block height and timestamp, returns 0 on success or an errno value
+int BRTxStoreAdd(BRTxStore *store, const BRTransaction *tx);
+
+// appends new block heights and timestamps for the given transactions with a single fsync, returns 0 on success or an
+// errno value
+int BRTxStoreUpdate(BRTxStore *store, const UInt256 txHashes[], size_t txCount, uint32_t blockHeight,
+                    uint32_t timestamp);
+
+// appends the removal of a tx, returns 0 on success or an errno value
+int BRTxStoreRemove(BRTxStore *store, UInt256 txHash);
+
+// returns a newly parsed copy of the stored tx with the given hash, or NULL if there is none
+// result must be freed by calling TransactionFree()
+BRTransaction *BRTxStoreGet(BRTxStore *store, UInt256 txHash);
+
+// parses the stored transactions, in the order they were last added, to txs and returns the number written, or the
+// number stored if txs is NULL, each tx written must be freed by calling TransactionFree()
+size_t BRTxStoreLoad(BRTxStore *store, BRTransaction *txs[], size_t txCount);
+
+// rewrites the log with only the latest record of each stored tx, returns 0 on success or an errno value
+int BRTxStoreCompact(BRTxStore *store);
+
+// syncs the index, closes the store files and frees memory allocated for store
+void BRTxStoreClose(BRTxStore *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRTxStore_h
@@ -25,6 +25,7 @@
 #include "BRWallet.h"
 #include "BRAddress.h"
 #include "BRArray.h"
+#include "BRAllocator.h"
 #include <stdlib.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -32,6 +33,36 @@
 #include <assert.h>
 #include "BRAssets.h"
 #include "BRScript.h"
+#include "BRTaskPool.h"
+
+#define WALLET_ALLOCATOR BRAllocatorForSubsystem(BR_ALLOC_WALLET)
+
+#define WALLET_PARALLEL_KEYS 8 // fewest missing chain keys that BRWalletUnusedAddrs() derives on the shared task pool
+#define ADDR_CACHE_VERSION 1
+#define ADDR_CACHE_HEADER_SIZE (3*sizeof(uint32_t)) // version, external chain count, internal chain count
+#define ADDR_CACHE_ENTRY_SIZE (sizeof(UInt160) + 33) // hash160, compressed pubkey
+
+typedef struct {
+    UInt160 hash160;
+    uint8_t pubKey[33];
+} BRChainKey;
+
+typedef struct _BRTxSpend {
+    UTXO outpoint; // first, so that an entry hashes and compares like the UTXO or TxInput it's looked up with
+    BRTransaction *tx;
+    struct _BRTxSpend *next; // other wallet tx spending the same outpoint, i.e. double spends
+} BRTxSpend;
+
+typedef struct {
+    BRTransaction *tx;
+    size_t size;
+    time_t time; // when the tx was added to the pool
+} BRPoolTx;
+
+typedef struct {
+    char key[64]; // address or asset name, first, so that an entry hashes and compares like the string it's looked up with
+    BRTransaction **txs; // wallet tx with the key, in history order
+} BRTxIndex;
 
 struct BRWalletStructure {
     uint64_t balance, totalSent, totalReceived, feePerKb, *balanceHist;
@@ -40,7 +71,16 @@ struct BRWalletStructure {
     BRTransaction **transactions;
     BRMasterPubKey masterPubKey;
     BRAddress *internalChain, *externalChain;
+    BRChainKey *internalKeys, *externalKeys; // keys of each chain address, ahead of the chain if from an address cache
     BRSet *allTx, *invalidTx, *pendingTx, *spentOutputs, *usedAddrs, *allAddrs;
+    BRTxStore *txStore; // optional, kept up to date with the wallet transactions and closed with the wallet
+    BRSet *spenders; // BRTxSpend lists of the wallet tx spending each outpoint, indexed by outpoint
+    BRTransaction **history; // wallet tx in history order: block height, then timestamp, then tx hash
+    BRSet *addressTx, *assetTx; // BRTxIndex history ordered lists of wallet tx, by address and by asset name
+    BRPoolTx *pool; // unconfirmed non-wallet tx, oldest first
+    BRSet *poolTx, *poolSpenders; // pool tx indexed by hash, and by the outpoints they spend
+    size_t poolBytes, poolMaxBytes;
+    uint32_t poolMaxAge;
     void *callbackInfo;
 
     void (*balanceChanged)(void *info, uint64_t balance);
@@ -52,6 +92,8 @@ struct BRWalletStructure {
 
     void (*txDeleted)(void *info, UInt256 txHash, int notifyUser, int recommendRescan);
 
+    void (*txStoreError)(void *info, int error);
+
     pthread_mutex_t lock;
 };
 
@@ -77,6 +119,13 @@ inline static size_t _txChainIndex(const BRTransaction *tx, const BRAddress *add
     return SIZE_MAX;
 }
 
+// returns the wallet tx, or the unconfirmed non-wallet tx from the pool, with the given hash
+inline static BRTransaction *_BRWalletTxForHash(const BRWallet *wallet, const UInt256 *txHash) {
+    BRTransaction *tx = BRSetGet(wallet->allTx, txHash);
+
+    return (tx) ? tx : BRSetGet(wallet->poolTx, txHash);
+}
+
 inline static int
 _BRWalletTxIsAscending(BRWallet *wallet, const BRTransaction *tx1, const BRTransaction *tx2) {
     if (!tx1 || !tx2) return 0;
@@ -92,7 +141,7 @@ _BRWalletTxIsAscending(BRWallet *wallet, const BRTransaction *tx1, const BRTrans
     }
 
     for (size_t i = 0; i < tx1->inCount; i++) {
-        if (_BRWalletTxIsAscending(wallet, BRSetGet(wallet->allTx, &(tx1->inputs[i].txHash)),
+        if (_BRWalletTxIsAscending(wallet, _BRWalletTxForHash(wallet, &(tx1->inputs[i].txHash)),
                                    tx2))
             return 1;
     }
@@ -114,8 +163,187 @@ _BRWalletTxCompare(BRWallet *wallet, const BRTransaction *tx1, const BRTransacti
     return 0;
 }
 
-// inserts tx into wallet->transactions, keeping wallet->transactions sorted by date, oldest first (insertion sort)
-inline static void _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx) {
+// adds tx to a spenders index under each outpoint it spends
+static void _BRWalletAddSpends(BRSet *spenders, BRTransaction *tx) {
+    for (size_t i = 0; i < tx->inCount; i++) {
+        BRTxSpend *spend = BRAllocatorCalloc(WALLET_ALLOCATOR, sizeof(*spend));
+
+        assert(spend != NULL);
+        spend->outpoint = ((const UTXO) {tx->inputs[i].txHash, tx->inputs[i].index});
+        spend->tx = tx;
+        spend->next = BRSetAdd(spenders, spend); // becomes the list head, any previous head follows it
+    }
+}
+
+// removes tx from a spenders index
+static void _BRWalletRemoveSpends(BRSet *spenders, const BRTransaction *tx) {
+    for (size_t i = 0; i < tx->inCount; i++) {
+        BRTxSpend *head = BRSetGet(spenders, &tx->inputs[i]), **link = &head, *spend;
+
+        while (*link && (*link)->tx != tx) link = &(*link)->next;
+        if (!*link) continue;
+        spend = *link;
+        *link = spend->next;
+        BRSetRemove(spenders, spend);
+        if (head) BRSetAdd(spenders, head);
+        BRAllocatorFree(WALLET_ALLOCATOR, spend, sizeof(*spend));
+    }
+}
+
+static void _setApplyFreeSpends(void *info, void *spend) {
+    for (BRTxSpend *next; spend; spend = next) {
+        next = ((BRTxSpend *) spend)->next;
+        BRAllocatorFree(WALLET_ALLOCATOR, spend, sizeof(BRTxSpend));
+    }
+}
+
+// unindexes entry i of the unconfirmed non-wallet tx pool and returns its tx, leaving the entry in wallet->pool
+static BRTransaction *_BRWalletPoolUnindex(BRWallet *wallet, size_t i) {
+    BRTransaction *tx = wallet->pool[i].tx;
+
+    wallet->poolBytes -= wallet->pool[i].size;
+    BRSetRemove(wallet->poolTx, tx);
+    _BRWalletRemoveSpends(wallet->poolSpenders, tx);
+    return tx;
+}
+
+// evicts pool tx older than the pool age limit, then the oldest remaining until extraBytes more fit under the cap
+static void _BRWalletPoolTrim(BRWallet *wallet, size_t extraBytes, time_t now) {
+    size_t i = 0;
+
+    while (i < array_count(wallet->pool) && (wallet->pool[i].time + wallet->poolMaxAge < now ||
+                                             wallet->poolBytes + extraBytes > wallet->poolMaxBytes)) {
+        BRTransactionFree(_BRWalletPoolUnindex(wallet, i++));
+    }
+
+    if (i > 0) array_rm_range(wallet->pool, 0, i); // one move for the whole evicted run
+}
+
+// adds an unconfirmed non-wallet tx to the pool, evicting older pool tx to make room, returns false if tx alone is
+// over the pool memory cap
+static int _BRWalletPoolAdd(BRWallet *wallet, BRTransaction *tx, time_t now) {
+    size_t size = BRTransactionSize(tx);
+
+    if (size > wallet->poolMaxBytes) return 0;
+    _BRWalletPoolTrim(wallet, size, now);
+    array_add(wallet->pool, ((BRPoolTx) {tx, size, now}));
+    wallet->poolBytes += size;
+    BRSetAdd(wallet->poolTx, tx);
+    _BRWalletAddSpends(wallet->poolSpenders, tx);
+    return 1;
+}
+
+// removes tx from the pool, returns false if it wasn't there, the caller must free tx
+static int _BRWalletPoolRemove(BRWallet *wallet, const BRTransaction *tx) {
+    size_t i = array_count(wallet->pool);
+
+    if (!BRSetContains(wallet->poolTx, tx)) return 0;
+    while (i > 0 && wallet->pool[i - 1].tx != tx) i--; // recent tx are the likeliest to confirm or be removed
+    _BRWalletPoolUnindex(wallet, i - 1);
+    array_rm(wallet->pool, i - 1);
+    return 1;
+}
+
+// returns the history position of tx
+inline static BRTxCursor _BRTxHistoryKey(const BRTransaction *tx) {
+    return (BRTxCursor) {tx->blockHeight, tx->timestamp, tx->txHash};
+}
+
+// compares history positions, returns -1, 0 or 1 as a is before, at or after b
+static int _BRTxCursorCompare(const BRTxCursor *a, const BRTxCursor *b) {
+    if (a->blockHeight != b->blockHeight) return (a->blockHeight < b->blockHeight) ? -1 : 1;
+    if (a->timestamp != b->timestamp) return (a->timestamp < b->timestamp) ? -1 : 1;
+    return memcmp(&a->txHash, &b->txHash, sizeof(UInt256));
+}
+
+// returns the index of the first tx in a history ordered list that is at or after key
+static size_t _BRTxHistoryLowerBound(BRTransaction *const *txs, size_t count, const BRTxCursor *key) {
+    size_t lo = 0, hi = count, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        BRTxCursor k = _BRTxHistoryKey(txs[mid]);
+
+        if (_BRTxCursorCompare(&k, key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+// adds tx to a history ordered list, unless it's already there
+static void _BRTxHistoryAdd(BRTransaction ***txs, BRTransaction *tx) {
+    BRTxCursor key = _BRTxHistoryKey(tx);
+    size_t i = _BRTxHistoryLowerBound(*txs, array_count(*txs), &key);
+
+    if (i < array_count(*txs) && (*txs)[i] == tx) return;
+    array_insert(*txs, i, tx);
+}
+
+// removes tx from a history ordered list, tx must still have the height and timestamp it was added with
+static void _BRTxHistoryRemove(BRTransaction **txs, const BRTransaction *tx) {
+    BRTxCursor key = _BRTxHistoryKey(tx);
+    size_t i = _BRTxHistoryLowerBound(txs, array_count(txs), &key);
+
+    if (i < array_count(txs) && txs[i] == tx) array_rm(txs, i);
+}
+
+// adds tx to the list of index under key, creating the list if needed
+static void _BRTxIndexAdd(BRSet *index, const char *key, BRTransaction *tx) {
+    BRTxIndex *entry;
+
+    if (key[0] == '\0' || strlen(key) >= sizeof(entry->key)) return;
+    entry = BRSetGet(index, key);
+
+    if (!entry) {
+        entry = BRAllocatorCalloc(WALLET_ALLOCATOR, sizeof(*entry));
+        assert(entry != NULL);
+        strncpy(entry->key, key, sizeof(entry->key) - 1);
+        array_new_with_allocator(entry->txs, 1, WALLET_ALLOCATOR);
+        BRSetAdd(index, entry);
+    }
+
+    _BRTxHistoryAdd(&entry->txs, tx);
+}
+
+// removes tx from the list of index under key, dropping the list once empty
+static void _BRTxIndexRemove(BRSet *index, const char *key, const BRTransaction *tx) {
+    BRTxIndex *entry = (key[0] != '\0') ? BRSetGet(index, key) : NULL;
+
+    if (!entry) return;
+    _BRTxHistoryRemove(entry->txs, tx);
+
+    if (array_count(entry->txs) == 0) {
+        BRSetRemove(index, entry);
+        array_free(entry->txs);
+        BRAllocatorFree(WALLET_ALLOCATOR, entry, sizeof(*entry));
+    }
+}
+
+static void _setApplyFreeTxIndex(void *info, void *entry) {
+    array_free(((BRTxIndex *) entry)->txs);
+    BRAllocatorFree(WALLET_ALLOCATOR, entry, sizeof(BRTxIndex));
+}
+
+// adds tx to the wallet history and to the address and asset indexes, by its current height and timestamp
+static void _BRWalletIndexTx(BRWallet *wallet, BRTransaction *tx) {
+    _BRTxHistoryAdd(&wallet->history, tx);
+    for (size_t i = 0; i < tx->inCount; i++) _BRTxIndexAdd(wallet->addressTx, tx->inputs[i].address, tx);
+    for (size_t i = 0; i < tx->outCount; i++) _BRTxIndexAdd(wallet->addressTx, tx->outputs[i].address, tx);
+    if (tx->asset && tx->asset->name) _BRTxIndexAdd(wallet->assetTx, tx->asset->name, tx);
+}
+
+// removes tx from the wallet history and indexes, call before changing its height or timestamp and index it again after
+static void _BRWalletUnindexTx(BRWallet *wallet, const BRTransaction *tx) {
+    _BRTxHistoryRemove(wallet->history, tx);
+    for (size_t i = 0; i < tx->inCount; i++) _BRTxIndexRemove(wallet->addressTx, tx->inputs[i].address, tx);
+    for (size_t i = 0; i < tx->outCount; i++) _BRTxIndexRemove(wallet->addressTx, tx->outputs[i].address, tx);
+    if (tx->asset && tx->asset->name) _BRTxIndexRemove(wallet->assetTx, tx->asset->name, tx);
+}
+
+// places tx in wallet->transactions, keeping wallet->transactions sorted by date, oldest first (insertion sort)
+// returns the index tx was placed at
+static size_t _BRWalletPlaceTx(BRWallet *wallet, BRTransaction *tx) {
     size_t i = array_count(wallet->transactions);
 
     array_set_count(wallet->transactions, i + 1);
@@ -126,6 +354,25 @@ inline static void _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx) {
     }
 
     wallet->transactions[i] = tx;
+    return i;
+}
+
+// inserts tx into wallet->transactions and the spenders and history indexes
+inline static void _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx) {
+    _BRWalletAddSpends(wallet->spenders, tx);
+    _BRWalletIndexTx(wallet, tx);
+    _BRWalletPlaceTx(wallet, tx);
+}
+
+// moves tx back into sorted order after its height changed, returns true if its position in wallet->transactions
+// changed, in which case the balance history no longer lines up with it and must be rebuilt
+static int _BRWalletResortTx(BRWallet *wallet, BRTransaction *tx) {
+    size_t i = array_count(wallet->transactions);
+
+    while (i > 0 && wallet->transactions[i - 1] != tx) i--;
+    if (i == 0) return 0;
+    array_rm(wallet->transactions, i - 1);
+    return (_BRWalletPlaceTx(wallet, tx) != i - 1);
 }
 
 // non-threadsafe version of WalletContainsTransaction()
@@ -146,12 +393,112 @@ static int _BRWalletContainsTx(BRWallet *wallet, const BRTransaction *tx) {
     return r;
 }
 
-static void _BRWalletUpdateBalance(BRWallet *wallet) {
+// returns the wallet balance after the first n transactions, in O(log n)
+static uint64_t _BRWalletBalanceHistSum(const BRWallet *wallet, size_t n) {
+    uint64_t balance = 0;
+
+    for (; n > 0; n -= n & (~n + 1)) balance += wallet->balanceHist[n - 1];
+    return balance;
+}
+
+// appends the balance change of the next transaction to the balanceHist Fenwick tree, in O(log n)
+static void _BRWalletBalanceHistAppend(BRWallet *wallet, uint64_t delta) {
+    size_t n = array_count(wallet->balanceHist) + 1;
+
+    // node n covers the changes of transactions n - lowbit(n) through n - 1
+    array_add(wallet->balanceHist, delta + _BRWalletBalanceHistSum(wallet, n - 1) -
+                                   _BRWalletBalanceHistSum(wallet, n - (n & (~n + 1))));
+}
+
+// applies the next transaction in sorted order to the UTXO set, spent outputs, balance and balance history
+static void _BRWalletApplyTx(BRWallet *wallet, BRTransaction *tx, time_t now) {
     int isInvalid, isPending;
-    uint64_t balance = 0, prevBalance = 0;
+    uint64_t balance = wallet->balance, prevBalance = wallet->balance;
+    size_t j;
+    BRTransaction *t;
+
+    // check if any inputs are invalid or already spent
+    if (tx->blockHeight == TX_UNCONFIRMED) {
+        for (j = 0, isInvalid = 0; !isInvalid && j < tx->inCount; j++) {
+            if (BRSetContains(wallet->spentOutputs, &tx->inputs[j]) ||
+                BRSetContains(wallet->invalidTx, &tx->inputs[j].txHash))
+                isInvalid = 1;
+        }
+
+        if (isInvalid) {
+            BRSetAdd(wallet->invalidTx, tx);
+            _BRWalletBalanceHistAppend(wallet, 0);
+            return;
+        }
+    }
+
+    // add inputs to spent output set
+    for (j = 0; j < tx->inCount; j++) {
+        BRSetAdd(wallet->spentOutputs, &tx->inputs[j]);
+    }
+
+    // check if tx is pending
+    if (tx->blockHeight == TX_UNCONFIRMED) {
+        isPending = (BRTransactionSize(tx) > TX_MAX_SIZE) ? 1
+                                                          : 0; // check tx size is under TX_MAX_SIZE
+
+        //TODO: Remove dust but without affecting assets
+//        for (j = 0; !isPending && j < tx->outCount; j++) {
+//            if (tx->outputs[j].amount < TX_MIN_OUTPUT_AMOUNT) isPending = 1; // check that no outputs are dust
+//        }
+
+        for (j = 0; !isPending && j < tx->inCount; j++) {
+            // Replace by fee removed.
+//            if (tx->inputs[j].sequence < UINT32_MAX - 1) isPending = 1; // check for replace-by-fee
+            if (/*tx->inputs[j].sequence < UINT32_MAX &&*/
+                    tx->lockTime < TX_MAX_LOCK_HEIGHT &&
+                    tx->lockTime > wallet->blockHeight - 180)
+                isPending = 1; // future lockTime
+
+            if (tx->inputs[j].sequence < UINT32_MAX && tx->lockTime > now)
+                isPending = 1; // future lockTime
+            if (BRSetContains(wallet->pendingTx, &tx->inputs[j].txHash))
+                isPending = 1; // check for pending inputs
+            // TODO: XXX handle BIP68 check lock time verify rules
+        }
+
+        if (isPending) {
+            BRSetAdd(wallet->pendingTx, tx);
+            _BRWalletBalanceHistAppend(wallet, 0);
+            return;
+        }
+    }
+
+    // add outputs to UTXO set
+    // NOTE: balance/UTXOs will then need to be recalculated when last block changes
+    for (j = 0; j < tx->outCount; j++) {
+        if (tx->outputs[j].address[0] != '\0') {
+            BRSetAdd(wallet->usedAddrs, tx->outputs[j].address);
+
+            if (BRSetContains(wallet->allAddrs, tx->outputs[j].address)) {
+                array_add(wallet->utxos, ((const UTXO) {tx->txHash, (uint32_t) j}));
+                balance += tx->outputs[j].amount;
+            }
+        }
+    }
+
+    // transaction ordering is not guaranteed, so check the entire UTXO set against the entire spent output set
+    for (j = array_count(wallet->utxos); j > 0; j--) {
+        if (!BRSetContains(wallet->spentOutputs, &wallet->utxos[j - 1]))
+            continue;
+        t = BRSetGet(wallet->allTx, &wallet->utxos[j - 1].hash);
+        balance -= t->outputs[wallet->utxos[j - 1].n].amount;
+        array_rm(wallet->utxos, j - 1);
+    }
+
+    if (prevBalance < balance) wallet->totalReceived += balance - prevBalance;
+    if (balance < prevBalance) wallet->totalSent += prevBalance - balance;
+    _BRWalletBalanceHistAppend(wallet, balance - prevBalance);
+    wallet->balance = balance;
+}
+
+static void _BRWalletUpdateBalance(BRWallet *wallet) {
     time_t now = time(NULL);
-    size_t i, j;
-    BRTransaction *tx, *t;
 
     array_clear(wallet->utxos);
     array_clear(wallet->balanceHist);
@@ -159,118 +506,122 @@ static void _BRWalletUpdateBalance(BRWallet *wallet) {
     BRSetClear(wallet->invalidTx);
     BRSetClear(wallet->pendingTx);
     BRSetClear(wallet->usedAddrs);
+    wallet->balance = 0;
     wallet->totalSent = 0;
     wallet->totalReceived = 0;
 
-    for (i = 0; i < array_count(wallet->transactions); i++) {
-        tx = wallet->transactions[i];
-
-        // check if any inputs are invalid or already spent
-        if (tx->blockHeight == TX_UNCONFIRMED) {
-            for (j = 0, isInvalid = 0; !isInvalid && j < tx->inCount; j++) {
-                if (BRSetContains(wallet->spentOutputs, &tx->inputs[j]) ||
-                    BRSetContains(wallet->invalidTx, &tx->inputs[j].txHash))
-                    isInvalid = 1;
-            }
+    for (size_t i = 0; i < array_count(wallet->transactions); i++) {
+        _BRWalletApplyTx(wallet, wallet->transactions[i], now);
+    }
 
-            if (isInvalid) {
-                BRSetAdd(wallet->invalidTx, tx);
-                array_add(wallet->balanceHist, balance);
-                continue;
-            }
-        }
+    assert(array_count(wallet->balanceHist) == array_count(wallet->transactions));
+}
 
-        // add inputs to spent output set
-        for (j = 0; j < tx->inCount; j++) {
-            BRSetAdd(wallet->spentOutputs, &tx->inputs[j]);
-        }
+// returns the index of the first tx in wallet->transactions with a blockHeight of at least blockHeight, the list is
+// sorted by blockHeight with unconfirmed tx last
+static size_t _BRWalletTxLowerBound(const BRWallet *wallet, uint32_t blockHeight) {
+    size_t lo = 0, hi = array_count(wallet->transactions), mid;
 
-        // check if tx is pending
-        if (tx->blockHeight == TX_UNCONFIRMED) {
-            isPending = (BRTransactionSize(tx) > TX_MAX_SIZE) ? 1
-                                                              : 0; // check tx size is under TX_MAX_SIZE
-
-            //TODO: Remove dust but without affecting assets
-//            for (j = 0; !isPending && j < tx->outCount; j++) {
-//                if (tx->outputs[j].amount < TX_MIN_OUTPUT_AMOUNT) isPending = 1; // check that no outputs are dust
-//            }
-
-            for (j = 0; !isPending && j < tx->inCount; j++) {
-                // Replace by fee removed.
-//                if (tx->inputs[j].sequence < UINT32_MAX - 1) isPending = 1; // check for replace-by-fee
-                if (/*tx->inputs[j].sequence < UINT32_MAX &&*/
-                        tx->lockTime < TX_MAX_LOCK_HEIGHT &&
-                        tx->lockTime > wallet->blockHeight - 180)
-                    isPending = 1; // future lockTime
-
-                if (tx->inputs[j].sequence < UINT32_MAX && tx->lockTime > now)
-                    isPending = 1; // future lockTime
-                if (BRSetContains(wallet->pendingTx, &tx->inputs[j].txHash))
-                    isPending = 1; // check for pending inputs
-                // TODO: XXX handle BIP68 check lock time verify rules
-            }
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (wallet->transactions[mid]->blockHeight < blockHeight) lo = mid + 1;
+        else hi = mid;
+    }
 
-            if (isPending) {
-                BRSetAdd(wallet->pendingTx, tx);
-                array_add(wallet->balanceHist, balance);
-                continue;
-            }
-        }
+    return lo;
+}
 
-        // add outputs to UTXO set
-        // NOTE: balance/UTXOs will then need to be recalculated when last block changes
-        for (j = 0; j < tx->outCount; j++) {
-            if (tx->outputs[j].address[0] != '\0') {
-                BRSetAdd(wallet->usedAddrs, tx->outputs[j].address);
+// returns the wallet balance after all tx confirmed at or below blockHeight
+static uint64_t _BRWalletBalanceAtHeight(const BRWallet *wallet, uint32_t blockHeight) {
+    if (blockHeight >= TX_UNCONFIRMED) blockHeight = TX_UNCONFIRMED - 1;
+    return _BRWalletBalanceHistSum(wallet, _BRWalletTxLowerBound(wallet, blockHeight + 1));
+}
 
-                if (BRSetContains(wallet->allAddrs, tx->outputs[j].address)) {
-                    array_add(wallet->utxos, ((const UTXO) {tx->txHash, (uint32_t) j}));
-                    balance += tx->outputs[j].amount;
-                }
-            }
-        }
+// MAC key for the address cache of mpk, so a cache can't be used with, or forged for, another wallet's xpub
+static UInt256 _BRWalletAddressCacheKey(BRMasterPubKey mpk) {
+    static const char label[] = "address cache";
+    uint8_t data[sizeof(UInt256) + sizeof(mpk.pubKey)];
+    UInt256 key;
 
-        // transaction ordering is not guaranteed, so check the entire UTXO set against the entire spent output set
-        for (j = array_count(wallet->utxos); j > 0; j--) {
-            if (!BRSetContains(wallet->spentOutputs, &wallet->utxos[j - 1]))
-                continue;
-            t = BRSetGet(wallet->allTx, &wallet->utxos[j - 1].hash);
-            balance -= t->outputs[wallet->utxos[j - 1].n].amount;
-            array_rm(wallet->utxos, j - 1);
-        }
+    UInt256Set(data, mpk.chainCode);
+    memcpy(&data[sizeof(UInt256)], mpk.pubKey, sizeof(mpk.pubKey));
+    HMAC(&key, SHA256, sizeof(key), label, strlen(label), data, sizeof(data));
+    return key;
+}
 
-        if (prevBalance < balance) wallet->totalReceived += balance - prevBalance;
-        if (balance < prevBalance) wallet->totalSent += prevBalance - balance;
-        array_add(wallet->balanceHist, balance);
-        prevBalance = balance;
+// loads the chain keys from an address cache made by BRWalletAddressCache() with the same master pubkey, returns
+// false and loads nothing unless the MAC verifies, addresses are only encoded from the keys as the chains reach them
+static int _BRWalletLoadAddressCache(BRWallet *wallet, const uint8_t *cache, size_t cacheLen) {
+    uint64_t externalCount, internalCount;
+    UInt256 key, mac;
+    size_t off = ADDR_CACHE_HEADER_SIZE;
+
+    if (!cache || cacheLen < ADDR_CACHE_HEADER_SIZE + sizeof(mac)) return 0;
+    if (UInt32GetLE(cache) != ADDR_CACHE_VERSION) return 0;
+    externalCount = UInt32GetLE(&cache[sizeof(uint32_t)]);
+    internalCount = UInt32GetLE(&cache[2*sizeof(uint32_t)]);
+    if (cacheLen != ADDR_CACHE_HEADER_SIZE + (externalCount + internalCount)*ADDR_CACHE_ENTRY_SIZE + sizeof(mac))
+        return 0;
+
+    key = _BRWalletAddressCacheKey(wallet->masterPubKey);
+    HMAC(&mac, SHA256, sizeof(mac), &key, sizeof(key), cache, cacheLen - sizeof(mac));
+    var_clean(&key);
+    if (!UInt256Eq(mac, UInt256Get(&cache[cacheLen - sizeof(mac)]))) return 0;
+
+    // entries are in chain order, so an entry's index is its position in its chain
+    for (uint64_t i = 0; i < externalCount + internalCount; i++, off += ADDR_CACHE_ENTRY_SIZE) {
+        BRChainKey k;
+
+        k.hash160 = UInt160Get(&cache[off]);
+        memcpy(k.pubKey, &cache[off + sizeof(UInt160)], sizeof(k.pubKey));
+        if (i < externalCount) array_add(wallet->externalKeys, k);
+        else array_add(wallet->internalKeys, k);
     }
 
-    assert(array_count(wallet->balanceHist) == array_count(wallet->transactions));
-    wallet->balance = balance;
+    return 1;
 }
 
 // allocates and populates a Wallet struct which must be freed by calling WalletFree()
 BRWallet *BRWalletNew(BRTransaction **transactions, size_t txCount, BRMasterPubKey mpk) {
+    return BRWalletNewWithAddressCache(transactions, txCount, mpk, NULL, 0);
+}
+
+// like WalletNew(), but takes the chain keys from an address cache written by WalletAddressCache() instead of deriving
+// them, a cache that fails authentication for mpk is ignored and the keys are derived as usual
+BRWallet *BRWalletNewWithAddressCache(BRTransaction **transactions, size_t txCount, BRMasterPubKey mpk,
+                                      const uint8_t *cache, size_t cacheLen) {
     BRWallet *wallet = NULL;
     BRTransaction *tx;
 
     assert(transactions != NULL || txCount == 0);
-    wallet = calloc(1, sizeof(*wallet));
+    wallet = BRAllocatorCalloc(WALLET_ALLOCATOR, sizeof(*wallet));
     assert(wallet != NULL);
-    array_new(wallet->utxos, 100);
-    array_new(wallet->transactions, txCount + 100);
+    array_new_with_allocator(wallet->utxos, 100, WALLET_ALLOCATOR);
+    array_new_with_allocator(wallet->transactions, txCount + 100, WALLET_ALLOCATOR);
     wallet->feePerKb = DEFAULT_FEE_PER_KB;
     wallet->masterPubKey = mpk;
-    array_new(wallet->internalChain, 100);
-    array_new(wallet->externalChain, 100);
-    array_new(wallet->balanceHist, txCount + 100);
-    wallet->allTx = BRSetNew(BRTransactionHash, BRTransactionEq, txCount + 100);
-    wallet->invalidTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
-    wallet->pendingTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
-    wallet->spentOutputs = BRSetNew(BRUTXOHash, BRUTXOEq, txCount + 100);
-    wallet->usedAddrs = BRSetNew(BRAddressHash, BRAddressEq, txCount + 100);
-    wallet->allAddrs = BRSetNew(BRAddressHash, BRAddressEq, txCount + 100);
+    array_new_with_allocator(wallet->internalChain, 100, WALLET_ALLOCATOR);
+    array_new_with_allocator(wallet->externalChain, 100, WALLET_ALLOCATOR);
+    array_new_with_allocator(wallet->internalKeys, 100, WALLET_ALLOCATOR);
+    array_new_with_allocator(wallet->externalKeys, 100, WALLET_ALLOCATOR);
+    array_new_with_allocator(wallet->balanceHist, txCount + 100, WALLET_ALLOCATOR);
+    wallet->allTx = BRSetNewWithAllocator(BRTransactionHash, BRTransactionEq, txCount + 100, WALLET_ALLOCATOR);
+    wallet->invalidTx = BRSetNewWithAllocator(BRTransactionHash, BRTransactionEq, 10, WALLET_ALLOCATOR);
+    wallet->pendingTx = BRSetNewWithAllocator(BRTransactionHash, BRTransactionEq, 10, WALLET_ALLOCATOR);
+    wallet->spentOutputs = BRSetNewWithAllocator(BRUTXOHash, BRUTXOEq, txCount + 100, WALLET_ALLOCATOR);
+    wallet->usedAddrs = BRSetNewWithAllocator(BRAddressHash, BRAddressEq, txCount + 100, WALLET_ALLOCATOR);
+    wallet->allAddrs = BRSetNewWithAllocator(BRAddressHash, BRAddressEq, txCount + 100, WALLET_ALLOCATOR);
+    wallet->spenders = BRSetNewWithAllocator(BRUTXOHash, BRUTXOEq, txCount + 100, WALLET_ALLOCATOR);
+    array_new_with_allocator(wallet->history, txCount + 100, WALLET_ALLOCATOR);
+    wallet->addressTx = BRSetNewWithAllocator(BRAddressHash, BRAddressEq, txCount + 100, WALLET_ALLOCATOR);
+    wallet->assetTx = BRSetNewWithAllocator(BRAddressHash, BRAddressEq, 100, WALLET_ALLOCATOR);
+    array_new_with_allocator(wallet->pool, 100, WALLET_ALLOCATOR);
+    wallet->poolTx = BRSetNewWithAllocator(BRTransactionHash, BRTransactionEq, 100, WALLET_ALLOCATOR);
+    wallet->poolSpenders = BRSetNewWithAllocator(BRUTXOHash, BRUTXOEq, 100, WALLET_ALLOCATOR);
+    wallet->poolMaxBytes = WALLET_POOL_MAX_BYTES;
+    wallet->poolMaxAge = WALLET_POOL_MAX_AGE;
     pthread_mutex_init(&wallet->lock, NULL);
+    _BRWalletLoadAddressCache(wallet, cache, cacheLen);
 
     for (size_t i = 0; transactions && i < txCount; i++) {
         tx = transactions[i];
@@ -297,6 +648,71 @@ BRWallet *BRWalletNew(BRTransaction **transactions, size_t txCount, BRMasterPubK
     return wallet;
 }
 
+// like WalletNewWithAddressCache(), but loads the transactions from store in one pass, and then keeps store up to date
+// with the wallet transactions, the wallet takes ownership of store and closes it in WalletFree()
+// returns NULL, leaving store open, if the stored transactions don't match mpk
+BRWallet *BRWalletNewWithTxStore(BRTxStore *store, BRMasterPubKey mpk, const uint8_t *cache, size_t cacheLen) {
+    BRWallet *wallet;
+    BRTransaction **transactions;
+    size_t txCount;
+
+    assert(store != NULL);
+    txCount = BRTxStoreLoad(store, NULL, 0);
+    transactions = malloc(txCount*sizeof(*transactions));
+    assert(transactions != NULL || txCount == 0);
+    txCount = BRTxStoreLoad(store, transactions, txCount);
+    wallet = BRWalletNewWithAddressCache(transactions, txCount, mpk, cache, cacheLen);
+    if (wallet) wallet->txStore = store;
+    free(transactions);
+    return wallet;
+}
+
+typedef struct {
+    BRWallet **wallet;
+    const void *seed;
+    size_t seedLen;
+    uint32_t coinType, account;
+} BRAccountRestore;
+
+static void _BRWalletAccountTask(void *info) {
+    BRAccountRestore *restore = info;
+    BRMasterPubKey mpk = BRBIP44MasterPubKey(restore->seed, restore->seedLen, restore->coinType, restore->account, 0);
+
+    *restore->wallet = BRWalletNew(NULL, 0, mpk);
+}
+
+// restores count BIP44 accounts of seed starting at firstAccount, deriving the account keys and their first gap limit
+// address windows on the shared task pool, and writes a new empty wallet for each to wallets
+void BRWalletNewAccounts(BRWallet *wallets[], size_t count, const void *seed, size_t seedLen, uint32_t coinType,
+                         uint32_t firstAccount) {
+    BRAccountRestore *restore = malloc(count*sizeof(*restore));
+    BRTaskGroup *group;
+
+    assert(wallets != NULL || count == 0);
+    assert(seed != NULL || seedLen == 0);
+    assert(restore != NULL || count == 0);
+    group = BRTaskGroupNew(BRTaskPoolShared());
+
+    for (size_t i = 0; i < count; i++) {
+        restore[i] = (BRAccountRestore) { &wallets[i], seed, seedLen, coinType, firstAccount + (uint32_t) i };
+        BRTaskGroupSpawn(group, &restore[i], _BRWalletAccountTask);
+    }
+
+    BRTaskGroupWaitIsolated(group); // the caller may hold locks that other tasks of the shared pool need
+    BRTaskGroupFree(group);
+    free(restore);
+}
+
+// returns the number of leading wallets that have transactions, BIP44 account discovery stops at the first unused
+// account, so if this equals count the next batch of accounts should be restored and synced as well
+size_t BRWalletUsedAccountCount(BRWallet *wallets[], size_t count) {
+    size_t i = 0;
+
+    assert(wallets != NULL || count == 0);
+    while (i < count && BRWalletTransactions(wallets[i], NULL, 0) > 0) i++;
+    return i;
+}
+
 // not thread-safe, set callbacks once after WalletNew(), before calling other Wallet functions
 // info is a void pointer that will be passed along with each callback call
 // void balanceChanged(void *, uint64_t) - called when the wallet balance changes
@@ -321,6 +737,57 @@ void BRWalletSetCallbacks(BRWallet *wallet, void *info,
     wallet->txDeleted = txDeleted;
 }
 
+// not thread-safe, set once after WalletNewWithTxStore() along with the other callbacks, info is the same as theirs
+// void txStoreError(void *, int) - called with the errno value when a change to the wallet transactions couldn't be
+//   written to the tx store, the wallet itself is up to date, but the store may reload stale tx until resynced
+void BRWalletSetTxStoreErrorCallback(BRWallet *wallet, void (*txStoreError)(void *info, int error)) {
+    assert(wallet != NULL);
+    wallet->txStoreError = txStoreError;
+}
+
+// reports the result of a tx store write through the txStoreError callback if it failed
+static void _BRWalletTxStoreResult(BRWallet *wallet, int error) {
+    if (error != 0 && wallet->txStoreError) wallet->txStoreError(wallet->callbackInfo, error);
+}
+
+typedef struct {
+    const BRMasterPubKey *mpk;
+    uint32_t chain, index;
+    size_t len;
+    BRChainKey key;
+} BRChainKeyDerivation;
+
+static void _BRChainKeyDerivationTask(void *info) {
+    BRChainKeyDerivation *d = info;
+    BRKey key;
+
+    d->len = BRBIP32PubKey(d->key.pubKey, sizeof(d->key.pubKey), *d->mpk, d->chain, d->index);
+    if (! BRKeySetPubKey(&key, d->key.pubKey, d->len)) d->len = 0;
+    if (d->len > 0) Hash160(&d->key.hash160, d->key.pubKey, d->len);
+}
+
+// derives the next count keys of chain on the shared task pool, and adds them to chainKeys up to the first invalid one
+// the caller holds wallet->lock, and possibly a peer manager lock, so only this group's tasks run on the calling thread
+static void _BRWalletDeriveChainKeys(BRWallet *wallet, BRChainKey **chainKeys, uint32_t chain, size_t count) {
+    BRChainKeyDerivation *derivations = malloc(count*sizeof(*derivations));
+    BRTaskGroup *group = BRTaskGroupNew(BRTaskPoolShared());
+    size_t i, start = array_count(*chainKeys);
+
+    assert(derivations != NULL);
+
+    for (i = 0; i < count; i++) {
+        derivations[i].mpk = &wallet->masterPubKey;
+        derivations[i].chain = chain;
+        derivations[i].index = (uint32_t) (start + i);
+        BRTaskGroupSpawn(group, &derivations[i], _BRChainKeyDerivationTask);
+    }
+
+    BRTaskGroupWaitIsolated(group);
+    BRTaskGroupFree(group);
+    for (i = 0; i < count && derivations[i].len > 0; i++) array_add(*chainKeys, derivations[i].key);
+    free(derivations);
+}
+
 // wallets are composed of chains of addresses
 // each chain is traversed until a gap of a number of addresses is found that haven't been used in any transactions
 // this function writes to addrs an array of <gapLimit> unused addresses following the last used address in the chain
@@ -329,6 +796,7 @@ void BRWalletSetCallbacks(BRWallet *wallet, void *info,
 // returns the number addresses written to addrs
 size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress *addrs, uint32_t gapLimit, int internal) {
     BRAddress *addrChain;
+    BRChainKey **chainKeys;
     size_t i, j = 0, count, startCount;
     uint32_t chain = (internal) ? SEQUENCE_INTERNAL_CHAIN : SEQUENCE_EXTERNAL_CHAIN;
 
@@ -336,22 +804,32 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress *addrs, uint32_t gapLimit
     assert(gapLimit > 0);
     pthread_mutex_lock(&wallet->lock);
     addrChain = (internal) ? wallet->internalChain : wallet->externalChain;
+    chainKeys = (internal) ? &wallet->internalKeys : &wallet->externalKeys;
     i = count = startCount = array_count(addrChain);
 
     // keep only the trailing contiguous block of addresses with no transactions
     while (i > 0 && !BRSetContains(wallet->usedAddrs, &addrChain[i - 1])) i--;
 
     while (i + gapLimit > count) { // generate new addresses up to gapLimit
-        BRKey key;
         BRAddress address = ADDRESS_NONE;
-        uint8_t pubKey[BRBIP32PubKey(NULL, 0, wallet->masterPubKey, chain, count)];
-        size_t len = BRBIP32PubKey(pubKey, sizeof(pubKey), wallet->masterPubKey, chain,
-                                   (uint32_t) count);
 
-        if (!BRKeySetPubKey(&key, pubKey, len)) break;
-        if (!BRKeyAddress(&key, address.s, sizeof(address)) ||
-            BRAddressEq(&address, &ADDRESS_NONE))
-            break;
+        if (count >= array_count(*chainKeys) && i + gapLimit - count >= WALLET_PARALLEL_KEYS) {
+            _BRWalletDeriveChainKeys(wallet, chainKeys, chain, i + gapLimit - count);
+        }
+
+        if (count >= array_count(*chainKeys)) { // derive keys that weren't loaded from an address cache
+            BRKey key;
+            BRChainKey k;
+            size_t len = BRBIP32PubKey(k.pubKey, sizeof(k.pubKey), wallet->masterPubKey, chain,
+                                       (uint32_t) count);
+
+            if (!BRKeySetPubKey(&key, k.pubKey, len)) break;
+            Hash160(&k.hash160, k.pubKey, len);
+            array_add(*chainKeys, k);
+        }
+
+        BRAddressFromHash160(address.s, sizeof(address.s), &(*chainKeys)[count].hash160);
+        if (BRAddressEq(&address, &ADDRESS_NONE)) break;
         array_add(addrChain, address);
         count++;
         if (BRSetContains(wallet->usedAddrs, &address)) i = count;
@@ -386,6 +864,40 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress *addrs, uint32_t gapLimit
     return j;
 }
 
+// writes an authenticated cache of the wallet chain keys (hash160 and compressed pubkey of each address) to cache, for
+// WalletNewWithAddressCache() to skip deriving them, returns number of bytes written, or cacheLen needed if cache is NULL
+size_t BRWalletAddressCache(BRWallet *wallet, uint8_t *cache, size_t cacheLen) {
+    size_t len, off = ADDR_CACHE_HEADER_SIZE, externalCount, internalCount;
+    UInt256 key;
+
+    assert(wallet != NULL);
+    pthread_mutex_lock(&wallet->lock);
+    externalCount = array_count(wallet->externalKeys);
+    internalCount = array_count(wallet->internalKeys);
+    len = ADDR_CACHE_HEADER_SIZE + (externalCount + internalCount)*ADDR_CACHE_ENTRY_SIZE + sizeof(UInt256);
+
+    if (cache && len <= cacheLen) {
+        UInt32SetLE(cache, ADDR_CACHE_VERSION);
+        UInt32SetLE(&cache[sizeof(uint32_t)], (uint32_t) externalCount);
+        UInt32SetLE(&cache[2*sizeof(uint32_t)], (uint32_t) internalCount);
+
+        for (size_t i = 0; i < externalCount + internalCount; i++, off += ADDR_CACHE_ENTRY_SIZE) {
+            const BRChainKey *k = (i < externalCount) ? &wallet->externalKeys[i] :
+                                  &wallet->internalKeys[i - externalCount];
+
+            UInt160Set(&cache[off], k->hash160);
+            memcpy(&cache[off + sizeof(UInt160)], k->pubKey, sizeof(k->pubKey));
+        }
+
+        key = _BRWalletAddressCacheKey(wallet->masterPubKey);
+        HMAC(&cache[off], SHA256, sizeof(UInt256), &key, sizeof(key), cache, off);
+        var_clean(&key);
+    }
+
+    pthread_mutex_unlock(&wallet->lock);
+    return (!cache || len <= cacheLen) ? len : 0;
+}
+
 // current wallet balance, not including transactions known to be invalid
 uint64_t BRWalletBalance(BRWallet *wallet) {
     uint64_t balance;
@@ -447,6 +959,102 @@ size_t BRWalletTxUnconfirmedBefore(BRWallet *wallet, BRTransaction **transaction
     return txCount;
 }
 
+// true if tx has an input or output to addr
+static int _txHasAddress(const BRTransaction *tx, const char *addr) {
+    for (size_t i = 0; i < tx->inCount; i++) {
+        if (strcmp(tx->inputs[i].address, addr) == 0) return 1;
+    }
+
+    for (size_t i = 0; i < tx->outCount; i++) {
+        if (strcmp(tx->outputs[i].address, addr) == 0) return 1;
+    }
+
+    return 0;
+}
+
+// non-threadsafe, writes the history record of wallet tx to record
+static void _BRWalletTxRecord(BRWallet *wallet, const BRTransaction *tx, BRTxRecord *record) {
+    uint64_t inputs = 0;
+
+    *record = (BRTxRecord) {tx->txHash, tx->blockHeight, tx->timestamp, 0, 0, 0,
+                            (tx->asset) ? tx->asset->amount : 0};
+
+    for (size_t i = 0; i < tx->outCount; i++) {
+        if (BRSetContains(wallet->allAddrs, tx->outputs[i].address)) record->received += tx->outputs[i].amount;
+    }
+
+    for (size_t i = 0; i < tx->inCount; i++) {
+        BRTransaction *t = _BRWalletTxForHash(wallet, &tx->inputs[i].txHash);
+        uint32_t n = tx->inputs[i].index;
+
+        if (!t || n >= t->outCount) inputs = UINT64_MAX;
+        if (inputs != UINT64_MAX) inputs += t->outputs[n].amount;
+        if (t && n < t->outCount && BRSetContains(wallet->allTx, t) &&
+            BRSetContains(wallet->allAddrs, t->outputs[n].address)) record->sent += t->outputs[n].amount;
+    }
+
+    for (size_t i = 0; i < tx->outCount && inputs != UINT64_MAX; i++) {
+        inputs -= tx->outputs[i].amount;
+    }
+
+    record->fee = inputs;
+}
+
+// writes records of up to limit wallet transactions matching query, newest first, starting after cursor, and
+// advances cursor past the last one written, returns the number of records written, fewer than limit at the end
+size_t BRWalletQueryTransactions(BRWallet *wallet, const BRTxQuery *query, BRTxCursor *cursor,
+                                 BRTxRecord records[], size_t limit) {
+    BRTxIndex *byAddress = NULL, *byAsset = NULL;
+    BRTransaction **txs, *tx, *last = NULL;
+    BRTxCursor top;
+    size_t i, count, n = 0;
+
+    assert(wallet != NULL);
+    assert(query != NULL);
+    assert(cursor != NULL);
+    assert(records != NULL || limit == 0);
+    pthread_mutex_lock(&wallet->lock);
+    txs = wallet->history;
+    count = array_count(wallet->history);
+
+    // scan the shortest of the lists that could hold a match
+    if (query->address) {
+        byAddress = BRSetGet(wallet->addressTx, query->address);
+        txs = (byAddress) ? byAddress->txs : NULL;
+        count = (byAddress) ? array_count(byAddress->txs) : 0;
+    }
+
+    if (query->assetName) {
+        byAsset = BRSetGet(wallet->assetTx, query->assetName);
+        if (!byAsset) count = 0;
+
+        if (byAsset && array_count(byAsset->txs) < count) {
+            txs = byAsset->txs;
+            count = array_count(byAsset->txs);
+        }
+    }
+
+    // start below both the cursor and the top of the height range
+    top = (query->toHeight < UINT32_MAX) ? (BRTxCursor) {query->toHeight + 1, 0, UINT256_ZERO} : *cursor;
+    if (_BRTxCursorCompare(cursor, &top) < 0) top = *cursor;
+    i = _BRTxHistoryLowerBound(txs, count, &top);
+
+    for (; i > 0 && n < limit; i--) {
+        tx = txs[i - 1];
+        if (tx->blockHeight < query->fromHeight) break;
+        if (tx->timestamp < query->fromTime || tx->timestamp > query->toTime) continue;
+        if (query->address && txs != byAddress->txs && !_txHasAddress(tx, query->address)) continue;
+        if (query->assetName && txs != byAsset->txs &&
+            (!tx->asset || !tx->asset->name || strcmp(tx->asset->name, query->assetName) != 0)) continue;
+        _BRWalletTxRecord(wallet, tx, &records[n++]);
+        last = tx;
+    }
+
+    if (last) *cursor = _BRTxHistoryKey(last);
+    pthread_mutex_unlock(&wallet->lock);
+    return n;
+}
+
 // total amount spent from the wallet (exluding change)
 uint64_t BRWalletTotalSent(BRWallet *wallet) {
     uint64_t totalSent;
@@ -487,6 +1095,28 @@ void BRWalletSetFeePerKb(BRWallet *wallet, uint64_t feePerKb) {
     pthread_mutex_unlock(&wallet->lock);
 }
 
+// limits the unconfirmed non-wallet transactions kept for invalid tx checks and child-pays-for-parent fees to maxBytes
+// of serialized size, and to maxAge seconds since they were relayed, the oldest are evicted first
+void BRWalletSetUnconfirmedPoolLimits(BRWallet *wallet, size_t maxBytes, uint32_t maxAge) {
+    assert(wallet != NULL);
+    pthread_mutex_lock(&wallet->lock);
+    wallet->poolMaxBytes = maxBytes;
+    wallet->poolMaxAge = maxAge;
+    _BRWalletPoolTrim(wallet, 0, time(NULL));
+    pthread_mutex_unlock(&wallet->lock);
+}
+
+// number of unconfirmed non-wallet transactions currently kept
+size_t BRWalletUnconfirmedPoolCount(BRWallet *wallet) {
+    size_t count;
+
+    assert(wallet != NULL);
+    pthread_mutex_lock(&wallet->lock);
+    count = array_count(wallet->pool);
+    pthread_mutex_unlock(&wallet->lock);
+    return count;
+}
+
 // returns the first unused external address
 BRAddress BRWalletReceiveAddress(BRWallet *wallet) {
     BRAddress addr = ADDRESS_NONE;
@@ -1235,9 +1865,9 @@ BRTransaction *BRWalletBurnRootAsset(BRWallet *wallet, BRAsset *asst) {
 }
 
 // returns an unsigned transaction that satisifes the given transaction outputs
-// result must be freed using TransactionFree()
-BRTransaction *
-BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t outCount) {
+// extraSize is the size of inputs and outputs the caller will add after coin selection, included when sizing the fee
+static BRTransaction *
+_BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t outCount, size_t extraSize) {
     BRTransaction *tx, *transaction = BRTransactionNew(1);
     uint64_t feeAmount, amount = 0, balance = 0, minAmount;
     size_t i, j, cpfpSize = 0;
@@ -1256,7 +1886,7 @@ BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t
 
     minAmount = BRWalletMinOutputAmount(wallet);
     pthread_mutex_lock(&wallet->lock);
-    feeAmount = _txFee(wallet->feePerKb, BRTransactionSize(transaction) + TX_OUTPUT_SIZE);
+    feeAmount = _txFee(wallet->feePerKb, BRTransactionSize(transaction) + TX_OUTPUT_SIZE + extraSize);
 
     for (i = 0; i < array_count(wallet->utxos); i++) {
         o = &wallet->utxos[i];
@@ -1270,7 +1900,7 @@ BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t
                               tx->outputs[o->n].script, tx->outputs[o->n].scriptLen, NULL, 0,
                               TXIN_SEQUENCE);
 
-        if (BRTransactionSize(transaction) + TX_OUTPUT_SIZE >
+        if (BRTransactionSize(transaction) + TX_OUTPUT_SIZE + extraSize >
             TX_MAX_SIZE) { // transaction size-in-bytes too large
             BRTransactionFree(transaction);
             transaction = NULL;
@@ -1278,7 +1908,7 @@ BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t
             // check for sufficient total funds before building a smaller transaction
             if (wallet->balance <
                 amount + _txFee(wallet->feePerKb, 10 + array_count(wallet->utxos) * TX_INPUT_SIZE +
-                                                  (outCount + 1) * TX_OUTPUT_SIZE + cpfpSize))
+                                                  (outCount + 1) * TX_OUTPUT_SIZE + cpfpSize + extraSize))
                 break;
             pthread_mutex_unlock(&wallet->lock);
 
@@ -1291,10 +1921,10 @@ BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t
 
                 newOutputs[outCount - 1].amount -=
                         amount + feeAmount - balance; // reduce last output amount
-                transaction = BRWalletCreateTxForOutputs(wallet, newOutputs, outCount);
+                transaction = _BRWalletCreateTxForOutputs(wallet, newOutputs, outCount, extraSize);
             } else
-                transaction = BRWalletCreateTxForOutputs(wallet, outputs,
-                                                         outCount - 1); // remove last output
+                transaction = _BRWalletCreateTxForOutputs(wallet, outputs, outCount - 1,
+                                                          extraSize); // remove last output
 
             balance = amount = feeAmount = 0;
             pthread_mutex_lock(&wallet->lock);
@@ -1305,7 +1935,7 @@ BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t
 
         // fee amount after adding a change output
         feeAmount = _txFee(wallet->feePerKb,
-                           BRTransactionSize(transaction) + TX_OUTPUT_SIZE + cpfpSize);
+                           BRTransactionSize(transaction) + TX_OUTPUT_SIZE + cpfpSize + extraSize);
 
         // increase fee to round off remaining wallet balance to nearest 100 satoshi
         if (wallet->balance > amount + feeAmount)
@@ -1332,6 +1962,121 @@ BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t
     return transaction;
 }
 
+// returns an unsigned transaction that satisifes the given transaction outputs
+// result must be freed using TransactionFree()
+BRTransaction *
+BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t outCount) {
+    return _BRWalletCreateTxForOutputs(wallet, outputs, outCount, 0);
+}
+
+// returns an unsigned transaction that issues assetCount unique assets under rootAsst in a single transaction
+// one coin selection covers the combined burn and fees, one ownership token input and TRANSFER! output prove ownership
+// and one NEW_ASSET output is added per asset, so the whole batch is signed in a single WalletSignTransaction() pass
+// Outputs order: Shuffled(Burn + change) TRANSFER! then NEW_ASSET -UNIQUE-ASSET for each asset, in the given order
+// returns NULL if funds are insufficient or the batch would exceed TX_MAX_SIZE, callers should split it and issue the
+// remainder in a following transaction
+// result must be freed by calling TransactionFree()
+BRTransaction *
+BRWalletCreateTxForUniqueAssetsCreation(BRWallet *wallet, const char *addr, BRAsset *assets, size_t assetCount,
+                                        BRAsset *rootAsst) {
+    BRTransaction *tx, *transaction = NULL;
+    BRTxOutput burn = TX_OUTPUT_NONE;
+    BRAddress address = ADDRESS_NONE;
+    BRAsset *temp;
+    UTXO *o, owner = {UINT256_ZERO, 0};
+    size_t i, addrLen, extraSize = TX_INPUT_SIZE, ownerLen, scriptLens[assetCount];
+    char ownerName[rootAsst->nameLen + OWNER_LENGTH + 1];
+
+    assert(wallet != NULL);
+    assert(addr != NULL && BRAddressIsValid(addr));
+    assert(assets != NULL && assetCount > 0);
+    assert(rootAsst != NULL);
+
+    // outputs added after coin selection, their sizes are known up front so the fee covers the whole batch
+    addrLen = BRAddressScriptPubKey(NULL, 0, addr);
+    ownerLen = BRTxOutputSetTransferOwnerAssetScriptWithoutTag(NULL, 0, rootAsst);
+    extraSize += 8 + BRVarIntSize(ownerLen) + ownerLen;
+
+    for (i = 0; i < assetCount; i++) {
+        scriptLens[i] = BRTxOutputSetNewAssetScript(NULL, 0, &assets[i]);
+        assert(scriptLens[i] >= addrLen);
+        extraSize += 8 + BRVarIntSize(scriptLens[i]) + scriptLens[i];
+    }
+
+    if (extraSize + 10 + TX_INPUT_SIZE + 2 * TX_OUTPUT_SIZE > TX_MAX_SIZE) return NULL; // batch too large
+
+    strcpy(ownerName, rootAsst->name);
+    strcat(ownerName, OWNER_TAG);
+    pthread_mutex_lock(&wallet->lock);
+
+    for (i = 0; UInt256IsZero(owner.hash) && i < array_count(wallet->utxos); i++) {
+        o = &wallet->utxos[i];
+        tx = BRSetGet(wallet->allTx, o);
+        if (!tx || o->n >= tx->outCount) continue;
+        temp = NewAsset();
+        if (GetAssetData(tx->outputs[o->n].script, tx->outputs[o->n].scriptLen, temp) && temp->name &&
+            strcmp(temp->name, ownerName) == 0) owner = *o;
+        AssetFree(temp);
+    }
+
+    pthread_mutex_unlock(&wallet->lock);
+    if (UInt256IsZero(owner.hash)) return NULL; // wallet doesn't hold the ownership token
+
+    // Add burn output, one unique asset burn per asset
+    burn.amount = IssueUniqueAssetBurnAmount * assetCount;
+#if TESTNET
+    BRTxOutputSetAddress(&burn, strIssueUniqueAssetBurnAddressTestNet);
+#elif REGTEST
+    BRTxOutputSetAddress(&burn, strIssueUniqueAssetBurnAddressRegTest);
+#else
+    BRTxOutputSetAddress(&burn, strIssueUniqueAssetBurnAddressMainNet);
+#endif
+
+    transaction = _BRWalletCreateTxForOutputs(wallet, &burn, 1, extraSize);
+    array_free(burn.script);
+    if (! transaction) return NULL;
+
+    if (BRTransactionSize(transaction) + extraSize > TX_MAX_SIZE) { // too many inputs were needed to fund the batch
+        BRTransactionFree(transaction);
+        return NULL;
+    }
+
+    // Move ownership token Input + Output
+    pthread_mutex_lock(&wallet->lock);
+    tx = BRSetGet(wallet->allTx, &owner);
+    if (tx) BRTransactionAddInput(transaction, tx->txHash, owner.n, tx->outputs[owner.n].amount,
+                                  tx->outputs[owner.n].script, tx->outputs[owner.n].scriptLen, NULL, 0,
+                                  TXIN_SEQUENCE);
+    pthread_mutex_unlock(&wallet->lock);
+
+    if (! tx) { // owner tx was removed from the wallet during coin selection
+        BRTransactionFree(transaction);
+        return NULL;
+    }
+
+    BRWalletUnusedAddrs(wallet, &address, 1, 1);
+
+    uint8_t script[ownerLen];
+
+    BRAddressScriptPubKey(script, sizeof(script), address.s);
+    BRTxOutputSetTransferOwnerAssetScriptWithoutTag(script, ownerLen, rootAsst);
+    BRTransactionAddOutput(transaction, 0, script, ownerLen);
+
+    // Add new asset outputs
+    for (i = 0; i < assetCount; i++) {
+        uint8_t assetScript[scriptLens[i]];
+
+        BRAddressScriptPubKey(assetScript, sizeof(assetScript), addr);
+        BRTxOutputSetNewAssetScript(assetScript, sizeof(assetScript), &assets[i]);
+        BRTransactionAddOutput(transaction, 0, assetScript, sizeof(assetScript));
+    }
+
+    //N.B. asset is created using an UnSafePointer that gets destroyed with thread, copying value to tx instead of pointing to it.
+    CopyAsset(&assets[0], transaction);
+
+    return transaction;
+}
+
 // signs any inputs in tx that can be signed using private keys from the wallet
 // forkId is 0 for bitcoin, 0x40 for b-cash
 // seed is the master private key (wallet seed) corresponding to the master public key given when the wallet was created
@@ -1387,8 +2132,11 @@ int BRWalletContainsTransaction(BRWallet *wallet, const BRTransaction *tx) {
     return r;
 }
 
-// adds a transaction to the wallet, or returns false if it isn't associated with the wallet
+// adds a transaction to the wallet, which takes ownership of it, or returns false if it isn't associated with the wallet,
+// in which case the caller still owns tx and must free it; if a tx with the same hash was already registered, returns
+// true but keeps the registered one, so the caller must free tx unless BRWalletTransactionForHash() returns it
 int BRWalletRegisterTransaction(BRWallet *wallet, BRTransaction *tx) {
+    BRTransaction *pooled = NULL;
     int wasAdded = 0, r = 1;
 
     assert(wallet != NULL);
@@ -1399,28 +2147,47 @@ int BRWalletRegisterTransaction(BRWallet *wallet, BRTransaction *tx) {
 
         if (!BRSetContains(wallet->allTx, tx)) {
             if (_BRWalletContainsTx(wallet, tx)) {
+                // a pooled tx becomes a wallet tx once the wallet has generated the address it pays
+                pooled = BRSetGet(wallet->poolTx, tx);
+                if (pooled) _BRWalletPoolRemove(wallet, pooled);
                 // TODO: verify signatures when possible
                 // TODO: handle tx replacement with input sequence numbers
                 //       (for now, replacements appear invalid until confirmation)
                 BRSetAdd(wallet->allTx, tx);
                 _BRWalletInsertTx(wallet, tx);
-                _BRWalletUpdateBalance(wallet);
+
+                // a tx sorted last can't change the state of those before it, and with no pending tx nothing
+                // earlier depends on the current time or block height either, so only the new tx needs applying
+                if (wallet->transactions[array_count(wallet->transactions) - 1] == tx &&
+                    BRSetCount(wallet->pendingTx) == 0) {
+                    _BRWalletApplyTx(wallet, tx, time(NULL));
+                } else _BRWalletUpdateBalance(wallet);
+
                 wasAdded = 1;
             } else { // keep track of unconfirmed non-wallet tx for invalid tx checks and child-pays-for-parent fees
-                // BUG: limit total non-wallet unconfirmed tx to avoid memory exhaustion attack
-                if (tx->blockHeight == TX_UNCONFIRMED) BRSetAdd(wallet->allTx, tx);
+                // the pool is bounded in memory and age, so relayed tx can't exhaust memory, and it keeps a copy so
+                // the caller owns tx either way
+                if (tx->blockHeight == TX_UNCONFIRMED && BRTransactionSize(tx) <= wallet->poolMaxBytes &&
+                    !BRSetContains(wallet->poolTx, tx)) {
+                    BRTransaction *copy = BRTransactionCopy(tx);
+
+                    if (! _BRWalletPoolAdd(wallet, copy, time(NULL))) BRTransactionFree(copy);
+                }
+
                 r = 0;
-                // BUG: XXX memory leak if tx is not added to wallet->allTx, and we can't just free it
             }
         }
 
         pthread_mutex_unlock(&wallet->lock);
     } else r = 0;
 
+    if (pooled) BRTransactionFree(pooled);
+
     if (wasAdded) {
         // when a wallet address is used in a transaction, generate a new address to replace it
         BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL, 0);
         BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL, 1);
+        if (wallet->txStore) _BRWalletTxStoreResult(wallet, BRTxStoreAdd(wallet->txStore, tx));
         if (wallet->balanceChanged) wallet->balanceChanged(wallet->callbackInfo, wallet->balance);
         if (wallet->txAdded) wallet->txAdded(wallet->callbackInfo, tx);
     }
@@ -1442,16 +2209,14 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash) {
     if (tx) {
         array_new(hashes, 0);
 
-        for (size_t i = array_count(wallet->transactions);
-             i > 0; i--) { // find depedent transactions
-            t = wallet->transactions[i - 1];
-            if (t->blockHeight < tx->blockHeight) break;
-            if (BRTransactionEq(tx, t)) continue;
+        for (uint32_t n = 0; n < tx->outCount; n++) { // find depedent transactions
+            UTXO o = {txHash, n};
 
-            for (size_t j = 0; j < t->inCount; j++) {
-                if (!UInt256Eq(t->inputs[j].txHash, txHash)) continue;
-                array_add(hashes, t->txHash);
-                break;
+            for (BRTxSpend *spend = BRSetGet(wallet->spenders, &o); spend; spend = spend->next) {
+                size_t i = array_count(hashes);
+
+                while (i > 0 && !UInt256Eq(hashes[i - 1], spend->tx->txHash)) i--;
+                if (i == 0) array_add(hashes, spend->tx->txHash); // a tx spending several outputs is listed once
             }
         }
 
@@ -1469,6 +2234,8 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash) {
             for (size_t i = array_count(wallet->transactions); i > 0; i--) {
                 if (!BRTransactionEq(wallet->transactions[i - 1], tx)) continue;
                 array_rm(wallet->transactions, i - 1);
+                _BRWalletRemoveSpends(wallet->spenders, tx);
+                _BRWalletUnindexTx(wallet, tx);
                 break;
             }
 
@@ -1488,6 +2255,7 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash) {
                 }
             }
 
+            if (wallet->txStore) _BRWalletTxStoreResult(wallet, BRTxStoreRemove(wallet->txStore, txHash));
             if (wallet->balanceChanged)
                 wallet->balanceChanged(wallet->callbackInfo, wallet->balance);
             if (wallet->txDeleted)
@@ -1496,6 +2264,10 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash) {
         }
 
         array_free(hashes);
+    } else if ((tx = BRSetGet(wallet->poolTx, &txHash))) {
+        _BRWalletPoolRemove(wallet, tx);
+        pthread_mutex_unlock(&wallet->lock);
+        BRTransactionFree(tx);
     } else pthread_mutex_unlock(&wallet->lock);
 }
 
@@ -1506,11 +2278,44 @@ BRTransaction *BRWalletTransactionForHash(BRWallet *wallet, UInt256 txHash) {
     assert(wallet != NULL);
     assert(!UInt256IsZero(txHash));
     pthread_mutex_lock(&wallet->lock);
-    tx = BRSetGet(wallet->allTx, &txHash);
+    tx = _BRWalletTxForHash(wallet, &txHash);
     pthread_mutex_unlock(&wallet->lock);
     return tx;
 }
 
+// writes the wallet transactions and pooled unconfirmed non-wallet transactions other than tx that spend any of the
+// same outputs as tx to conflicts, returns the number of conflicting transactions written, or conflictsCount needed if
+// conflicts is NULL
+size_t BRWalletConflictingTransactions(BRWallet *wallet, const BRTransaction *tx, BRTransaction *conflicts[],
+                                       size_t conflictsCount) {
+    BRTransaction **found;
+    size_t count;
+
+    assert(wallet != NULL);
+    assert(tx != NULL);
+    array_new(found, 1);
+    pthread_mutex_lock(&wallet->lock);
+
+    for (size_t i = 0; i < tx->inCount * 2; i++) { // wallet spenders, then pool spenders
+        BRSet *spenders = (i < tx->inCount) ? wallet->spenders : wallet->poolSpenders;
+
+        for (BRTxSpend *spend = BRSetGet(spenders, &tx->inputs[i % tx->inCount]); spend; spend = spend->next) {
+            size_t j = array_count(found);
+
+            if (BRTransactionEq(spend->tx, tx)) continue;
+            while (j > 0 && found[j - 1] != spend->tx) j--;
+            if (j == 0) array_add(found, spend->tx); // a tx conflicting on several inputs is listed once
+        }
+    }
+
+    pthread_mutex_unlock(&wallet->lock);
+    count = array_count(found);
+    if (conflicts && count > conflictsCount) count = conflictsCount;
+    if (conflicts && count > 0) memcpy(conflicts, found, count * sizeof(*found));
+    array_free(found);
+    return count;
+}
+
 // true if no previous wallet transaction spends any of the given transaction's inputs, and no inputs are invalid
 int BRWalletTransactionIsValid(BRWallet *wallet, const BRTransaction *tx) {
     BRTransaction *t;
@@ -1621,24 +2426,31 @@ void BRWalletUpdateTransactions(BRWallet *wallet, const UInt256 *txHashes, size_
     if (blockHeight > wallet->blockHeight) wallet->blockHeight = blockHeight;
 
     for (i = 0, j = 0; txHashes && i < txCount; i++) {
-        tx = BRSetGet(wallet->allTx, &txHashes[i]);
+        tx = _BRWalletTxForHash(wallet, &txHashes[i]);
         if (!tx || (tx->blockHeight == blockHeight && tx->timestamp == timestamp)) continue;
-        tx->timestamp = timestamp;
-        tx->blockHeight = blockHeight;
 
-        if (_BRWalletContainsTx(wallet, tx)) {
+        if (BRSetContains(wallet->allTx, tx)) {
+            _BRWalletUnindexTx(wallet, tx);
+            tx->timestamp = timestamp;
+            tx->blockHeight = blockHeight;
+            _BRWalletIndexTx(wallet, tx);
             hashes[j++] = txHashes[i];
-            if (BRSetContains(wallet->pendingTx, tx) ||
+            if (_BRWalletResortTx(wallet, tx) || BRSetContains(wallet->pendingTx, tx) ||
                 BRSetContains(wallet->invalidTx, tx))
                 needsUpdate = 1;
         } else if (blockHeight != TX_UNCONFIRMED) { // remove and free confirmed non-wallet tx
-            BRSetRemove(wallet->allTx, tx);
+            _BRWalletPoolRemove(wallet, tx);
             BRTransactionFree(tx);
+        } else {
+            tx->timestamp = timestamp;
+            tx->blockHeight = blockHeight;
         }
     }
 
     if (needsUpdate) _BRWalletUpdateBalance(wallet);
     pthread_mutex_unlock(&wallet->lock);
+    if (j > 0 && wallet->txStore)
+        _BRWalletTxStoreResult(wallet, BRTxStoreUpdate(wallet->txStore, hashes, j, blockHeight, timestamp));
     if (j > 0 && wallet->txUpdated)
         wallet->txUpdated(wallet->callbackInfo, hashes, j, blockHeight, timestamp);
 }
@@ -1657,12 +2469,19 @@ void BRWalletSetTxUnconfirmedAfter(BRWallet *wallet, uint32_t blockHeight) {
     UInt256 hashes[count];
 
     for (j = 0; j < count; j++) {
+        _BRWalletUnindexTx(wallet, wallet->transactions[i + j]);
         wallet->transactions[i + j]->blockHeight = TX_UNCONFIRMED;
+        _BRWalletIndexTx(wallet, wallet->transactions[i + j]);
         hashes[j] = wallet->transactions[i + j]->txHash;
     }
 
+    // the tail is now all unconfirmed, so it's re-sorted by dependency and chain order alone
+    for (j = 0; j < count; j++) _BRWalletResortTx(wallet, BRSetGet(wallet->allTx, &hashes[j]));
+
     if (count > 0) _BRWalletUpdateBalance(wallet);
     pthread_mutex_unlock(&wallet->lock);
+    if (count > 0 && wallet->txStore)
+        _BRWalletTxStoreResult(wallet, BRTxStoreUpdate(wallet->txStore, hashes, count, TX_UNCONFIRMED, 0));
     if (count > 0 && wallet->txUpdated)
         wallet->txUpdated(wallet->callbackInfo, hashes, count, TX_UNCONFIRMED, 0);
 }
@@ -1745,7 +2564,7 @@ uint64_t BRWalletFeeForTx(BRWallet *wallet, const BRTransaction *tx) {
     pthread_mutex_lock(&wallet->lock);
 
     for (size_t i = 0; tx && i < tx->inCount && amount != UINT64_MAX; i++) {
-        BRTransaction *t = BRSetGet(wallet->allTx, &tx->inputs[i].txHash);
+        BRTransaction *t = _BRWalletTxForHash(wallet, &tx->inputs[i].txHash);
         uint32_t n = tx->inputs[i].index;
 
         if (t && n < t->outCount) {
@@ -1771,9 +2590,12 @@ uint64_t BRWalletBalanceAfterTx(BRWallet *wallet, const BRTransaction *tx) {
     pthread_mutex_lock(&wallet->lock);
     balance = wallet->balance;
 
-    for (size_t i = array_count(wallet->transactions); tx && i > 0; i--) {
-        if (!BRTransactionEq(tx, wallet->transactions[i - 1])) continue;
-        balance = wallet->balanceHist[i - 1];
+    // tx are sorted by blockHeight, so only those at the same height need comparing
+    for (size_t i = (tx) ? _BRWalletTxLowerBound(wallet, tx->blockHeight) : SIZE_MAX;
+         i < array_count(wallet->transactions); i++) {
+        if (wallet->transactions[i]->blockHeight != tx->blockHeight) break;
+        if (!BRTransactionEq(tx, wallet->transactions[i])) continue;
+        balance = _BRWalletBalanceHistSum(wallet, i + 1);
         break;
     }
 
@@ -1781,6 +2603,31 @@ uint64_t BRWalletBalanceAfterTx(BRWallet *wallet, const BRTransaction *tx) {
     return balance;
 }
 
+// historical wallet balance after all transactions confirmed at or below blockHeight
+uint64_t BRWalletBalanceAtHeight(BRWallet *wallet, uint32_t blockHeight) {
+    uint64_t balance;
+
+    assert(wallet != NULL);
+    pthread_mutex_lock(&wallet->lock);
+    balance = _BRWalletBalanceAtHeight(wallet, blockHeight);
+    pthread_mutex_unlock(&wallet->lock);
+    return balance;
+}
+
+// writes the historical wallet balance at each of the given block heights to balances, for charting balance over time
+void BRWalletBalanceHistory(BRWallet *wallet, uint64_t balances[], const uint32_t blockHeights[], size_t count) {
+    assert(wallet != NULL);
+    assert(balances != NULL || count == 0);
+    assert(blockHeights != NULL || count == 0);
+    pthread_mutex_lock(&wallet->lock);
+
+    for (size_t i = 0; i < count; i++) {
+        balances[i] = _BRWalletBalanceAtHeight(wallet, blockHeights[i]);
+    }
+
+    pthread_mutex_unlock(&wallet->lock);
+}
+
 // fee that will be added for a transaction of the given size in bytes
 uint64_t BRWalletFeeForTxSize(BRWallet *wallet, size_t size) {
     uint64_t fee;
@@ -1863,14 +2710,33 @@ uint64_t BRWalletMaxOutputAmount(BRWallet *wallet) {
 void BRWalletFree(BRWallet *wallet) {
     assert(wallet != NULL);
     pthread_mutex_lock(&wallet->lock);
+    if (wallet->txStore) BRTxStoreClose(wallet->txStore);
     BRSetFree(wallet->allAddrs);
     BRSetFree(wallet->usedAddrs);
     BRSetFree(wallet->allTx);
     BRSetFree(wallet->invalidTx);
     BRSetFree(wallet->pendingTx);
     BRSetFree(wallet->spentOutputs);
+    BRSetApply(wallet->spenders, NULL, _setApplyFreeSpends);
+    BRSetFree(wallet->spenders);
+    BRSetApply(wallet->addressTx, NULL, _setApplyFreeTxIndex);
+    BRSetFree(wallet->addressTx);
+    BRSetApply(wallet->assetTx, NULL, _setApplyFreeTxIndex);
+    BRSetFree(wallet->assetTx);
+    array_free(wallet->history);
+    BRSetFree(wallet->poolTx);
+    BRSetApply(wallet->poolSpenders, NULL, _setApplyFreeSpends);
+    BRSetFree(wallet->poolSpenders);
+
+    for (size_t i = array_count(wallet->pool); i > 0; i--) {
+        BRTransactionFree(wallet->pool[i - 1].tx);
+    }
+
+    array_free(wallet->pool);
     array_free(wallet->internalChain);
     array_free(wallet->externalChain);
+    array_free(wallet->internalKeys);
+    array_free(wallet->externalKeys);
     array_free(wallet->balanceHist);
 
     for (size_t i = array_count(wallet->transactions); i > 0; i--) {
@@ -1881,7 +2747,7 @@ void BRWalletFree(BRWallet *wallet) {
     array_free(wallet->utxos);
     pthread_mutex_unlock(&wallet->lock);
     pthread_mutex_destroy(&wallet->lock);
-    free(wallet);
+    BRAllocatorFree(WALLET_ALLOCATOR, wallet, sizeof(*wallet));
 }
 
 // returns the given amount (in corbies) in local currency units (i.e. pennies, pence)
@@ -1949,6 +2815,9 @@ BRTransactionDecompose(BRWallet *wallet, const BRTransaction *tx, BRTransaction
         txDecomposed[count].inputs = inputs;
         txDecomposed[count].outputs = outputs;
         txDecomposed[count].inCount = txDecomposed[count].outCount = 0;
+        txDecomposed[count].size = 0; // recomputed on demand, tx's cached size and bytes don't apply
+        txDecomposed[count].serialized = NULL;
+        txDecomposed[count].serializedLen = 0;
 
         txDecomposed[count].asset = NULL;
 
@@ -1983,6 +2852,9 @@ BRTransactionDecompose(BRWallet *wallet, const BRTransaction *tx, BRTransaction
             txDecomposed[count].inputs = inputs;
             txDecomposed[count].outputs = outputs;
             txDecomposed[count].inCount = txDecomposed[count].outCount = 0;
+            txDecomposed[count].size = 0;
+            txDecomposed[count].serialized = NULL;
+            txDecomposed[count].serializedLen = 0;
 
             txDecomposed[count].asset = NewAsset();
 
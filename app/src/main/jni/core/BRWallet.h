@@ -34,6 +34,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include "BRSet.h"
+#include "BRTxStore.h"
 #include <pthread.h>
 
 
@@ -44,6 +45,8 @@ extern "C" {
 #define DEFAULT_FEE_PER_KB ((5000ULL*1000 + 99)/100) // ravend 0.11 min relay fee on 100bytes
 #define MIN_FEE_PER_KB     ((TX_FEE_PER_KB*1000 + 190)/191) // minimum relay fee on a 191byte tx
 #define MAX_FEE_PER_KB     ((1000100ULL*1000 + 190)/191) // slightly higher than a 10000bit fee on a 191byte tx
+#define WALLET_POOL_MAX_BYTES (1000*1000) // default cap on unconfirmed non-wallet tx kept, by serialized size
+#define WALLET_POOL_MAX_AGE   (2*24*60*60) // default seconds an unconfirmed non-wallet tx is kept
 
 typedef struct {
     UInt256 hash;
@@ -66,6 +69,28 @@ typedef struct BRWalletStructure BRWallet;
 // allocates and populates a Wallet struct that must be freed by calling WalletFree()
 BRWallet *BRWalletNew(BRTransaction **transactions, size_t txCount, BRMasterPubKey mpk);
 
+// like WalletNew(), but takes the chain keys from an address cache written by WalletAddressCache() instead of deriving
+// them, a cache that fails authentication for mpk is ignored and the keys are derived as usual
+BRWallet *BRWalletNewWithAddressCache(BRTransaction **transactions, size_t txCount, BRMasterPubKey mpk,
+                                      const uint8_t *cache, size_t cacheLen);
+
+// like WalletNewWithAddressCache(), but loads the transactions from store in one pass, and then keeps store up to date
+// with the wallet transactions, the wallet takes ownership of store and closes it in WalletFree()
+// returns NULL, leaving store open, if the stored transactions don't match mpk
+BRWallet *BRWalletNewWithTxStore(BRTxStore *store, BRMasterPubKey mpk, const uint8_t *cache, size_t cacheLen);
+
+// restores count BIP44 accounts of seed starting at firstAccount, deriving the account keys and their first gap limit
+// address windows on parallel threads, and writes a new empty wallet for each to wallets
+// pass wallets[0] to PeerManagerNew() and the others to PeerManagerAddWallet() to discover them all in one sync, each
+// wallet's address window then grows as its addresses are matched
+// each wallet must be freed by calling WalletFree()
+void BRWalletNewAccounts(BRWallet *wallets[], size_t count, const void *seed, size_t seedLen, uint32_t coinType,
+                         uint32_t firstAccount);
+
+// returns the number of leading wallets that have transactions, BIP44 account discovery stops at the first unused
+// account, so if this equals count the next batch of accounts should be restored and synced as well
+size_t BRWalletUsedAccountCount(BRWallet *wallets[], size_t count);
+
 // not thread-safe, set callbacks once after WalletNew(), before calling other Wallet functions
 // info is a void pointer that will be passed along with each callback call
 // void balanceChanged(void *, uint64_t) - called when the wallet balance changes
@@ -82,6 +107,11 @@ void BRWalletSetCallbacks(BRWallet *wallet, void *info,
                           void (*txDeleted)(void *info, UInt256 txHash, int notifyUser,
                                             int recommendRescan));
 
+// not thread-safe, set once after WalletNewWithTxStore() along with the other callbacks, info is the same as theirs
+// void txStoreError(void *, int) - called with the errno value when a change to the wallet transactions couldn't be
+//   written to the tx store, the wallet itself is up to date, but the store may reload stale tx until resynced
+void BRWalletSetTxStoreErrorCallback(BRWallet *wallet, void (*txStoreError)(void *info, int error));
+
 // wallets are composed of chains of addresses
 // each chain is traversed until a gap of a number of addresses is found that haven't been used in any transactions
 // this function writes to addrs an array of <gapLimit> unused addresses following the last used address in the chain
@@ -90,6 +120,10 @@ void BRWalletSetCallbacks(BRWallet *wallet, void *info,
 // returns the number addresses written to addrs
 size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress *addrs, uint32_t gapLimit, int internal);
 
+// writes an authenticated cache of the wallet chain keys (hash160 and compressed pubkey of each address) to cache, for
+// WalletNewWithAddressCache() to skip deriving them, returns number of bytes written, or cacheLen needed if cache is NULL
+size_t BRWalletAddressCache(BRWallet *wallet, uint8_t *cache, size_t cacheLen);
+
 // returns the first unused external address
 BRAddress BRWalletReceiveAddress(BRWallet *wallet);
 
@@ -114,6 +148,41 @@ size_t BRWalletTransactions(BRWallet *wallet, BRTransaction **transactions, size
 size_t BRWalletTxUnconfirmedBefore(BRWallet *wallet, BRTransaction **transactions, size_t txCount,
                                    uint32_t blockHeight);
 
+typedef struct {
+    const char *address; // tx with an input or output to this address, or NULL for any
+    const char *assetName; // tx carrying this asset, or NULL for any
+    uint32_t fromHeight, toHeight; // inclusive block height range, TX_UNCONFIRMED is above every confirmed height
+    uint32_t fromTime, toTime; // inclusive timestamp range
+} BRTxQuery;
+
+#define BR_TX_QUERY_ALL ((const BRTxQuery) { NULL, NULL, 0, TX_UNCONFIRMED, 0, UINT32_MAX })
+
+// position in the wallet history, newest first: by block height, then timestamp, then tx hash
+typedef struct {
+    uint32_t blockHeight;
+    uint32_t timestamp;
+    UInt256 txHash;
+} BRTxCursor;
+
+#define BR_TX_CURSOR_START ((const BRTxCursor) { UINT32_MAX, UINT32_MAX, UINT256_ZERO })
+
+typedef struct {
+    UInt256 txHash;
+    uint32_t blockHeight;
+    uint32_t timestamp;
+    uint64_t received; // as BRWalletAmountReceivedFromTx()
+    uint64_t sent; // as BRWalletAmountSentByTx()
+    uint64_t fee; // as BRWalletFeeForTx(), UINT64_MAX if unknown
+    uint64_t assetAmount; // amount of the tx asset, 0 if the tx carries none
+} BRTxRecord;
+
+// writes records of up to limit wallet transactions matching query, newest first, starting after cursor, and
+// advances cursor past the last one written, returns the number of records written, fewer than limit at the end
+// an address or asset query costs O(log n + results) from per address and per asset indexes, and a height range is
+// found by binary search, timestamps are checked on each tx within those bounds
+size_t BRWalletQueryTransactions(BRWallet *wallet, const BRTxQuery *query, BRTxCursor *cursor,
+                                 BRTxRecord records[], size_t limit);
+
 // current wallet balance, not including transactions known to be invalid
 uint64_t BRWalletBalance(BRWallet *wallet);
 
@@ -131,6 +200,13 @@ uint64_t BRWalletFeePerKb(BRWallet *wallet);
 
 void BRWalletSetFeePerKb(BRWallet *wallet, uint64_t feePerKb);
 
+// limits the unconfirmed non-wallet transactions kept for invalid tx checks and child-pays-for-parent fees to maxBytes
+// of serialized size, and to maxAge seconds since they were relayed, the oldest are evicted first
+void BRWalletSetUnconfirmedPoolLimits(BRWallet *wallet, size_t maxBytes, uint32_t maxAge);
+
+// number of unconfirmed non-wallet transactions currently kept
+size_t BRWalletUnconfirmedPoolCount(BRWallet *wallet);
+
 // returns an unsigned transaction that sends the specified amount from the wallet to the given address
 // result must be freed using TransactionFree()
 BRTransaction *BRWalletCreateTransaction(BRWallet *wallet, uint64_t amount, const char *addr);
@@ -189,6 +265,14 @@ BRWalletCreateTxForRootAssetTransferOwnership(BRWallet *wallet, uint64_t amount,
 // result must be freed by calling TransactionFree()
 BRTransaction *BRWalletBurnRootAsset(BRWallet *wallet, BRAsset *asset);
 
+// returns an unsigned transaction that issues assetCount unique assets under rootAsst, with a single coin selection
+// and one ownership token transfer shared by the whole batch
+// returns NULL if funds are insufficient or the batch would exceed TX_MAX_SIZE, in which case split the batch
+// result must be freed by calling TransactionFree()
+BRTransaction *
+BRWalletCreateTxForUniqueAssetsCreation(BRWallet *wallet, const char *addr, BRAsset *assets, size_t assetCount,
+                                        BRAsset *rootAsst);
+
 // returns an unsigned transaction that satisifes the given transaction outputs
 // result must be freed using TransactionFree()
 BRTransaction *
@@ -203,7 +287,9 @@ int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, const void *see
 // true if the given transaction is associated with the wallet (even if it hasn't been registered)
 int BRWalletContainsTransaction(BRWallet *wallet, const BRTransaction *tx);
 
-// adds a transaction to the wallet, or returns false if it isn't associated with the wallet
+// adds a transaction to the wallet, which takes ownership of it, or returns false if it isn't associated with the wallet,
+// in which case the caller still owns tx and must free it; if a tx with the same hash was already registered, returns
+// true but keeps the registered one, so the caller must free tx unless BRWalletTransactionForHash() returns it
 int BRWalletRegisterTransaction(BRWallet *wallet, BRTransaction *tx);
 
 // removes a tx from the wallet and calls TransactionFree() on it, along with any tx that depend on its outputs
@@ -212,6 +298,12 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash);
 // returns the transaction with the given hash if it's been registered in the wallet
 BRTransaction *BRWalletTransactionForHash(BRWallet *wallet, UInt256 txHash);
 
+// writes the wallet transactions and pooled unconfirmed non-wallet transactions other than tx that spend any of the
+// same outputs as tx to conflicts, returns the number of conflicting transactions written, or conflictsCount needed if
+// conflicts is NULL
+size_t BRWalletConflictingTransactions(BRWallet *wallet, const BRTransaction *tx, BRTransaction *conflicts[],
+                                       size_t conflictsCount);
+
 // true if no previous wallet transaction spends any of the given transaction's inputs, and no inputs are invalid
 int BRWalletTransactionIsValid(BRWallet *wallet, const BRTransaction *tx);
 
@@ -246,6 +338,12 @@ uint64_t BRWalletFeeForTx(BRWallet *wallet, const BRTransaction *tx);
 // historical wallet balance after the given transaction, or current balance if transaction is not registered in wallet
 uint64_t BRWalletBalanceAfterTx(BRWallet *wallet, const BRTransaction *tx);
 
+// historical wallet balance after all transactions confirmed at or below blockHeight
+uint64_t BRWalletBalanceAtHeight(BRWallet *wallet, uint32_t blockHeight);
+
+// writes the historical wallet balance at each of the given block heights to balances, for charting balance over time
+void BRWalletBalanceHistory(BRWallet *wallet, uint64_t balances[], const uint32_t blockHeights[], size_t count);
+
 // fee that will be added for a transaction of the given size in bytes
 uint64_t BRWalletFeeForTxSize(BRWallet *wallet, size_t size);
 
@@ -0,0 +1,228 @@
+//
+//  BRWorkQueue.c
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "BRWorkQueue.h"
+#include "BRArray.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <assert.h>
+
+typedef struct {
+    uint64_t id;
+    void *info;
+    void (*run)(void *info);
+    void (*done)(void *info, uint64_t jobId, int cancelled);
+    int cancelled;
+} BRWorkJob;
+
+struct BRWorkQueueStruct {
+    BRWorkJob *jobs; // queued jobs, oldest first
+    BRWorkJob **running; // jobs taken by a worker thread and not yet done
+    pthread_t *threads;
+    uint64_t lastId;
+    int stopping;
+    void *info;
+    void (*threadCleanup)(void *info);
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static void _dummyThreadCleanup(void *info) {
+}
+
+static void *_BRWorkQueueThreadRoutine(void *arg) {
+    BRWorkQueue *queue = arg;
+    BRWorkJob *job;
+    int cancelled;
+
+    pthread_cleanup_push(queue->threadCleanup, queue->info);
+    pthread_mutex_lock(&queue->lock);
+
+    while (!queue->stopping || array_count(queue->jobs) > 0) {
+        if (array_count(queue->jobs) == 0) {
+            pthread_cond_wait(&queue->cond, &queue->lock);
+            continue;
+        }
+
+        job = malloc(sizeof(*job));
+        assert(job != NULL);
+        *job = queue->jobs[0];
+        array_rm(queue->jobs, 0);
+        array_add(queue->running, job);
+        pthread_mutex_unlock(&queue->lock);
+
+        job->run(job->info);
+
+        pthread_mutex_lock(&queue->lock);
+        cancelled = job->cancelled;
+
+        for (size_t i = array_count(queue->running); i > 0; i--) {
+            if (queue->running[i - 1] != job) continue;
+            array_rm(queue->running, i - 1);
+            break;
+        }
+
+        pthread_mutex_unlock(&queue->lock);
+        if (job->done) job->done(job->info, job->id, cancelled);
+        free(job);
+        pthread_mutex_lock(&queue->lock);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    pthread_cleanup_pop(1);
+    return NULL;
+}
+
+// returns a newly allocated work queue with threadCount worker threads that must be freed by calling WorkQueueFree()
+// info is a void pointer that will be passed along with threadCleanup
+// void threadCleanup(void *) - called before a worker thread terminates to faciliate any needed cleanup
+BRWorkQueue *BRWorkQueueNew(size_t threadCount, void *info, void (*threadCleanup)(void *info)) {
+    BRWorkQueue *queue = calloc(1, sizeof(*queue));
+    pthread_t thread;
+
+    assert(queue != NULL);
+    assert(threadCount > 0);
+    array_new(queue->jobs, 10);
+    array_new(queue->running, threadCount);
+    array_new(queue->threads, threadCount);
+    queue->info = info;
+    queue->threadCleanup = (threadCleanup) ? threadCleanup : _dummyThreadCleanup;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+
+    for (size_t i = 0; i < threadCount; i++) {
+        if (pthread_create(&thread, NULL, _BRWorkQueueThreadRoutine, queue) != 0) break;
+        array_add(queue->threads, thread);
+    }
+
+    assert(array_count(queue->threads) > 0);
+    return queue;
+}
+
+// queues a job and returns its id, a worker thread calls run(jobInfo) when the job reaches the head of the queue
+// void done(void *, uint64_t, int) - called exactly once per job with the job id, after run() on the worker thread, or
+// with cancelled true and without run() on the thread that cancelled the job before it started
+// done() may be called before this returns, a caller that looks jobs up by id in done() should use WorkQueueNewId()
+uint64_t BRWorkQueueAdd(BRWorkQueue *queue, void *jobInfo, void (*run)(void *jobInfo),
+                        void (*done)(void *jobInfo, uint64_t jobId, int cancelled)) {
+    uint64_t id = BRWorkQueueNewId(queue);
+
+    BRWorkQueueAddWithId(queue, id, jobInfo, run, done);
+    return id;
+}
+
+// returns a new job id for WorkQueueAddWithId(), so the caller can record the id before the job can run and complete
+uint64_t BRWorkQueueNewId(BRWorkQueue *queue) {
+    uint64_t id;
+
+    assert(queue != NULL);
+    pthread_mutex_lock(&queue->lock);
+    id = ++queue->lastId;
+    pthread_mutex_unlock(&queue->lock);
+    return id;
+}
+
+// queues a job like WorkQueueAdd(), under jobId from WorkQueueNewId(), which must be used for only one job
+void BRWorkQueueAddWithId(BRWorkQueue *queue, uint64_t jobId, void *jobInfo, void (*run)(void *jobInfo),
+                          void (*done)(void *jobInfo, uint64_t jobId, int cancelled)) {
+    int stopping;
+
+    assert(queue != NULL);
+    assert(run != NULL);
+    pthread_mutex_lock(&queue->lock);
+    assert(jobId > 0 && jobId <= queue->lastId);
+    stopping = queue->stopping;
+    if (!stopping) array_add(queue->jobs, ((BRWorkJob) {jobId, jobInfo, run, done, 0}));
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+    if (stopping && done) done(jobInfo, jobId, 1); // added by a job finishing while the queue is freed
+}
+
+// cancels a job, a queued job is dropped and its done() called from here, a running job finishes but its done() is
+// called with cancelled true, returns false if the job had already completed, or wasn't queued yet
+int BRWorkQueueCancel(BRWorkQueue *queue, uint64_t jobId) {
+    BRWorkJob job = {0, NULL, NULL, NULL, 0};
+    int r = 0;
+
+    assert(queue != NULL);
+    pthread_mutex_lock(&queue->lock);
+
+    for (size_t i = 0; !r && i < array_count(queue->running); i++) {
+        if (queue->running[i]->id != jobId) continue;
+        queue->running[i]->cancelled = r = 1;
+    }
+
+    for (size_t i = 0; !r && i < array_count(queue->jobs); i++) {
+        if (queue->jobs[i].id != jobId) continue;
+        job = queue->jobs[i];
+        array_rm(queue->jobs, i);
+        r = 1;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    if (job.done) job.done(job.info, job.id, 1);
+    return r;
+}
+
+// number of jobs queued or running
+size_t BRWorkQueuePendingCount(BRWorkQueue *queue) {
+    size_t count;
+
+    assert(queue != NULL);
+    pthread_mutex_lock(&queue->lock);
+    count = array_count(queue->jobs) + array_count(queue->running);
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+// cancels all queued jobs, waits for running jobs to finish, and frees memory allocated for queue, must not be called
+// from a job
+void BRWorkQueueFree(BRWorkQueue *queue) {
+    BRWorkJob *jobs;
+
+    assert(queue != NULL);
+    pthread_mutex_lock(&queue->lock);
+    jobs = queue->jobs;
+    array_new(queue->jobs, 1);
+    for (size_t i = 0; i < array_count(queue->running); i++) queue->running[i]->cancelled = 1;
+    queue->stopping = 1;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+
+    for (size_t i = 0; i < array_count(jobs); i++) {
+        if (jobs[i].done) jobs[i].done(jobs[i].info, jobs[i].id, 1);
+    }
+
+    for (size_t i = 0; i < array_count(queue->threads); i++) {
+        pthread_join(queue->threads[i], NULL);
+    }
+
+    array_free(jobs);
+    array_free(queue->jobs);
+    array_free(queue->running);
+    array_free(queue->threads);
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+}
@@ -0,0 +1,76 @@
+//
+//  BRWorkQueue.h
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef BRWorkQueue_h
+#define BRWorkQueue_h
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a fixed set of worker threads running queued jobs in the order they were added, so that slow operations like key
+// derivation, signing and coin selection can be taken off the calling thread
+// this is kept apart from BRTaskPool: a job may block, on a wallet lock held by a thread waiting on a task group, or in
+// a done() callback into the JVM, which would stall a task pool worker, and its threads need a threadCleanup before
+// they exit, so jobs that are CPU bound should still split their work into BRTaskPoolShared() tasks
+typedef struct BRWorkQueueStruct BRWorkQueue;
+
+// returns a newly allocated work queue with threadCount worker threads that must be freed by calling WorkQueueFree()
+// info is a void pointer that will be passed along with threadCleanup
+// void threadCleanup(void *) - called before a worker thread terminates to faciliate any needed cleanup
+BRWorkQueue *BRWorkQueueNew(size_t threadCount, void *info, void (*threadCleanup)(void *info));
+
+// queues a job and returns its id, a worker thread calls run(jobInfo) when the job reaches the head of the queue
+// void done(void *, uint64_t, int) - called exactly once per job with the job id, after run() on the worker thread, or
+// with cancelled true and without run() on the thread that cancelled the job before it started
+// done() may be called before this returns, a caller that looks jobs up by id in done() should use WorkQueueNewId()
+uint64_t BRWorkQueueAdd(BRWorkQueue *queue, void *jobInfo, void (*run)(void *jobInfo),
+                        void (*done)(void *jobInfo, uint64_t jobId, int cancelled));
+
+// returns a new job id for WorkQueueAddWithId(), so the caller can record the id before the job can run and complete
+uint64_t BRWorkQueueNewId(BRWorkQueue *queue);
+
+// queues a job like WorkQueueAdd(), under jobId from WorkQueueNewId(), which must be used for only one job
+void BRWorkQueueAddWithId(BRWorkQueue *queue, uint64_t jobId, void *jobInfo, void (*run)(void *jobInfo),
+                          void (*done)(void *jobInfo, uint64_t jobId, int cancelled));
+
+// cancels a job, a queued job is dropped and its done() called from here, a running job finishes but its done() is
+// called with cancelled true, returns false if the job had already completed, or wasn't queued yet
+int BRWorkQueueCancel(BRWorkQueue *queue, uint64_t jobId);
+
+// number of jobs queued or running
+size_t BRWorkQueuePendingCount(BRWorkQueue *queue);
+
+// cancels all queued jobs, waits for running jobs to finish, and frees memory allocated for queue, must not be called
+// from a job
+void BRWorkQueueFree(BRWorkQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRWorkQueue_h
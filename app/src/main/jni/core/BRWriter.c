@@ -0,0 +1,132 @@
+//
+//  BRWriter.c
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "BRWriter.h"
+#include "BRAddress.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// initializes writer with room for capacity bytes, call WriterFree() when done
+void BRWriterInit(BRWriter *writer, size_t capacity)
+{
+    assert(writer != NULL);
+    writer->len = 0;
+    writer->capacity = capacity;
+    writer->data = (capacity > 0) ? malloc(capacity) : NULL;
+    assert(writer->data != NULL || capacity == 0);
+}
+
+// discards written bytes but keeps the allocation for reuse
+void BRWriterReset(BRWriter *writer)
+{
+    assert(writer != NULL);
+    writer->len = 0;
+}
+
+// appends len uninitialized bytes and returns a pointer to them, valid until the next writer call
+uint8_t *BRWriterReserve(BRWriter *writer, size_t len)
+{
+    uint8_t *p;
+
+    assert(writer != NULL);
+
+    if (writer->len + len > writer->capacity) {
+        size_t capacity = (writer->capacity > 0) ? writer->capacity : 64;
+
+        while (capacity < writer->len + len) capacity *= 2;
+        writer->data = realloc(writer->data, capacity);
+        assert(writer->data != NULL);
+        writer->capacity = capacity;
+    }
+
+    p = &writer->data[writer->len];
+    writer->len += len;
+    return p;
+}
+
+// appends len bytes from data
+void BRWriterAppend(BRWriter *writer, const void *data, size_t len)
+{
+    assert(data != NULL || len == 0);
+    if (len > 0) memcpy(BRWriterReserve(writer, len), data, len);
+}
+
+void BRWriterUInt8(BRWriter *writer, uint8_t u)
+{
+    *BRWriterReserve(writer, sizeof(uint8_t)) = u;
+}
+
+void BRWriterUInt32LE(BRWriter *writer, uint32_t u)
+{
+    UInt32SetLE(BRWriterReserve(writer, sizeof(uint32_t)), u);
+}
+
+void BRWriterUInt64LE(BRWriter *writer, uint64_t u)
+{
+    UInt64SetLE(BRWriterReserve(writer, sizeof(uint64_t)), u);
+}
+
+void BRWriterUInt256(BRWriter *writer, UInt256 u)
+{
+    UInt256Set(BRWriterReserve(writer, sizeof(UInt256)), u);
+}
+
+void BRWriterVarInt(BRWriter *writer, uint64_t i)
+{
+    size_t len = BRVarIntSize(i);
+
+    BRVarIntSet(BRWriterReserve(writer, len), len, i);
+}
+
+// serializes tx into writer in a single pass, returns number of bytes appended
+size_t BRWriterTransaction(BRWriter *writer, const BRTransaction *tx)
+{
+    size_t len = BRTransactionSerializedSize(tx);
+
+    return BRTransactionSerialize(tx, BRWriterReserve(writer, len), len);
+}
+
+// serializes block into writer in a single pass, returns number of bytes appended
+size_t BRWriterMerkleBlock(BRWriter *writer, const BRMerkleBlock *block)
+{
+    size_t len = BRMerkleBlockSerializedSize(block);
+
+    return BRMerkleBlockSerialize(block, BRWriterReserve(writer, len), len);
+}
+
+// serializes filter into writer in a single pass, returns number of bytes appended
+size_t BRWriterBloomFilter(BRWriter *writer, const BRBloomFilter *filter)
+{
+    size_t len = BRBloomFilterSerializedSize(filter);
+
+    return BRBloomFilterSerialize(filter, BRWriterReserve(writer, len), len);
+}
+
+// frees memory allocated for writer data
+void BRWriterFree(BRWriter *writer)
+{
+    assert(writer != NULL);
+    if (writer->data) free(writer->data);
+    *writer = BR_WRITER_NONE;
+}
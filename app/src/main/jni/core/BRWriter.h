@@ -0,0 +1,78 @@
+//
+//  BRWriter.h
+//
+//  Copyright (c) 2026 The Raven Core developers
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef BRWriter_h
+#define BRWriter_h
+
+#include "BRInt.h"
+#include "BRTransaction.h"
+#include "BRMerkleBlock.h"
+#include "BRBloomFilter.h"
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a growable byte sink for building wire messages without sizing them twice or placing them in stack VLAs
+// a writer can be reset and reused, keeping its allocation, so repeated serialization doesn't hit the allocator
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+} BRWriter;
+
+#define BR_WRITER_NONE ((const BRWriter) { NULL, 0, 0 })
+
+// initializes writer with room for capacity bytes, call WriterFree() when done
+void BRWriterInit(BRWriter *writer, size_t capacity);
+
+// discards written bytes but keeps the allocation for reuse
+void BRWriterReset(BRWriter *writer);
+
+// appends len uninitialized bytes and returns a pointer to them, valid until the next writer call
+uint8_t *BRWriterReserve(BRWriter *writer, size_t len);
+
+// appends len bytes from data
+void BRWriterAppend(BRWriter *writer, const void *data, size_t len);
+
+void BRWriterUInt8(BRWriter *writer, uint8_t u);
+void BRWriterUInt32LE(BRWriter *writer, uint32_t u);
+void BRWriterUInt64LE(BRWriter *writer, uint64_t u);
+void BRWriterUInt256(BRWriter *writer, UInt256 u);
+void BRWriterVarInt(BRWriter *writer, uint64_t i);
+
+// serializes tx, block or filter into writer in a single pass, returns number of bytes appended
+size_t BRWriterTransaction(BRWriter *writer, const BRTransaction *tx);
+size_t BRWriterMerkleBlock(BRWriter *writer, const BRMerkleBlock *block);
+size_t BRWriterBloomFilter(BRWriter *writer, const BRBloomFilter *filter);
+
+// frees memory allocated for writer data
+void BRWriterFree(BRWriter *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRWriter_h
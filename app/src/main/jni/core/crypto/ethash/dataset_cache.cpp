@@ -0,0 +1,210 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// A bounded cache of the 2048-bit dataset items ProgPoW light verification computes from the light cache.
+
+#include "ethash-internal.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr size_t default_capacity = 16 * 1024 * 1024;
+
+/// Each shard is an independent LRU with its own lock, so verifier threads only contend when
+/// their items hash to the same shard.
+constexpr size_t num_shards = 16;
+
+struct entry
+{
+    uint64_t key;
+    ethash_hash2048 item;
+};
+
+/// The bytes an entry costs, counting the list node and the map node that point at it.
+constexpr size_t entry_cost = sizeof(entry) + 4 * sizeof(void*) + sizeof(uint64_t) + 2 * sizeof(void*);
+
+inline uint64_t make_key(int epoch_number, uint32_t index) noexcept
+{
+    return (uint64_t(uint32_t(epoch_number)) << 32) | index;
+}
+
+class shard
+{
+public:
+    bool get(uint64_t key, ethash_hash2048& item)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        const auto it = map_.find(key);
+
+        if (it == map_.end())
+            return false;
+
+        lru_.splice(lru_.begin(), lru_, it->second);
+        item = it->second->item;
+        return true;
+    }
+
+    void put(uint64_t key, const ethash_hash2048& item, size_t max_entries)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        if (max_entries == 0 || map_.count(key) != 0)
+            return;
+
+        while (map_.size() >= max_entries)
+            evict();
+
+        // Out of memory only costs the item its cache slot.
+        try
+        {
+            lru_.push_front(entry{key, item});
+        }
+        catch (...)
+        {
+            return;
+        }
+        try
+        {
+            map_.emplace(key, lru_.begin());
+        }
+        catch (...)
+        {
+            lru_.pop_front();
+        }
+    }
+
+    void trim(size_t max_entries)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        while (map_.size() > max_entries)
+            evict();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return map_.size();
+    }
+
+private:
+    void evict()
+    {
+        map_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+
+    std::mutex mutex_;
+    std::list<entry> lru_;
+    std::unordered_map<uint64_t, std::list<entry>::iterator> map_;
+};
+
+shard shards[num_shards];
+std::atomic<size_t> capacity{default_capacity};
+std::atomic<uint64_t> hits{0};
+std::atomic<uint64_t> misses{0};
+
+inline shard& shard_of(uint64_t key) noexcept
+{
+    // Fibonacci hashing, so that neighbouring indexes land in different shards.
+    return shards[(key * 0x9E3779B97F4A7C15) >> 60];
+}
+
+inline size_t shard_max_entries() noexcept
+{
+    return capacity.load(std::memory_order_relaxed) / entry_cost / num_shards;
+}
+}  // namespace
+
+ethash_hash2048 lookup_dataset_item_2048(const ethash_epoch_context& context, uint32_t index) noexcept
+{
+    const uint64_t key = make_key(context.epoch_number, index);
+    shard& s = shard_of(key);
+    ethash_hash2048 item;
+
+    if (s.get(key, item))
+    {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return item;
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    item = calculate_dataset_item_2048(context, index);
+    s.put(key, item, shard_max_entries());
+    return item;
+}
+
+extern "C" {
+
+void ethash_dataset_cache_set_capacity(size_t bytes) noexcept
+{
+    capacity.store(bytes, std::memory_order_relaxed);
+
+    const size_t max_entries = shard_max_entries();
+    for (shard& s : shards)
+        s.trim(max_entries);
+}
+
+struct ethash_dataset_cache_stats ethash_dataset_cache_get_stats(void) noexcept
+{
+    ethash_dataset_cache_stats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.num_items = 0;
+    for (shard& s : shards)
+        stats.num_items += s.size();
+    stats.capacity = capacity.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ethash_dataset_cache_precompute(const struct ethash_epoch_context* context, uint32_t first_index,
+    uint32_t num_items, unsigned num_threads) noexcept
+{
+    const uint32_t end = static_cast<uint32_t>(std::min<uint64_t>(
+        uint64_t(first_index) + num_items, uint64_t(context->full_dataset_num_items / 2)));
+    const size_t max_entries = shard_max_entries();
+
+    if (first_index >= end || max_entries == 0)
+        return;
+
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Workers take the next index from a shared counter, so the range is covered however many of
+    // them could be started.
+    std::atomic<uint32_t> next{first_index};
+    const auto work = [&] {
+        for (uint32_t i = next++; i < end; i = next++)
+        {
+            const uint64_t key = make_key(context->epoch_number, i);
+            shard_of(key).put(key, calculate_dataset_item_2048(*context, i), max_entries);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    try
+    {
+        for (unsigned t = 1; t < num_threads; ++t)
+            workers.emplace_back(work);
+    }
+    catch (...)
+    {
+        // Out of threads, the calling thread and the workers already started finish the range.
+    }
+
+    work();
+    for (std::thread& w : workers)
+        w.join();
+}
+
+}  // extern "C"
@@ -14,3 +14,13 @@
 
 #include <memory>
 #include <vector>
+
+void build_light_cache(ethash_hash512 cache[], int num_items, const ethash_hash256& seed) noexcept;
+
+ethash_hash1024 calculate_dataset_item_1024(const ethash_epoch_context& context, uint32_t index) noexcept;
+
+/// Calculates the 2048-bit dataset item ProgPoW reads per round, made of 4 consecutive 512-bit items.
+ethash_hash2048 calculate_dataset_item_2048(const ethash_epoch_context& context, uint32_t index) noexcept;
+
+/// Returns the 2048-bit dataset item from the shared item cache, computing and caching it on a miss.
+ethash_hash2048 lookup_dataset_item_2048(const ethash_epoch_context& context, uint32_t index) noexcept;
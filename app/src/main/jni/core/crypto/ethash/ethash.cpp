@@ -15,6 +15,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <new>
 
 // Internal constants:
 constexpr static int light_cache_init_size = 1 << 24;
@@ -47,3 +48,185 @@ inline ethash_hash512 bitwise_xor(const ethash_hash512& x, const ethash_hash512&
     return z;
 }
 
+
+int ethash_calculate_light_cache_num_items(int epoch_number) noexcept
+{
+    static constexpr int item_size = sizeof(ethash_hash512);
+    static constexpr int num_items_init = light_cache_init_size / item_size;
+    static constexpr int num_items_growth = light_cache_growth / item_size;
+    static_assert(
+        light_cache_init_size % item_size == 0, "light_cache_init_size not multiple of item size");
+    static_assert(
+        light_cache_growth % item_size == 0, "light_cache_growth not multiple of item size");
+
+    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
+    int num_items = ethash_find_largest_prime(num_items_upper_bound);
+    return num_items;
+}
+
+int ethash_calculate_full_dataset_num_items(int epoch_number) noexcept
+{
+    static constexpr int item_size = sizeof(ethash_hash1024);
+    static constexpr int num_items_init = full_dataset_init_size / item_size;
+    static constexpr int num_items_growth = full_dataset_growth / item_size;
+    static_assert(full_dataset_init_size % item_size == 0,
+        "full_dataset_init_size not multiple of item size");
+    static_assert(
+        full_dataset_growth % item_size == 0, "full_dataset_growth not multiple of item size");
+
+    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
+    int num_items = ethash_find_largest_prime(num_items_upper_bound);
+    return num_items;
+}
+
+ethash_hash256 ethash_calculate_epoch_seed(int epoch_number) noexcept
+{
+    ethash_hash256 epoch_seed = {};
+    for (int i = 0; i < epoch_number; ++i)
+        epoch_seed = ethash::keccak256(epoch_seed);
+    return epoch_seed;
+}
+
+void build_light_cache(ethash_hash512 cache[], int num_items, const ethash_hash256& seed) noexcept
+{
+    ethash_hash512 item = ethash::keccak512(seed.bytes, sizeof(seed));
+    cache[0] = item;
+    for (int i = 1; i < num_items; ++i)
+    {
+        item = ethash::keccak512(item);
+        cache[i] = item;
+    }
+
+    for (int q = 0; q < light_cache_rounds; ++q)
+    {
+        for (int i = 0; i < num_items; ++i)
+        {
+            const uint32_t index_limit = static_cast<uint32_t>(num_items);
+
+            // Fist index: 4 first bytes of the item as little-endian integer.
+            const uint32_t t = le::uint32(cache[i].word32s[0]);
+            const uint32_t v = t % index_limit;
+
+            // Second index.
+            const uint32_t w = static_cast<uint32_t>(num_items + (i - 1)) % index_limit;
+
+            const ethash_hash512 x = bitwise_xor(cache[v], cache[w]);
+            cache[i] = ethash::keccak512(x);
+        }
+    }
+}
+
+namespace
+{
+struct item_state
+{
+    const ethash_hash512* const cache;
+    const int64_t num_cache_items;
+    const uint32_t seed;
+
+    ethash_hash512 mix;
+
+    ALWAYS_INLINE item_state(const ethash_epoch_context& context, int64_t index) noexcept
+      : cache{context.light_cache},
+        num_cache_items{context.light_cache_num_items},
+        seed{static_cast<uint32_t>(index)}
+    {
+        mix = cache[index % num_cache_items];
+        mix.word32s[0] ^= le::uint32(seed);
+        mix = le::uint32s(ethash::keccak512(mix));
+    }
+
+    ALWAYS_INLINE void update(uint32_t round) noexcept
+    {
+        static constexpr size_t num_words = sizeof(mix) / sizeof(uint32_t);
+        const uint32_t t = fnv1(seed ^ round, mix.word32s[round % num_words]);
+        const int64_t parent_index = t % num_cache_items;
+        mix = fnv1(mix, le::uint32s(cache[parent_index]));
+    }
+
+    ALWAYS_INLINE ethash_hash512 final() noexcept { return ethash::keccak512(le::uint32s(mix)); }
+};
+}  // namespace
+
+ethash_hash1024 calculate_dataset_item_1024(const ethash_epoch_context& context, uint32_t index) noexcept
+{
+    item_state item0{context, int64_t(index) * 2};
+    item_state item1{context, int64_t(index) * 2 + 1};
+
+    for (uint32_t j = 0; j < full_dataset_item_parents; ++j)
+    {
+        item0.update(j);
+        item1.update(j);
+    }
+
+    ethash_hash1024 item;
+    item.hash512s[0] = item0.final();
+    item.hash512s[1] = item1.final();
+    return item;
+}
+
+ethash_hash2048 calculate_dataset_item_2048(const ethash_epoch_context& context, uint32_t index) noexcept
+{
+    item_state item0{context, int64_t(index) * 4};
+    item_state item1{context, int64_t(index) * 4 + 1};
+    item_state item2{context, int64_t(index) * 4 + 2};
+    item_state item3{context, int64_t(index) * 4 + 3};
+
+    for (uint32_t j = 0; j < full_dataset_item_parents; ++j)
+    {
+        item0.update(j);
+        item1.update(j);
+        item2.update(j);
+        item3.update(j);
+    }
+
+    ethash_hash2048 item;
+    item.hash512s[0] = item0.final();
+    item.hash512s[1] = item1.final();
+    item.hash512s[2] = item2.final();
+    item.hash512s[3] = item3.final();
+    return item;
+}
+
+ethash_epoch_context* ethash_create_epoch_context(int epoch_number) noexcept
+{
+    static_assert(sizeof(ethash_epoch_context) < sizeof(ethash_hash512), "ethash_epoch_context too big");
+    static constexpr size_t context_alloc_size = sizeof(ethash_hash512);
+
+    const int light_cache_num_items = ethash_calculate_light_cache_num_items(epoch_number);
+    const int full_dataset_num_items = ethash_calculate_full_dataset_num_items(epoch_number);
+    const size_t light_cache_size = size_t(light_cache_num_items) * sizeof(ethash_hash512);
+    const size_t alloc_size = context_alloc_size + light_cache_size + l1_cache_size;
+
+    char* const alloc_data = static_cast<char*>(std::calloc(1, alloc_size));
+    if (!alloc_data)
+        return nullptr;  // Signal out-of-memory by returning null pointer.
+
+    ethash_hash512* const light_cache = reinterpret_cast<ethash_hash512*>(alloc_data + context_alloc_size);
+    const ethash_hash256 epoch_seed = ethash_calculate_epoch_seed(epoch_number);
+    build_light_cache(light_cache, light_cache_num_items, epoch_seed);
+
+    uint32_t* const l1_cache =
+        reinterpret_cast<uint32_t*>(alloc_data + context_alloc_size + light_cache_size);
+
+    ethash_epoch_context* const context = new (alloc_data) ethash_epoch_context{
+        epoch_number,
+        light_cache_num_items,
+        light_cache,
+        l1_cache,
+        full_dataset_num_items,
+    };
+
+    // The ProgPoW L1 cache is the start of the full dataset, computed once per epoch.
+    ethash_hash2048* const l1_items = reinterpret_cast<ethash_hash2048*>(l1_cache);
+    for (uint32_t i = 0; i < l1_cache_size / sizeof(l1_items[0]); ++i)
+        l1_items[i] = calculate_dataset_item_2048(*context, i);
+
+    return context;
+}
+
+void ethash_destroy_epoch_context(ethash_epoch_context* context) noexcept
+{
+    context->~ethash_epoch_context();
+    std::free(context);
+}
@@ -8,6 +8,7 @@
 #include "hash_types.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -115,6 +116,34 @@ const struct ethash_epoch_context_full* ethash_get_global_epoch_context_full(
     int epoch_number) NOEXCEPT;
 
 
+struct ethash_dataset_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    size_t num_items;
+    size_t capacity;
+};
+
+/**
+ * Sets the memory cap of the shared cache of 2048-bit dataset items that light ProgPoW
+ * verification computes, 16 MB by default. Items over the new cap are evicted, 0 disables the cache.
+ */
+void ethash_dataset_cache_set_capacity(size_t bytes) NOEXCEPT;
+
+/**
+ * Returns the dataset item cache hit and miss counts since start and its current size.
+ */
+struct ethash_dataset_cache_stats ethash_dataset_cache_get_stats(void) NOEXCEPT;
+
+/**
+ * Computes the 2048-bit dataset items [first_index, first_index + num_items) of the context's
+ * epoch into the cache with num_threads workers, or one per core if num_threads is 0.
+ * Blocks until done. Items beyond the cache capacity evict the least recently used ones.
+ */
+void ethash_dataset_cache_precompute(const struct ethash_epoch_context* context, uint32_t first_index,
+    uint32_t num_items, unsigned num_threads) NOEXCEPT;
+
+
 struct ethash_result ethash_hash(const struct ethash_epoch_context* context,
     const union ethash_hash256* header_hash, uint64_t nonce) NOEXCEPT;
 
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <mutex>
+#include <utility>
 
 #if !defined(__has_cpp_attribute)
 #define __has_cpp_attribute(x) 0
@@ -17,4 +18,46 @@
 #define ATTRIBUTE_NOINLINE __declspec(noinline)
 #else
 #define ATTRIBUTE_NOINLINE
-#endif
\ No newline at end of file
+#endif
+namespace
+{
+using epoch_context_ptr =
+    std::unique_ptr<ethash_epoch_context, decltype(&ethash_destroy_epoch_context)>;
+
+std::mutex shared_context_mutex;
+std::shared_ptr<ethash_epoch_context> shared_context;
+thread_local std::shared_ptr<ethash_epoch_context> thread_local_context;
+
+ATTRIBUTE_NOINLINE
+void update_local_context(int epoch_number)
+{
+    // Release the shared pointer of the obsoleted context.
+    thread_local_context.reset();
+
+    // Local context invalid, check the shared context.
+    std::lock_guard<std::mutex> lock{shared_context_mutex};
+
+    if (!shared_context || shared_context->epoch_number != epoch_number)
+    {
+        // Release the shared pointer of the obsoleted context.
+        shared_context.reset();
+
+        // Build new context.
+        epoch_context_ptr context{ethash_create_epoch_context(epoch_number),
+            ethash_destroy_epoch_context};
+        if (context)
+            shared_context = std::move(context);
+    }
+
+    thread_local_context = shared_context;
+}
+}  // namespace
+
+const ethash_epoch_context* ethash_get_global_epoch_context(int epoch_number) noexcept
+{
+    // Check if local context matches epoch number.
+    if (!thread_local_context || thread_local_context->epoch_number != epoch_number)
+        update_local_context(epoch_number);
+
+    return thread_local_context.get();
+}
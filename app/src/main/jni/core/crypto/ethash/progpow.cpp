@@ -15,6 +15,9 @@
 #include <array>
 #include <iostream>
 #include <climits>
+#include <cstring>
+#include <mutex>
+#include <utility>
 
 
 /// A variant of Keccak hash function for ProgPoW.
@@ -56,6 +59,278 @@ inline void keccak_progpow_64(uint32_t* st) noexcept
             0x00000057, //W
     };
 
+namespace
+{
+/// A merge of `src` into register `dst`, with the merge selector decoded ahead of time.
+struct merge_op
+{
+    uint8_t dst;
+    uint8_t src;
+    uint8_t merge;  ///< sel % 4
+    uint8_t rot;    ///< (sel >> 16) % 31 + 1
+};
+
+/// A random math op on two registers, merged into a third.
+struct math_op
+{
+    uint8_t src1;
+    uint8_t src2;
+    uint8_t math;  ///< sel1 % 11
+    merge_op merge;
+};
+
+/// The random program of a ProgPoW period, generated by kiss99 from the period number.
+///
+/// Every round of every hash in a period runs the same program, so it is compiled once into
+/// register indexes and pre-decoded selectors, and the rounds only dispatch on small op codes.
+struct mix_program
+{
+    uint64_t period;
+    merge_op cache_ops[num_cache_accesses];
+    math_op math_ops[num_math_operations];
+    merge_op dag_ops[num_dag_words_per_lane];
+};
+
+inline merge_op compile_merge(uint32_t dst, uint32_t src, uint32_t sel) noexcept
+{
+    return {static_cast<uint8_t>(dst), static_cast<uint8_t>(src), static_cast<uint8_t>(sel % 4),
+        static_cast<uint8_t>((sel >> 16) % 31 + 1)};
+}
+
+void generate_program(mix_program& prog, uint64_t period) noexcept
+{
+    const uint32_t seed_lo = static_cast<uint32_t>(period);
+    const uint32_t seed_hi = static_cast<uint32_t>(period >> 32);
+
+    const uint32_t z = fnv1a(fnv_offset_basis, seed_lo);
+    const uint32_t w = fnv1a(z, seed_hi);
+    const uint32_t jsr = fnv1a(w, seed_lo);
+    const uint32_t jcong = fnv1a(jsr, seed_hi);
+    kiss99 rng{z, w, jsr, jcong};
+
+    // Random permutations of mix destinations / sources, using Fisher-Yates shuffle.
+    uint32_t dst_seq[num_regs], src_seq[num_regs];
+    size_t dst_counter = 0, src_counter = 0;
+
+    for (uint32_t i = 0; i < num_regs; ++i)
+    {
+        dst_seq[i] = i;
+        src_seq[i] = i;
+    }
+
+    for (uint32_t i = num_regs; i > 1; --i)
+    {
+        std::swap(dst_seq[i - 1], dst_seq[rng() % i]);
+        std::swap(src_seq[i - 1], src_seq[rng() % i]);
+    }
+
+    constexpr int max_operations =
+        num_cache_accesses > num_math_operations ? num_cache_accesses : num_math_operations;
+
+    prog.period = period;
+
+    for (int i = 0; i < max_operations; ++i)
+    {
+        if (i < num_cache_accesses)
+        {
+            const uint32_t src = src_seq[(src_counter++) % num_regs];
+            const uint32_t dst = dst_seq[(dst_counter++) % num_regs];
+            prog.cache_ops[i] = compile_merge(dst, src, rng());
+        }
+        if (i < num_math_operations)
+        {
+            // Generate 2 unique source indexes.
+            const uint32_t src_rnd = rng() % (num_regs * (num_regs - 1));
+            const uint32_t src1 = src_rnd % num_regs;  // O <= src1 < num_regs
+            uint32_t src2 = src_rnd / num_regs;        // 0 <= src2 < num_regs - 1
+            if (src2 >= src1)
+                ++src2;  // src2 is now any reg other than src1
+
+            math_op& op = prog.math_ops[i];
+            op.src1 = static_cast<uint8_t>(src1);
+            op.src2 = static_cast<uint8_t>(src2);
+            op.math = static_cast<uint8_t>(rng() % 11);
+            const uint32_t dst = dst_seq[(dst_counter++) % num_regs];
+            op.merge = compile_merge(dst, 0, rng());
+        }
+    }
+
+    for (size_t i = 0; i < num_dag_words_per_lane; ++i)
+    {
+        const uint32_t dst = i == 0 ? 0 : dst_seq[(dst_counter++) % num_regs];
+        prog.dag_ops[i] = compile_merge(dst, 0, rng());
+    }
+}
+
+/// Compiled programs of the most recently hashed periods.
+///
+/// Headers are verified in height order, so the up to 2000 headers of a headers message walk
+/// through their periods one after another and each program is generated once for the whole
+/// batch. A few entries are kept so that interleaved callers don't evict each other.
+class program_cache
+{
+public:
+    void get(mix_program& prog, uint64_t period)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        size_t lru = 0;
+
+        for (size_t i = 0; i < cache_size; ++i)
+        {
+            if (used_[i] != 0 && programs_[i].period == period)
+            {
+                used_[i] = ++tick_;
+                prog = programs_[i];
+                return;
+            }
+            if (used_[i] < used_[lru])
+                lru = i;
+        }
+
+        generate_program(programs_[lru], period);
+        used_[lru] = ++tick_;
+        prog = programs_[lru];
+    }
+
+private:
+    static constexpr size_t cache_size = 4;
+
+    std::mutex mutex_;
+    mix_program programs_[cache_size];
+    uint64_t used_[cache_size] = {};  ///< Tick of the last use, 0 for an empty slot.
+    uint64_t tick_ = 0;
+};
+
+program_cache programs;
+
+/// The mix state, laid out structure-of-arrays: mix[r][l] is register r of lane l.
+///
+/// The 16 lanes of a register are contiguous, and each operation picks its registers and selector
+/// once for all lanes, so every step below is a branch-free loop over 16 words that the compiler
+/// turns into AVX2 or NEON vector instructions.
+typedef uint32_t lane_words[num_lanes];
+typedef lane_words mix_array[num_regs];
+
+#define FOR_LANES for (size_t l = 0; l < num_lanes; ++l)
+
+NO_SANITIZE("unsigned-integer-overflow")
+inline void random_math(lane_words& d, const lane_words& a, const lane_words& b, uint32_t math) noexcept
+{
+    switch (math)
+    {
+    default:
+    case 0: FOR_LANES d[l] = a[l] + b[l]; break;
+    case 1: FOR_LANES d[l] = a[l] * b[l]; break;
+    case 2: FOR_LANES d[l] = static_cast<uint32_t>((uint64_t(a[l]) * uint64_t(b[l])) >> 32); break;
+    case 3: FOR_LANES d[l] = a[l] < b[l] ? a[l] : b[l]; break;
+    case 4: FOR_LANES d[l] = (a[l] << (b[l] & 31)) | (a[l] >> ((32 - (b[l] & 31)) & 31)); break;
+    case 5: FOR_LANES d[l] = (a[l] >> (b[l] & 31)) | (a[l] << ((32 - (b[l] & 31)) & 31)); break;
+    case 6: FOR_LANES d[l] = a[l] & b[l]; break;
+    case 7: FOR_LANES d[l] = a[l] | b[l]; break;
+    case 8: FOR_LANES d[l] = a[l] ^ b[l]; break;
+    case 9: FOR_LANES d[l] = clz32(a[l]) + clz32(b[l]); break;
+    case 10: FOR_LANES d[l] = popcount32(a[l]) + popcount32(b[l]); break;
+    }
+}
+
+/// Merge data from `b` into `a` across all lanes.
+/// Assuming `a` has high entropy, only do ops that retain entropy even if `b`
+/// has low entropy (i.e. do not do `a & b`).
+NO_SANITIZE("unsigned-integer-overflow")
+inline void random_merge(lane_words& a, const lane_words& b, const merge_op& op) noexcept
+{
+    const uint32_t x = op.rot;  // Additional non-zero selector from higher bits.
+
+    switch (op.merge)
+    {
+    case 0: FOR_LANES a[l] = (a[l] * 33) + b[l]; break;
+    case 1: FOR_LANES a[l] = (a[l] ^ b[l]) * 33; break;
+    case 2: FOR_LANES a[l] = ((a[l] << x) | (a[l] >> (32 - x))) ^ b[l]; break;
+    case 3: FOR_LANES a[l] = ((a[l] >> x) | (a[l] << (32 - x))) ^ b[l]; break;
+    }
+}
+
+void init_mix(mix_array& mix, const uint32_t seed[2]) noexcept
+{
+    const uint32_t z = fnv1a(fnv_offset_basis, seed[0]);
+    const uint32_t w = fnv1a(z, seed[1]);
+
+    for (uint32_t l = 0; l < num_lanes; ++l)
+    {
+        const uint32_t jsr = fnv1a(w, l);
+        const uint32_t jcong = fnv1a(jsr, l);
+        kiss99 rng{z, w, jsr, jcong};
+
+        for (uint32_t i = 0; i < num_regs; ++i)
+            mix[i][l] = rng();
+    }
+}
+
+void round(const ethash_epoch_context& context, uint32_t r, mix_array& mix, const mix_program& prog)
+{
+    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
+    const uint32_t item_index = mix[0][r % num_lanes] % num_items;
+    const ethash_hash2048 item = lookup_dataset_item_2048(context, item_index);
+    alignas(64) lane_words data;
+
+    constexpr int max_operations =
+        num_cache_accesses > num_math_operations ? num_cache_accesses : num_math_operations;
+
+    for (int i = 0; i < max_operations; ++i)
+    {
+        if (i < num_cache_accesses)  // Random access to cached memory.
+        {
+            const merge_op& op = prog.cache_ops[i];
+            const lane_words& src = mix[op.src];
+            FOR_LANES data[l] = le::uint32(context.l1_cache[src[l] % l1_cache_num_items]);
+            random_merge(mix[op.dst], data, op);
+        }
+        if (i < num_math_operations)  // Random math.
+        {
+            const math_op& op = prog.math_ops[i];
+            random_math(data, mix[op.src1], mix[op.src2], op.math);
+            random_merge(mix[op.merge.dst], data, op.merge);
+        }
+    }
+
+    // DAG access, lane l reads the words at ((l ^ r) % num_lanes) of the item.
+    for (size_t i = 0; i < num_dag_words_per_lane; ++i)
+    {
+        FOR_LANES data[l] = le::uint32(item.word32s[((l ^ r) % num_lanes) * num_dag_words_per_lane + i]);
+        random_merge(mix[prog.dag_ops[i].dst], data, prog.dag_ops[i]);
+    }
+}
+
+ethash_hash256 hash_mix(const ethash_epoch_context& context, uint64_t period, const uint32_t seed[2]) noexcept
+{
+    alignas(64) mix_array mix;
+    mix_program prog;
+
+    init_mix(mix, seed);
+    programs.get(prog, period);
+
+    for (uint32_t r = 0; r < ETHASH_NUM_DATASET_ACCESSES; ++r)
+        round(context, r, mix, prog);
+
+    // Reduce mix data to a single per-lane result.
+    alignas(64) lane_words lane_hash;
+    FOR_LANES lane_hash[l] = fnv_offset_basis;
+    for (uint32_t i = 0; i < num_regs; ++i)
+        FOR_LANES lane_hash[l] = fnv1a(lane_hash[l], mix[i][l]);
+
+    // Reduce all lanes to a single 256-bit result.
+    static constexpr size_t num_words = sizeof(ethash_hash256) / sizeof(uint32_t);
+    ethash_hash256 mix_hash;
+    for (size_t i = 0; i < num_words; ++i)
+        mix_hash.word32s[i] = fnv_offset_basis;
+    for (size_t l = 0; l < num_lanes; ++l)
+        mix_hash.word32s[l % num_words] = fnv1a(mix_hash.word32s[l % num_words], lane_hash[l]);
+    return le::uint32s(mix_hash);
+}
+
+#undef FOR_LANES
+}  // namespace
+
 bool light_verify(const union ethash_hash256 header_hash, const union ethash_hash256 mix_hash,const uint64_t nonce, uint8_t* actual) {
 
 //    ethash_hash256 header_hash = to_hash256(std::string(str_header_hash, 64));
@@ -136,3 +411,47 @@ bool light_verify(const union ethash_hash256 header_hash, const union ethash_has
 
     return true;
 }
+
+union ethash_hash256 progpow_hash_mix(const struct ethash_epoch_context* context, uint64_t period,
+    const uint32_t seed[2])
+{
+    return hash_mix(*context, period, seed);
+}
+
+struct ethash_result progpow_hash(const struct ethash_epoch_context* context, int block_number,
+    const union ethash_hash256* header_hash, uint64_t nonce)
+{
+    uint32_t state2[8];
+    uint32_t hash_seed[2];  // KISS99 initiator
+    ethash_result result;
+
+    {
+        // Absorb phase for initial round of keccak
+        uint32_t state[25] = {0x0};
+
+        for (int i = 0; i < 8; i++)
+            state[i] = le::uint32(header_hash->word32s[i]);
+        state[8] = nonce;
+        state[9] = nonce >> 32;
+        for (int i = 10; i < 25; i++)
+            state[i] = ravencoin_kawpow[i-10];
+
+        keccak_progpow_64(state);
+
+        for (int i = 0; i < 8; i++)
+            state2[i] = state[i];
+    }
+
+    hash_seed[0] = state2[0];
+    hash_seed[1] = state2[1];
+    result.mix_hash = hash_mix(*context, uint64_t(block_number / period_length), hash_seed);
+    light_verify(*header_hash, result.mix_hash, nonce, result.final_hash.bytes);
+    return result;
+}
+
+bool progpow_verify(const struct ethash_epoch_context* context, int block_number,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce)
+{
+    const ethash_result result = progpow_hash(context, block_number, header_hash, nonce);
+    return std::memcmp(result.mix_hash.bytes, mix_hash->bytes, sizeof(result.mix_hash)) == 0;
+}
@@ -15,13 +15,15 @@
 /// https://github.com/ifdefelse/ProgPOW#change-history.
 //constexpr auto revision = "0.9.3";
 
-const int period_length = 10;
-const uint32_t num_regs = 32;
-const size_t num_lanes = 16;
-const int num_cache_accesses = 11;
-const int num_math_operations = 18;
-const size_t l1_cache_size = 16 * 1024;
-const size_t l1_cache_num_items = l1_cache_size / sizeof(uint32_t);
+/// KAWPOW changes the program every 3 blocks, ProgPoW 0.9.3 every 10.
+static const int period_length = 3;
+static const uint32_t num_regs = 32;
+static const size_t num_lanes = 16;
+static const int num_cache_accesses = 11;
+static const int num_math_operations = 18;
+static const size_t l1_cache_size = 16 * 1024;
+static const size_t l1_cache_num_items = l1_cache_size / sizeof(uint32_t);
+static const size_t num_dag_words_per_lane = sizeof(union ethash_hash2048) / (sizeof(uint32_t) * 16);  // per lane
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,6 +34,24 @@ union UInt256;
 
 bool light_verify(const union ethash_hash256 header_hash, const union ethash_hash256 mix_hash,const uint64_t nonce, uint8_t* actual);
 
+/// Runs the ProgPoW mix loop over the light cache for the program of the given period.
+///
+/// This is the stage shared by ProgPoW 0.9.3 and KAWPOW, which only differ in how the keccak
+/// seed and final hash are derived, so it can be checked against the ProgPoW reference vectors.
+union ethash_hash256 progpow_hash_mix(const struct ethash_epoch_context* context, uint64_t period,
+    const uint32_t seed[2]);
+
+/// Computes the KAWPOW mix and final hash of a header from the epoch's light cache.
+///
+/// The mix is recomputed from scratch, so unlike light_verify() a forged mix_hash is detected.
+/// @param context       The epoch context of block_number, see ethash_create_epoch_context().
+struct ethash_result progpow_hash(const struct ethash_epoch_context* context, int block_number,
+    const union ethash_hash256* header_hash, uint64_t nonce);
+
+/// Returns true if mix_hash is the KAWPOW mix of the header at block_number.
+bool progpow_verify(const struct ethash_epoch_context* context, int block_number,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce);
+
 
 #ifdef __cplusplus
 }
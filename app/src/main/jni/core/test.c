@@ -6,6 +6,7 @@
 #include "BRBIP38Key.h"
 #include "BRAddress.h"
 #include "BRBase58.h"
+#include "BRBech32.h"
 #include "BRBIP39Mnemonic.h"
 #include "BRBIP39WordsEn.h"
 #include "BRBIP44Sequence.h"
@@ -15,16 +16,26 @@
 #include "BRInt.h"
 #include "BRArray.h"
 #include "BRSet.h"
+#include "BRWriter.h"
+#include "BRTxStore.h"
+#include "BRWorkQueue.h"
+#include "BRTaskPool.h"
+#include "BRAllocator.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <errno.h>
 #include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include "BRAssets.h"
 #include "BRScript.h"
+#include "crypto/ethash/progpow.hpp"
+#include "crypto/ethash/keccak.h"
 #include "BRBIP44Sequence.h"
 
 
@@ -1295,11 +1306,84 @@ int AddressTests() {
     if (!BRAddressEq(&addr, &addr2))
         r = 0, fprintf(stderr, "***FAILED*** %s: AddressFromScriptPubKey()\n", __func__);
 
+    UInt160 hash = BRKeyHash160(&k), hash2;
+
+    if (BRAddressFromHash160(addr3.s, sizeof(addr3), &hash) == 0 || !BRAddressEq(&addr, &addr3) ||
+        !BRAddressHash160(&hash2, addr3.s) || !UInt160Eq(hash, hash2))
+        r = 0, fprintf(stderr, "***FAILED*** %s: AddressFromHash160()\n", __func__);
+
     // TODO: test AddressFromScriptSig()
     
     return r;
 }
 
+// BIP173 test vectors: https://github.com/bitcoin/bips/blob/master/bip-0173.mediawiki
+int Bech32Tests() {
+    int r = 1;
+    const char *addrs[] = {
+        "BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4",
+        "tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7",
+        "bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7k7grplx",
+        "BC1SW50QA3JX3S",
+        "bc1zw508d6qejxtdg4y5r3zarvaryvg6kdaj",
+        "tb1qqqqqp399et2xygdj5xreqhjjvcmzhxw4aywxecjdzew6hylgvsesrxh6hy",
+    };
+    const char *hrps[] = { "bc", "tb", "bc", "bc", "bc", "tb" };
+    const char *programs[] = {
+        "\x00\x14\x75\x1e\x76\xe8\x19\x91\x96\xd4\x54\x94\x1c\x45\xd1\xb3\xa3\x23\xf1\x43\x3b\xd6",
+        "\x00\x20\x18\x63\x14\x3c\x14\xc5\x16\x68\x04\xbd\x19\x20\x33\x56\xda\x13\x6c\x98\x56\x78\xcd\x4d\x27\xa1\xb8\xc6\x32\x96\x04\x90\x32\x62",
+        "\x51\x28\x75\x1e\x76\xe8\x19\x91\x96\xd4\x54\x94\x1c\x45\xd1\xb3\xa3\x23\xf1\x43\x3b\xd6\x75\x1e\x76\xe8\x19\x91\x96\xd4\x54\x94\x1c\x45\xd1\xb3\xa3\x23\xf1\x43\x3b\xd6",
+        "\x60\x02\x75\x1e",
+        "\x52\x10\x75\x1e\x76\xe8\x19\x91\x96\xd4\x54\x94\x1c\x45\xd1\xb3\xa3\x23",
+        "\x00\x20\x00\x00\x00\xc4\xa5\xca\xd4\x62\x21\xb2\xa1\x87\x90\x5e\x52\x66\x36\x2b\x99\xd5\xe9\x1c\x6c\xe2\x4d\x16\x5d\xab\x93\xe8\x64\x33",
+    };
+    const char *invalid[] = {
+        "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t5",
+        "BC13W508D6QEJXTDG4Y5R3ZARVARY0C5XW7KN40WF2",
+        "bc1rw5uspcuh",
+        "bc10w508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7kw5rljs90",
+        "tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sL5k7",
+        "bc1gmk9yu",
+    };
+    size_t i, j, len, count = sizeof(addrs)/sizeof(*addrs), dataLens[count];
+    char hrp[84], addr[91], addrs91[count][91];
+    uint8_t data[42], data42s[count][42];
+
+    for (i = 0; i < count; i++) {
+        len = BRBech32Decode(hrp, data, addrs[i]);
+        if (len == 0 || strcmp(hrp, hrps[i]) != 0 || memcmp(data, programs[i], len) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: Bech32Decode() test %zu\n", __func__, i);
+
+        BRBech32Encode(addr, hrp, data);
+        for (j = 0; addrs[i][j] && tolower(addrs[i][j]) == addr[j]; j++);
+        if (addrs[i][j] != '\0' || addr[j] != '\0')
+            r = 0, fprintf(stderr, "***FAILED*** %s: Bech32Encode() test %zu\n", __func__, i);
+    }
+
+    for (i = 0; i < sizeof(invalid)/sizeof(*invalid); i++) {
+        if (BRBech32Decode(hrp, data, invalid[i]) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: Bech32Decode() invalid test %zu\n", __func__, i);
+    }
+
+    // batch decode only accepts addresses with the given hrp, and must match single address decoding
+    if (BRBech32DecodeBatch(data42s, dataLens, "bc", addrs, count) != 4)
+        r = 0, fprintf(stderr, "***FAILED*** %s: Bech32DecodeBatch() test 0\n", __func__);
+
+    for (i = 0; i < count; i++) {
+        len = (strcmp(hrps[i], "bc") == 0) ? BRBech32Decode(hrp, data, addrs[i]) : 0;
+        if (dataLens[i] != len || memcmp(data42s[i], data, len) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: Bech32DecodeBatch() test %zu\n", __func__, i + 1);
+    }
+
+    const uint8_t *programs2[] = { data42s[0], data42s[2], (const uint8_t *)"\x01\x02\xff\xff" };
+
+    if (BRBech32EncodeBatch(addrs91, "bc", programs2, 3) != 2 || strcmp(addrs91[0], "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4") != 0 ||
+        strcmp(addrs91[1], addrs[2]) != 0 || addrs91[2][0] != '\0')
+        r = 0, fprintf(stderr, "***FAILED*** %s: Bech32EncodeBatch() test\n", __func__);
+
+    return r;
+}
+
 int BIP39MnemonicTests() {
     int r = 1;
     
@@ -1513,7 +1597,7 @@ int TransactionTests() {
 
     uint8_t script[BRAddressScriptPubKey(NULL, 0, address.s)];
     size_t scriptLen = BRAddressScriptPubKey(script, sizeof(script), address.s);
-    BRTransaction *tx = BRTransactionNew();
+    BRTransaction *tx = BRTransactionNew(1);
 
     BRTransactionAddInput(tx, inHash, 0, 1, script, scriptLen, NULL, 0, TXIN_SEQUENCE);
     BRTransactionAddOutput(tx, 100000000, script, scriptLen);
@@ -1521,6 +1605,7 @@ int TransactionTests() {
     
     uint8_t buf[BRTransactionSerialize(tx, NULL, 0)]; // test serializing/parsing unsigned tx
     size_t len = BRTransactionSerialize(tx, buf, sizeof(buf));
+    size_t size = BRTransactionSize(tx);
     
     if (len == 0) r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSerialize() test 0\n", __func__);
     BRTransactionFree(tx);
@@ -1529,8 +1614,12 @@ int TransactionTests() {
     if (! tx || tx->inCount != 1 || tx->outCount != 2)
         r = 0, fprintf(stderr, "***FAILED*** %s: TransactionParse() test 0\n", __func__);
     if (! tx) return r;
+    
+    // size maintained incrementally by AddInput()/AddOutput() must match the size computed from scratch by Parse()
+    if (size != 10 + TX_INPUT_SIZE + 2 * (9 + scriptLen) || BRTransactionSize(tx) != size)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSize() test 0\n", __func__);
 
-    BRTransactionSign(tx, 0, k, 2);
+    BRTransactionSign(tx, k, 2);
     BRAddressFromScriptSig(addr.s, sizeof(addr), tx->inputs[0].signature, tx->inputs[0].sigLen);
     if (!BRTransactionIsSigned(tx) || !BRAddressEq(&address, &addr))
         r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSign() test 1\n", __func__);
@@ -1538,6 +1627,17 @@ int TransactionTests() {
     uint8_t buf2[BRTransactionSerialize(tx, NULL, 0)];
     size_t len2 = BRTransactionSerialize(tx, buf2, sizeof(buf2));
 
+    if (! tx->serialized || len2 != tx->serializedLen || BRTransactionSize(tx) != len2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSerialize() cache test\n", __func__);
+    
+    tx->lockTime = 1234; // direct assignment must not be masked by the cached bytes
+    
+    uint8_t buf2b[BRTransactionSerialize(tx, NULL, 0)];
+    
+    if (BRTransactionSerialize(tx, buf2b, sizeof(buf2b)) != len2 || UInt32GetLE(&buf2b[len2 - 4]) != 1234)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSerialize() lockTime test\n", __func__);
+    
+    tx->lockTime = 0;
     BRTransactionFree(tx);
     tx = BRTransactionParse(buf2, len2);
 
@@ -1552,7 +1652,7 @@ int TransactionTests() {
         r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSerialize() test 1\n", __func__);
     BRTransactionFree(tx);
     
-    tx = BRTransactionNew();
+    tx = BRTransactionNew(1);
     BRTransactionAddInput(tx, inHash, 0, 1, script, scriptLen, NULL, 0, TXIN_SEQUENCE);
     BRTransactionAddInput(tx, inHash, 0, 1, script, scriptLen, NULL, 0, TXIN_SEQUENCE);
     BRTransactionAddInput(tx, inHash, 0, 1, script, scriptLen, NULL, 0, TXIN_SEQUENCE);
@@ -1573,12 +1673,17 @@ int TransactionTests() {
     BRTransactionAddOutput(tx, 1000000, script, scriptLen);
     BRTransactionAddOutput(tx, 1000000, script, scriptLen);
     BRTransactionAddOutput(tx, 1000000, script, scriptLen);
-    BRTransactionSign(tx, 0, k, 2);
+    BRTransactionSign(tx, k, 2);
     BRAddressFromScriptSig(addr.s, sizeof(addr), tx->inputs[tx->inCount - 1].signature,
                            tx->inputs[tx->inCount - 1].sigLen);
     if (!BRTransactionIsSigned(tx) || !BRAddressEq(&address, &addr))
         r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSign() test 2\n", __func__);
 
+    // signatures are deterministic, so the pre-image spliced from the shared template must give the same tx
+    if (! UInt256Eq(tx->txHash,
+                    u256_hex_decode("b04471afeaf5917f0c0e76e1d3495a75250067b2e80b963e408698daf4431149")))
+        r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSign() test 3\n", __func__);
+
     uint8_t buf4[BRTransactionSerialize(tx, NULL, 0)];
     size_t len4 = BRTransactionSerialize(tx, buf4, sizeof(buf4));
 
@@ -1649,7 +1754,7 @@ int WalletTests() {
     uint8_t outScript[BRAddressScriptPubKey(NULL, 0, recvAddr.s)];
     size_t outScriptLen = BRAddressScriptPubKey(outScript, sizeof(outScript), recvAddr.s);
     
-    tx = BRTransactionNew();
+    tx = BRTransactionNew(1);
     BRTransactionAddInput(tx, inHash, 0, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
     BRTransactionAddOutput(tx, CORBIES, outScript, outScriptLen);
 //    WalletRegisterTransaction(w, tx); // test adding unsigned tx
@@ -1659,7 +1764,7 @@ int WalletTests() {
     if (BRWalletTransactions(w, NULL, 0) != 0)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletTransactions() test 1\n", __func__);
 
-    BRTransactionSign(tx, 0, &k, 1);
+    BRTransactionSign(tx, &k, 1);
     BRWalletRegisterTransaction(w, tx);
     if (BRWalletBalance(w) != CORBIES)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletRegisterTransaction() test 2\n", __func__);
@@ -1671,15 +1776,16 @@ int WalletTests() {
     if (BRWalletBalance(w) != CORBIES)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletRegisterTransaction() test 3\n", __func__);
 
-    tx = BRTransactionNew();
+    tx = BRTransactionNew(1);
     BRTransactionAddInput(tx, inHash, 1, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE - 1);
     BRTransactionAddOutput(tx, CORBIES, outScript, outScriptLen);
     tx->lockTime = 1000;
-    BRTransactionSign(tx, 0, &k, 1);
+    BRTransactionSign(tx, &k, 1);
 
     if (!BRWalletTransactionIsPending(w, tx))
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletTransactionIsPending() test\n", __func__);
 
+    BRWalletSetTxUnconfirmedAfter(w, 500); // lockTime is only pending within 180 blocks of the wallet height
     BRWalletRegisterTransaction(w, tx); // test adding tx with future lockTime
     if (BRWalletBalance(w) != CORBIES)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletRegisterTransaction() test 4\n", __func__);
@@ -1688,36 +1794,132 @@ int WalletTests() {
     if (BRWalletBalance(w) != CORBIES*2)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletUpdateTransactions() test\n", __func__);
 
+    // the tx confirmed at 1000 now sorts before the unconfirmed one
+    if (BRWalletBalanceAfterTx(w, tx) != CORBIES || BRWalletBalanceAtHeight(w, 999) != 0 ||
+        BRWalletBalanceAtHeight(w, 1000) != CORBIES)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletBalanceAtHeight() test\n", __func__);
+
+    if (BRWalletConflictingTransactions(w, tx, NULL, 0) != 0) // the two tx spend different outputs of inHash
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletConflictingTransactions() test\n", __func__);
+
+    BRTxQuery query = BR_TX_QUERY_ALL;
+    BRTxCursor cursor = BR_TX_CURSOR_START;
+    BRTxRecord records[2];
+
+    query.address = recvAddr.s;
+    if (BRWalletQueryTransactions(w, &query, &cursor, records, 1) != 1 || records[0].blockHeight != TX_UNCONFIRMED ||
+        BRWalletQueryTransactions(w, &query, &cursor, records, 2) != 1 || !UInt256Eq(records[0].txHash, tx->txHash) ||
+        records[0].received != CORBIES)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 1\n", __func__);
+
+    query.toHeight = 999, cursor = BR_TX_CURSOR_START;
+    if (BRWalletQueryTransactions(w, &query, &cursor, records, 2) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 2\n", __func__);
+
+    tx = BRTransactionNew(1);
+    BRTransactionAddInput(tx, inHash, 2, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, CORBIES, inScript, inScriptLen); // pays no wallet address
+    BRTransactionSign(tx, &k, 1);
+    if (BRWalletRegisterTransaction(w, tx) || BRWalletUnconfirmedPoolCount(w) != 1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletUnconfirmedPoolCount() test 1\n", __func__);
+
+    if (BRWalletRegisterTransaction(w, tx) || BRWalletUnconfirmedPoolCount(w) != 1) // test pooling same tx twice
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletUnconfirmedPoolCount() test 2\n", __func__);
+
+    BRTransactionFree(tx); // the pool keeps its own copy
+    BRWalletSetUnconfirmedPoolLimits(w, 0, WALLET_POOL_MAX_AGE); // evicts and frees the pooled copy
+    if (BRWalletUnconfirmedPoolCount(w) != 0 || BRWalletTransactions(w, NULL, 0) != 2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletUnconfirmedPoolCount() test 3\n", __func__);
+
     BRWalletFree(w);
-    tx = BRTransactionNew();
+    tx = BRTransactionNew(1);
     BRTransactionAddInput(tx, inHash, 0, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
-    BRTransactionAddOutput(tx, CORBIES, outScript, outScriptLen);
-    BRTransactionSign(tx, 0, &k, 1);
+    BRTransactionAddOutput(tx, CORBIES*10, outScript, outScriptLen); // enough to cover the TX_FEE_PER_KB minimum
+    BRTransactionSign(tx, &k, 1);
     tx->timestamp = 1;
     w = BRWalletNew(&tx, 1, mpk);
-    if (BRWalletBalance(w) != CORBIES)
+    if (BRWalletBalance(w) != CORBIES*10)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletNew() test\n", __func__);
 
     if (BRWalletAllAddrs(w, NULL, 0) != SEQUENCE_GAP_LIMIT_EXTERNAL + SEQUENCE_GAP_LIMIT_INTERNAL + 1)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletAllAddrs() test\n", __func__);
-    
+
+    uint8_t addrCache[BRWalletAddressCache(w, NULL, 0)];
+    BRWallet *cw = BRWalletNewWithAddressCache(NULL, 0, mpk, addrCache,
+                                               BRWalletAddressCache(w, addrCache, sizeof(addrCache)));
+    BRAddress derivedAddr = BRWalletReceiveAddress(w);
+
+    if (! BRWalletContainsAddress(cw, derivedAddr.s) || BRWalletAddressCache(cw, NULL, 0) != sizeof(addrCache))
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletNewWithAddressCache() test\n", __func__);
+
+    BRWalletFree(cw);
+
+    const char *tmpDir = getenv("TMPDIR");
+    char storePath[PATH_MAX], idxPath[PATH_MAX + sizeof(".idx")];
+    UInt256 updateHashes[] = { tx->txHash, inHash }; // inHash was never stored, so its update is skipped
+    BRTransaction *storedTx;
+    int storeFd;
+
+    snprintf(storePath, sizeof(storePath), "%s/txstore_test_XXXXXX", (tmpDir && *tmpDir) ? tmpDir : "/tmp");
+    storeFd = mkstemp(storePath);
+    if (storeFd >= 0) close(storeFd);
+    snprintf(idxPath, sizeof(idxPath), "%s.idx", storePath);
+    BRTxStore *store = (storeFd >= 0) ? BRTxStoreOpen(storePath) : NULL;
+
+    if (! store || BRTxStoreAdd(store, tx) != 0 || BRTxStoreUpdate(store, updateHashes, 2, 1000, 1) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TxStoreAdd() test\n", __func__);
+
+    if (store) BRTxStoreClose(store);
+    store = (storeFd >= 0) ? BRTxStoreOpen(storePath) : NULL;
+    cw = (store) ? BRWalletNewWithTxStore(store, mpk, NULL, 0) : NULL;
+    storedTx = (cw) ? BRWalletTransactionForHash(cw, tx->txHash) : NULL;
+    if (! cw || BRWalletBalance(cw) != CORBIES*10 || ! storedTx || storedTx->blockHeight != 1000)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletNewWithTxStore() test\n", __func__);
+
+    if (cw) BRWalletFree(cw);
+    else if (store) BRTxStoreClose(store);
+
+    // an index left next to a different log must be rebuilt, not trusted up to its own log length
+    char staleIdxPath[sizeof(idxPath) + sizeof(".old")];
+    BRTransaction *otherTx = BRTransactionNew(1);
+
+    BRTransactionAddInput(otherTx, inHash, 3, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(otherTx, CORBIES*10, outScript, outScriptLen);
+    BRTransactionSign(otherTx, &k, 1);
+    snprintf(staleIdxPath, sizeof(staleIdxPath), "%s.old", idxPath);
+    if (storeFd >= 0) rename(idxPath, staleIdxPath), unlink(storePath);
+    store = (storeFd >= 0) ? BRTxStoreOpen(storePath) : NULL;
+    for (int i = 0; store && i < 3; i++) BRTxStoreAdd(store, otherTx); // a longer log than the stale index covers
+    if (store) BRTxStoreClose(store);
+    if (storeFd >= 0) rename(staleIdxPath, idxPath);
+    store = (storeFd >= 0) ? BRTxStoreOpen(storePath) : NULL;
+    storedTx = (store) ? BRTxStoreGet(store, otherTx->txHash) : NULL;
+
+    if (! storedTx || BRTxStoreLoad(store, NULL, 0) != 1 || BRTxStoreGet(store, tx->txHash))
+        r = 0, fprintf(stderr, "***FAILED*** %s: TxStoreOpen() test\n", __func__);
+
+    if (storedTx) BRTransactionFree(storedTx);
+    if (store) BRTxStoreClose(store);
+    BRTransactionFree(otherTx);
+    if (storeFd >= 0) unlink(storePath), unlink(idxPath);
+
     UInt256 hash = tx->txHash;
 
-    tx = BRWalletCreateTransaction(w, CORBIES * 2, addr.s);
+    tx = BRWalletCreateTransaction(w, CORBIES*20, addr.s);
     if (tx) r = 0, fprintf(stderr, "***FAILED*** %s: WalletCreateTransaction() test 3\n", __func__);
 
-    if (BRWalletFeeForTxAmount(w, CORBIES / 2) < 1000)
+    if (BRWalletFeeForTxAmount(w, CORBIES*5) < TX_FEE_PER_KB)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletFeeForTxAmount() test 1\n", __func__);
     
-    tx = BRWalletCreateTransaction(w, CORBIES / 2, addr.s);
+    tx = BRWalletCreateTransaction(w, CORBIES*5, addr.s);
     if (! tx) r = 0, fprintf(stderr, "***FAILED*** %s: WalletCreateTransaction() test 4\n", __func__);
 
-    if (tx) BRWalletSignTransaction(w, tx, 0, "", 1);
+    if (tx) BRWalletSignTransaction(w, tx, "", 1);
     if (tx && !BRTransactionIsSigned(tx))
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletSignTransaction() test\n", __func__);
     
     if (tx) tx->timestamp = 1, BRWalletRegisterTransaction(w, tx);
-    if (tx && BRWalletBalance(w) + BRWalletFeeForTx(w, tx) != CORBIES/2)
+    if (tx && BRWalletBalance(w) + BRWalletFeeForTx(w, tx) != CORBIES*5)
         r = 0, fprintf(stderr, "***FAILED*** %s: WalletRegisterTransaction() test 5\n", __func__);
     
     if (BRWalletTransactions(w, NULL, 0) != 2)
@@ -1750,10 +1952,10 @@ int WalletTests() {
 
     int64_t amt;
     
-    tx = BRTransactionNew();
+    tx = BRTransactionNew(1);
     BRTransactionAddInput(tx, inHash, 0, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
-    BRTransactionAddOutput(tx, 740000, outScript, outScriptLen);
-    BRTransactionSign(tx, 0, &k, 1);
+    BRTransactionAddOutput(tx, 74*CORBIES, outScript, outScriptLen);
+    BRTransactionSign(tx, &k, 1);
     w = BRWalletNew(&tx, 1, mpk);
     BRWalletSetCallbacks(w, w, walletBalanceChanged, walletTxAdded, walletTxUpdated, walletTxDeleted);
     BRWalletSetFeePerKb(w, 65000);
@@ -1765,7 +1967,40 @@ int WalletTests() {
 
     BRTransactionFree(tx);
     BRWalletFree(w);
-    
+
+    BRTransaction *parent, *child, *grandchild, *conflicts[2];
+
+    parent = BRTransactionNew(1);
+    BRTransactionAddInput(parent, inHash, 0, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(parent, CORBIES*10, outScript, outScriptLen);
+    BRTransactionAddOutput(parent, CORBIES*10, outScript, outScriptLen);
+    BRTransactionSign(parent, &k, 1);
+    parent->timestamp = 1;
+    w = BRWalletNew(&parent, 1, mpk);
+    child = BRWalletCreateTransaction(w, CORBIES*15, addr.s); // needs both outputs of parent
+    if (child) BRWalletSignTransaction(w, child, "", 1), BRWalletRegisterTransaction(w, child);
+    grandchild = BRWalletCreateTransaction(w, CORBIES, addr.s); // spends the change from child
+    if (grandchild) BRWalletSignTransaction(w, grandchild, "", 1), BRWalletRegisterTransaction(w, grandchild);
+
+    if (! child || child->inCount != 2 || ! grandchild || ! UInt256Eq(grandchild->inputs[0].txHash, child->txHash) ||
+        BRWalletTransactions(w, NULL, 0) != 3)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletCreateTransaction() test 5\n", __func__);
+
+    tx = BRTransactionNew(1); // double spends the second output of parent
+    BRTransactionAddInput(tx, parent->txHash, 1, CORBIES*10, outScript, outScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, CORBIES*9, inScript, inScriptLen);
+
+    if (BRWalletConflictingTransactions(w, tx, NULL, 0) != 1 ||
+        BRWalletConflictingTransactions(w, tx, conflicts, 2) != 1 || conflicts[0] != child)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletConflictingTransactions() test 2\n", __func__);
+
+    BRTransactionFree(tx);
+    BRWalletRemoveTransaction(w, parent->txHash); // child spends two outputs of parent, grandchild spends child
+    if (BRWalletTransactions(w, NULL, 0) != 0 || BRWalletBalance(w) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletRemoveTransaction() test 2\n", __func__);
+
+    BRWalletFree(w);
+
     amt = RavencoinAmount(50000, 50000);
     if (amt != CORBIES) r = 0, fprintf(stderr, "***FAILED*** %s: RavencoinAmount() test 1\n", __func__);
 
@@ -1777,7 +2012,191 @@ int WalletTests() {
 
     amt = BRLocalAmount(-CORBIES, 50000);
     if (amt != -50000) r = 0, fprintf(stderr, "***FAILED*** %s: LocalAmount() test 2\n", __func__);
-    
+
+    BRWallet *accounts[3];
+
+    BRWalletNewAccounts(accounts, 3, "", 1, 175, 0);
+    w = BRWalletNew(NULL, 0, BRBIP44MasterPubKey("", 1, 175, 2, 0));
+
+    if (strcmp(BRWalletReceiveAddress(accounts[2]).s, BRWalletReceiveAddress(w).s) != 0 ||
+        strcmp(BRWalletReceiveAddress(accounts[0]).s, recvAddr.s) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletNewAccounts() test\n", __func__);
+
+    if (BRWalletUsedAccountCount(accounts, 3) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletUsedAccountCount() test\n", __func__);
+
+    for (size_t i = 0; i < 3; i++) BRWalletFree(accounts[i]);
+    BRWalletFree(w);
+
+    // 25 tx confirmed at heights 100 to 124, two of them carrying an asset
+    BRAsset asset = { .type = TRANSFER, .name = "QUERYTEST", .nameLen = 9 };
+    BRTxRecord page[10];
+    size_t n, total = 0;
+    uint32_t height;
+
+    w = BRWalletNew(NULL, 0, mpk);
+    recvAddr = BRWalletReceiveAddress(w);
+    BRAddressScriptPubKey(outScript, sizeof(outScript), recvAddr.s);
+
+    for (uint32_t i = 0; i < 25; i++) {
+        tx = BRTransactionNew(1);
+        BRTransactionAddInput(tx, inHash, 100 + i, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+        BRTransactionAddOutput(tx, CORBIES, outScript, outScriptLen);
+        if (i == 7 || i == 20) tx->asset = &asset;
+        BRTransactionSign(tx, &k, 1);
+        BRWalletRegisterTransaction(w, tx);
+        BRWalletUpdateTransactions(w, &tx->txHash, 1, 100 + i, 1000 + i);
+    }
+
+    // pages of 10 come newest first, each starting where the last one stopped
+    query = BR_TX_QUERY_ALL, cursor = BR_TX_CURSOR_START, height = 124;
+
+    while ((n = BRWalletQueryTransactions(w, &query, &cursor, page, 10)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (page[i].blockHeight != height-- || page[i].timestamp != page[i].blockHeight + 900)
+                r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 3\n", __func__);
+        }
+
+        total += n;
+        if (n < 10) break;
+    }
+
+    if (total != 25 || n != 5 || BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 4\n", __func__);
+
+    query.fromHeight = 105, query.toHeight = 109, cursor = BR_TX_CURSOR_START;
+    if (BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 5 || page[0].blockHeight != 109 ||
+        page[4].blockHeight != 105)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 5\n", __func__);
+
+    query = BR_TX_QUERY_ALL, query.assetName = "QUERYTEST", cursor = BR_TX_CURSOR_START;
+    if (BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 2 || page[0].blockHeight != 120 ||
+        page[1].blockHeight != 107)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 6\n", __func__);
+
+    query.assetName = "OTHERTEST", cursor = BR_TX_CURSOR_START;
+    if (BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 7\n", __func__);
+
+    // an older unconfirmed tx, that the tx unconfirmed by a reorg below 111 sort above, by their later timestamps
+    tx = BRTransactionNew(1);
+    BRTransactionAddInput(tx, inHash, 125, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, CORBIES, outScript, outScriptLen);
+    tx->timestamp = 500;
+    BRTransactionSign(tx, &k, 1);
+    BRWalletRegisterTransaction(w, tx);
+    BRWalletSetTxUnconfirmedAfter(w, 110);
+    query = BR_TX_QUERY_ALL, query.fromHeight = 111, query.toHeight = TX_UNCONFIRMED - 1, cursor = BR_TX_CURSOR_START;
+    if (BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 8\n", __func__);
+
+    query.fromHeight = TX_UNCONFIRMED, query.toHeight = TX_UNCONFIRMED, cursor = BR_TX_CURSOR_START, total = 0;
+    while ((n = BRWalletQueryTransactions(w, &query, &cursor, page, 10)) > 0) total += n;
+    if (total != 15)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 9\n", __func__);
+
+    query = BR_TX_QUERY_ALL, cursor = BR_TX_CURSOR_START;
+    if (BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 10 || page[0].timestamp != 1024 ||
+        BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 10 || page[3].timestamp != 1011 ||
+        page[4].timestamp != 500 || page[4].blockHeight != TX_UNCONFIRMED || page[5].blockHeight != 110 ||
+        page[9].blockHeight != 106)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 10\n", __func__);
+
+    query.assetName = "QUERYTEST", cursor = BR_TX_CURSOR_START;
+    if (BRWalletQueryTransactions(w, &query, &cursor, page, 10) != 2 || page[0].blockHeight != TX_UNCONFIRMED ||
+        page[1].blockHeight != 107)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletQueryTransactions() test 11\n", __func__);
+
+    BRWalletFree(w); // before asset goes out of scope, tx don't own their asset
+
+    // a batch of unique assets spends the ownership token once and adds one NEW_ASSET output per asset
+    BRAsset root = { .type = TRANSFER, .name = "BATCH", .nameLen = 5 },
+            uniques[] = { { .type = NEW_ASSET, .name = "BATCH#A", .nameLen = 7, .amount = CORBIES },
+                          { .type = NEW_ASSET, .name = "BATCH#B", .nameLen = 7, .amount = CORBIES },
+                          { .type = NEW_ASSET, .name = "BATCH#C", .nameLen = 7, .amount = CORBIES } },
+            notOwned = { .type = TRANSFER, .name = "OTHER", .nameLen = 5 };
+    size_t uniqueCount = sizeof(uniques)/sizeof(*uniques), ownerInputs = 0, burns = 0;
+    BRTransaction *fundTx, *batchTx, *keyTx;
+    BRAddress changeAddr;
+    BRKey keys[2];
+    uint32_t keyIdx = 0;
+
+    w = BRWalletNew(NULL, 0, mpk);
+    recvAddr = BRWalletReceiveAddress(w);
+    BRWalletUnusedAddrs(w, &changeAddr, 1, 1); // the token sits on the internal chain, the rvn on the external one
+    BRAddressScriptPubKey(outScript, sizeof(outScript), recvAddr.s);
+
+    uint8_t ownerScript[BRTxOutputSetTransferOwnerAssetScriptWithoutTag(NULL, 0, &root)];
+
+    BRAddressScriptPubKey(ownerScript, sizeof(ownerScript), changeAddr.s);
+    BRTxOutputSetTransferOwnerAssetScriptWithoutTag(ownerScript, sizeof(ownerScript), &root);
+    fundTx = BRTransactionNew(1);
+    BRTransactionAddInput(fundTx, inHash, 200, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(fundTx, GetIssueUniqueAssetBurnAmount()*uniqueCount + CORBIES*10, outScript, outScriptLen);
+    BRTransactionAddOutput(fundTx, 0, ownerScript, sizeof(ownerScript));
+    BRTransactionSign(fundTx, &k, 1);
+    BRWalletRegisterTransaction(w, fundTx);
+
+    if (BRWalletCreateTxForUniqueAssetsCreation(w, recvAddr.s, uniques, uniqueCount, &notOwned) != NULL)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletCreateTxForUniqueAssetsCreation() test 1\n", __func__);
+
+    batchTx = BRWalletCreateTxForUniqueAssetsCreation(w, recvAddr.s, uniques, uniqueCount, &root);
+
+    for (size_t i = 0; batchTx && i < batchTx->inCount; i++) {
+        if (UInt256Eq(batchTx->inputs[i].txHash, fundTx->txHash) && batchTx->inputs[i].index == 1) ownerInputs++;
+    }
+
+    for (size_t i = 0; batchTx && i + uniqueCount + 1 < batchTx->outCount; i++) {
+        if (batchTx->outputs[i].amount == GetIssueUniqueAssetBurnAmount()*uniqueCount) burns++;
+    }
+
+    if (! batchTx || ownerInputs != 1 || burns != 1 || batchTx->outCount < uniqueCount + 2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletCreateTxForUniqueAssetsCreation() test 2\n", __func__);
+
+    // TRANSFER! goes to a fresh change address just before the NEW_ASSET outputs, which keep the given order
+    if (batchTx && batchTx->outCount >= uniqueCount + 2) {
+        BRTxOutput *o = &batchTx->outputs[batchTx->outCount - uniqueCount - 1];
+
+        if (o->amount != 0 || o->scriptLen != sizeof(ownerScript) || ! IsScriptTransferAsset(o->script, o->scriptLen) ||
+            memcmp(&o->script[25], &ownerScript[25], sizeof(ownerScript) - 25) != 0 ||
+            ! BRWalletContainsAddress(w, o->address) || BRAddressEq(o->address, changeAddr.s))
+            r = 0, fprintf(stderr, "***FAILED*** %s: WalletCreateTxForUniqueAssetsCreation() test 3\n", __func__);
+
+        for (size_t i = 0; i < uniqueCount; i++) {
+            uint8_t uniqueScript[BRTxOutputSetNewAssetScript(NULL, 0, &uniques[i])];
+
+            o = &batchTx->outputs[batchTx->outCount - uniqueCount + i];
+            BRAddressScriptPubKey(uniqueScript, sizeof(uniqueScript), recvAddr.s);
+            BRTxOutputSetNewAssetScript(uniqueScript, sizeof(uniqueScript), &uniques[i]);
+
+            if (o->amount != 0 || o->scriptLen != sizeof(uniqueScript) ||
+                memcmp(o->script, uniqueScript, sizeof(uniqueScript)) != 0)
+                r = 0, fprintf(stderr, "***FAILED*** %s: WalletCreateTxForUniqueAssetsCreation() test 4\n", __func__);
+        }
+    }
+
+    // signing the batch in one pass gives the same signatures as signing it one key at a time
+    keyTx = (batchTx) ? BRTransactionCopy(batchTx) : NULL;
+    BRBIP44PrivKeyList(&keys[0], 1, "", 1, BIP44_RVN_COINTYPE, BIP44_DEFAULT_ACCOUNT, SEQUENCE_EXTERNAL_CHAIN, &keyIdx);
+    BRBIP44PrivKeyList(&keys[1], 1, "", 1, BIP44_RVN_COINTYPE, BIP44_DEFAULT_ACCOUNT, SEQUENCE_INTERNAL_CHAIN, &keyIdx);
+
+    if (keyTx) BRWalletSignTransaction(w, batchTx, "", 1), BRTransactionSign(keyTx, &keys[0], 1),
+               BRTransactionSign(keyTx, &keys[1], 1);
+
+    for (size_t i = 0; keyTx && i < keyTx->inCount; i++) {
+        if (batchTx->inputs[i].sigLen != keyTx->inputs[i].sigLen ||
+            memcmp(batchTx->inputs[i].signature, keyTx->inputs[i].signature, keyTx->inputs[i].sigLen) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: WalletSignTransaction() batch test 1\n", __func__);
+    }
+
+    if (! keyTx || ! BRTransactionIsSigned(batchTx) || ! UInt256Eq(batchTx->txHash, keyTx->txHash))
+        r = 0, fprintf(stderr, "***FAILED*** %s: WalletSignTransaction() batch test 2\n", __func__);
+
+    BRKeyClean(&keys[0]), BRKeyClean(&keys[1]);
+    if (keyTx) BRTransactionFree(keyTx); // shares batchTx's asset
+    if (batchTx) AssetFree(batchTx->asset), BRTransactionFree(batchTx);
+    BRWalletFree(w);
+
     return r;
 }
 
@@ -1855,6 +2274,400 @@ int BloomFilterTests() {
     return r;
 }
 
+int WriterTests() {
+    int r = 1;
+    BRWriter w;
+    
+    BRWriterInit(&w, 0);
+    BRWriterVarInt(&w, 0xfd);
+    BRWriterUInt32LE(&w, 0x01020304);
+    
+    if (w.len != 7 || memcmp(w.data, "\xfd\xfd\x00\x04\x03\x02\x01", 7) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WriterVarInt() test\n", __func__);
+    
+    for (int i = 0; i < 1000; i++) BRWriterUInt256(&w, UINT256_ZERO); // force several reallocs
+    
+    size_t capacity = w.capacity;
+    
+    BRWriterReset(&w);
+    if (w.len != 0 || w.capacity != capacity || capacity < 7 + 1000 * sizeof(UInt256))
+        r = 0, fprintf(stderr, "***FAILED*** %s: WriterReset() test\n", __func__);
+    
+    UInt256 inHash = u256_hex_decode("0000000000000000000000000000000000000000000000000000000000000001");
+    uint8_t script[] = "\x76\xa9\x14\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+                       "\x88\xac";
+    BRTransaction *tx = BRTransactionNew(1);
+    
+    BRTransactionAddInput(tx, inHash, 0, 1, script, sizeof(script) - 1, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddInput(tx, inHash, 1, 0, script, sizeof(script) - 1, script, sizeof(script) - 1, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, 100000000, script, sizeof(script) - 1);
+    
+    uint8_t buf[1000];
+    size_t len = BRTransactionSerialize(tx, buf, sizeof(buf));
+    
+    if (len == 0 || BRTransactionSerializedSize(tx) != len || BRTransactionSerialize(tx, NULL, 0) != len)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TransactionSerializedSize() test\n", __func__);
+    
+    if (BRWriterTransaction(&w, tx) != len || w.len != len || memcmp(w.data, buf, len) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WriterTransaction() test\n", __func__);
+    
+    BRTransactionFree(tx);
+    
+    BRBloomFilter *f = BRBloomFilterNew(0.01, 3, 0, BLOOM_UPDATE_ALL);
+    char data[] = "\x99\x10\x8a\xd8\xed\x9b\xb6\x27\x4d\x39\x80\xba\xb5\xa8\x5c\x04\x8f\x09\x50\xc8";
+    
+    BRBloomFilterInsertData(f, (uint8_t *) data, sizeof(data) - 1);
+    BRWriterReset(&w);
+    
+    if (BRWriterBloomFilter(&w, f) != BRBloomFilterSerializedSize(f) ||
+        BRBloomFilterSerialize(f, buf, sizeof(buf)) != w.len || memcmp(w.data, buf, w.len) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WriterBloomFilter() test\n", __func__);
+    
+    BRBloomFilterFree(f);
+    BRWriterFree(&w);
+    return r;
+}
+
+static void workQueueTestRun(void *info) {
+    (*(int *) info)++;
+}
+
+static void workQueueTestDone(void *info, uint64_t jobId, int cancelled) {
+    if (cancelled) *(int *) info += 100;
+}
+
+static void workQueueTestIdDone(void *info, uint64_t jobId, int cancelled) {
+    *(uint64_t *) info = jobId;
+}
+
+int WorkQueueTests() {
+    int r = 1, runs[10] = {0};
+    BRWorkQueue *queue = BRWorkQueueNew(1, NULL, NULL);
+    uint64_t id = 0;
+
+    for (int i = 0; i < 10; i++) id = BRWorkQueueAdd(queue, &runs[i], workQueueTestRun, workQueueTestDone);
+    while (BRWorkQueuePendingCount(queue) > 0) usleep(1000);
+
+    for (int i = 0; i < 10; i++) {
+        if (runs[i] != 1) r = 0, fprintf(stderr, "***FAILED*** %s: WorkQueueAdd() test %d\n", __func__, i);
+    }
+
+    if (BRWorkQueueCancel(queue, id)) // already completed
+        r = 0, fprintf(stderr, "***FAILED*** %s: WorkQueueCancel() test 1\n", __func__);
+
+    uint64_t doneId = 0;
+
+    id = BRWorkQueueNewId(queue);
+    if (id == 0 || BRWorkQueueCancel(queue, id)) // not queued yet
+        r = 0, fprintf(stderr, "***FAILED*** %s: WorkQueueCancel() test 2\n", __func__);
+
+    BRWorkQueueAddWithId(queue, id, &doneId, workQueueTestRun, workQueueTestIdDone);
+    while (doneId == 0) usleep(1000); // done() is called after the job stops being counted as pending
+    if (doneId != id || BRWorkQueueAdd(queue, &runs[0], workQueueTestRun, NULL) != id + 1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: WorkQueueAddWithId() test\n", __func__);
+
+    BRWorkQueueFree(queue);
+    return r;
+}
+
+static void taskPoolTestCount(void *info) {
+    __atomic_add_fetch((int *) info, 1, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    BRTaskPool *pool;
+    uint32_t begin, end;
+    uint64_t sum;
+} TaskPoolTestRange;
+
+// sums begin..end-1 by splitting the range in half until it's short, spawning one half and running the other
+static void taskPoolTestSum(void *info) {
+    TaskPoolTestRange *range = info, lo, hi;
+    BRTaskGroup *group;
+    uint64_t *scratch;
+
+    if (range->end - range->begin <= 64) {
+        scratch = BRTaskScratch((range->end - range->begin)*sizeof(*scratch));
+        range->sum = 0;
+        for (uint32_t i = range->begin; i < range->end; i++) scratch[i - range->begin] = i;
+        for (uint32_t i = range->begin; i < range->end; i++) range->sum += scratch[i - range->begin];
+        return;
+    }
+
+    lo = (TaskPoolTestRange) { range->pool, range->begin, range->begin + (range->end - range->begin)/2, 0 };
+    hi = (TaskPoolTestRange) { range->pool, lo.end, range->end, 0 };
+    group = BRTaskGroupNew(range->pool);
+    BRTaskGroupSpawn(group, &hi, taskPoolTestSum);
+    taskPoolTestSum(&lo);
+    BRTaskGroupFree(group);
+    range->sum = lo.sum + hi.sum;
+}
+
+static pthread_t taskPoolTestThread;
+static int taskPoolTestRanOnThread;
+
+static void taskPoolTestForeign(void *info) {
+    if (pthread_equal(pthread_self(), taskPoolTestThread))
+        __atomic_store_n(&taskPoolTestRanOnThread, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch((int *) info, 1, __ATOMIC_RELAXED);
+}
+
+int TaskPoolTests() {
+    int r = 1, count = 0, foreignCount = 0;
+    BRTaskGroup *foreign;
+    BRTaskPool *pool = BRTaskPoolNew(4);
+    BRTaskGroup *group = BRTaskGroupNew(pool);
+    TaskPoolTestRange range = { pool, 0, 100000, 0 };
+
+    for (int i = 0; i < 10000; i++) BRTaskGroupSpawn(group, &count, taskPoolTestCount);
+
+    if (! BRTaskGroupWait(group) || count != 10000)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TaskGroupWait() test 1\n", __func__);
+
+    BRTaskGroupSpawn(group, &range, taskPoolTestSum); // nested groups
+    BRTaskGroupWait(group);
+
+    if (range.sum != 100000ULL*99999/2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TaskGroupWait() test 2\n", __func__);
+
+    BRTaskGroupFree(group);
+    group = BRTaskGroupNew(pool);
+    count = 0;
+    BRTaskGroupCancel(group);
+    for (int i = 0; i < 100; i++) BRTaskGroupSpawn(group, &count, taskPoolTestCount);
+
+    if (BRTaskGroupWait(group) || count != 0 || ! BRTaskGroupIsCancelled(group))
+        r = 0, fprintf(stderr, "***FAILED*** %s: TaskGroupCancel() test\n", __func__);
+
+    BRTaskGroupFree(group);
+    group = BRTaskGroupNew(pool);
+    foreign = BRTaskGroupNew(pool);
+    count = 0;
+    taskPoolTestThread = pthread_self();
+    taskPoolTestRanOnThread = 0;
+    for (int i = 0; i < 1000; i++) BRTaskGroupSpawn(foreign, &foreignCount, taskPoolTestForeign);
+    for (int i = 0; i < 1000; i++) BRTaskGroupSpawn(group, &count, taskPoolTestCount);
+
+    if (! BRTaskGroupWaitIsolated(group) || count != 1000 || taskPoolTestRanOnThread)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TaskGroupWaitIsolated() test\n", __func__);
+
+    BRTaskGroupFree(foreign);
+    BRTaskGroupFree(group);
+
+    if (foreignCount != 1000)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TaskGroupWaitIsolated() test 2\n", __func__);
+
+    BRTaskPoolFree(pool);
+    return r;
+}
+
+// prints spawn overhead and scaling of TaskPool for 1 up to one worker per CPU
+int TaskPoolBench() {
+    int r = 1, count;
+    long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+    struct timespec start, end;
+
+    printf("\n");
+
+    for (size_t workers = 1; workers == 1 || workers <= (size_t) cpuCount; workers *= 2) {
+        BRTaskPool *pool = BRTaskPoolNew(workers);
+        TaskPoolTestRange range = { pool, 0, 1000000, 0 };
+        BRTaskGroup *group = BRTaskGroupNew(pool);
+        double spawnNs, sumMs;
+
+        count = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < 100000; i++) BRTaskGroupSpawn(group, &count, taskPoolTestCount);
+        BRTaskGroupWait(group);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        spawnNs = ((end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec))/100000;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        BRTaskGroupSpawn(group, &range, taskPoolTestSum);
+        BRTaskGroupWait(group);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        sumMs = ((end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec))/1e6;
+
+        if (count != 100000 || range.sum != 1000000ULL*999999/2) r = 0;
+        printf("%zu workers: %.0f ns per spawned task, %.2f ms to sum 1000000 integers in nested tasks\n",
+               workers, spawnNs, sumMs);
+        BRTaskGroupFree(group);
+        BRTaskPoolFree(pool);
+    }
+
+    printf("                                  ");
+    return r;
+}
+
+int AllocatorTests() {
+    int r = 1, *a, x[1000];
+    uint8_t script[25] = { 0 };
+    void *p, *q, *objs[17];
+    BRAllocator *counting = BRCountingAllocatorNew(NULL), *arena, *slab;
+    BRAllocatorStats stats, txStats = BRAllocatorSubsystemStats(BR_ALLOC_TX);
+    BRTransaction *tx;
+    BRSet *s;
+
+    p = BRAllocatorCalloc(counting, 100);
+    p = BRAllocatorRealloc(counting, p, 100, 200);
+    q = BRAllocatorCalloc(counting, 50);
+    stats = BRCountingAllocatorStats(counting);
+
+    if (stats.bytes != 250 || stats.count != 2 || stats.peakBytes != 250 || stats.allocations != 3)
+        r = 0, fprintf(stderr, "***FAILED*** %s: CountingAllocatorStats() test 1\n", __func__);
+
+    BRAllocatorFree(counting, p, 200);
+    BRAllocatorFree(counting, q, 50);
+    stats = BRCountingAllocatorStats(counting);
+
+    if (stats.bytes != 0 || stats.count != 0 || stats.peakBytes != 250)
+        r = 0, fprintf(stderr, "***FAILED*** %s: CountingAllocatorStats() test 2\n", __func__);
+
+    arena = BRArenaAllocatorNew(1024, counting);
+    for (int i = 0; i < 10; i++) BRAllocatorCalloc(arena, 64); // carved out of one block
+    p = BRAllocatorCalloc(arena, 2000); // larger than a block
+    stats = BRCountingAllocatorStats(counting);
+
+    if (stats.count != 2 || stats.bytes != 1024 + 2000)
+        r = 0, fprintf(stderr, "***FAILED*** %s: ArenaAllocatorNew() test\n", __func__);
+
+    BRArenaAllocatorReset(arena);
+    stats = BRCountingAllocatorStats(counting);
+    if (stats.count != 1) r = 0, fprintf(stderr, "***FAILED*** %s: ArenaAllocatorReset() test\n", __func__);
+    BRArenaAllocatorFree(arena);
+    stats = BRCountingAllocatorStats(counting);
+    if (stats.count != 0) r = 0, fprintf(stderr, "***FAILED*** %s: ArenaAllocatorFree() test\n", __func__);
+
+    slab = BRSlabAllocatorNew(32, 16, counting);
+    for (int i = 0; i < 17; i++) objs[i] = BRAllocatorCalloc(slab, 32);
+    stats = BRCountingAllocatorStats(counting);
+    if (stats.count != 2) r = 0, fprintf(stderr, "***FAILED*** %s: SlabAllocatorNew() test 1\n", __func__);
+    q = objs[3];
+    BRAllocatorFree(slab, objs[3], 32);
+    objs[3] = BRAllocatorCalloc(slab, 32); // reuses the freed object
+    if (objs[3] != q) r = 0, fprintf(stderr, "***FAILED*** %s: SlabAllocatorNew() test 2\n", __func__);
+    p = BRAllocatorCalloc(slab, 100); // too big for a slab, comes from counting
+    stats = BRCountingAllocatorStats(counting);
+    if (stats.count != 3) r = 0, fprintf(stderr, "***FAILED*** %s: SlabAllocatorNew() test 3\n", __func__);
+    BRAllocatorFree(slab, p, 100);
+    for (int i = 0; i < 17; i++) BRAllocatorFree(slab, objs[i], 32);
+    BRSlabAllocatorFree(slab);
+    stats = BRCountingAllocatorStats(counting);
+    if (stats.count != 0) r = 0, fprintf(stderr, "***FAILED*** %s: SlabAllocatorFree() test\n", __func__);
+
+    array_new_with_allocator(a, 1, counting);
+    for (int i = 0; i < 1000; i++) array_add(a, i);
+    stats = BRCountingAllocatorStats(counting);
+
+    if (array_allocator(a) != counting || array_count(a) != 1000 || a[999] != 999 || stats.count != 1 ||
+        stats.bytes < 1000*sizeof(*a))
+        r = 0, fprintf(stderr, "***FAILED*** %s: array_new_with_allocator() test\n", __func__);
+
+    array_free(a);
+    s = BRSetNewWithAllocator(hash_int, eq_int, 0, counting);
+    for (int i = 0; i < 1000; i++) x[i] = i, BRSetAdd(s, &x[i]);
+    if (BRSetCount(s) != 1000 || BRCountingAllocatorStats(counting).count != 2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: SetNewWithAllocator() test\n", __func__);
+    BRSetFree(s);
+    stats = BRCountingAllocatorStats(counting);
+
+    if (stats.bytes != 0 || stats.count != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: array_free()/SetFree() test\n", __func__);
+
+    BRCountingAllocatorFree(counting);
+    tx = BRTransactionNew(1);
+    BRTransactionAddOutput(tx, 100000000, script, sizeof(script));
+    stats = BRAllocatorSubsystemStats(BR_ALLOC_TX);
+    if (stats.count <= txStats.count) r = 0, fprintf(stderr, "***FAILED*** %s: TransactionNew() test\n", __func__);
+    BRTransactionFree(tx);
+    stats = BRAllocatorSubsystemStats(BR_ALLOC_TX);
+
+    if (stats.bytes != txStats.bytes || stats.count != txStats.count)
+        r = 0, fprintf(stderr, "***FAILED*** %s: TransactionFree() test\n", __func__);
+
+    return r;
+}
+
+// ProgPoW 0.9.3 reference vectors for epoch 0: https://github.com/chfast/ethash/blob/master/test/unittests/progpow_test_vectors.hpp
+// KAWPOW shares the mix loop but seeds it and computes the final hash differently, so the mix is checked on its own
+int ProgPowTests() {
+    int r = 1;
+    struct { int block; const char *header, *mix; uint64_t nonce; } v[] = {
+        { 0, "0000000000000000000000000000000000000000000000000000000000000000",
+          "f4ac202715ded4136e72887c39e63a4738331c57fd9eb79f6ec421c281aa8743", 0x0000000000000000 },
+        { 49, "63155f732f2bf556967f906155b510c917e48e99685ead76ea83f4eca03ab12b",
+          "8f744dec9140938453c8a502a489861aedec7e98ce7e11b10a3b661940c38786", 0x0000000006ff2c47 },
+        { 50, "9e7248f20914913a73d80a70174c331b1d34f260535ac3631d770e656b5dd922",
+          "bd772e573609acead3b0f27d7935022ea0bf72f22ecf0980f0c21a74cc2fa3ef", 0x00000000076e482e },
+        { 99, "de37e1824c86d35d154cf65a88de6d9286aec4f7f10c3fc9f0fa1bcc2687188d",
+          "18a5d2f1eaa3df5a54f254c3f90bfa8e40c63913664175c93a9e5136f4dc7c5c", 0x000000003917afab }
+    };
+    struct ethash_epoch_context *context = ethash_create_epoch_context(0);
+    struct ethash_dataset_cache_stats stats;
+    union ethash_hash256 header, mix;
+    uint32_t state[25], seed[2];
+    size_t i, j;
+
+    if (! context) return 0;
+
+    for (i = 0; i < sizeof(v)/sizeof(*v); i++) {
+        UInt256Set(header.bytes, u256_hex_decode(v[i].header));
+        memset(state, 0, sizeof(state)); // ProgPoW 0.9.3 seed: keccak-f800 of header and nonce, big-endian top 64 bits
+        for (j = 0; j < 8; j++) state[j] = header.word32s[j];
+        state[8] = (uint32_t)v[i].nonce;
+        state[9] = (uint32_t)(v[i].nonce >> 32);
+        ethash_keccakf800(state);
+        seed[0] = UInt32GetBE(&state[1]);
+        seed[1] = UInt32GetBE(&state[0]);
+        mix = progpow_hash_mix(context, v[i].block / 10, seed);
+
+        if (! UInt256Eq(UInt256Get(mix.bytes), u256_hex_decode(v[i].mix)))
+            r = 0, fprintf(stderr, "***FAILED*** %s: ProgPowHashMix() test %zu\n", __func__, i);
+    }
+
+    // programs are cached per period, hashing four other periods evicts period 0 and it must be rebuilt identically
+    for (j = 0; j < 4; j++) progpow_hash_mix(context, 10 + j, seed);
+    UInt256Set(header.bytes, u256_hex_decode(v[0].header));
+    memset(state, 0, sizeof(state));
+    ethash_keccakf800(state);
+    seed[0] = UInt32GetBE(&state[1]);
+    seed[1] = UInt32GetBE(&state[0]);
+    stats = ethash_dataset_cache_get_stats();
+    mix = progpow_hash_mix(context, 0, seed);
+    if (! UInt256Eq(UInt256Get(mix.bytes), u256_hex_decode(v[0].mix)))
+        r = 0, fprintf(stderr, "***FAILED*** %s: ProgPowHashMix() eviction test 0\n", __func__);
+
+    // the repeated hash reads all its dataset items from the cache
+    if (ethash_dataset_cache_get_stats().hits - stats.hits != ETHASH_NUM_DATASET_ACCESSES)
+        r = 0, fprintf(stderr, "***FAILED*** %s: DatasetCacheStats() test 0\n", __func__);
+
+    ethash_dataset_cache_set_capacity(0);
+    if (ethash_dataset_cache_get_stats().num_items != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: DatasetCacheSetCapacity() test 0\n", __func__);
+
+    ethash_dataset_cache_set_capacity(1024*1024);
+    ethash_dataset_cache_precompute(context, 0, 64, 4);
+    stats = ethash_dataset_cache_get_stats();
+    if (stats.num_items != 64 || progpow_hash_mix(context, 0, seed).word32s[0] != mix.word32s[0])
+        r = 0, fprintf(stderr, "***FAILED*** %s: DatasetCachePrecompute() test 0\n", __func__);
+
+    // a KAWPOW header must only verify with its own mix
+    struct ethash_result result = progpow_hash(context, 1, &header, v[3].nonce);
+    uint8_t final[32];
+
+    light_verify(header, result.mix_hash, v[3].nonce, final);
+    if (memcmp(final, result.final_hash.bytes, sizeof(final)) != 0 ||
+        ! progpow_verify(context, 1, &header, &result.mix_hash, v[3].nonce))
+        r = 0, fprintf(stderr, "***FAILED*** %s: ProgPowVerify() test 0\n", __func__);
+
+    result.mix_hash.bytes[0] ^= 1;
+    if (progpow_verify(context, 1, &header, &result.mix_hash, v[3].nonce))
+        r = 0, fprintf(stderr, "***FAILED*** %s: ProgPowVerify() test 1\n", __func__);
+
+    ethash_destroy_epoch_context(context);
+    return r;
+}
+
 int MerkleBlockTests() {
     int r = 1;
     char block[] = // block 10001 filtered to include only transactions 0, 1, 2, and 6
@@ -1874,7 +2687,7 @@ int MerkleBlockTests() {
     uint8_t block2[sizeof(block) - 1];
     BRMerkleBlock *b;
     
-    b = BRMerkleBlockParse((uint8_t *) block, sizeof(block) - 1);
+    b = BRMerkleBlockParse((uint8_t *) block, sizeof(block) - 1, NULL);
     
     if (! UInt256Eq(b->blockHash,
         UInt256Reverse(u256_hex_decode("00000000000080b66c911bd5ba14a74260057311eaeb1982802f7010f1a9f090"))))
@@ -1919,7 +2732,22 @@ int MerkleBlockTests() {
     // TODO: XXX test MerkleBlockVerifyDifficulty()
     
     // TODO: test (CVE-2012-2459) vulnerability
-    
+
+    // a headers message straddling KAWPOW activation: an 80 byte header, then a 120 byte one, each with a tx count
+    uint8_t headers[80 + 1 + 120 + 1] = { 0 };
+    BRMerkleBlockHeaderView views[2];
+
+    UInt32SetLE(&headers[68], KAWPOW_ActivationTime - 1);
+    UInt32SetLE(&headers[81 + 68], KAWPOW_ActivationTime);
+
+    if (BRMerkleBlockDecodeHeaders(views, 2, headers, sizeof(headers)) != sizeof(headers) ||
+        views[0].offset != 0 || views[0].len != 80 || views[1].offset != 81 || views[1].len != 120 ||
+        views[1].timestamp != KAWPOW_ActivationTime)
+        r = 0, fprintf(stderr, "***FAILED*** %s: MerkleBlockDecodeHeaders() test 0\n", __func__);
+
+    if (BRMerkleBlockDecodeHeaders(views, 2, headers, sizeof(headers) - 1) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: MerkleBlockDecodeHeaders() test 1\n", __func__);
+
     if (b) BRMerkleBlockFree(b);
     return r;
 }
@@ -2103,6 +2931,51 @@ int PaymentProtocolTests() {
     // check for a chain of 3 certificates
     if (i != 3) r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestCert() test 1\n", __func__);
     
+    if (BRPaymentProtocolRequestCertCount(req) != 3)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestCertCount() test 1\n", __func__);
+    
+    uint8_t md1[32], md2[32];
+    
+    // check that the cached digest matches a freshly parsed copy of the same request
+    if (BRPaymentProtocolRequestDigest(req, md1, sizeof(md1)) != sizeof(md1))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestDigest() test 1\n", __func__);
+    
+    BRPaymentProtocolRequest *req2 = BRPaymentProtocolRequestParse(buf3, sizeof(buf3));
+    
+    if (BRPaymentProtocolRequestDigest(req2, md2, sizeof(md2)) != sizeof(md2) || memcmp(md1, md2, sizeof(md1)) != 0 ||
+        BRPaymentProtocolRequestDigest(req, md2, sizeof(md2)) != sizeof(md2) || memcmp(md1, md2, sizeof(md1)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestDigest() test 2\n", __func__);
+    
+    // check that a validation result is shared by requests with the same hash
+    if (! UInt256Eq(BRPaymentProtocolRequestHash(req), BRPaymentProtocolRequestHash(req2)) ||
+        BRPaymentProtocolRequestVerified(req2) != -1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestVerified() test 1\n", __func__);
+    
+    uint64_t expires = req->details->expires;
+    
+    // check that a result isn't used once the request it was recorded for has expired
+    BRPaymentProtocolRequestSetVerified(req, 0);
+    if (BRPaymentProtocolRequestVerified(req2) != -1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestVerified() test 2\n", __func__);
+    
+    req->details->expires = 0; // the hash is taken when the request is parsed, so it doesn't change
+    BRPaymentProtocolRequestSetVerified(req, 0);
+    if (BRPaymentProtocolRequestVerified(req2) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestVerified() test 3\n", __func__);
+    
+    // check that a result recorded shortly before the request expires goes stale when it does
+    req->details->expires = (uint64_t)time(NULL) + 1;
+    BRPaymentProtocolRequestSetVerified(req, 1);
+    if (BRPaymentProtocolRequestVerified(req2) != 1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestVerified() test 4\n", __func__);
+    
+    sleep(2);
+    if (BRPaymentProtocolRequestVerified(req2) != -1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequestVerified() test 5\n", __func__);
+    
+    req->details->expires = expires;
+    if (req2) BRPaymentProtocolRequestFree(req2);
+    
     if (req->details->expires == 0 || req->details->expires >= time(NULL)) // check that request is expired
         r = 0, fprintf(stderr, "***FAILED*** %s: PaymentProtocolRequest->details->expires test 1\n", __func__);
     
@@ -2361,6 +3234,21 @@ int PaymentProtocolEncryptionTests() {
 }
 
 void PeerAcceptMessageTest(BRPeer *peer, const uint8_t *msg, size_t len, const char *type);
+void PeerManagerAddBlockTest(BRPeerManager *manager, uint32_t timestamp, uint32_t nonce);
+int PeerManagerLoadBloomFilterTest(BRPeerManager *manager, BRPeer *peer);
+void PeerManagerRelayedTxTest(BRPeerManager *manager, BRPeer *peer, BRTransaction *tx);
+BRWallet *PeerManagerWalletForTxTest(BRPeerManager *manager, UInt256 txHash);
+void PeerManagerRelayedBlockTest(BRPeerManager *manager, BRPeer *peer, uint32_t timestamp, uint32_t nonce);
+void PeerManagerSyncTest(BRPeerManager *manager, BRPeer *peer, uint32_t estimatedHeight, uint64_t bytesReceived);
+void PeerManagerDisconnectedTest(BRPeerManager *manager, BRPeer *peer, int error);
+
+static void peerTestSyncStarted(void *info) {
+    ((int *) info)[0]++;
+}
+
+static void peerTestSyncStopped(void *info, int error) {
+    ((int *) info)[1] = error;
+}
 
 int PeerTests() {
     int r = 1;
@@ -2368,6 +3256,166 @@ int PeerTests() {
     const char msg[] = "my message";
 
     PeerAcceptMessageTest(p, (const uint8_t *) msg, sizeof(msg) - 1, "inv");
+
+    // nothing went over a socket, accepting a message directly isn't counted
+    if (BRPeerBytesSent(p) != 0 || BRPeerBytesReceived(p) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerBytes() test\n", __func__);
+
+    BRWallet *w = BRWalletNew(NULL, 0, BRBIP44MasterPubKey("", 1, 175, 0, 0));
+    BRPeer peer = { UINT128_ZERO, 8767, SERVICES_NODE_NETWORK, 1, 0, NULL };
+    BRPeerManager *m1, *m2;
+    uint8_t snapshot[0x1000];
+    size_t len;
+
+    peer.address.u32[3] = 1;
+    m1 = BRPeerManagerNew(w, BIP39_CREATION_TIME, NULL, 0, &peer, 1);
+    m2 = BRPeerManagerNew(w, BIP39_CREATION_TIME, NULL, 0, NULL, 0);
+    len = BRPeerManagerSnapshot(m1, snapshot, sizeof(snapshot));
+
+    if (len == 0 || BRPeerManagerSnapshot(m1, snapshot, len - 1) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerSnapshot() test\n", __func__);
+
+    snapshot[len - 1] ^= 1;
+    if (BRPeerManagerRestoreSnapshot(m2, snapshot, len))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerRestoreSnapshot() test 1\n", __func__);
+
+    snapshot[len - 1] ^= 1;
+    if (!BRPeerManagerRestoreSnapshot(m2, snapshot, len))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerRestoreSnapshot() test 2\n", __func__);
+
+    // the default wallet rate is below the TX_FEE_PER_KB minimum that every wallet tx pays
+    if (BRWalletFeePerKb(w) >= TX_FEE_PER_KB || BRPeerManagerFeeFilter(m1) != TX_FEE_PER_KB / 2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerFeeFilter() test 1\n", __func__);
+
+    BRWalletSetFeePerKb(w, TX_FEE_PER_KB*4);
+    if (BRPeerManagerFeeFilter(m1) != TX_FEE_PER_KB*2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerFeeFilter() test 2\n", __func__);
+
+    BRPeerManagerFree(m2);
+
+    // unsaved blocks, the bloom filter and the peers all come back from a snapshot
+    BRWallet *w2 = BRWalletNew(NULL, 0, BRBIP44MasterPubKey("", 1, 175, 1, 0)); // same elements, different digest
+    uint8_t snapshot2[0x1000];
+    size_t len2;
+
+    for (uint32_t i = 0; i < 3; i++) PeerManagerAddBlockTest(m1, 1515015723 + i, i);
+    PeerManagerLoadBloomFilterTest(m1, p);
+    len = BRPeerManagerSnapshot(m1, snapshot, sizeof(snapshot));
+    m2 = BRPeerManagerNew(w, BIP39_CREATION_TIME, NULL, 0, NULL, 0);
+    len2 = (BRPeerManagerRestoreSnapshot(m2, snapshot, len)) ?
+           BRPeerManagerSnapshot(m2, snapshot2, sizeof(snapshot2)) : 0;
+
+    // the same state gives the same snapshot, apart from the snapshot time and checksum
+    if (BRPeerManagerLastBlockHeight(m2) != BRPeerManagerLastBlockHeight(m1) || len2 != len ||
+        memcmp(&snapshot[sizeof(uint32_t)*2], &snapshot2[sizeof(uint32_t)*2], len - sizeof(uint32_t)*3) != 0 ||
+        ! PeerManagerLoadBloomFilterTest(m2, p))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerRestoreSnapshot() test 3\n", __func__);
+
+    BRPeerManagerFree(m2);
+    m2 = BRPeerManagerNew(w2, BIP39_CREATION_TIME, NULL, 0, NULL, 0);
+    len2 = (BRPeerManagerRestoreSnapshot(m2, snapshot, len)) ?
+           BRPeerManagerSnapshot(m2, snapshot2, sizeof(snapshot2)) : 0;
+
+    // the blocks and peers are still used, but a filter built from other wallet elements isn't
+    if (BRPeerManagerLastBlockHeight(m2) != BRPeerManagerLastBlockHeight(m1) || len2 == 0 || len2 >= len ||
+        PeerManagerLoadBloomFilterTest(m2, p))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerRestoreSnapshot() test 4\n", __func__);
+
+    // a relayed tx paying a watched wallet is registered with a copy of its own, the manager's wallet only pools it
+    BRWallet *w3 = BRWalletNew(NULL, 0, BRBIP44MasterPubKey("", 1, 175, 2, 0));
+    UInt256 secret = u256_hex_decode("0000000000000000000000000000000000000000000000000000000000000001"), txHash;
+    BRKey k;
+    BRAddress addr, recvAddr = BRWalletReceiveAddress(w2);
+    BRTransaction *tx;
+    BRSyncPolicy policy = BRPeerManagerSyncPolicy(m1);
+
+    BRKeySetSecret(&k, &secret, 1);
+    BRKeyAddress(&k, addr.s, sizeof(addr));
+
+    uint8_t inScript[BRAddressScriptPubKey(NULL, 0, addr.s)];
+    size_t inScriptLen = BRAddressScriptPubKey(inScript, sizeof(inScript), addr.s);
+    uint8_t outScript[BRAddressScriptPubKey(NULL, 0, recvAddr.s)];
+    size_t outScriptLen = BRAddressScriptPubKey(outScript, sizeof(outScript), recvAddr.s);
+
+    if (! BRPeerManagerAddWallet(m1, w2, BIP39_CREATION_TIME))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerAddWallet() test 1\n", __func__);
+
+    tx = BRTransactionNew(1);
+    BRTransactionAddInput(tx, secret, 0, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, CORBIES, outScript, outScriptLen);
+    BRTransactionSign(tx, &k, 1);
+    txHash = tx->txHash;
+    PeerManagerRelayedTxTest(m1, p, tx);
+
+    if (BRWalletBalance(w2) != CORBIES || BRWalletTransactionForHash(w2, txHash) == NULL ||
+        BRWalletTransactions(w, NULL, 0) != 0 || BRWalletUnconfirmedPoolCount(w) != 1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerRelayedTx() test 1\n", __func__);
+
+    if (PeerManagerWalletForTxTest(m1, txHash) != w2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerWalletForTx() test 1\n", __func__);
+
+    // once removed, the wallet isn't given any more tx
+    BRPeerManagerRemoveWallet(m1, w2);
+    tx = BRTransactionNew(1);
+    BRTransactionAddInput(tx, secret, 1, 1, inScript, inScriptLen, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, CORBIES, outScript, outScriptLen);
+    BRTransactionSign(tx, &k, 1);
+    txHash = tx->txHash;
+    PeerManagerRelayedTxTest(m1, p, tx);
+
+    if (BRWalletBalance(w2) != CORBIES || BRWalletTransactionForHash(w2, txHash) != NULL)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerRelayedTx() test 2\n", __func__);
+
+    if (PeerManagerWalletForTxTest(m1, txHash) != NULL)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerWalletForTx() test 2\n", __func__);
+
+    // at this rate a full size filter holds ~400 elements, room for the manager's own wallet but not another one
+    BRPeerManagerSetSyncPolicy(m1, (BRSyncPolicy) { 1e-150, policy.filterLookahead, 0, 0, 0 });
+    if (BRPeerManagerAddWallet(m1, w3, BIP39_CREATION_TIME))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerAddWallet() test 2\n", __func__);
+
+    BRPeerManagerSetSyncPolicy(m1, policy);
+    if (! BRPeerManagerAddWallet(m1, w3, BIP39_CREATION_TIME))
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerAddWallet() test 3\n", __func__);
+
+    // a sync that uses up its byte budget stops where it got to, and doesn't reconnect when its peers disconnect
+    BRPeerManager *m3;
+    BRPeer *dp = BRPeerNew();
+    int syncState[2] = { 0, 0 }; // syncStarted calls, syncStopped error
+    uint32_t height;
+    uint64_t received;
+
+    m3 = BRPeerManagerNew(w, (uint32_t) time(NULL), NULL, 0, NULL, 0); // headers of blocks before now are kept
+    BRPeerManagerSetCallbacks(m3, syncState, peerTestSyncStarted, peerTestSyncStopped, NULL, NULL, NULL, NULL, NULL);
+    policy.byteBudget = 1000;
+    BRPeerManagerSetSyncPolicy(m3, policy);
+    height = BRPeerManagerLastBlockHeight(m3);
+    PeerManagerSyncTest(m3, dp, height + 10, 999);
+    PeerManagerLoadBloomFilterTest(m3, dp);
+    PeerManagerRelayedBlockTest(m3, dp, 1515015723, 0);
+    BRPeerManagerByteCount(m3, NULL, &received);
+
+    if (BRPeerManagerLastBlockHeight(m3) != height + 1 || received != 999 || syncState[1] != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerSyncPolicy() test 1\n", __func__);
+
+    policy.byteBudget = 999;
+    BRPeerManagerSetSyncPolicy(m3, policy);
+    PeerManagerRelayedBlockTest(m3, dp, 1515015724, 1);
+
+    if (BRPeerManagerLastBlockHeight(m3) != height + 2 || syncState[1] != EDQUOT)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerSyncPolicy() test 2\n", __func__);
+
+    PeerManagerDisconnectedTest(m3, dp, 0);
+    if (syncState[0] != 0 || BRPeerManagerConnectStatus(m3) != BRPeerStatusDisconnected)
+        r = 0, fprintf(stderr, "***FAILED*** %s: PeerManagerSyncPolicy() test 3\n", __func__);
+
+    BRPeerManagerFree(m1);
+    BRPeerManagerFree(m2);
+    BRPeerManagerFree(m3);
+    BRWalletFree(w3);
+    BRWalletFree(w2);
+    BRWalletFree(w);
+    BRPeerFree(p);
     return r;
 }
 
@@ -2551,6 +3599,8 @@ int RunTests() {
 #endif
     printf("AddressTests...                   ");
     printf("%s\n", (AddressTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("Bech32Tests...                    ");
+    printf("%s\n", (Bech32Tests()) ? "success" : (fail++, "***FAIL***"));
     printf("BIP39MnemonicTests...             ");
     printf("%s\n", (BIP39MnemonicTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BIP32SequenceTests...             ");
@@ -2561,8 +3611,20 @@ int RunTests() {
     printf("%s\n", (WalletTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BloomFilterTests...               ");
     printf("%s\n", (BloomFilterTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("ProgPowTests...                   ");
+    printf("%s\n", (ProgPowTests()) ? "success" : (fail++, "***FAIL***"));
     printf("MerkleBlockTests...               ");
     printf("%s\n", (MerkleBlockTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("WriterTests...                    ");
+    printf("%s\n", (WriterTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("WorkQueueTests...                 ");
+    printf("%s\n", (WorkQueueTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("TaskPoolTests...                  ");
+    printf("%s\n", (TaskPoolTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("TaskPoolBench...                  ");
+    printf("%s\n", (TaskPoolBench()) ? "success" : (fail++, "***FAIL***"));
+    printf("AllocatorTests...                 ");
+    printf("%s\n", (AllocatorTests()) ? "success" : (fail++, "***FAIL***"));
     printf("PaymentProtocolTests...           ");
     printf("%s\n", (PaymentProtocolTests()) ? "success" : (fail++, "***FAIL***"));
     printf("PaymentProtocolEncryptionTests... ");
@@ -25,6 +25,7 @@
 
 package com.ravenwallet.core;
 
+import java.nio.ByteBuffer;
 
 public class BRCoreKey extends BRCoreJniReference {
 
@@ -136,6 +137,46 @@ public class BRCoreKey extends BRCoreJniReference {
 
     public native byte[] decryptNative(byte[] data, byte[] nonce);
 
+    /**
+     * Encrypt the remaining bytes of the direct buffer `data` into the direct buffer `out`
+     * without copying through the Java heap.  Both positions advance on success.
+     *
+     * @return the number of bytes written to `out`, or 0 if `out` is too small (which
+     * needs 16 bytes more than `data`) or either buffer is not direct.
+     */
+    public int encrypt (ByteBuffer data, byte[] nonce, ByteBuffer out) {
+        int written = jniEncryptDirect(data, data.position(), data.remaining(),
+                nonce, out, out.position(), out.remaining());
+        if (written > 0) {
+            data.position(data.limit());
+            out.position(out.position() + written);
+        }
+        return written;
+    }
+
+    /**
+     * Decrypt the remaining bytes of the direct buffer `data` into the direct buffer `out`.
+     * Both positions advance on success.
+     *
+     * @return the number of bytes written to `out`, or 0 if authentication fails or
+     * either buffer is not direct.
+     */
+    public int decrypt (ByteBuffer data, byte[] nonce, ByteBuffer out) {
+        int written = jniDecryptDirect(data, data.position(), data.remaining(),
+                nonce, out, out.position(), out.remaining());
+        if (written > 0) {
+            data.position(data.limit());
+            out.position(out.position() + written);
+        }
+        return written;
+    }
+
+    private native int jniEncryptDirect(ByteBuffer data, int dataOffset, int dataLength, byte[] nonce,
+                                        ByteBuffer out, int outOffset, int outLength);
+
+    private native int jniDecryptDirect(ByteBuffer data, int dataOffset, int dataLength, byte[] nonce,
+                                        ByteBuffer out, int outOffset, int outLength);
+
     //
     //
     //
@@ -24,6 +24,8 @@
  */
 package com.ravenwallet.core;
 
+import java.nio.ByteBuffer;
+
 /**
  *
  */
@@ -33,6 +35,14 @@ public class BRCoreMerkleBlock extends BRCoreJniReference {
         this (createJniCoreMerkleBlock (block, blockHeight));
     }
 
+    /**
+     * Parse the remaining bytes of a direct buffer in place, without a copy through the
+     * Java heap.  The buffer's position is advanced past the block.
+     */
+    public BRCoreMerkleBlock(ByteBuffer block, int blockHeight) {
+        this (parseDirect (block, blockHeight));
+    }
+
     protected BRCoreMerkleBlock (long jniReferenceAddress) {
         super (jniReferenceAddress);
     }
@@ -47,6 +57,18 @@ public class BRCoreMerkleBlock extends BRCoreJniReference {
     // Test
     private static native long createJniCoreMerkleBlockEmpty ();
 
+    private static native long createJniCoreMerkleBlockDirect (ByteBuffer block, int offset, int length,
+                                                               int blockHeight, int[] consumed);
+
+    private static long parseDirect (ByteBuffer block, int blockHeight) {
+        int[] consumed = new int[1];
+        long reference = createJniCoreMerkleBlockDirect (block, block.position(), block.remaining(), blockHeight,
+                consumed);
+        if (0 == reference) throw new IllegalArgumentException("invalid merkle block");
+        block.position(block.position() + consumed[0]);
+        return reference;
+    }
+
     public native byte[] getBlockHash ();
 
     public native long getVersion ();
@@ -76,6 +98,21 @@ public class BRCoreMerkleBlock extends BRCoreJniReference {
      */
     public native byte[] serialize ();
 
+    /**
+     * Serialize the block directly into the remaining space of a direct buffer,
+     * advancing its position on success.
+     *
+     * @return the number of bytes written, or 0 if the block does not fit or the
+     * buffer is not direct
+     */
+    public int serialize (ByteBuffer buffer) {
+        int written = jniSerializeDirect (buffer, buffer.position(), buffer.remaining());
+        if (written > 0) buffer.position(buffer.position() + written);
+        return written;
+    }
+
+    private native int jniSerializeDirect (ByteBuffer buffer, int offset, int length);
+
     public native boolean isValid (long currentTime);
 
     /**
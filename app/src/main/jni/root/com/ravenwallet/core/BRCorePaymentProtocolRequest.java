@@ -58,6 +58,16 @@ public class BRCorePaymentProtocolRequest extends BRCoreJniReference {
 
     public native byte[][] getCerts ();
 
+    /**
+     * The result of a prior validation of this request's certificate chain and signature, shared by
+     * every request parsed from the same bytes.
+     *
+     * @return 1 if valid, 0 if invalid, -1 if not yet validated
+     */
+    public native int getVerified ();
+
+    public native void setVerified (boolean verified);
+
     private static native long createPaymentProtocolRequest(byte[] data);
 
     public native byte[] serialize ();
@@ -55,6 +55,10 @@ public class BRCorePeerManager extends BRCoreJniReference {
 
         // Called on publishTransaction
         void txPublished(String error);
+
+        // Called with a new getSnapshot() once sync completes, every few minutes after that, and on
+        // disconnect; store it in place of the last one and hand it to restoreSnapshot() on launch
+        void saveSnapshot(byte[] snapshot);
     }
 
     //
@@ -180,6 +184,44 @@ public class BRCorePeerManager extends BRCoreJniReference {
      */
     public native String getDownloadPeerName();
 
+    /**
+     * Use a sync that spends less data, for metered connections: a tighter bloom filter, mempool
+     * from the download peer only and no peer address requests.
+     *
+     * @param metered
+     * @param byteBudget stop syncing once this many bytes were used in the session, 0 for no cap
+     */
+    public native void setMeteredSync(boolean metered, long byteBudget);
+
+    /**
+     * @return bytes sent to peers since the last resetSessionBytes()
+     */
+    public native long getSessionBytesSent();
+
+    /**
+     * @return bytes received from peers since the last resetSessionBytes()
+     */
+    public native long getSessionBytesReceived();
+
+    public native void resetSessionBytes();
+
+    /**
+     * The state needed to resume syncing where this session left off: main chain blocks not yet
+     * passed to saveBlocks(), the bloom filter, the best peers, known and pending transactions.
+     * Store it on pause or disconnect and hand it to restoreSnapshot() on the next launch.
+     *
+     * @return the serialized snapshot, or null if there wasn't memory for it
+     */
+    public native byte[] getSnapshot();
+
+    /**
+     * Resume from a getSnapshot() of a previous session.  Call before connect().
+     *
+     * @param snapshot
+     * @return false if the snapshot was corrupt or for another chain, and was not used
+     */
+    public native boolean restoreSnapshot(byte[] snapshot);
+
     /**
      * @param transaction
      */
@@ -24,6 +24,8 @@
  */
 package com.ravenwallet.core;
 
+import java.nio.ByteBuffer;
+
 /**
  *
  */
@@ -48,6 +50,14 @@ public class BRCoreTransaction extends BRCoreJniReference {
         // ...
     }
 
+    /**
+     * Parse the remaining bytes of a direct buffer in place, without a copy through the
+     * Java heap.  The buffer's position is advanced past the transaction.
+     */
+    public BRCoreTransaction (ByteBuffer buffer, long blockHeight, long timeStamp) throws FailedToParse {
+        this (parseDirect (buffer, blockHeight, timeStamp));
+    }
+
     public BRCoreTransaction () {
         this (createJniCoreTransactionEmpty(1));
     }
@@ -152,6 +162,26 @@ public class BRCoreTransaction extends BRCoreJniReference {
      */
     public native byte[] serialize ();
 
+    /**
+     * The number of bytes that serialize() will produce.
+     */
+    public native int getSerializedSize ();
+
+    /**
+     * Serialize the transaction directly into the remaining space of a direct buffer,
+     * advancing its position on success.
+     *
+     * @return the number of bytes written, or 0 if the buffer has less than
+     * getSerializedSize() bytes remaining or is not direct
+     */
+    public int serialize (ByteBuffer buffer) {
+        int written = jniSerializeDirect (buffer, buffer.position(), buffer.remaining());
+        if (written > 0) buffer.position(buffer.position() + written);
+        return written;
+    }
+
+    private native int jniSerializeDirect (ByteBuffer buffer, int offset, int length);
+
     /**
      *
      * @param input
@@ -239,6 +269,18 @@ public class BRCoreTransaction extends BRCoreJniReference {
 
     private static native long createJniCoreTransactionEmpty (int count);
 
+    private static native long createJniCoreTransactionDirect (ByteBuffer buffer, int offset, int length,
+                                                               long blockHeight, long timeStamp, int[] consumed);
+
+    private static long parseDirect (ByteBuffer buffer, long blockHeight, long timeStamp) throws FailedToParse {
+        int[] consumed = new int[1];
+        long reference = createJniCoreTransactionDirect (buffer, buffer.position(), buffer.remaining(),
+                blockHeight, timeStamp, consumed);
+        if (0 == reference) throw new FailedToParse();
+        buffer.position(buffer.position() + consumed[0]);
+        return reference;
+    }
+
     public static class FailedToParse extends Exception {}
 
 }
\ No newline at end of file
@@ -54,6 +54,21 @@ public class BRCoreWallet extends BRCoreJniReference {
         void onTxDeleted(String hash, int notifyUser, final int recommendRescan);
     }
 
+    /**
+     * Receives the result of an *Async operation, on a native worker thread, or on the thread
+     * that called cancelOperation() if the operation was cancelled before it started.
+     */
+    public interface OperationListener {
+        /**
+         * @param operationId the id passed to the *Async call
+         * @param result a Boolean for signTransactionAsync, a BRCoreKey for the key derivations,
+         *               and a BRCoreTransaction, or null if one couldn't be made, for the others;
+         *               null when cancelled
+         * @param cancelled true if cancelOperation() was called before the result was delivered
+         */
+        void onOperationComplete(long operationId, Object result, boolean cancelled);
+    }
+
     //
     // Hold a weak reference to the listener.  It is a weak reference because it is likely to
     // be self-referential which would prevent GC of this Wallet.  This listener is used
@@ -70,7 +85,39 @@ public class BRCoreWallet extends BRCoreJniReference {
     public BRCoreWallet(BRCoreTransaction[] transactions,
                         BRCoreMasterPubKey masterPubKey,
                         Listener listener) {
-        super(createJniCoreWallet(transactions, masterPubKey));
+        this(createJniCoreWallet(transactions, masterPubKey), transactions, listener);
+    }
+
+    //
+    // Takes the wallet addresses from an `addressCache` saved with getAddressCache() rather than
+    // deriving each one from `masterPubKey`.  A cache that doesn't authenticate for
+    // `masterPubKey` is ignored.
+    //
+    public BRCoreWallet(BRCoreTransaction[] transactions,
+                        BRCoreMasterPubKey masterPubKey,
+                        byte[] addressCache,
+                        Listener listener) {
+        this(createJniCoreWalletWithAddressCache(transactions, masterPubKey, addressCache),
+                transactions, listener);
+    }
+
+    //
+    // Loads the wallet transactions from the native transaction store at `txStorePath`, created
+    // if it doesn't exist, in one call instead of from BRCoreTransaction objects.  The wallet
+    // keeps the store up to date as transactions are added, updated and removed.
+    //
+    public BRCoreWallet(String txStorePath,
+                        BRCoreMasterPubKey masterPubKey,
+                        byte[] addressCache,
+                        Listener listener) {
+        this(createJniCoreWalletFromTxStore(txStorePath, masterPubKey, addressCache),
+                new BRCoreTransaction[0], listener);
+    }
+
+    private BRCoreWallet(long jniReferenceAddress,
+                         BRCoreTransaction[] transactions,
+                         Listener listener) {
+        super(jniReferenceAddress);
         assert (null != listener);
         this.listener = new WeakReference<>(listener);
 
@@ -84,6 +131,14 @@ public class BRCoreWallet extends BRCoreJniReference {
     protected static native long createJniCoreWallet(BRCoreTransaction[] transactions,
                                                      BRCoreMasterPubKey masterPubKey);
 
+    protected static native long createJniCoreWalletWithAddressCache(BRCoreTransaction[] transactions,
+                                                                     BRCoreMasterPubKey masterPubKey,
+                                                                     byte[] addressCache);
+
+    protected static native long createJniCoreWalletFromTxStore(String txStorePath,
+                                                                BRCoreMasterPubKey masterPubKey,
+                                                                byte[] addressCache);
+
     protected native void installListener(Listener listener);
 
     // returns the first unused external address
@@ -102,6 +157,11 @@ public class BRCoreWallet extends BRCoreJniReference {
     // int BRWalletAddressIsUsed(BRWallet *wallet, const char *addr);
     public native boolean addressIsUsed(BRCoreAddress address);
 
+    // authenticated cache of the derived wallet addresses, to pass back to the constructor on
+    // the next start so they needn't be derived again
+    // size_t BRWalletAddressCache(BRWallet *wallet, uint8_t *cache, size_t cacheLen);
+    public native byte[] getAddressCache();
+
     // TODO: Holding these transactions when the wallet is GCed.... boom!?
     public BRCoreTransaction[] getTransactions() {
         BRCoreTransaction[] transactions = jniGetTransactions();
@@ -125,6 +185,32 @@ public class BRCoreWallet extends BRCoreJniReference {
 
     public native BRCoreTransaction[] getTransactionsConfirmedBefore(long blockHeight);
 
+    // size of each record returned by queryTransactions(): txHash (32), blockHeight (4),
+    // timestamp (4), received (8), sent (8), fee (8) and assetAmount (8), little endian
+    public static final int TRANSACTION_RECORD_SIZE = 72;
+
+    /**
+     * Query the wallet history without marshalling every transaction.  Records come newest
+     * first; pass the last record of a page as `afterRecord` for the next page, or null for the
+     * first.  An address or asset query costs O(results) from native indexes.
+     *
+     * @param address tx with an input or output to this address, or null for any
+     * @param assetName tx carrying this asset, or null for any
+     * @param fromHeight inclusive, 0 for any
+     * @param toHeight inclusive, Integer.MAX_VALUE includes unconfirmed tx
+     * @param fromTime inclusive, 0 for any
+     * @param toTime inclusive, 0xFFFFFFFFL for any
+     * @param afterRecord the last record of the previous page, or null
+     * @param limit most records to return, fewer means the history is exhausted
+     * @return packed records of TRANSACTION_RECORD_SIZE bytes each
+     */
+    // size_t BRWalletQueryTransactions(BRWallet *wallet, const BRTxQuery *query, BRTxCursor *cursor,
+    //                                  BRTxRecord records[], size_t limit);
+    public native byte[] queryTransactions(String address, String assetName,
+                                           long fromHeight, long toHeight,
+                                           long fromTime, long toTime,
+                                           byte[] afterRecord, int limit);
+
     public native long getBalance();
 
     public native long getTotalSent();
@@ -185,6 +271,15 @@ public class BRCoreWallet extends BRCoreJniReference {
                                                                  BRCoreTransactionAsset asset,
                                                                  BRCoreTransactionAsset rootAsset);
 
+    /**
+     * Issue several unique assets under rootAsset in one transaction, sharing the burn, fee and
+     * ownership token transfer.  Returns null if funds are insufficient or the batch is too large
+     * for one transaction, in which case issue it in smaller batches.
+     */
+    public native BRCoreTransaction createUniqueAssetsTransaction(BRCoreAddress brAddress,
+                                                                  BRCoreTransactionAsset[] assets,
+                                                                  BRCoreTransactionAsset rootAsset);
+
     public native BRCoreTransaction burnAsset(BRCoreTransactionAsset asset);
 
     public native BRCoreTransaction[] decomposeTransaction(BRCoreTransaction tx);
@@ -214,6 +309,46 @@ public class BRCoreWallet extends BRCoreJniReference {
      */
     public native boolean signTransaction(BRCoreTransaction transaction, int forkId, byte[] phrase);
 
+    //
+    // Asynchronous variants: each queues the operation on a native worker pool under an id from
+    // newOperationId(), and later calls listener.onOperationComplete() with that id.  The
+    // listener may run before the *Async call returns, so record the id before making the call.
+    // The arguments are kept alive until then; `transaction` must not be used until it is signed.
+    //
+
+    /**
+     * @return a new id for exactly one *Async call
+     */
+    public static native long newOperationId();
+
+    public native void signTransactionAsync(long operationId, BRCoreTransaction transaction, int forkId,
+                                            byte[] phrase, OperationListener listener);
+
+    public native void generatePrivateKeyBip44Async(long operationId, byte[] phrase, int index, int chain,
+                                                    OperationListener listener);
+
+    public native void generatePrivateKeyBip32Async(long operationId, byte[] phrase, int index, int chain,
+                                                    OperationListener listener);
+
+    public native void createTransactionAsync(long operationId, long amount, BRCoreAddress address,
+                                              OperationListener listener);
+
+    public native void createAssetTransactionAsync(long operationId, long amount, BRCoreAddress address,
+                                                   BRCoreTransactionAsset asset,
+                                                   OperationListener listener);
+
+    public native void transferAssetAsync(long operationId, double amount, String address,
+                                          BRCoreTransactionAsset asset,
+                                          OperationListener listener);
+
+    /**
+     * Cancel an *Async operation.  One not yet started is dropped; a running one finishes but
+     * its result is discarded.  Either way its listener is called with `cancelled` true.
+     *
+     * @return false if the operation had already completed, or its *Async call wasn't made yet
+     */
+    public static native boolean cancelOperation(long operationId);
+
     public native boolean containsTransaction(BRCoreTransaction transaction);
 
     public boolean registerTransaction(BRCoreTransaction transaction) {
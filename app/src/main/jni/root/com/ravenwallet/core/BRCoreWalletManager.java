@@ -264,6 +264,12 @@ public class BRCoreWalletManager implements
         showTxDetail("txPublished");
     }
 
+    @Override
+    public void saveSnapshot(byte[] snapshot) {
+        if (!SHOW_CALLBACK) return;
+        System.out.println(getChainDescriptiveName() + String.format(": saveSnapshot: %d", snapshot.length));
+    }
+
     //
     // BRCoreWallet.Listener
     //
@@ -404,6 +410,14 @@ public class BRCoreWalletManager implements
                 ex.printStackTrace(System.err);
             }
         }
+
+        @Override
+        public void saveSnapshot(byte[] snapshot) {
+            try { listener.saveSnapshot(snapshot); }
+            catch (Exception ex) {
+                ex.printStackTrace(System.err);
+            }
+        }
     }
 
     // ============================================================================================
@@ -488,6 +502,16 @@ public class BRCoreWalletManager implements
                 }
             });
         }
+
+        @Override
+        public void saveSnapshot(final byte[] snapshot) {
+            executor.execute(new Runnable() {
+                @Override
+                public void run() {
+                    listener.saveSnapshot(snapshot);
+                }
+            });
+        }
     }
 
     // ============================================================================================
@@ -956,6 +956,11 @@ public class BRWalletManager extends BRCoreWalletManager {
                 System.out.println(String.format("            txPublished: %s", error));
 
             }
+
+            @Override
+            public void saveSnapshot(byte[] snapshot) {
+                System.out.println(String.format("            saveSnapshot: %d", snapshot.length));
+            }
         };
     }
 